@@ -0,0 +1,207 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/framed_socket.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace hintless_pir {
+namespace benchmarks {
+namespace {
+
+absl::Status ErrnoError(absl::string_view what) {
+  return absl::InternalError(absl::StrCat(what, ": ", std::strerror(errno)));
+}
+
+absl::StatusOr<sockaddr_un> UnixAddress(absl::string_view path) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid Unix socket path \"", path, "\"."));
+  }
+  std::memcpy(address.sun_path, path.data(), path.size());
+  return address;
+}
+
+// Writes all `size` bytes at `data`.
+absl::Status WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ErrnoError("send");
+    }
+    data += n;
+    size -= n;
+  }
+  return absl::OkStatus();
+}
+
+// Reads exactly `size` bytes into `data`. Returns the number of bytes read
+// before the peer closed the connection, which is less than `size` only at
+// end of stream.
+absl::StatusOr<size_t> ReadAll(int fd, char* data, size_t size) {
+  size_t total = 0;
+  while (total < size) {
+    ssize_t n = recv(fd, data + total, size - total, 0);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ErrnoError("recv");
+    }
+    if (n == 0) {
+      break;
+    }
+    total += n;
+  }
+  return total;
+}
+
+}  // namespace
+
+Socket::~Socket() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+Socket& Socket::operator=(Socket&& other) {
+  if (this != &other) {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    fd_ = other.fd_;
+    other.fd_ = -1;
+  }
+  return *this;
+}
+
+void Socket::Shutdown() {
+  if (fd_ >= 0) {
+    shutdown(fd_, SHUT_RDWR);
+  }
+}
+
+absl::StatusOr<Socket> ListenUnixSocket(absl::string_view path, int backlog) {
+  absl::StatusOr<sockaddr_un> address = UnixAddress(path);
+  if (!address.ok()) {
+    return address.status();
+  }
+  Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (!socket.is_valid()) {
+    return ErrnoError("socket");
+  }
+  unlink(address->sun_path);
+  if (bind(socket.fd(), reinterpret_cast<const sockaddr*>(&*address),
+           sizeof(*address)) < 0) {
+    return ErrnoError(absl::StrCat("bind ", path));
+  }
+  if (listen(socket.fd(), backlog) < 0) {
+    return ErrnoError("listen");
+  }
+  return socket;
+}
+
+absl::StatusOr<Socket> AcceptConnection(const Socket& listener) {
+  while (true) {
+    int fd = accept(listener.fd(), nullptr, nullptr);
+    if (fd >= 0) {
+      return Socket(fd);
+    }
+    if (errno != EINTR) {
+      return ErrnoError("accept");
+    }
+  }
+}
+
+absl::StatusOr<Socket> ConnectUnixSocket(absl::string_view path) {
+  absl::StatusOr<sockaddr_un> address = UnixAddress(path);
+  if (!address.ok()) {
+    return address.status();
+  }
+  Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+  if (!socket.is_valid()) {
+    return ErrnoError("socket");
+  }
+  if (connect(socket.fd(), reinterpret_cast<const sockaddr*>(&*address),
+              sizeof(*address)) < 0) {
+    return ErrnoError(absl::StrCat("connect ", path));
+  }
+  return socket;
+}
+
+absl::Status WriteFrame(const Socket& socket, absl::string_view payload) {
+  if (payload.size() > kMaxFrameBytes) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Frame of ", payload.size(), " bytes is too large."));
+  }
+  uint32_t size = payload.size();
+  char header[4] = {static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+                    static_cast<char>(size >> 8), static_cast<char>(size)};
+  absl::Status status = WriteAll(socket.fd(), header, sizeof(header));
+  if (!status.ok()) {
+    return status;
+  }
+  return WriteAll(socket.fd(), payload.data(), payload.size());
+}
+
+absl::StatusOr<std::string> ReadFrame(const Socket& socket) {
+  unsigned char header[4];
+  absl::StatusOr<size_t> num_read =
+      ReadAll(socket.fd(), reinterpret_cast<char*>(header), sizeof(header));
+  if (!num_read.ok()) {
+    return num_read.status();
+  }
+  if (*num_read == 0) {
+    return absl::OutOfRangeError("Connection closed.");
+  }
+  if (*num_read < sizeof(header)) {
+    return absl::DataLossError("Connection closed within a frame header.");
+  }
+  uint32_t size = (uint32_t{header[0]} << 24) | (uint32_t{header[1]} << 16) |
+                  (uint32_t{header[2]} << 8) | uint32_t{header[3]};
+  if (size > kMaxFrameBytes) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Frame of ", size, " bytes is too large."));
+  }
+  std::string payload(size, '\0');
+  num_read = ReadAll(socket.fd(), payload.data(), size);
+  if (!num_read.ok()) {
+    return num_read.status();
+  }
+  if (*num_read < size) {
+    return absl::DataLossError("Connection closed within a frame.");
+  }
+  return payload;
+}
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_BENCHMARKS_FRAMED_SOCKET_H_
+#define HINTLESS_PIR_BENCHMARKS_FRAMED_SOCKET_H_
+
+// Length-prefixed message frames over Unix domain stream sockets. Each frame
+// is a 4-byte big-endian payload length followed by the payload.
+
+#include <cstdint>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+
+namespace hintless_pir {
+namespace benchmarks {
+
+// Frames larger than this are rejected, to bound the memory of a reader.
+inline constexpr uint32_t kMaxFrameBytes = 1u << 30;
+
+// An owned socket file descriptor, closed on destruction.
+class Socket {
+ public:
+  explicit Socket(int fd = -1) : fd_(fd) {}
+  ~Socket();
+
+  Socket(Socket&& other) : fd_(other.fd_) { other.fd_ = -1; }
+  Socket& operator=(Socket&& other);
+  Socket(const Socket&) = delete;
+  Socket& operator=(const Socket&) = delete;
+
+  int fd() const { return fd_; }
+  bool is_valid() const { return fd_ >= 0; }
+
+  // Shuts down both directions, unblocking pending reads of other threads.
+  void Shutdown();
+
+ private:
+  int fd_;
+};
+
+// Creates a listening socket bound to `path`, replacing any existing socket
+// file at that path.
+absl::StatusOr<Socket> ListenUnixSocket(absl::string_view path,
+                                        int backlog = 128);
+
+// Accepts a connection on `listener`.
+absl::StatusOr<Socket> AcceptConnection(const Socket& listener);
+
+// Connects to the listening socket at `path`.
+absl::StatusOr<Socket> ConnectUnixSocket(absl::string_view path);
+
+// Writes `payload` as one frame.
+absl::Status WriteFrame(const Socket& socket, absl::string_view payload);
+
+// Reads one frame and returns its payload. Returns an OutOfRange error if the
+// peer closed the connection before the start of a frame.
+absl::StatusOr<std::string> ReadFrame(const Socket& socket);
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_BENCHMARKS_FRAMED_SOCKET_H_
@@ -0,0 +1,133 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/load_stats.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace hintless_pir {
+namespace benchmarks {
+namespace {
+
+// Returns the value in bytes of a "<key>: <value> kB" line in
+// /proc/self/status, or 0 if not found.
+int64_t ReadProcStatusBytes(absl::string_view key) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (!absl::StartsWith(line, key)) {
+      continue;
+    }
+    std::vector<absl::string_view> fields =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    int64_t kilobytes;
+    if (fields.size() >= 2 && absl::SimpleAtoi(fields[1], &kilobytes)) {
+      return kilobytes * 1024;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+void LatencyRecorder::Add(absl::Duration latency) {
+  absl::MutexLock lock(&mutex_);
+  latencies_.push_back(latency);
+  sorted_ = false;
+}
+
+int64_t LatencyRecorder::Count() const {
+  absl::MutexLock lock(&mutex_);
+  return latencies_.size();
+}
+
+absl::Duration LatencyRecorder::Quantile(double q) const {
+  absl::MutexLock lock(&mutex_);
+  if (latencies_.empty()) {
+    return absl::ZeroDuration();
+  }
+  if (!sorted_) {
+    std::sort(latencies_.begin(), latencies_.end());
+    sorted_ = true;
+  }
+  // Nearest-rank quantile.
+  int64_t rank = static_cast<int64_t>(std::ceil(q * latencies_.size()));
+  rank = std::clamp<int64_t>(rank, 1, latencies_.size());
+  return latencies_[rank - 1];
+}
+
+absl::Duration LatencyRecorder::Mean() const {
+  absl::MutexLock lock(&mutex_);
+  if (latencies_.empty()) {
+    return absl::ZeroDuration();
+  }
+  absl::Duration total;
+  for (absl::Duration latency : latencies_) {
+    total += latency;
+  }
+  return total / latencies_.size();
+}
+
+ProcessUsage GetProcessUsage() {
+  ProcessUsage usage{
+      .cpu_time = absl::ZeroDuration(), .rss_bytes = 0, .peak_rss_bytes = 0};
+  rusage self;
+  if (getrusage(RUSAGE_SELF, &self) == 0) {
+    usage.cpu_time = absl::DurationFromTimeval(self.ru_utime) +
+                     absl::DurationFromTimeval(self.ru_stime);
+    // ru_maxrss is in kilobytes on Linux.
+    usage.peak_rss_bytes = static_cast<int64_t>(self.ru_maxrss) * 1024;
+  }
+  usage.rss_bytes = ReadProcStatusBytes("VmRSS:");
+  // VmHWM honours ResetPeakRss(), unlike ru_maxrss.
+  int64_t peak_rss_bytes = ReadProcStatusBytes("VmHWM:");
+  if (peak_rss_bytes > 0) {
+    usage.peak_rss_bytes = peak_rss_bytes;
+  }
+  return usage;
+}
+
+bool ResetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (!clear_refs) {
+    return false;
+  }
+  clear_refs << "5";
+  return static_cast<bool>(clear_refs.flush());
+}
+
+std::string LatencySummary(const LatencyRecorder& latencies) {
+  return absl::StrCat("p50=", absl::FormatDuration(latencies.Quantile(0.5)),
+                      " p99=", absl::FormatDuration(latencies.Quantile(0.99)),
+                      " p99.9=",
+                      absl::FormatDuration(latencies.Quantile(0.999)));
+}
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_BENCHMARKS_LOAD_STATS_H_
+#define HINTLESS_PIR_BENCHMARKS_LOAD_STATS_H_
+
+// Statistics collected by load benchmarks: request latencies and the resource
+// usage of the process.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace hintless_pir {
+namespace benchmarks {
+
+// Collects request latencies from multiple threads.
+class LatencyRecorder {
+ public:
+  LatencyRecorder() = default;
+
+  // Records the latency of one request. Thread-safe.
+  void Add(absl::Duration latency) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of recorded requests.
+  int64_t Count() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the `q`-quantile of the recorded latencies, for q in [0, 1], or
+  // zero if nothing has been recorded.
+  absl::Duration Quantile(double q) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the mean of the recorded latencies.
+  absl::Duration Mean() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  mutable std::vector<absl::Duration> latencies_ ABSL_GUARDED_BY(mutex_);
+  mutable bool sorted_ ABSL_GUARDED_BY(mutex_) = true;
+};
+
+// Resource usage of the current process.
+struct ProcessUsage {
+  // Total user and system CPU time consumed by all threads.
+  absl::Duration cpu_time;
+  // Current and peak resident set size in bytes, or 0 if unavailable.
+  int64_t rss_bytes;
+  int64_t peak_rss_bytes;
+};
+
+// Returns the resource usage of the current process.
+ProcessUsage GetProcessUsage();
+
+// Resets the peak resident set size reported by GetProcessUsage() to the
+// current resident set size, where supported by the OS (Linux >= 4.0).
+// Returns false if the peak could not be reset.
+bool ResetPeakRss();
+
+// Returns a one-line summary of the latency distribution, e.g.
+// "p50=1.2ms p99=3.4ms p99.9=5.6ms".
+std::string LatencySummary(const LatencyRecorder& latencies);
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_BENCHMARKS_LOAD_STATS_H_
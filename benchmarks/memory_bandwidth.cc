@@ -0,0 +1,99 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/memory_bandwidth.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+
+namespace hintless_pir {
+namespace benchmarks {
+namespace {
+
+// Runs `fn(begin, end)` on `num_threads` threads over an even split of
+// [0, num_elements), and returns the elapsed wall time in seconds.
+template <typename Fn>
+double TimeParallel(int64_t num_elements, int num_threads, Fn fn) {
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  int64_t chunk = (num_elements + num_threads - 1) / num_threads;
+  absl::Time start = absl::Now();
+  for (int t = 0; t < num_threads; ++t) {
+    int64_t begin = std::min(num_elements, t * chunk);
+    int64_t end = std::min(num_elements, begin + chunk);
+    threads.emplace_back(fn, begin, end);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return absl::ToDoubleSeconds(absl::Now() - start);
+}
+
+}  // namespace
+
+double MeasureReadBandwidth(int64_t num_bytes, int num_threads,
+                            int num_repetitions) {
+  int64_t num_elements = num_bytes / sizeof(uint64_t);
+  std::vector<uint64_t> buffer(num_elements, 1);
+  auto read = [&buffer](int64_t begin, int64_t end) {
+    // Independent accumulators so that the loop is not latency bound.
+    uint64_t sums[4] = {0, 0, 0, 0};
+    int64_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+      sums[0] += buffer[i];
+      sums[1] += buffer[i + 1];
+      sums[2] += buffer[i + 2];
+      sums[3] += buffer[i + 3];
+    }
+    for (; i < end; ++i) {
+      sums[0] += buffer[i];
+    }
+    benchmark::DoNotOptimize(sums);
+  };
+  double best = 0;
+  for (int i = 0; i < num_repetitions; ++i) {
+    double seconds = TimeParallel(num_elements, num_threads, read);
+    best = std::max(best, num_elements * sizeof(uint64_t) / seconds);
+  }
+  return best;
+}
+
+double MeasureTriadBandwidth(int64_t num_bytes, int num_threads,
+                             int num_repetitions) {
+  int64_t num_elements = num_bytes / (3 * sizeof(double));
+  std::vector<double> a(num_elements, 0), b(num_elements, 1),
+      c(num_elements, 2);
+  constexpr double kScalar = 3.0;
+  auto triad = [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      a[i] = b[i] + kScalar * c[i];
+    }
+    benchmark::ClobberMemory();
+  };
+  double best = 0;
+  for (int i = 0; i < num_repetitions; ++i) {
+    double seconds = TimeParallel(num_elements, num_threads, triad);
+    best = std::max(best, 3 * num_elements * sizeof(double) / seconds);
+  }
+  return best;
+}
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_BENCHMARKS_MEMORY_BANDWIDTH_H_
+#define HINTLESS_PIR_BENCHMARKS_MEMORY_BANDWIDTH_H_
+
+// STREAM-like measurements of the sustainable memory bandwidth of the host,
+// used as the bandwidth ceiling of roofline benchmarks.
+
+#include <cstdint>
+
+namespace hintless_pir {
+namespace benchmarks {
+
+// Returns the best read bandwidth, in bytes per second, observed over
+// `num_repetitions` passes in which `num_threads` threads each sum their share
+// of a `num_bytes` buffer. The buffer should be several times larger than the
+// last-level cache to measure DRAM bandwidth.
+double MeasureReadBandwidth(int64_t num_bytes, int num_threads,
+                            int num_repetitions = 5);
+
+// Same as above but for the STREAM "triad" kernel a[i] = b[i] + s * c[i] over
+// three arrays of `num_bytes / 3` bytes each, counting both reads and writes.
+double MeasureTriadBandwidth(int64_t num_bytes, int num_threads,
+                             int num_repetitions = 5);
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_BENCHMARKS_MEMORY_BANDWIDTH_H_
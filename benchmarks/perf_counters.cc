@@ -0,0 +1,217 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/perf_counters.h"
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+ABSL_FLAG(bool, perf_counters, false,
+          "Report hardware performance counters (cycles, instructions, cache "
+          "and TLB misses) per benchmark iteration, where supported.");
+
+namespace hintless_pir {
+namespace benchmarks {
+namespace {
+
+constexpr char kCycles[] = "cycles";
+constexpr char kInstructions[] = "instructions";
+constexpr char kLlcMisses[] = "LLC-misses";
+constexpr char kDtlbMisses[] = "dTLB-misses";
+
+#ifdef __linux__
+
+struct EventSpec {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr uint64_t CacheEventConfig(uint64_t cache, uint64_t op,
+                                    uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+constexpr EventSpec kEventSpecs[] = {
+    {kCycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {kInstructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {kLlcMisses, PERF_TYPE_HW_CACHE,
+     CacheEventConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                      PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {kDtlbMisses, PERF_TYPE_HW_CACHE,
+     CacheEventConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                      PERF_COUNT_HW_CACHE_RESULT_MISS)},
+};
+
+// Opens a counter for `spec` on the calling thread, including threads created
+// later. Returns -1 if the event is not supported.
+int OpenEvent(const EventSpec& spec) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = spec.type;
+  attr.config = spec.config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, /*pid=*/0,
+                                  /*cpu=*/-1, /*group_fd=*/-1, /*flags=*/0));
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<PerfCounters>> PerfCounters::Create() {
+  std::vector<Event> events;
+#ifdef __linux__
+  for (const EventSpec& spec : kEventSpecs) {
+    int fd = OpenEvent(spec);
+    if (fd >= 0) {
+      events.push_back(Event{.name = spec.name, .fd = fd});
+    }
+  }
+#endif
+  if (events.empty()) {
+    return absl::UnavailableError(
+        "No hardware performance counters are available on this host.");
+  }
+  return absl::WrapUnique(new PerfCounters(std::move(events)));
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (const Event& event : events_) {
+    close(event.fd);
+  }
+#endif
+}
+
+absl::Status PerfCounters::Start() {
+#ifdef __linux__
+  for (const Event& event : events_) {
+    if (ioctl(event.fd, PERF_EVENT_IOC_RESET, 0) != 0 ||
+        ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0) != 0) {
+      return absl::InternalError(
+          absl::StrCat("Failed to enable counter ", event.name));
+    }
+  }
+#endif
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<PerfCounters::Reading>> PerfCounters::Stop() {
+  std::vector<Reading> readings;
+#ifdef __linux__
+  for (const Event& event : events_) {
+    if (ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0) != 0) {
+      return absl::InternalError(
+          absl::StrCat("Failed to disable counter ", event.name));
+    }
+  }
+  for (const Event& event : events_) {
+    // Layout given by PERF_FORMAT_TOTAL_TIME_ENABLED | _RUNNING.
+    uint64_t buffer[3];
+    if (read(event.fd, buffer, sizeof(buffer)) != sizeof(buffer)) {
+      return absl::InternalError(
+          absl::StrCat("Failed to read counter ", event.name));
+    }
+    uint64_t value = buffer[0], time_enabled = buffer[1],
+             time_running = buffer[2];
+    if (time_running == 0) {
+      // The event never got scheduled; there is nothing to report.
+      continue;
+    }
+    double scale = static_cast<double>(time_enabled) / time_running;
+    readings.push_back(Reading{.name = event.name, .value = value * scale});
+  }
+#endif
+  return readings;
+}
+
+void ReportPerfCounters(const std::vector<PerfCounters::Reading>& readings,
+                        benchmark::State& state) {
+  double cycles = 0, instructions = 0;
+  for (const PerfCounters::Reading& reading : readings) {
+    state.counters[reading.name] =
+        benchmark::Counter(reading.value, benchmark::Counter::kAvgIterations);
+    if (reading.name == kCycles) {
+      cycles = reading.value;
+    } else if (reading.name == kInstructions) {
+      instructions = reading.value;
+    } else if (reading.name == kLlcMisses) {
+      // Every last-level miss brings in one cache line from memory.
+      state.counters["mem_bw"] = benchmark::Counter(
+          reading.value * kCacheLineBytes, benchmark::Counter::kIsRate,
+          benchmark::Counter::kIs1024);
+    }
+  }
+  if (cycles > 0 && instructions > 0) {
+    state.counters["IPC"] = instructions / cycles;
+  }
+}
+
+ScopedPerfCounters::ScopedPerfCounters(benchmark::State& state)
+    : state_(state) {
+  if (!absl::GetFlag(FLAGS_perf_counters)) {
+    return;
+  }
+  auto counters = PerfCounters::Create();
+  if (!counters.ok()) {
+    // Only complain once, not for every benchmark run.
+    static bool warned = false;
+    if (!warned) {
+      std::cerr << "--perf_counters ignored: " << counters.status() << "\n";
+      warned = true;
+    }
+    return;
+  }
+  if (!(*counters)->Start().ok()) {
+    return;
+  }
+  counters_ = std::move(*counters);
+}
+
+ScopedPerfCounters::~ScopedPerfCounters() {
+  if (counters_ == nullptr) {
+    return;
+  }
+  auto readings = counters_->Stop();
+  if (readings.ok()) {
+    ReportPerfCounters(*readings, state_);
+  }
+}
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
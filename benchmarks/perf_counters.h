@@ -0,0 +1,111 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_BENCHMARKS_PERF_COUNTERS_H_
+#define HINTLESS_PIR_BENCHMARKS_PERF_COUNTERS_H_
+
+// Hardware performance counters for benchmarks, based on perf_event_open(2).
+//
+// Counting is opt-in via the --perf_counters flag. When enabled, a benchmark
+// wraps its timing loop in a `ScopedPerfCounters` and gets per-iteration
+// cycles, instructions, IPC, last-level cache misses, dTLB misses, and an
+// estimate of DRAM bandwidth derived from the LLC misses. Events that are not
+// supported by the host (e.g. in VMs or when perf_event_paranoid is too
+// restrictive) are silently skipped.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/declare.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+
+ABSL_DECLARE_FLAG(bool, perf_counters);
+
+namespace hintless_pir {
+namespace benchmarks {
+
+// Size in bytes of a cache line, used to convert LLC misses into bytes
+// transferred from memory.
+inline constexpr int kCacheLineBytes = 64;
+
+// A set of hardware counters for the calling thread and all threads it spawns
+// after the counters are created.
+class PerfCounters {
+ public:
+  // The value of one counter accumulated between Start() and Stop().
+  struct Reading {
+    std::string name;
+    double value;
+  };
+
+  // Opens all supported hardware events. Returns an error if none of the
+  // events is available on this host.
+  static absl::StatusOr<std::unique_ptr<PerfCounters>> Create();
+
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Resets and enables all counters.
+  absl::Status Start();
+
+  // Disables all counters and returns their values, scaled up to account for
+  // multiplexing when the kernel could not schedule all events at once.
+  absl::StatusOr<std::vector<Reading>> Stop();
+
+ private:
+  struct Event {
+    std::string name;
+    int fd;
+  };
+
+  explicit PerfCounters(std::vector<Event> events)
+      : events_(std::move(events)) {}
+
+  std::vector<Event> events_;
+};
+
+// Adds the counter readings to `state` as per-iteration averages, together
+// with the derived IPC and memory bandwidth when the underlying events are
+// available.
+void ReportPerfCounters(const std::vector<PerfCounters::Reading>& readings,
+                        benchmark::State& state);
+
+// Measures hardware counters over its lifetime and reports them to the given
+// benchmark state when it goes out of scope. Construct it right before the
+// benchmark loop. Does nothing unless --perf_counters is set.
+class ScopedPerfCounters {
+ public:
+  explicit ScopedPerfCounters(benchmark::State& state);
+  ~ScopedPerfCounters();
+
+  ScopedPerfCounters(const ScopedPerfCounters&) = delete;
+  ScopedPerfCounters& operator=(const ScopedPerfCounters&) = delete;
+
+ private:
+  benchmark::State& state_;
+  std::unique_ptr<PerfCounters> counters_;
+};
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_BENCHMARKS_PERF_COUNTERS_H_
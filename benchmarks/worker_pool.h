@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_BENCHMARKS_WORKER_POOL_H_
+#define HINTLESS_PIR_BENCHMARKS_WORKER_POOL_H_
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace hintless_pir {
+namespace benchmarks {
+
+// A fixed number of threads executing tasks from a shared FIFO queue, used to
+// model a server with a bounded number of request handlers.
+class WorkerPool {
+ public:
+  explicit WorkerPool(int num_threads);
+
+  // Runs all pending tasks and joins the threads.
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // Enqueues `task` to be run by one of the threads.
+  void Schedule(std::function<void()> task) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of tasks waiting for a thread.
+  int QueueLength() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void Run();
+
+  mutable absl::Mutex mutex_;
+  std::deque<std::function<void()>> tasks_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace benchmarks
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_BENCHMARKS_WORKER_POOL_H_
@@ -29,12 +29,13 @@
 #include "hintless_simplepir/parameters.h"
 #include "hintless_simplepir/serialization.pb.h"
 #include "hintless_simplepir/utils.h"
+#include "linpir/packing.h"
 #include "lwe/encode.h"
 #include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/prng_type.h"
 #include "lwe/types.h"
 #include "shell_encryption/int256.h"
 #include "shell_encryption/prng/prng.h"
-#include "shell_encryption/prng/single_thread_chacha_prng.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
 #include "shell_encryption/rns/crt_interpolation.h"
 #include "shell_encryption/status_macros.h"
@@ -42,15 +43,17 @@
 namespace hintless_pir {
 namespace hintless_simplepir {
 
-absl::StatusOr<std::unique_ptr<Client>> Client::Create(
+template <typename RlweInteger>
+absl::StatusOr<std::unique_ptr<Client<RlweInteger>>>
+Client<RlweInteger>::Create(
     const Parameters& params,
     const HintlessPirServerPublicParams& public_params) {
-  if (!(params.prng_type == rlwe::PRNG_TYPE_HKDF ||
-        params.prng_type == rlwe::PRNG_TYPE_CHACHA)) {
+  if (!lwe::IsSupportedPrngType(params.prng_type)) {
     return absl::InvalidArgumentError("Invalid PRNG type in `params`.");
   }
   // Create LinPir clients, one per plaintext modulus in `ts`.
-  auto const& rlwe_params = params.linpir_params;
+  RLWE_ASSIGN_OR_RETURN(linpir::RlweParameters<RlweInteger> rlwe_params,
+                        NarrowLinPirParameters<RlweInteger>(params));
   int num_linpir_instances = rlwe_params.ts.size();
   if (public_params.prng_seed_linpir_ct_pads_size() != num_linpir_instances) {
     return absl::InvalidArgumentError(
@@ -107,7 +110,8 @@ absl::StatusOr<std::unique_ptr<Client>> Client::Create(
   } else {
     client->client_id_ = "fallback_client_id_001"; 
   }
-  auto sk_seed_status = rlwe::SingleThreadHkdfPrng::GenerateSeed();
+  auto sk_seed_status =
+      lwe::GeneratePrngSeed(params.linpir_params.prng_type);
   if (sk_seed_status.ok()) {
     client->session_linpir_sk_seed_ = sk_seed_status.value();
   } else {
@@ -117,41 +121,26 @@ absl::StatusOr<std::unique_ptr<Client>> Client::Create(
 }
 
 //创建LWE密钥s，以及用s加密过后的LWE密文
-absl::StatusOr<HintlessPirRequest> Client::GenerateRequest(int64_t index) {
+template <typename RlweInteger>
+absl::StatusOr<HintlessPirRequest> Client<RlweInteger>::GenerateRequest(
+    int64_t index) {
   if (index < 0 || index >= params_.db_rows * params_.db_cols) {
     return absl::InvalidArgumentError("`index` out of range.");
   }
 
   // Step 1. Encrypting the selection vector under LWE.
-  lwe::Matrix lwe_pad;
-  std::unique_ptr<rlwe::SecurePrng> lwe_enc_prng;
-  std::string prng_seed_linpir_sk;
-  if (params_.prng_type == rlwe::PRNG_TYPE_HKDF) {
-    RLWE_ASSIGN_OR_RETURN(auto pad_prng, rlwe::SingleThreadHkdfPrng::Create(
-                                             prng_seed_lwe_query_pad_));
-    RLWE_ASSIGN_OR_RETURN(
-        lwe_pad, lwe::ExpandPad(params_.db_cols, params_.lwe_secret_dim,
-                                pad_prng.get()));
-    RLWE_ASSIGN_OR_RETURN(std::string prng_seed_enc,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-    RLWE_ASSIGN_OR_RETURN(lwe_enc_prng,
-                          rlwe::SingleThreadHkdfPrng::Create(prng_seed_enc));
-    RLWE_ASSIGN_OR_RETURN(prng_seed_linpir_sk,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-
-  } else {
-    RLWE_ASSIGN_OR_RETURN(auto pad_prng, rlwe::SingleThreadChaChaPrng::Create(
-                                             prng_seed_lwe_query_pad_));
-    RLWE_ASSIGN_OR_RETURN(
-        lwe_pad, lwe::ExpandPad(params_.db_cols, params_.lwe_secret_dim,
-                                pad_prng.get()));
-    RLWE_ASSIGN_OR_RETURN(std::string prng_seed_enc,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-    RLWE_ASSIGN_OR_RETURN(lwe_enc_prng,
-                          rlwe::SingleThreadChaChaPrng::Create(prng_seed_enc));
-    RLWE_ASSIGN_OR_RETURN(prng_seed_linpir_sk,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-  }
+  RLWE_ASSIGN_OR_RETURN(
+      lwe::Matrix lwe_pad,
+      lwe::ExpandPadFromSeed(params_.db_cols, params_.lwe_secret_dim,
+                             prng_seed_lwe_query_pad_, params_.prng_type,
+                             params_.num_threads));
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_enc,
+                        lwe::GeneratePrngSeed(params_.prng_type));
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> lwe_enc_prng,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_enc));
+  RLWE_ASSIGN_OR_RETURN(
+      std::string prng_seed_linpir_sk,
+      lwe::GeneratePrngSeed(params_.linpir_params.prng_type));
   RLWE_ASSIGN_OR_RETURN(
       lwe::SymmetricLweKey lwe_secret_key,
       lwe::SymmetricLweKey::Sample(params_.lwe_secret_dim, lwe_enc_prng.get()));
@@ -211,7 +200,8 @@ absl::StatusOr<HintlessPirRequest> Client::GenerateRequest(int64_t index) {
 //   }
 //   return absl::OkStatus();
 // }
-absl::Status Client::GenerateLinPirRequestInPlace(
+template <typename RlweInteger>
+absl::Status Client<RlweInteger>::GenerateLinPirRequestInPlace(
     HintlessPirRequest& request, const lwe::Vector& lwe_secret) const {
   if (linpir_clients_.empty()) {
     return absl::InvalidArgumentError("No LinPir client available.");
@@ -221,11 +211,22 @@ absl::Status Client::GenerateLinPirRequestInPlace(
   request.set_client_id(client_id_);
 
   // Encode the LWE secret vector using LinPir plaintext moduli...
-  RlweInteger lwe_modulus = RlweInteger{1} << params_.lwe_modulus_bit_size;
+  uint64_t lwe_modulus = uint64_t{1} << params_.lwe_modulus_bit_size;
+  int packing_factor = LinPirPackingFactor(params_);
+  RLWE_ASSIGN_OR_RETURN(linpir::RlweParameters<RlweInteger> linpir_params,
+                        NarrowLinPirParameters<RlweInteger>(params_));
   for (size_t k = 0; k < linpir_clients_.size(); ++k) {
     RlweInteger plaintext_modulus = rlwe_contexts_[k]->PlaintextModulus();
     std::vector<RlweInteger> lwe_secret_mod_t =
         EncodeLweVector(lwe_secret, lwe_modulus, plaintext_modulus);
+    if (packing_factor > 1) {
+      // The hints of all shards are packed into one LinPir database, whose
+      // query repeats the LWE secret once per packed matrix.
+      RLWE_ASSIGN_OR_RETURN(
+          lwe_secret_mod_t,
+          linpir::PackQuery<RlweInteger>(linpir_params, packing_factor,
+                                         lwe_secret_mod_t));
+    }
     RLWE_ASSIGN_OR_RETURN(
         auto ct, linpir_clients_[k]->EncryptQuery(lwe_secret_mod_t,
                                                   session_linpir_sk_seed_));
@@ -249,20 +250,22 @@ absl::Status Client::GenerateLinPirRequestInPlace(
   return absl::OkStatus();
 }
 
-std::vector<Client::RlweInteger> Client::EncodeLweVector(
-    const lwe::Vector& lwe_vector, RlweInteger lwe_modulus,
+template <typename RlweInteger>
+std::vector<RlweInteger> Client<RlweInteger>::EncodeLweVector(
+    const lwe::Vector& lwe_vector, uint64_t lwe_modulus,
     RlweInteger encode_modulus) {
-  RlweInteger lwe_modulus_half = lwe_modulus >> 1;
+  uint64_t lwe_modulus_half = lwe_modulus >> 1;
   std::vector<RlweInteger> lwe_vector_mod_t(lwe_vector.size(), 0);
   for (int i = 0; i < lwe_vector.size(); ++i) {
-    RlweInteger x = lwe_vector[i];
-    lwe_vector_mod_t[i] =
-        ConvertModulus(x, lwe_modulus, encode_modulus, lwe_modulus_half);
+    uint64_t x = lwe_vector[i];
+    lwe_vector_mod_t[i] = static_cast<RlweInteger>(ConvertModulus<uint64_t>(
+        x, lwe_modulus, encode_modulus, lwe_modulus_half));
   }
   return lwe_vector_mod_t;
 }
 
-absl::StatusOr<std::string> Client::RecoverRecord(
+template <typename RlweInteger>
+absl::StatusOr<std::string> Client<RlweInteger>::RecoverRecord(
     const HintlessPirResponse& response) {
   int num_shards =
       DivAndRoundUp(params_.db_record_bit_size, params_.lwe_plaintext_bit_size);
@@ -303,7 +306,9 @@ absl::StatusOr<std::string> Client::RecoverRecord(
   return ReconstructRecord(values, params_);
 }
 
-absl::StatusOr<std::vector<lwe::Vector>> Client::RecoverLweDecryptionParts(
+template <typename RlweInteger>
+absl::StatusOr<std::vector<lwe::Vector>>
+Client<RlweInteger>::RecoverLweDecryptionParts(
     const HintlessPirResponse& response) const {
   using BigInteger = rlwe::uint256;
 
@@ -316,7 +321,10 @@ absl::StatusOr<std::vector<lwe::Vector>> Client::RecoverLweDecryptionParts(
 
   int num_shards =
       DivAndRoundUp(params_.db_record_bit_size, params_.lwe_plaintext_bit_size);
-  if (num_shards != response.linpir_responses(0).ct_inner_products_size()) {
+  int packing_factor = LinPirPackingFactor(params_);
+  int num_linpir_databases = packing_factor > 1 ? 1 : num_shards;
+  if (num_linpir_databases !=
+      response.linpir_responses(0).ct_inner_products_size()) {
     return absl::InvalidArgumentError(
         "`response` contains an expected number of shards.");
   }
@@ -329,17 +337,38 @@ absl::StatusOr<std::vector<lwe::Vector>> Client::RecoverLweDecryptionParts(
   for (auto& h : hint_crt_values) {
     h.resize(num_linpir_plaintext_moduli);
   }
+  int64_t num_packed_rows =
+      NumPackedHintRows(num_shards, params_.db_rows, packing_factor);
   for (int k = 0; k < num_linpir_plaintext_moduli; ++k) {
     RLWE_ASSIGN_OR_RETURN(
         auto hint_values_mod_tk,
-        linpir_clients_[k]->Recover(response.linpir_responses(k),linpir_response_pads_[k]));
+        linpir_clients_[k]->Recover(response.linpir_responses(k),
+                                    linpir_response_pads_[k], packing_factor));
     auto mod_params_tk = plaintext_moduli[k]->ModParams();
     for (int i = 0; i < num_shards; ++i) {
-      hint_crt_values[i][k].reserve(hint_values_mod_tk[i].size());
-      for (auto const& hint_value : hint_values_mod_tk[i]) {
-        RLWE_ASSIGN_OR_RETURN(auto hint_mod_tk, RlweModularInt::ImportInt(
-                                                    hint_value, mod_params_tk));
-        hint_crt_values[i][k].push_back(std::move(hint_mod_tk));
+      if (packing_factor > 1) {
+        // Row r of shard i is the stacked row i * db_rows + r, which is packed
+        // as row (stacked row % num_packed_rows) of matrix p = stacked row /
+        // num_packed_rows.
+        hint_crt_values[i][k].reserve(params_.db_rows);
+        for (int64_t r = 0; r < params_.db_rows; ++r) {
+          int64_t stacked_row = i * params_.db_rows + r;
+          RLWE_ASSIGN_OR_RETURN(
+              auto hint_mod_tk,
+              RlweModularInt::ImportInt(
+                  hint_values_mod_tk[stacked_row / num_packed_rows]
+                                    [stacked_row % num_packed_rows],
+                  mod_params_tk));
+          hint_crt_values[i][k].push_back(std::move(hint_mod_tk));
+        }
+      } else {
+        hint_crt_values[i][k].reserve(hint_values_mod_tk[i].size());
+        for (auto const& hint_value : hint_values_mod_tk[i]) {
+          RLWE_ASSIGN_OR_RETURN(
+              auto hint_mod_tk,
+              RlweModularInt::ImportInt(hint_value, mod_params_tk));
+          hint_crt_values[i][k].push_back(std::move(hint_mod_tk));
+        }
       }
     }
   }
@@ -369,8 +398,8 @@ absl::StatusOr<std::vector<lwe::Vector>> Client::RecoverLweDecryptionParts(
     lwe::Vector hint = lwe::Vector::Zero(hint_values.size());
     for (int i = 0; i < hint_values.size(); ++i) {
       BigInteger x = hint_values[i] % p;
-      hint[i] =
-          static_cast<RlweInteger>(ConvertModulus(x, p, lwe_modulus, p_half));
+      hint[i] = static_cast<Parameters::RlweInteger>(
+          ConvertModulus(x, p, lwe_modulus, p_half));
     }
     hint_vectors.push_back(std::move(hint));
   }
@@ -378,5 +407,8 @@ absl::StatusOr<std::vector<lwe::Vector>> Client::RecoverLweDecryptionParts(
   return hint_vectors;
 }
 
+template class Client<linpir::Uint32>;
+template class Client<linpir::Uint64>;
+
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
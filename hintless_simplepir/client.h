@@ -37,7 +37,9 @@
 namespace hintless_pir {
 namespace hintless_simplepir {
 
-// The client part of the HintlessPir protocol.
+// The client part of the HintlessPir protocol, computing the LinPIR part with
+// RLWE integers of type `RlweInteger`, which must match the server's.
+template <typename RlweInteger>
 class Client {
  public:
   // Creates a client from the given protocol parameters `params` and the
@@ -54,7 +56,6 @@ class Client {
       const HintlessPirResponse& response);
 
  private:
-  using RlweInteger = Parameters::RlweInteger;
   using RlweModularInt = rlwe::MontgomeryInt<RlweInteger>;
   using RlweRnsContext = rlwe::RnsContext<RlweModularInt>;
   using RlwePrimeModulus = rlwe::PrimeModulus<RlweModularInt>;
@@ -75,7 +76,7 @@ class Client {
   };
 
   explicit Client(
-      Parameters params, 
+      Parameters params,
       const HintlessPirServerPublicParams& public_params,
       std::vector<std::unique_ptr<const RlweRnsContext>> rlwe_contexts,
       std::vector<const RlwePrimeModulus*> rlwe_moduli,
@@ -93,8 +94,9 @@ class Client {
          public_params.linpir_response_hints().end());
         }
 
+  // `lwe_modulus` is 64-bit as it may not fit in `RlweInteger`.
   static std::vector<RlweInteger> EncodeLweVector(const lwe::Vector& lwe_vector,
-                                                  RlweInteger lwe_modulus,
+                                                  uint64_t lwe_modulus,
                                                   RlweInteger encode_modulus);
 
   // Encrypts the LWE secret vector using LinPir clients and update `request`
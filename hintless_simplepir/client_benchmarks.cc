@@ -0,0 +1,515 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the HintlessPIR client. Besides the end-to-end client calls,
+// the request generation and the record recovery are split into the stages
+// performed by `Client`, which are reproduced here on top of the public LWE,
+// LinPir and CRT APIs:
+//
+//   GenerateRequest = LWE pad expansion + LWE encryption
+//                     + LinPir encryption (per plaintext modulus)
+//                     + Galois key generation (first request only)
+//   RecoverRecord   = LinPir decryption + CRT interpolation + LWE decoding
+//
+// Every benchmark is run over a sweep of database shapes and record sizes,
+// given as (rows, cols, record bits) arguments.
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/parse.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "benchmarks/perf_counters.h"
+#include "hintless_simplepir/client.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "hintless_simplepir/server.h"
+#include "hintless_simplepir/utils.h"
+#include "linpir/client.h"
+#include "linpir/parameters.h"
+#include "linpir/serialization.pb.h"
+#include "lwe/encode.h"
+#include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/types.h"
+#include "shell_encryption/int256.h"
+#include "shell_encryption/montgomery.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/rns/crt_interpolation.h"
+#include "shell_encryption/rns/rns_context.h"
+#include "shell_encryption/rns/rns_modulus.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+using RlweModularInt = rlwe::MontgomeryInt<RlweInteger>;
+using RlweRnsContext = rlwe::RnsContext<RlweModularInt>;
+using RlwePrimeModulus = rlwe::PrimeModulus<RlweModularInt>;
+using LinPirClient = linpir::Client<RlweInteger>;
+using BigInteger = rlwe::uint256;
+using Prng = rlwe::SingleThreadHkdfPrng;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+// The index of the record queried by all benchmarks.
+constexpr int64_t kIndex = 1;
+
+// Client-side state for one database shape. The server is only needed to
+// produce the public parameters and the responses, and is released afterwards.
+struct ClientBenchmarkEnv {
+  Parameters params;
+  HintlessPirServerPublicParams public_params;
+
+  // Per plaintext modulus RLWE contexts and LinPir clients, and the context
+  // used for CRT interpolation wrt the plaintext moduli.
+  std::vector<std::unique_ptr<const RlweRnsContext>> rlwe_contexts;
+  std::vector<std::unique_ptr<LinPirClient>> linpir_clients;
+  std::unique_ptr<const RlweRnsContext> crt_context;
+  std::string prng_seed_linpir_sk;
+
+  // A request assembled from the individual stages, and its response.
+  lwe::Vector lwe_secret;
+  HintlessPirRequest request;
+  HintlessPirResponse response;
+
+  // A client with an outstanding request, and the response to the request.
+  std::unique_ptr<Client<RlweInteger>> client;
+  HintlessPirResponse client_response;
+};
+
+// Returns the LWE query pad "A" expanded from the public parameters.
+lwe::Matrix ExpandLweQueryPad(const ClientBenchmarkEnv& env) {
+  auto prng = Prng::Create(env.public_params.prng_seed_lwe_query_pad()).value();
+  return lwe::ExpandPad(env.params.db_cols, env.params.lwe_secret_dim,
+                        prng.get())
+      .value();
+}
+
+// Encrypts the selection vector of column `kIndex % cols` under a fresh LWE
+// secret key, which is returned in `lwe_secret`.
+lwe::Vector EncryptLweQuery(const ClientBenchmarkEnv& env,
+                            const lwe::Matrix& lwe_pad,
+                            lwe::Vector& lwe_secret) {
+  auto prng = Prng::Create(Prng::GenerateSeed().value()).value();
+  auto key =
+      lwe::SymmetricLweKey::Sample(env.params.lwe_secret_dim, prng.get())
+          .value();
+  lwe::Vector query_vector = lwe::Vector::Zero(env.params.db_cols);
+  query_vector[kIndex % env.params.db_cols] = 1;
+  int log_scaling_factor =
+      env.params.lwe_modulus_bit_size - env.params.lwe_plaintext_bit_size;
+  key.EncryptFromPadInPlace(query_vector, lwe_pad, log_scaling_factor,
+                            prng.get())
+      .IgnoreError();
+  lwe_secret = key.Key();
+  return query_vector;
+}
+
+// Returns the serialized "b" component of the LinPir ciphertext encrypting the
+// LWE secret mod the k-th plaintext modulus.
+rlwe::SerializedRnsPolynomial EncryptLinPirQuery(ClientBenchmarkEnv& env,
+                                                 int k) {
+  RlweInteger lwe_modulus = RlweInteger{1} << env.params.lwe_modulus_bit_size;
+  RlweInteger t = env.rlwe_contexts[k]->PlaintextModulus();
+  std::vector<RlweInteger> lwe_secret_mod_t(env.lwe_secret.size());
+  for (int i = 0; i < env.lwe_secret.size(); ++i) {
+    lwe_secret_mod_t[i] =
+        ConvertModulus<RlweInteger>(env.lwe_secret[i], lwe_modulus, t,
+                                    lwe_modulus >> 1);
+  }
+  auto ct = env.linpir_clients[k]
+                ->EncryptQuery(lwe_secret_mod_t, env.prng_seed_linpir_sk)
+                .value();
+  return ct.Component(0)
+      .value()
+      .Serialize(env.rlwe_contexts[k]->MainPrimeModuli())
+      .value();
+}
+
+// Returns the serialized "b" components of the Galois key.
+std::vector<rlwe::SerializedRnsPolynomial> GenerateGaloisKey(
+    const ClientBenchmarkEnv& env) {
+  auto gk =
+      env.linpir_clients[0]->GenerateGaloisKey(env.prng_seed_linpir_sk).value();
+  std::vector<rlwe::SerializedRnsPolynomial> gk_bs;
+  for (auto const& gk_b : gk.GetKeyB()) {
+    gk_bs.push_back(
+        gk_b.Serialize(env.rlwe_contexts[0]->MainPrimeModuli()).value());
+  }
+  return gk_bs;
+}
+
+// Returns the LinPir decryptions, indexed by [plaintext modulus][shard].
+std::vector<std::vector<std::vector<RlweInteger>>> DecryptLinPirResponses(
+    ClientBenchmarkEnv& env) {
+  std::vector<std::vector<std::vector<RlweInteger>>> values;
+  for (int k = 0; k < env.linpir_clients.size(); ++k) {
+    values.push_back(env.linpir_clients[k]
+                         ->Recover(env.response.linpir_responses(k),
+                                   env.public_params.linpir_response_hints(k))
+                         .value());
+  }
+  return values;
+}
+
+// CRT interpolates the LinPir decryptions into hint * LWE secret mod the LWE
+// modulus, one vector per shard.
+std::vector<lwe::Vector> InterpolateHintProducts(
+    const ClientBenchmarkEnv& env,
+    const std::vector<std::vector<std::vector<RlweInteger>>>& values) {
+  auto plaintext_moduli = env.crt_context->MainPrimeModuli();
+  int num_moduli = plaintext_moduli.size();
+  int num_shards = values[0].size();
+  BigInteger p = 1;
+  for (auto pi : plaintext_moduli) {
+    p *= rlwe::ConvertToBigInteger<RlweInteger, BigInteger>(pi->Modulus());
+  }
+  BigInteger p_half = p / 2;
+  BigInteger lwe_modulus = BigInteger(1) << env.params.lwe_modulus_bit_size;
+  std::vector<BigInteger> p_hats =
+      rlwe::RnsModulusComplements<RlweModularInt, BigInteger>(plaintext_moduli);
+  std::vector<RlweModularInt> p_hat_invs =
+      env.crt_context->MainPrimeModulusCrtFactors(num_moduli - 1).value();
+
+  std::vector<lwe::Vector> hints;
+  for (int j = 0; j < num_shards; ++j) {
+    std::vector<std::vector<RlweModularInt>> crt_values(num_moduli);
+    for (int k = 0; k < num_moduli; ++k) {
+      auto mod_params = plaintext_moduli[k]->ModParams();
+      for (RlweInteger value : values[k][j]) {
+        crt_values[k].push_back(
+            RlweModularInt::ImportInt(value, mod_params).value());
+      }
+    }
+    std::vector<BigInteger> hint_values =
+        rlwe::CrtInterpolation<RlweModularInt, BigInteger>(
+            crt_values, plaintext_moduli, p_hats, p_hat_invs)
+            .value();
+    lwe::Vector hint = lwe::Vector::Zero(hint_values.size());
+    for (int i = 0; i < hint_values.size(); ++i) {
+      BigInteger x = hint_values[i] % p;
+      hint[i] =
+          static_cast<RlweInteger>(ConvertModulus(x, p, lwe_modulus, p_half));
+    }
+    hints.push_back(std::move(hint));
+  }
+  return hints;
+}
+
+// Removes hint * LWE secret and the error from the LWE responses.
+std::string DecodeLweResponses(const ClientBenchmarkEnv& env,
+                               const std::vector<lwe::Vector>& hints) {
+  int64_t row_idx = kIndex / env.params.db_cols;
+  int log_scaling_factor =
+      env.params.lwe_modulus_bit_size - env.params.lwe_plaintext_bit_size;
+  std::vector<lwe::Integer> values;
+  for (int i = 0; i < env.response.ct_records_size(); ++i) {
+    lwe::Vector noisy_plaintext{
+        {static_cast<lwe::Integer>(
+            env.response.ct_records(i).b_coeffs(row_idx))}};
+    noisy_plaintext[0] -= hints[i][row_idx];
+    lwe::RemoveErrorInPlace(noisy_plaintext, log_scaling_factor)
+        .IgnoreError();
+    values.push_back(noisy_plaintext(0));
+  }
+  return ReconstructRecord(values, env.params);
+}
+
+std::unique_ptr<ClientBenchmarkEnv> CreateEnv(const Parameters& params) {
+  auto env = std::make_unique<ClientBenchmarkEnv>();
+  env->params = params;
+  auto server =
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params).value();
+  server->Preprocess().IgnoreError();
+  env->public_params = server->GetPublicParams();
+
+  auto const& rlwe_params = params.linpir_params;
+  for (int k = 0; k < rlwe_params.ts.size(); ++k) {
+    env->rlwe_contexts.push_back(std::make_unique<const RlweRnsContext>(
+        RlweRnsContext::CreateForBfvFiniteFieldEncoding(
+            rlwe_params.log_n, rlwe_params.qs, /*ps=*/{}, rlwe_params.ts[k])
+            .value()));
+    env->linpir_clients.push_back(
+        LinPirClient::Create(rlwe_params, env->rlwe_contexts[k].get(),
+                             env->public_params.prng_seed_linpir_ct_pads(k),
+                             env->public_params.prng_seed_linpir_gk_pad())
+            .value());
+  }
+  env->crt_context = std::make_unique<const RlweRnsContext>(
+      RlweRnsContext::Create(rlwe_params.log_n, rlwe_params.ts, /*ps=*/{}, 2)
+          .value());
+  env->prng_seed_linpir_sk = Prng::GenerateSeed().value();
+
+  // Assemble a request from the individual stages.
+  lwe::Matrix lwe_pad = ExpandLweQueryPad(*env);
+  lwe::Vector ct_query = EncryptLweQuery(*env, lwe_pad, env->lwe_secret);
+  *env->request.mutable_ct_query_vector() = SerializeLweCiphertext(ct_query);
+  for (int k = 0; k < env->linpir_clients.size(); ++k) {
+    *env->request.add_linpir_ct_bs() = EncryptLinPirQuery(*env, k);
+  }
+  for (auto& gk_b : GenerateGaloisKey(*env)) {
+    *env->request.add_linpir_gk_bs() = std::move(gk_b);
+  }
+  env->response = server->HandleRequest(env->request).value();
+
+  env->client = Client<RlweInteger>::Create(params, env->public_params).value();
+  auto client_request = env->client->GenerateRequest(kIndex).value();
+  env->client_response = server->HandleRequest(client_request).value();
+  return env;
+}
+
+// Returns the environment for the (rows, cols, record bits) arguments of
+// `state`, creating it on first use.
+ClientBenchmarkEnv& GetEnv(const benchmark::State& state) {
+  static auto* envs =
+      new std::map<std::tuple<int64_t, int64_t, int64_t>,
+                   std::unique_ptr<ClientBenchmarkEnv>>();
+  auto key = std::make_tuple(state.range(0), state.range(1), state.range(2));
+  auto it = envs->find(key);
+  if (it == envs->end()) {
+    Parameters params = kParameters;
+    params.db_rows = state.range(0);
+    params.db_cols = state.range(1);
+    params.db_record_bit_size = state.range(2);
+    it = envs->emplace(key, CreateEnv(params)).first;
+  }
+  return *it->second;
+}
+
+void BM_ClientCreate(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  state.counters["hint_KiB"] = env.public_params.ByteSizeLong() / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto client = Client<RlweInteger>::Create(env.params, env.public_params);
+    benchmark::DoNotOptimize(client);
+  }
+}
+
+// The first request of a session, which includes the Galois key.
+void BM_GenerateRequestFirst(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  int64_t num_bytes = 0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto client =
+        Client<RlweInteger>::Create(env.params, env.public_params).value();
+    state.ResumeTiming();
+    auto request = client->GenerateRequest(kIndex).value();
+    num_bytes = request.ByteSizeLong();
+    benchmark::DoNotOptimize(request);
+  }
+  state.counters["up_KiB"] = num_bytes / 1024.0;
+}
+
+// The subsequent requests of a session, without the Galois key.
+void BM_GenerateRequest(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  auto client =
+      Client<RlweInteger>::Create(env.params, env.public_params).value();
+  client->GenerateRequest(kIndex).IgnoreError();
+  int64_t num_bytes = client->GenerateRequest(kIndex).value().ByteSizeLong();
+  state.counters["up_KiB"] = num_bytes / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto request = client->GenerateRequest(kIndex);
+    benchmark::DoNotOptimize(request);
+  }
+}
+
+void BM_ExpandLweQueryPad(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  state.counters["pad_KiB"] = env.params.db_cols * env.params.lwe_secret_dim *
+                              sizeof(lwe::Integer) / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto pad = ExpandLweQueryPad(env);
+    benchmark::DoNotOptimize(pad);
+  }
+}
+
+void BM_LweEncrypt(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  lwe::Matrix lwe_pad = ExpandLweQueryPad(env);
+  state.counters["up_KiB"] =
+      env.request.ct_query_vector().ByteSizeLong() / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  lwe::Vector lwe_secret;
+  for (auto _ : state) {
+    auto ct_query = EncryptLweQuery(env, lwe_pad, lwe_secret);
+    benchmark::DoNotOptimize(ct_query);
+  }
+}
+
+// Reports the time spent per plaintext modulus as "t<k>_ms".
+void BM_LinPirEncrypt(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  int num_moduli = env.linpir_clients.size();
+  int64_t num_bytes = 0;
+  for (int k = 0; k < num_moduli; ++k) {
+    num_bytes += env.request.linpir_ct_bs(k).ByteSizeLong();
+  }
+  state.counters["up_KiB"] = num_bytes / 1024.0;
+  std::vector<absl::Duration> times(num_moduli);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    for (int k = 0; k < num_moduli; ++k) {
+      absl::Time start = absl::Now();
+      auto ct_b = EncryptLinPirQuery(env, k);
+      times[k] += absl::Now() - start;
+      benchmark::DoNotOptimize(ct_b);
+    }
+  }
+  for (int k = 0; k < num_moduli; ++k) {
+    state.counters[absl::StrCat("t", k, "_ms")] = benchmark::Counter(
+        absl::ToDoubleMilliseconds(times[k]), benchmark::Counter::kAvgIterations);
+  }
+}
+
+void BM_GenerateGaloisKey(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  int64_t num_bytes = 0;
+  for (auto const& gk_b : env.request.linpir_gk_bs()) {
+    num_bytes += gk_b.ByteSizeLong();
+  }
+  state.counters["up_KiB"] = num_bytes / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto gk_bs = GenerateGaloisKey(env);
+    benchmark::DoNotOptimize(gk_bs);
+  }
+}
+
+void BM_RecoverRecord(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  state.counters["down_KiB"] = env.client_response.ByteSizeLong() / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto record = env.client->RecoverRecord(env.client_response);
+    benchmark::DoNotOptimize(record);
+  }
+}
+
+void BM_LinPirDecrypt(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  int64_t num_bytes = 0;
+  for (auto const& linpir_response : env.response.linpir_responses()) {
+    num_bytes += linpir_response.ByteSizeLong();
+  }
+  state.counters["down_KiB"] = num_bytes / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto values = DecryptLinPirResponses(env);
+    benchmark::DoNotOptimize(values);
+  }
+}
+
+void BM_CrtInterpolation(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  auto values = DecryptLinPirResponses(env);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto hints = InterpolateHintProducts(env, values);
+    benchmark::DoNotOptimize(hints);
+  }
+}
+
+void BM_LweDecode(benchmark::State& state) {
+  ClientBenchmarkEnv& env = GetEnv(state);
+  auto hints = InterpolateHintProducts(env, DecryptLinPirResponses(env));
+  int64_t num_bytes = 0;
+  for (auto const& ct_record : env.response.ct_records()) {
+    num_bytes += ct_record.ByteSizeLong();
+  }
+  state.counters["down_KiB"] = num_bytes / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto record = DecodeLweResponses(env, hints);
+    benchmark::DoNotOptimize(record);
+  }
+}
+
+// Database shapes and record sizes: (rows, cols, record bits).
+void DatabaseSweep(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"rows", "cols", "record_bits"});
+  b->Args({1024, 1024, 64});
+  b->Args({2048, 2048, 64});
+  b->Args({1024, 1024, 256});
+  b->Args({2048, 2048, 256});
+  b->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK(BM_ClientCreate)->Apply(DatabaseSweep);
+BENCHMARK(BM_GenerateRequestFirst)->Apply(DatabaseSweep);
+BENCHMARK(BM_GenerateRequest)->Apply(DatabaseSweep);
+BENCHMARK(BM_ExpandLweQueryPad)->Apply(DatabaseSweep);
+BENCHMARK(BM_LweEncrypt)->Apply(DatabaseSweep);
+BENCHMARK(BM_LinPirEncrypt)->Apply(DatabaseSweep);
+BENCHMARK(BM_GenerateGaloisKey)->Apply(DatabaseSweep);
+BENCHMARK(BM_RecoverRecord)->Apply(DatabaseSweep);
+BENCHMARK(BM_LinPirDecrypt)->Apply(DatabaseSweep);
+BENCHMARK(BM_CrtInterpolation)->Apply(DatabaseSweep);
+BENCHMARK(BM_LweDecode)->Apply(DatabaseSweep);
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -77,7 +77,8 @@ TEST(Client, CreateFailsIfInvalidPrngType) {
   Parameters invalid_params = kParameters;
   invalid_params.prng_type = rlwe::PRNG_TYPE_INVALID;
   EXPECT_THAT(
-      Client::Create(invalid_params, GenerateDummyPublicParams(invalid_params)),
+      Client<RlweInteger>::Create(invalid_params,
+                                  GenerateDummyPublicParams(invalid_params)),
       StatusIs(absl::StatusCode::kInvalidArgument,
                testing::HasSubstr("Invalid PRNG type")));
 }
@@ -86,7 +87,7 @@ TEST(Client, CreateFailsIfInvalidPublicParams) {
   // Empty public params.
   HintlessPirServerPublicParams invalid_public_params;
   EXPECT_THAT(
-      Client::Create(kParameters, invalid_public_params),
+      Client<RlweInteger>::Create(kParameters, invalid_public_params),
       StatusIs(absl::StatusCode::kInvalidArgument,
                testing::HasSubstr(
                    "`public_params` contains incorrect number of PRNG seeds")));
@@ -94,12 +95,14 @@ TEST(Client, CreateFailsIfInvalidPublicParams) {
 
 TEST(Client, Create) {
   auto public_params = GenerateDummyPublicParams(kParameters);
-  ASSERT_OK_AND_ASSIGN(auto client, Client::Create(kParameters, public_params));
+  ASSERT_OK_AND_ASSIGN(
+      auto client, Client<RlweInteger>::Create(kParameters, public_params));
 }
 
 TEST(Client, GenerateRequestFailsIfIndexIsOutOfRange) {
   auto public_params = GenerateDummyPublicParams(kParameters);
-  ASSERT_OK_AND_ASSIGN(auto client, Client::Create(kParameters, public_params));
+  ASSERT_OK_AND_ASSIGN(
+      auto client, Client<RlweInteger>::Create(kParameters, public_params));
 
   EXPECT_THAT(client->GenerateRequest(-1),
               StatusIs(absl::StatusCode::kInvalidArgument,
@@ -112,7 +115,8 @@ TEST(Client, GenerateRequestFailsIfIndexIsOutOfRange) {
 
 TEST(Client, RecoverRecordFailsIfInvalidResponse) {
   auto public_params = GenerateDummyPublicParams(kParameters);
-  ASSERT_OK_AND_ASSIGN(auto client, Client::Create(kParameters, public_params));
+  ASSERT_OK_AND_ASSIGN(
+      auto client, Client<RlweInteger>::Create(kParameters, public_params));
 
   HintlessPirResponse empty_response;
   EXPECT_THAT(client->RecoverRecord(empty_response),
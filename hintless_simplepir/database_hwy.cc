@@ -14,6 +14,7 @@
 
 #include "hintless_simplepir/database_hwy.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
@@ -27,9 +28,12 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "hintless_simplepir/inner_product_hwy.h"
 #include "hintless_simplepir/parameters.h"
 #include "hintless_simplepir/utils.h"
+#include "linpir/parallel.h"
+#include "lwe/lwe_symmetric_encryption.h"
 #include "lwe/types.h"
 #include "shell_encryption/status_macros.h"
 
@@ -191,16 +195,114 @@ absl::Status Database::UpdateHints() {
   return absl::OkStatus();
 }
 
+absl::Status Database::UpdateHintsFromSeed(absl::string_view prng_seed,
+                                           rlwe::PrngType prng_type) {
+  // Number of rows of the LWE query pad, i.e. of database columns, per tile.
+  constexpr int64_t kPadTileRows = 1024;
+  int64_t num_cols = params_.db_cols;
+  int num_lwe_cols = params_.lwe_secret_dim;
+  RLWE_ASSIGN_OR_RETURN(
+      lwe::PadRowStream pad_stream,
+      lwe::PadRowStream::Create(prng_seed, prng_type, num_lwe_cols));
+
+  // The hints are accumulated by rows directly into `hint_matrices_`: the
+  // product of each tile of the pad with a shard is computed one column at a
+  // time into the same scratch buffer, which holds a value per padded row.
+  constexpr int64_t kNumValuesPerBlock =
+      sizeof(BlockType) / sizeof(lwe::PlainInteger);
+  for (LweMatrix& hint : hint_matrices_) {
+    hint = CreateZeroMatrix(params_.db_rows, num_lwe_cols);
+  }
+  LweVector product(
+      DivAndRoundUp<int64_t>(params_.db_rows, kNumValuesPerBlock) *
+      kNumValuesPerBlock);
+  lwe::Matrix pad_tile(std::min(kPadTileRows, num_cols), num_lwe_cols);
+  for (int64_t col_begin = 0; col_begin < num_cols;
+       col_begin += kPadTileRows) {
+    int64_t tile_rows = std::min(kPadTileRows, num_cols - col_begin);
+    RLWE_RETURN_IF_ERROR(pad_stream.Next(pad_tile.topRows(tile_rows)));
+    for (int i = 0; i < data_matrices_.size(); ++i) {
+      absl::Span<const RawVector> data_cols =
+          absl::MakeConstSpan(data_matrices_[i]).subspan(col_begin, tile_rows);
+      LweMatrix& hint = hint_matrices_[i];
+      for (int j = 0; j < num_lwe_cols; ++j) {
+        std::fill(product.begin(), product.end(), 0);
+        // Columns of `pad_tile` are contiguous, as it is column-major.
+        RLWE_RETURN_IF_ERROR(
+            internal::InnerProductAccumulate<lwe::PlainInteger>(
+                data_cols,
+                absl::MakeConstSpan(pad_tile.col(j).data(), tile_rows),
+                absl::MakeSpan(product)));
+        for (int64_t k = 0; k < params_.db_rows; ++k) {
+          hint[k][j] += product[k];
+        }
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
 absl::StatusOr<std::vector<Database::LweVector>> Database::InnerProductWith(
     const LweVector& query) const {
-  std::vector<LweVector> results;
-  results.reserve(data_matrices_.size());
-  for (auto const& matrix : data_matrices_) {
-    RLWE_ASSIGN_OR_RETURN(
-        LweVector result,
-        internal::InnerProduct<lwe::PlainInteger>(matrix, query));
-    result.resize(params_.db_rows);
-    results.push_back(result);
+  if (query.size() != params_.db_cols) {
+    return absl::InvalidArgumentError(
+        "`query` must have one value per database column.");
+  }
+  if (params_.num_query_threads <= 1) {
+    std::vector<LweVector> results;
+    results.reserve(data_matrices_.size());
+    for (auto const& matrix : data_matrices_) {
+      RLWE_ASSIGN_OR_RETURN(
+          LweVector result,
+          internal::InnerProduct<lwe::PlainInteger>(matrix, query));
+      result.resize(params_.db_rows);
+      results.push_back(std::move(result));
+    }
+    return results;
+  }
+
+  // Each range of columns is multiplied into its own partial products, on the
+  // calling thread and on the query thread pool, which are then summed modulo
+  // 2^32 per shard.
+  constexpr int64_t kNumValuesPerBlock =
+      sizeof(BlockType) / sizeof(lwe::PlainInteger);
+  int num_cols = static_cast<int>(params_.db_cols);
+  int cols_per_range =
+      linpir::ItemsPerRange(num_cols, params_.num_query_threads);
+  int num_ranges = DivAndRoundUp(num_cols, cols_per_range);
+  int64_t num_padded_rows =
+      DivAndRoundUp<int64_t>(params_.db_rows, kNumValuesPerBlock) *
+      kNumValuesPerBlock;
+  // Indexed by [range][shard].
+  std::vector<std::vector<LweVector>> partial_results(
+      num_ranges, std::vector<LweVector>(data_matrices_.size(),
+                                         LweVector(num_padded_rows, 0)));
+  RLWE_RETURN_IF_ERROR(linpir::ParallelFor(
+      num_cols, params_.num_query_threads, query_thread_pool_.get(),
+      [&](int col_begin, int col_end) -> absl::Status {
+        std::vector<LweVector>& partial_result =
+            partial_results[col_begin / cols_per_range];
+        int num_range_cols = col_end - col_begin;
+        for (int i = 0; i < data_matrices_.size(); ++i) {
+          RLWE_RETURN_IF_ERROR(
+              internal::InnerProductAccumulate<lwe::PlainInteger>(
+                  absl::MakeConstSpan(data_matrices_[i])
+                      .subspan(col_begin, num_range_cols),
+                  absl::MakeConstSpan(query).subspan(col_begin,
+                                                     num_range_cols),
+                  absl::MakeSpan(partial_result[i])));
+        }
+        return absl::OkStatus();
+      }));
+
+  std::vector<LweVector> results = std::move(partial_results[0]);
+  for (int i = 0; i < results.size(); ++i) {
+    results[i].resize(params_.db_rows);
+    for (int r = 1; r < num_ranges; ++r) {
+      for (int64_t k = 0; k < params_.db_rows; ++k) {
+        results[i][k] += partial_results[r][i][k];
+      }
+    }
   }
   return results;
 }
@@ -28,7 +28,9 @@
 #include "absl/types/span.h"
 #include "hintless_simplepir/inner_product_hwy.h"
 #include "hintless_simplepir/parameters.h"
+#include "linpir/parallel.h"
 #include "lwe/types.h"
+#include "shell_encryption/serialization.pb.h"
 
 namespace hintless_pir {
 namespace hintless_simplepir {
@@ -62,6 +64,13 @@ class Database {
   // ready for accepting client queries, or after a new LWE query pad is set.
   absl::Status UpdateHints();
 
+  // Updates the hint matrices for the LWE query pad expanded from `prng_seed`
+  // by a PRNG of type `prng_type`. Unlike `UpdateHints()`, the pad is never
+  // held in memory: it is regenerated a tile of rows at a time, and each tile
+  // is multiplied into the hints before the next one is generated.
+  absl::Status UpdateHintsFromSeed(absl::string_view prng_seed,
+                                   rlwe::PrngType prng_type);
+
   // Returns the products between the data matrices and the query vector, one
   // per shard.
   absl::StatusOr<std::vector<LweVector>> InnerProductWith(
@@ -84,7 +93,11 @@ class Database {
         lwe_query_pad_(lwe_query_pad),
         num_records_(num_records),
         data_matrices_(std::move(data_matrices)),
-        hint_matrices_(std::move(hint_matrices)) {}
+        hint_matrices_(std::move(hint_matrices)),
+        query_thread_pool_(params_.num_query_threads > 1
+                               ? std::make_unique<linpir::ThreadPool>(
+                                     params_.num_query_threads - 1)
+                               : nullptr) {}
 
   // Returns the row and the column indices of the given database index to store
   // a record in the data matrices.
@@ -109,6 +122,10 @@ class Database {
 
   // The hint matrices, one per shard of the database. Stored by rows.
   std::vector<LweMatrix> hint_matrices_;
+
+  // The threads computing `InnerProductWith()` along with the calling thread,
+  // shared by all the concurrent requests. Null with one query thread.
+  std::unique_ptr<linpir::ThreadPool> query_thread_pool_;
 };
 
 // Returns a column-major matrix from an eigen3 matrix.
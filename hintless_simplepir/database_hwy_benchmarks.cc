@@ -20,6 +20,7 @@
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "benchmark/benchmark.h"
+#include "benchmarks/perf_counters.h"
 #include "gtest/gtest.h"
 #include "hintless_simplepir/database_hwy.h"
 #include "hintless_simplepir/parameters.h"
@@ -59,6 +60,7 @@ void BM_InnerProductWith(benchmark::State& state) {
 
   std::vector<lwe::Integer> query = testing::GenerateRandomQuery(num_cols);
 
+  benchmarks::ScopedPerfCounters perf_counters(state);
   for (auto _ : state) {
     auto results = database->InnerProductWith(query);
     benchmark::DoNotOptimize(results);
@@ -29,7 +29,9 @@
 #include "hintless_simplepir/testing.h"
 #include "hintless_simplepir/utils.h"
 #include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/prng_type.h"
 #include "lwe/types.h"
+#include "shell_encryption/serialization.pb.h"
 #include "shell_encryption/testing/status_matchers.h"
 #include "shell_encryption/testing/status_testing.h"
 #include "shell_encryption/testing/testing_prng.h"
@@ -179,6 +181,46 @@ TEST_F(DatabaseTest, UpdateHints) {
   }
 }
 
+TEST(Database, UpdateHintsFromSeed) {
+  // More database columns than rows of a pad tile.
+  const Parameters params{
+      .db_rows = 16,
+      .db_cols = 2500,
+      .db_record_bit_size = 8,
+      .lwe_secret_dim = 6,
+      .lwe_modulus_bit_size = 32,
+      .lwe_plaintext_bit_size = 8,
+      .lwe_error_variance = 8,
+  };
+  ASSERT_OK_AND_ASSIGN(auto database, Database::CreateRandom(params));
+  for (rlwe::PrngType prng_type :
+       {rlwe::PRNG_TYPE_HKDF, rlwe::PRNG_TYPE_CHACHA, lwe::kPrngTypeAesCtr}) {
+    ASSERT_OK_AND_ASSIGN(std::string seed, lwe::GeneratePrngSeed(prng_type));
+    ASSERT_OK(database->UpdateHintsFromSeed(seed, prng_type));
+    ASSERT_OK_AND_ASSIGN(lwe::Matrix lwe_query_pad,
+                         lwe::ExpandPadFromSeed(params.db_cols,
+                                                params.lwe_secret_dim, seed,
+                                                prng_type));
+    absl::Span<const Database::RawMatrix> data_matrices = database->Data();
+    absl::Span<const Database::LweMatrix> hint_matrices = database->Hints();
+    ASSERT_EQ(data_matrices.size(), hint_matrices.size());
+    for (int i = 0; i < data_matrices.size(); ++i) {
+      lwe::Matrix data_matrix = ExportRawMatrix(
+          data_matrices[i], params.db_rows, params.lwe_plaintext_bit_size);
+      lwe::Matrix hint_matrix = ExportLweMatrix(hint_matrices[i]).transpose();
+      lwe::Matrix expected_hint = data_matrix * lwe_query_pad;
+      EXPECT_EQ(hint_matrix, expected_hint);
+    }
+  }
+}
+
+TEST(Database, UpdateHintsFromSeedFailsIfInvalidPrngType) {
+  ASSERT_OK_AND_ASSIGN(auto database, Database::Create(kParameters));
+  EXPECT_THAT(
+      database->UpdateHintsFromSeed("seed", rlwe::PRNG_TYPE_INVALID),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST_F(DatabaseTest, AccessRecordWithInvalidIndex) {
   ASSERT_OK_AND_ASSIGN(auto database, Database::Create(kParameters));
   ASSERT_OK(database->UpdateLweQueryPad(this->lwe_query_pad_.get()));
@@ -234,6 +276,39 @@ TEST_F(DatabaseTest, InnerProductWith) {
   }
 }
 
+TEST(Database, InnerProductWithMultipleThreads) {
+  for (int num_threads : {2, 5, static_cast<int>(kParameters.db_cols) + 1}) {
+    Parameters params = kParameters;
+    params.num_query_threads = num_threads;
+    ASSERT_OK_AND_ASSIGN(auto database, Database::CreateRandom(params));
+    lwe::Vector query = lwe::Vector::Random(params.db_cols);
+    ASSERT_OK_AND_ASSIGN(
+        std::vector<Database::LweVector> product,
+        database->InnerProductWith(
+            Database::LweVector(query.data(), query.data() + query.size())));
+    absl::Span<const Database::RawMatrix> data_matrices = database->Data();
+    ASSERT_EQ(product.size(), data_matrices.size());
+    for (int i = 0; i < product.size(); ++i) {
+      lwe::Vector expected =
+          ExportRawMatrix(data_matrices[i], params.db_rows,
+                          params.lwe_plaintext_bit_size) *
+          query;
+      EXPECT_EQ(product[i],
+                Database::LweVector(expected.data(),
+                                    expected.data() + expected.size()))
+          << "num_threads " << num_threads;
+    }
+  }
+}
+
+TEST(Database, InnerProductWithFailsIfQueryHasIncorrectSize) {
+  ASSERT_OK_AND_ASSIGN(auto database, Database::CreateRandom(kParameters));
+  Database::LweVector query(kParameters.db_cols + 1, 0);
+  EXPECT_THAT(database->InnerProductWith(query),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("one value per database column")));
+}
+
 }  // namespace
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
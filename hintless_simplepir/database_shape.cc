@@ -0,0 +1,157 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hintless_simplepir/database_shape.h"
+
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "hintless_simplepir/inner_product_hwy.h"
+#include "hintless_simplepir/parameter_selection.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/utils.h"
+#include "lwe/types.h"
+#include "shell_encryption/status_macros.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+
+namespace {
+
+// Nominal cost of a modular multiplication of 64-bit integers.
+constexpr double kNominalModMulNs = 1;
+
+// Nominal cost of a database value in the LWE matrix-vector product, which
+// multiplies 8-bit values by 32-bit query entries many at a time in SIMD
+// registers.
+constexpr double kNominalLweNsPerValue = 0.125;
+
+double Objective(const CostEstimate& estimate, ShapeObjective objective) {
+  switch (objective) {
+    case ShapeObjective::kLatency:
+      return estimate.server_ms_per_query;
+    case ShapeObjective::kDownload:
+      return estimate.download_bytes;
+    case ShapeObjective::kTotalBytes:
+      return estimate.upload_bytes + estimate.download_bytes;
+  }
+  return 0;
+}
+
+}  // namespace
+
+int64_t DatabaseRowAlignment(const Parameters& params) {
+  constexpr int64_t kNumValuesPerBlock =
+      sizeof(internal::BlockType) / sizeof(lwe::PlainInteger);
+  return std::lcm<int64_t>(params.linpir_params.rows_per_block,
+                           kNumValuesPerBlock);
+}
+
+CostModel NominalCostModel(const Parameters& params) {
+  const auto& rlwe_params = params.linpir_params;
+  int log_n = rlwe_params.log_n;
+  int num_qs = rlwe_params.qs.size();
+  double n = int64_t{1} << log_n;
+  int num_digits = NumGadgetDigits(rlwe_params);
+  // A rotation converts the query out of NTT form, decomposes it into gadget
+  // digits, and takes the inner product of their NTTs with the Galois key.
+  // Absorbing a diagonal is one coefficient-wise product.
+  double ntt_mod_muls = n / 2 * log_n;
+  double rotation_mod_muls =
+      num_qs * (ntt_mod_muls + num_digits * (ntt_mod_muls + 2 * n));
+  double absorb_mod_muls = num_qs * n;
+  double encode_mod_muls = num_qs * ntt_mod_muls;
+
+  CostModel model;
+  model.lwe = LweCosts{
+      .query_ns_per_value = kNominalLweNsPerValue,
+      .hint_ns_per_product = kNominalLweNsPerValue,
+      .pad_ns_per_value = kNominalModMulNs,
+  };
+  model.rlwe[std::make_pair(log_n, num_qs)] = RlweCosts{
+      .rotation_ns = rotation_mod_muls * kNominalModMulNs,
+      .absorb_ns = absorb_mod_muls * kNominalModMulNs,
+      .encode_ns = encode_mod_muls * kNominalModMulNs,
+      .pad_rotation_ns = rotation_mod_muls * kNominalModMulNs,
+      .pad_absorb_ns = absorb_mod_muls * kNominalModMulNs,
+  };
+  return model;
+}
+
+absl::StatusOr<Parameters> SelectDatabaseShape(int64_t num_records,
+                                               int record_bit_size,
+                                               ShapeObjective objective,
+                                               const Parameters& base_params,
+                                               const CostModel& model) {
+  if (num_records <= 0) {
+    return absl::InvalidArgumentError("`num_records` must be positive.");
+  }
+  if (record_bit_size <= 0) {
+    return absl::InvalidArgumentError("`record_bit_size` must be positive.");
+  }
+  if (base_params.linpir_params.rows_per_block <= 0) {
+    return absl::InvalidArgumentError("`rows_per_block` must be positive.");
+  }
+
+  Parameters params = base_params;
+  params.db_record_bit_size = record_bit_size;
+  int64_t alignment = DatabaseRowAlignment(params);
+  std::optional<Parameters> best;
+  double best_objective = 0;
+  int64_t prev_db_cols = -1;
+  for (params.db_rows = alignment;; params.db_rows += alignment) {
+    params.db_cols = DivAndRoundUp(num_records, params.db_rows);
+    // The LWE error sampler needs even sizes.
+    params.db_cols += params.db_cols % 2;
+    // For a fixed number of columns, more rows only cost more.
+    bool is_new_shape = params.db_cols != prev_db_cols;
+    prev_db_cols = params.db_cols;
+    if (is_new_shape && EstimateFailureProbabilities(params).lwe <=
+                            kMaxLog2LweFailureProbability) {
+      RLWE_ASSIGN_OR_RETURN(CostEstimate estimate,
+                            EstimateCost(params, model));
+      double value = Objective(estimate, objective);
+      if (!best.has_value() || value < best_objective) {
+        best = params;
+        best_objective = value;
+      }
+    }
+    if (params.db_cols <= 2) {
+      break;
+    }
+  }
+  if (!best.has_value()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "No database shape for ", num_records,
+        " records keeps the LWE failure probability below 2^",
+        kMaxLog2LweFailureProbability, "."));
+  }
+  return *std::move(best);
+}
+
+absl::StatusOr<Parameters> SelectDatabaseShape(int64_t num_records,
+                                               int record_bit_size,
+                                               ShapeObjective objective,
+                                               const Parameters& base_params) {
+  return SelectDatabaseShape(num_records, record_bit_size, objective,
+                             base_params, NominalCostModel(base_params));
+}
+
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_HINTLESS_SIMPLEPIR_DATABASE_SHAPE_H_
+#define HINTLESS_PIR_HINTLESS_SIMPLEPIR_DATABASE_SHAPE_H_
+
+#include <cstdint>
+
+#include "absl/status/statusor.h"
+#include "hintless_simplepir/parameter_selection.h"
+#include "hintless_simplepir/parameters.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+
+// The quantity minimized when choosing the shape of a database.
+enum class ShapeObjective {
+  // Server CPU time per query.
+  kLatency,
+  // Size of a response, including the LinPIR response hints.
+  kDownload,
+  // Size of a request and its response.
+  kTotalBytes,
+};
+
+// Largest base-2 log of the probability that the LWE error of a record shard
+// prevents decoding, which bounds the number of columns of a database.
+inline constexpr double kMaxLog2LweFailureProbability = -40;
+
+// Returns the granularity of `db_rows` under `params`: a multiple of the LinPIR
+// `rows_per_block` and of the number of values packed in a database block.
+int64_t DatabaseRowAlignment(const Parameters& params);
+
+// Returns a host-independent cost model for the RLWE parameters of `params`,
+// counting modular multiplications at a nominal cost. It ranks database shapes
+// sensibly but its absolute times are only indicative; use a model calibrated
+// by `parameter_selector` for those.
+CostModel NominalCostModel(const Parameters& params);
+
+// Returns `base_params` with `db_rows`, `db_cols` and `db_record_bit_size` set
+// to hold `num_records` records of `record_bit_size` bits, minimizing
+// `objective` per `model`. `db_rows` is a multiple of
+// `DatabaseRowAlignment(base_params)` and `db_cols` is even.
+absl::StatusOr<Parameters> SelectDatabaseShape(int64_t num_records,
+                                               int record_bit_size,
+                                               ShapeObjective objective,
+                                               const Parameters& base_params,
+                                               const CostModel& model);
+
+// As above, using `NominalCostModel(base_params)`.
+absl::StatusOr<Parameters> SelectDatabaseShape(int64_t num_records,
+                                               int record_bit_size,
+                                               ShapeObjective objective,
+                                               const Parameters& base_params);
+
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_HINTLESS_SIMPLEPIR_DATABASE_SHAPE_H_
@@ -0,0 +1,148 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hintless_simplepir/database_shape.h"
+
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "hintless_simplepir/parameter_selection.h"
+#include "hintless_simplepir/parameters.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/testing/status_matchers.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+using rlwe::testing::StatusIs;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+double ObjectiveValue(const Parameters& params, ShapeObjective objective) {
+  CostEstimate estimate = EstimateCost(params, NominalCostModel(params)).value();
+  switch (objective) {
+    case ShapeObjective::kLatency:
+      return estimate.server_ms_per_query;
+    case ShapeObjective::kDownload:
+      return estimate.download_bytes;
+    case ShapeObjective::kTotalBytes:
+      return estimate.upload_bytes + estimate.download_bytes;
+  }
+  return 0;
+}
+
+TEST(DatabaseShapeTest, RowAlignment) {
+  Parameters params = kParameters;
+  EXPECT_EQ(DatabaseRowAlignment(params), 1024);
+  params.linpir_params.rows_per_block = 8;
+  EXPECT_EQ(DatabaseRowAlignment(params), 16);
+  params.linpir_params.rows_per_block = 48;
+  EXPECT_EQ(DatabaseRowAlignment(params), 48);
+}
+
+TEST(DatabaseShapeTest, SelectedShapeHoldsRecords) {
+  constexpr int64_t kNumRecords = 1000000;
+  for (ShapeObjective objective :
+       {ShapeObjective::kLatency, ShapeObjective::kDownload,
+        ShapeObjective::kTotalBytes}) {
+    ASSERT_OK_AND_ASSIGN(
+        Parameters params,
+        SelectDatabaseShape(kNumRecords, /*record_bit_size=*/32, objective,
+                            kParameters));
+    EXPECT_EQ(params.db_record_bit_size, 32);
+    EXPECT_EQ(params.db_rows % DatabaseRowAlignment(kParameters), 0);
+    EXPECT_EQ(params.db_cols % 2, 0);
+    EXPECT_GE(params.db_rows * params.db_cols, kNumRecords);
+    EXPECT_LE(EstimateFailureProbabilities(params).lwe,
+              kMaxLog2LweFailureProbability);
+    EXPECT_EQ(params.linpir_params.rows_per_block,
+              kParameters.linpir_params.rows_per_block);
+  }
+}
+
+TEST(DatabaseShapeTest, SelectedShapeIsNoWorseThanSquare) {
+  // The 1024 x 1024 shape of `kParameters` is one of the candidates.
+  for (ShapeObjective objective :
+       {ShapeObjective::kLatency, ShapeObjective::kDownload,
+        ShapeObjective::kTotalBytes}) {
+    ASSERT_OK_AND_ASSIGN(
+        Parameters params,
+        SelectDatabaseShape(kParameters.db_rows * kParameters.db_cols,
+                            kParameters.db_record_bit_size, objective,
+                            kParameters));
+    EXPECT_LE(ObjectiveValue(params, objective),
+              ObjectiveValue(kParameters, objective));
+  }
+}
+
+TEST(DatabaseShapeTest, DownloadPrefersFewerRows) {
+  constexpr int64_t kNumRecords = 1 << 22;
+  ASSERT_OK_AND_ASSIGN(
+      Parameters download,
+      SelectDatabaseShape(kNumRecords, 64, ShapeObjective::kDownload,
+                          kParameters));
+  ASSERT_OK_AND_ASSIGN(
+      Parameters total_bytes,
+      SelectDatabaseShape(kNumRecords, 64, ShapeObjective::kTotalBytes,
+                          kParameters));
+  EXPECT_LE(download.db_rows, total_bytes.db_rows);
+}
+
+TEST(DatabaseShapeTest, FewRecords) {
+  ASSERT_OK_AND_ASSIGN(
+      Parameters params,
+      SelectDatabaseShape(10, 8, ShapeObjective::kTotalBytes, kParameters));
+  EXPECT_EQ(params.db_rows, 1024);
+  EXPECT_EQ(params.db_cols, 2);
+}
+
+TEST(DatabaseShapeTest, FailsWithInvalidArguments) {
+  EXPECT_THAT(
+      SelectDatabaseShape(0, 8, ShapeObjective::kLatency, kParameters),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(
+      SelectDatabaseShape(1024, 0, ShapeObjective::kLatency, kParameters),
+      StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(SelectDatabaseShape(1024, 8, ShapeObjective::kLatency,
+                                  kParameters, CostModel{}),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
@@ -0,0 +1,432 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_HINTLESS_SIMPLEPIR_DOUBLEPIR_H_
+#define HINTLESS_PIR_HINTLESS_SIMPLEPIR_DOUBLEPIR_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "hintless_simplepir/database_hwy.h"
+#include "hintless_simplepir/parameters.h"
+#include "lwe/encode.h"
+#include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/prng_type.h"
+#include "lwe/sample_error.h"
+#include "lwe/types.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/status_macros.h"
+
+// An implementation of DoublePIR [1], which shrinks the hint of SimplePIR (see
+// simplepir.h) by running a second level of SimplePIR over it.
+//
+// In SimplePIR the client downloads the hint H = D * A1 of size
+// db_rows x lwe_secret_dim, and uses the row of H matching its query. Here the
+// server instead decomposes H into base-2^8 digits and treats the digit matrix
+// as a second database, indexed by the database row. The client sends a second
+// LWE query selecting its row, and the server answers it over the digits of
+// both H and of the first-level answer D * c1. The client only downloads the
+// hint of the second level, of size
+//   lwe_secret_dim * kNumDigits x lwe_secret_dim,
+// which no longer depends on the size of the database.
+//
+// [1]: https://eprint.iacr.org/2022/949
+
+namespace hintless_pir {
+namespace simplepir {
+
+// The server state of DoublePIR: the packed records, and the packed digits of
+// the first-level hint, stored by rows of the second-level database.
+struct DoublePirDatabase {
+  std::unique_ptr<hintless_simplepir::Database> records;
+  std::unique_ptr<hintless_simplepir::Database> hint_digits;
+};
+
+// The client state, holding the row and the column of the queried record and
+// the LWE secrets of both levels.
+struct DoublePirClientState {
+  int row_idx;
+  int col_idx;
+  lwe::Vector first_key;
+  lwe::Vector second_key;
+};
+
+// A DoublePIR query: LWE encryptions of the selection vectors of the column
+// (first level) and of the row (second level) of the queried record.
+struct DoublePirQuery {
+  lwe::Vector col_query;
+  lwe::Vector row_query;
+};
+
+// A DoublePIR response. `hint_part` answers the second-level query over the
+// digits of the first-level hint, whose second-level hint is downloaded once.
+// `answer_part` answers it over the digits of the first-level answer, whose
+// second-level hint `answer_pad` is sent along.
+struct DoublePirResponse {
+  lwe::Vector hint_part;
+  lwe::Vector answer_part;
+  lwe::Matrix answer_pad;
+};
+
+// The public parameters required by both the Client and Server to execute
+// the DoublePIR protocol.
+template <typename Prng = rlwe::SingleThreadHkdfPrng>
+class DoublePirParems {
+ public:
+  // Number of bits of the digits of the first-level hint and answer, which are
+  // the records of the second level.
+  static constexpr int kDigitBits = 8 * sizeof(lwe::PlainInteger);
+
+  // Number of digits per value mod the LWE modulus.
+  static constexpr int kNumDigits = lwe::kIntBitwidth / kDigitBits;
+
+  // Create a new set of Parems. The LWE query pads of the first and the second
+  // level are expanded from `first_seed` and `second_seed`.
+  static DoublePirParems Create(absl::string_view first_seed,
+                                absl::string_view second_seed,
+                                int lwe_secret_dim, int record_bit_size,
+                                int db_rows, int db_cols) {
+    return DoublePirParems(first_seed, second_seed, lwe_secret_dim,
+                           record_bit_size, db_rows, db_cols);
+  }
+
+  // Packs `database` into the server state, whose inner products are computed
+  // with `num_threads` threads. Requires `RecordBitSize()` to be at most 8.
+  absl::StatusOr<DoublePirDatabase> PackDatabase(const lwe::Matrix& database,
+                                                 int num_threads = 1) const {
+    if (database.cols() != DbCols() || database.rows() != DbRows()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The database is ", database.rows(), " x ", database.cols(),
+          ", which does not match the public parameters, ", DbRows(), " x ",
+          DbCols(), "."));
+    }
+    if (RecordBitSize() <= 0 || RecordBitSize() > kDigitBits) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("The record bit size, ", RecordBitSize(),
+                       ", does not fit in a packed database value."));
+    }
+    if (num_threads < 1) {
+      return absl::InvalidArgumentError("`num_threads` must be positive.");
+    }
+    DoublePirDatabase packed;
+    RLWE_ASSIGN_OR_RETURN(
+        packed.records,
+        hintless_simplepir::Database::Create(DatabaseParameters(
+            DbRows(), DbCols(), RecordBitSize(), num_threads)));
+    RLWE_ASSIGN_OR_RETURN(
+        packed.hint_digits,
+        hintless_simplepir::Database::Create(DatabaseParameters(
+            NumHintDigits(), DbRows(), kDigitBits, num_threads)));
+    // The packed database stores its records row after row.
+    for (int i = 0; i < DbRows(); ++i) {
+      for (int j = 0; j < DbCols(); ++j) {
+        RLWE_RETURN_IF_ERROR(packed.records->Append(
+            std::string(1, static_cast<char>(database(i, j)))));
+      }
+    }
+    return packed;
+  }
+
+  // Preprocesses the first-level hint of `database`, decomposes it into the
+  // second-level database, and returns the second-level hint for the client.
+  // Both LWE query pads are streamed from their seeds.
+  absl::StatusOr<lwe::Matrix> ServerPreprocess(
+      DoublePirDatabase* database) const {
+    if (database == nullptr || database->records == nullptr ||
+        database->hint_digits == nullptr) {
+      return absl::InvalidArgumentError("`database` must not be null.");
+    }
+    if (database->hint_digits->NumRecords() != 0) {
+      return absl::FailedPreconditionError(
+          "`database` has already been preprocessed.");
+    }
+    constexpr rlwe::PrngType prng_type = lwe::PrngTypeOf<Prng>();
+    RLWE_RETURN_IF_ERROR(
+        database->records->UpdateHintsFromSeed(FirstSeed(), prng_type));
+
+    // Row j * kNumDigits + k of the second-level database holds digit k of
+    // column j of the first-level hint, which is stored by rows.
+    const hintless_simplepir::Database::LweMatrix& hint =
+        database->records->Hints()[0];
+    for (int j = 0; j < LweSecretDim(); ++j) {
+      for (int k = 0; k < kNumDigits; ++k) {
+        for (int i = 0; i < DbRows(); ++i) {
+          RLWE_RETURN_IF_ERROR(database->hint_digits->Append(
+              std::string(1, static_cast<char>(Digit(hint[i][j], k)))));
+        }
+      }
+    }
+    RLWE_RETURN_IF_ERROR(
+        database->hint_digits->UpdateHintsFromSeed(SecondSeed(), prng_type));
+    return hintless_simplepir::ExportLweMatrix(
+               database->hint_digits->Hints()[0])
+        .transpose()
+        .eval();
+  }
+
+  absl::StatusOr<std::pair<DoublePirClientState, DoublePirQuery>> ClientQuery(
+      int query_idx) const {
+    int db_size = DbRows() * DbCols();
+    if (query_idx < 0 || query_idx >= db_size) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("The query index, ", query_idx, " is out of range."));
+    }
+    RLWE_ASSIGN_OR_RETURN(std::shared_ptr<const lwe::Matrix> first_pad,
+                          FirstPad());
+    RLWE_ASSIGN_OR_RETURN(std::shared_ptr<const lwe::Matrix> second_pad,
+                          SecondPad());
+    int col_idx = query_idx / DbRows();
+    int row_idx = query_idx % DbRows();
+    RLWE_ASSIGN_OR_RETURN(std::string client_seed, Prng::GenerateSeed());
+    RLWE_ASSIGN_OR_RETURN(auto client_prng, Prng::Create(client_seed));
+    RLWE_ASSIGN_OR_RETURN(
+        lwe::SymmetricLweKey first_key,
+        lwe::SymmetricLweKey::Sample(LweSecretDim(), client_prng.get()));
+    RLWE_ASSIGN_OR_RETURN(
+        lwe::SymmetricLweKey second_key,
+        lwe::SymmetricLweKey::Sample(LweSecretDim(), client_prng.get()));
+
+    // The first level selects the column among the records.
+    DoublePirQuery query;
+    query.col_query = lwe::Vector::Zero(DbCols());
+    query.col_query[col_idx] = 1;
+    RLWE_RETURN_IF_ERROR(first_key.EncryptFromPadInPlace(
+        query.col_query, *first_pad, lwe::kIntBitwidth - RecordBitSize(),
+        client_prng.get()));
+
+    // The second level selects the row among the digits.
+    query.row_query = lwe::Vector::Zero(DbRows());
+    query.row_query[row_idx] = 1;
+    RLWE_RETURN_IF_ERROR(second_key.EncryptFromPadInPlace(
+        query.row_query, *second_pad, lwe::kIntBitwidth - kDigitBits,
+        client_prng.get()));
+
+    DoublePirClientState client_state{.row_idx = row_idx,
+                                      .col_idx = col_idx,
+                                      .first_key = first_key.Key(),
+                                      .second_key = second_key.Key()};
+    return std::make_pair(std::move(client_state), std::move(query));
+  }
+
+  // Computes and returns the ServerResponse, answering the second-level query
+  // over the digits of the first-level hint and of the first-level answer
+  // database * col_query.
+  absl::StatusOr<DoublePirResponse> ServerResponse(
+      const DoublePirDatabase& database, const DoublePirQuery& query) const {
+    if (query.col_query.size() != DbCols()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The size of the column query, ", query.col_query.size(),
+          " does not match the number of cols in the public parameters, ",
+          DbCols(), "."));
+    }
+    if (query.row_query.size() != DbRows()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The size of the row query, ", query.row_query.size(),
+          " does not match the number of rows in the public parameters, ",
+          DbRows(), "."));
+    }
+    RLWE_ASSIGN_OR_RETURN(std::shared_ptr<const lwe::Matrix> second_pad,
+                          SecondPad());
+    RLWE_ASSIGN_OR_RETURN(
+        std::vector<hintless_simplepir::Database::LweVector> answers,
+        database.records->InnerProductWith(ToLweVector(query.col_query)));
+    RLWE_ASSIGN_OR_RETURN(
+        std::vector<hintless_simplepir::Database::LweVector> hint_parts,
+        database.hint_digits->InnerProductWith(ToLweVector(query.row_query)));
+
+    // The digits of the first-level answer form a kNumDigits x DbRows()
+    // database, small enough to be answered with its pad on the fly.
+    const hintless_simplepir::Database::LweVector& answer = answers[0];
+    lwe::Matrix answer_digits(kNumDigits, DbRows());
+    for (int i = 0; i < DbRows(); ++i) {
+      for (int k = 0; k < kNumDigits; ++k) {
+        answer_digits(k, i) = Digit(answer[i], k);
+      }
+    }
+    DoublePirResponse response;
+    response.hint_part = Eigen::Map<const lwe::Vector>(hint_parts[0].data(),
+                                                       hint_parts[0].size());
+    response.answer_part = answer_digits * query.row_query;
+    response.answer_pad = answer_digits * *second_pad;
+    return response;
+  }
+
+  absl::StatusOr<lwe::Integer> ClientRecovery(
+      const DoublePirClientState& state, const lwe::Matrix& hint,
+      const DoublePirResponse& response) const {
+    if (hint.rows() != NumHintDigits() || hint.cols() != LweSecretDim()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The hint is ", hint.rows(), " x ", hint.cols(),
+          ", which does not match the public parameters, ", NumHintDigits(),
+          " x ", LweSecretDim(), "."));
+    }
+    if (response.hint_part.size() != NumHintDigits() ||
+        response.answer_part.size() != kNumDigits ||
+        response.answer_pad.rows() != kNumDigits ||
+        response.answer_pad.cols() != LweSecretDim()) {
+      return absl::InvalidArgumentError(
+          "The server response does not match the public parameters.");
+    }
+    if (state.first_key.size() != LweSecretDim() ||
+        state.second_key.size() != LweSecretDim()) {
+      return absl::InvalidArgumentError(
+          "The client state does not match the public parameters.");
+    }
+
+    // Decrypt the digits of the queried row of the first-level hint and of
+    // the first-level answer.
+    int log_digit_scaling_factor = lwe::kIntBitwidth - kDigitBits;
+    lwe::Vector hint_digits = response.hint_part - hint * state.second_key;
+    RLWE_RETURN_IF_ERROR(
+        lwe::RemoveErrorInPlace(hint_digits, log_digit_scaling_factor));
+    lwe::Vector answer_digits =
+        response.answer_part - response.answer_pad * state.second_key;
+    RLWE_RETURN_IF_ERROR(
+        lwe::RemoveErrorInPlace(answer_digits, log_digit_scaling_factor));
+
+    // Recompose them, and remove hint * s from the first-level answer, which
+    // gives us \Delta * m + e.
+    lwe::Vector hint_row(LweSecretDim());
+    for (int j = 0; j < LweSecretDim(); ++j) {
+      hint_row[j] = Recompose(hint_digits.segment(j * kNumDigits, kNumDigits));
+    }
+    lwe::Vector noisy_plaintext(1);
+    noisy_plaintext[0] =
+        Recompose(answer_digits) - hint_row.dot(state.first_key);
+
+    // Remove the error e.
+    RLWE_RETURN_IF_ERROR(lwe::RemoveErrorInPlace(
+        noisy_plaintext, lwe::kIntBitwidth - RecordBitSize()));
+    return noisy_plaintext[0];
+  }
+
+  // Expands both LWE query pads once and keeps them, so that `ClientQuery()`
+  // and `ServerResponse()` no longer expand them from the seeds on every
+  // call. The cached pads are shared by copies of these parameters.
+  absl::Status CachePads() {
+    RLWE_ASSIGN_OR_RETURN(first_pad_,
+                          ExpandPad(FirstSeed(), DbCols(), LweSecretDim()));
+    RLWE_ASSIGN_OR_RETURN(second_pad_,
+                          ExpandPad(SecondSeed(), DbRows(), LweSecretDim()));
+    return absl::OkStatus();
+  }
+
+  // Accessors.
+  absl::string_view FirstSeed() const { return first_seed_; }
+  absl::string_view SecondSeed() const { return second_seed_; }
+  int LweSecretDim() const { return lwe_secret_dim_; }
+  int RecordBitSize() const { return record_bit_size_; }
+  int DbRows() const { return db_rows_; }
+  int DbCols() const { return db_cols_; }
+
+  // Number of rows of the second-level database and hint.
+  int NumHintDigits() const { return LweSecretDim() * kNumDigits; }
+
+ private:
+  explicit DoublePirParems(absl::string_view first_seed,
+                           absl::string_view second_seed, int lwe_secret_dim,
+                           int record_bit_size, int db_rows, int db_cols)
+      : first_seed_(std::string{first_seed}),
+        second_seed_(std::string{second_seed}),
+        lwe_secret_dim_(lwe_secret_dim),
+        record_bit_size_(record_bit_size),
+        db_rows_(db_rows),
+        db_cols_(db_cols) {}
+
+  // Returns the parameters of a packed `num_rows` x `num_cols` database with
+  // values of `value_bit_size` bits.
+  hintless_simplepir::Parameters DatabaseParameters(int num_rows,
+                                                    int num_cols,
+                                                    int value_bit_size,
+                                                    int num_threads) const {
+    return hintless_simplepir::Parameters{
+        .db_rows = num_rows,
+        .db_cols = num_cols,
+        .db_record_bit_size = value_bit_size,
+        .lwe_secret_dim = LweSecretDim(),
+        .lwe_modulus_bit_size = lwe::kIntBitwidth,
+        .lwe_plaintext_bit_size = value_bit_size,
+        .prng_type = lwe::PrngTypeOf<Prng>(),
+        .num_query_threads = num_threads,
+    };
+  }
+
+  // Returns digit `k` of `value` in base 2^kDigitBits.
+  static lwe::Integer Digit(lwe::Integer value, int k) {
+    return (value >> (k * kDigitBits)) & ((lwe::Integer{1} << kDigitBits) - 1);
+  }
+
+  // Returns the value whose digits in base 2^kDigitBits are `digits`.
+  static lwe::Integer Recompose(const lwe::Vector& digits) {
+    lwe::Integer value = 0;
+    for (int k = 0; k < kNumDigits; ++k) {
+      value |= digits[k] << (k * kDigitBits);
+    }
+    return value;
+  }
+
+  static hintless_simplepir::Database::LweVector ToLweVector(
+      const lwe::Vector& vector) {
+    return hintless_simplepir::Database::LweVector(
+        vector.data(), vector.data() + vector.size());
+  }
+
+  // Returns the `num_rows` x `num_cols` LWE query pad expanded from `seed`.
+  static absl::StatusOr<std::shared_ptr<const lwe::Matrix>> ExpandPad(
+      absl::string_view seed, int num_rows, int num_cols) {
+    RLWE_ASSIGN_OR_RETURN(auto pad_prng, Prng::Create(seed));
+    RLWE_ASSIGN_OR_RETURN(
+        lwe::Matrix pad,
+        lwe::SampleUniformMatrix(num_rows, num_cols, pad_prng.get()));
+    return std::make_shared<const lwe::Matrix>(std::move(pad));
+  }
+
+  // Return the cached LWE query pads if any, or freshly expanded ones.
+  absl::StatusOr<std::shared_ptr<const lwe::Matrix>> FirstPad() const {
+    if (first_pad_ != nullptr) {
+      return first_pad_;
+    }
+    return ExpandPad(FirstSeed(), DbCols(), LweSecretDim());
+  }
+  absl::StatusOr<std::shared_ptr<const lwe::Matrix>> SecondPad() const {
+    if (second_pad_ != nullptr) {
+      return second_pad_;
+    }
+    return ExpandPad(SecondSeed(), DbRows(), LweSecretDim());
+  }
+
+  std::string first_seed_;
+  std::string second_seed_;
+  int lwe_secret_dim_;
+  int record_bit_size_;
+  int db_rows_;
+  int db_cols_;
+
+  // The LWE query pads cached by `CachePads()`, or null.
+  std::shared_ptr<const lwe::Matrix> first_pad_;
+  std::shared_ptr<const lwe::Matrix> second_pad_;
+};
+
+}  // namespace simplepir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_HINTLESS_SIMPLEPIR_DOUBLEPIR_H_
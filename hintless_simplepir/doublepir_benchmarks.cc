@@ -0,0 +1,137 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the server response of plain SimplePIR and of DoublePIR on the
+// same packed database, reporting the hint, upload and download sizes of each
+// mode as counters.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "benchmark/benchmark.h"
+#include "benchmarks/perf_counters.h"
+#include "gtest/gtest.h"
+#include "hintless_simplepir/doublepir.h"
+#include "hintless_simplepir/simplepir.h"
+#include "lwe/types.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+
+ABSL_FLAG(int, num_rows, 1024, "Number of rows");
+ABSL_FLAG(int, num_cols, 1024, "Number of cols");
+ABSL_FLAG(int, lwe_secret_dim, 1024, "Dimension of the LWE secrets");
+ABSL_FLAG(int, num_threads, 1, "Number of threads of the server");
+
+namespace hintless_pir {
+namespace simplepir {
+namespace {
+
+using Prng = rlwe::SingleThreadHkdfPrng;
+
+constexpr int kRecordBitSize = 8;
+constexpr double kIntegerKiB = sizeof(lwe::Integer) / 1024.0;
+
+lwe::Matrix GenerateDatabase(int num_rows, int num_cols) {
+  lwe::Matrix database = lwe::Matrix::Random(num_rows, num_cols);
+  return database.array()
+      .unaryExpr([](lwe::Integer x) { return x % (1 << kRecordBitSize); })
+      .eval();
+}
+
+void BM_SimplePirServerResponse(benchmark::State& state) {
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_cols = absl::GetFlag(FLAGS_num_cols);
+  int lwe_secret_dim = absl::GetFlag(FLAGS_lwe_secret_dim);
+  auto parems =
+      Parems<Prng>::Create(Prng::GenerateSeed().value(), lwe_secret_dim,
+                           kRecordBitSize, num_rows, num_cols);
+  ASSERT_TRUE(parems.CachePad().ok());
+  auto database = parems
+                      .PackDatabase(GenerateDatabase(num_rows, num_cols),
+                                    absl::GetFlag(FLAGS_num_threads))
+                      .value();
+  lwe::Matrix hint = parems.ServerPreprocess(database.get()).value();
+  ClientState client_state;
+  lwe::Vector query;
+  std::tie(client_state, query) = parems.ClientQuery(1, hint).value();
+
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto response = parems.ServerResponse(*database, query);
+    benchmark::DoNotOptimize(response);
+  }
+  state.counters["hint_KiB"] = hint.size() * kIntegerKiB;
+  state.counters["up_KiB"] = query.size() * kIntegerKiB;
+  state.counters["down_KiB"] = num_rows * kIntegerKiB;
+}
+BENCHMARK(BM_SimplePirServerResponse);
+
+void BM_DoublePirServerResponse(benchmark::State& state) {
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_cols = absl::GetFlag(FLAGS_num_cols);
+  int lwe_secret_dim = absl::GetFlag(FLAGS_lwe_secret_dim);
+  auto parems = DoublePirParems<Prng>::Create(
+      Prng::GenerateSeed().value(), Prng::GenerateSeed().value(),
+      lwe_secret_dim, kRecordBitSize, num_rows, num_cols);
+  ASSERT_TRUE(parems.CachePads().ok());
+  auto database = parems
+                      .PackDatabase(GenerateDatabase(num_rows, num_cols),
+                                    absl::GetFlag(FLAGS_num_threads))
+                      .value();
+  lwe::Matrix hint = parems.ServerPreprocess(&database).value();
+  DoublePirClientState client_state;
+  DoublePirQuery query;
+  std::tie(client_state, query) = parems.ClientQuery(1).value();
+
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto response = parems.ServerResponse(database, query);
+    benchmark::DoNotOptimize(response);
+  }
+  DoublePirResponse response = parems.ServerResponse(database, query).value();
+  state.counters["hint_KiB"] = hint.size() * kIntegerKiB;
+  state.counters["up_KiB"] =
+      (query.col_query.size() + query.row_query.size()) * kIntegerKiB;
+  state.counters["down_KiB"] =
+      (response.hint_part.size() + response.answer_part.size() +
+       response.answer_pad.size()) *
+      kIntegerKiB;
+}
+BENCHMARK(BM_DoublePirServerResponse);
+
+}  // namespace
+}  // namespace simplepir
+}  // namespace hintless_pir
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,128 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hintless_simplepir/doublepir.h"
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lwe/types.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/testing/status_matchers.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace simplepir {
+namespace {
+
+using rlwe::testing::StatusIs;
+using Prng = rlwe::SingleThreadHkdfPrng;
+
+class DoublePirTest : public testing::Test {
+ protected:
+  using Parems = simplepir::DoublePirParems<Prng>;
+  // Samples a database and set of parems once for all tests
+  void SetUp() override {
+    constexpr int db_rows = 40;
+    constexpr int db_cols = 60;
+    constexpr int record_bit_size = 8;
+    constexpr int lwe_secret_dim = 20;
+    parems_ = std::make_unique<Parems>(Parems::Create(
+        Prng::GenerateSeed().value(), Prng::GenerateSeed().value(),
+        lwe_secret_dim, record_bit_size, db_rows, db_cols));
+    database_ = lwe::Matrix::Random(db_rows, db_cols);
+    database_ = database_.array().unaryExpr(
+        [&](lwe::Integer x) { return x % (1 << record_bit_size); });
+  }
+
+  std::unique_ptr<Parems> parems_;
+  lwe::Matrix database_;
+};
+
+// Tests functional correctness of DoublePIR end-to-end.
+TEST_F(DoublePirTest, EndToEndTest) {
+  ASSERT_OK_AND_ASSIGN(DoublePirDatabase database,
+                       parems_->PackDatabase(database_, /*num_threads=*/2));
+  ASSERT_OK_AND_ASSIGN(lwe::Matrix hint, parems_->ServerPreprocess(&database));
+  EXPECT_EQ(hint.rows(), parems_->LweSecretDim() * Parems::kNumDigits);
+  EXPECT_EQ(hint.cols(), parems_->LweSecretDim());
+
+  ASSERT_OK(parems_->CachePads());
+  for (int client_idx :
+       {0, 111, 1234, parems_->DbRows() * parems_->DbCols() - 1}) {
+    // Client: Generates the client state and the PIR query.
+    DoublePirClientState client_state;
+    DoublePirQuery query;
+    ASSERT_OK_AND_ASSIGN(std::tie(client_state, query),
+                         parems_->ClientQuery(client_idx));
+
+    // Server: Handles the query and returns the PIR response.
+    ASSERT_OK_AND_ASSIGN(DoublePirResponse response,
+                         parems_->ServerResponse(database, query));
+
+    // Client: Recover the required database record from the response.
+    ASSERT_OK_AND_ASSIGN(lwe::Integer output,
+                         parems_->ClientRecovery(client_state, hint, response));
+    EXPECT_EQ(output, database_(client_state.row_idx, client_state.col_idx));
+  }
+}
+
+TEST_F(DoublePirTest, PackDatabaseTooLargeBitSizeTest) {
+  auto parems = Parems::Create(parems_->FirstSeed(), parems_->SecondSeed(),
+                               parems_->LweSecretDim(), /*record_bit_size=*/9,
+                               parems_->DbRows(), parems_->DbCols());
+  EXPECT_THAT(parems.PackDatabase(database_),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("does not fit in a packed")));
+}
+
+TEST_F(DoublePirTest, ServerPreprocessTwiceTest) {
+  ASSERT_OK_AND_ASSIGN(DoublePirDatabase database,
+                       parems_->PackDatabase(database_));
+  ASSERT_OK(parems_->ServerPreprocess(&database).status());
+  EXPECT_THAT(parems_->ServerPreprocess(&database),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       testing::HasSubstr("already been preprocessed")));
+}
+
+TEST_F(DoublePirTest, ClientQueryLargeIdxTest) {
+  EXPECT_THAT(parems_->ClientQuery(parems_->DbCols() * parems_->DbRows()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("out of range")));
+}
+
+TEST_F(DoublePirTest, ClientRecoveryHintWrongRowsTest) {
+  ASSERT_OK_AND_ASSIGN(DoublePirDatabase database,
+                       parems_->PackDatabase(database_));
+  ASSERT_OK_AND_ASSIGN(lwe::Matrix hint, parems_->ServerPreprocess(&database));
+  DoublePirClientState client_state;
+  DoublePirQuery query;
+  ASSERT_OK_AND_ASSIGN(std::tie(client_state, query),
+                       parems_->ClientQuery(/*query_idx=*/1));
+  ASSERT_OK_AND_ASSIGN(DoublePirResponse response,
+                       parems_->ServerResponse(database, query));
+  lwe::Matrix malformed_hint = hint.topRows(hint.rows() - 1);
+  EXPECT_THAT(parems_->ClientRecovery(client_state, malformed_hint, response),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("does not match the public")));
+}
+
+}  // namespace
+}  // namespace simplepir
+}  // namespace hintless_pir
@@ -17,10 +17,12 @@
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <type_traits>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "benchmark/benchmark.h"
+#include "benchmarks/perf_counters.h"
 #include "hintless_simplepir/client.h"
 #include "hintless_simplepir/database_hwy.h"
 #include "hintless_simplepir/parameters.h"
@@ -61,15 +63,16 @@ const Parameters kParameters{
 
 // 测试环境封装类，用于初始化 Server 和 Client
 struct BenchmarkEnv {
-  std::unique_ptr<Server> server;
-  std::unique_ptr<Client> client;
+  std::unique_ptr<Server<RlweInteger>> server;
+  std::unique_ptr<Client<RlweInteger>> client;
   HintlessPirServerPublicParams public_params;
 
   BenchmarkEnv(const Parameters& params) {
-    server = Server::CreateWithRandomDatabaseRecords(params).value();
+    server =
+        Server<RlweInteger>::CreateWithRandomDatabaseRecords(params).value();
     server->Preprocess().IgnoreError();
     public_params = server->GetPublicParams();
-    client = Client::Create(params, public_params).value();
+    client = Client<RlweInteger>::Create(params, public_params).value();
   }
 };
 
@@ -89,6 +92,7 @@ void BM_SessionInit_FirstQuery(benchmark::State& state) {
   state.counters["Down (KB)"] = temp_response.ByteSizeLong() / 1024.0;
   state.counters["Hint (KB)"] = env.public_params.ByteSizeLong() / 1024.0;
 
+  benchmarks::ScopedPerfCounters perf_counters(state);
   for (auto _ : state) {
     auto response = env.server->HandleRequest(request);
     benchmark::DoNotOptimize(response);
@@ -119,6 +123,7 @@ void BM_SessionReuse_SubsequentQuery(benchmark::State& state) {
   state.counters["Down (KB)"] = temp_response.ByteSizeLong() / 1024.0;
   state.counters["Hint (KB)"] = env.public_params.ByteSizeLong() / 1024.0;
 
+  benchmarks::ScopedPerfCounters perf_counters(state);
   for (auto _ : state) {
     auto response = env.server->HandleRequest(request_2);
     benchmark::DoNotOptimize(response);
@@ -128,6 +133,39 @@ BENCHMARK(BM_SessionReuse_SubsequentQuery)
     ->Name("2. Subsequent (Cached Key)")
     ->Unit(benchmark::kMillisecond);
 
+// Handling a request with a cached Galois key, where LinPIR computes over
+// 64-bit RLWE integers with two 45-bit ciphertext moduli, or over 32-bit RLWE
+// integers with three 30-bit ciphertext moduli of the same total size.
+template <typename Integer>
+void BM_HandleRequestWithRlweInteger(benchmark::State& state) {
+  Parameters params = kParameters;
+  params.db_rows = absl::GetFlag(FLAGS_num_rows);
+  params.db_cols = absl::GetFlag(FLAGS_num_cols);
+  if constexpr (std::is_same_v<Integer, linpir::Uint32>) {
+    params = With30BitRlweModuli(params);
+  }
+
+  auto server =
+      Server<Integer>::CreateWithRandomDatabaseRecords(params).value();
+  server->Preprocess().IgnoreError();
+  auto client =
+      Client<Integer>::Create(params, server->GetPublicParams()).value();
+  auto request_1 = client->GenerateRequest(1).value();
+  server->HandleRequest(request_1).IgnoreError();
+  auto request_2 = client->GenerateRequest(2).value();
+  state.counters["Up (KB)"] = request_2.ByteSizeLong() / 1024.0;
+
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto response = server->HandleRequest(request_2);
+    benchmark::DoNotOptimize(response);
+  }
+}
+BENCHMARK_TEMPLATE(BM_HandleRequestWithRlweInteger, linpir::Uint64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_HandleRequestWithRlweInteger, linpir::Uint32)
+    ->Unit(benchmark::kMillisecond);
+
 }  // namespace
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
@@ -16,6 +16,7 @@
 #include <memory>
 #include <string>
 
+#include "absl/status/status.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "hintless_simplepir/client.h"
@@ -23,6 +24,7 @@
 #include "hintless_simplepir/parameters.h"
 #include "hintless_simplepir/server.h"
 #include "linpir/parameters.h"
+#include "shell_encryption/testing/status_matchers.h"
 #include "shell_encryption/testing/status_testing.h"
 
 namespace hintless_pir {
@@ -30,6 +32,8 @@ namespace hintless_simplepir {
 namespace {
 
 using RlweInteger = Parameters::RlweInteger;
+using ::rlwe::testing::StatusIs;
+using ::testing::HasSubstr;
 
 const Parameters kParameters{
     .db_rows = 8,
@@ -54,15 +58,17 @@ const Parameters kParameters{
 
 TEST(HintlessSimplePir, EndToEndTest) {
   // Create server and fill in random database records.
-  ASSERT_OK_AND_ASSIGN(auto server,
-                       Server::CreateWithRandomDatabaseRecords(kParameters));
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(kParameters));
 
   // Preprocess the server and get public parameters.
   ASSERT_OK(server->Preprocess());
   auto public_params = server->GetPublicParams();
 
   // Create a client and issue request.
-  ASSERT_OK_AND_ASSIGN(auto client, Client::Create(kParameters, public_params));
+  ASSERT_OK_AND_ASSIGN(
+      auto client, Client<RlweInteger>::Create(kParameters, public_params));
   ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(1));
 
   // Handle the request
@@ -91,15 +97,17 @@ TEST(HintlessSimplePir, EndToEndTestWithChaChaPrng) {
   params.prng_type = rlwe::PRNG_TYPE_CHACHA;
 
   // Create server and fill in random database records.
-  ASSERT_OK_AND_ASSIGN(auto server,
-                       Server::CreateWithRandomDatabaseRecords(params));
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
 
   // Preprocess the server and get public parameters.
   ASSERT_OK(server->Preprocess());
   auto public_params = server->GetPublicParams();
 
   // Create a client and issue request.
-  ASSERT_OK_AND_ASSIGN(auto client, Client::Create(params, public_params));
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<RlweInteger>::Create(params, public_params));
   ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(1));
 
   // Handle the request
@@ -111,6 +119,160 @@ TEST(HintlessSimplePir, EndToEndTestWithChaChaPrng) {
   EXPECT_EQ(record, expected);
 }
 
+TEST(HintlessSimplePir, EndToEndTestWith32BitRlweIntegers) {
+  // Use 30-bit RLWE ciphertext moduli, so that LinPIR runs on 32-bit integers.
+  Parameters params = With30BitRlweModuli(kParameters);
+
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<linpir::Uint32>::CreateWithRandomDatabaseRecords(params));
+  ASSERT_OK(server->Preprocess());
+  auto public_params = server->GetPublicParams();
+
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<linpir::Uint32>::Create(params, public_params));
+  for (int64_t index : {int64_t{1}, params.db_rows * params.db_cols - 1}) {
+    ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(index));
+    ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+    ASSERT_OK_AND_ASSIGN(auto record, client->RecoverRecord(response));
+    ASSERT_OK_AND_ASSIGN(auto expected, server->GetDatabase()->Record(index));
+    EXPECT_EQ(record, expected);
+  }
+}
+
+TEST(HintlessSimplePir, EndToEndTestWithParallelPreprocessing) {
+  // Preprocess both plaintext moduli concurrently, each with 3 threads.
+  Parameters params = kParameters;
+  params.num_threads = 2;
+  params.linpir_params.num_threads = 3;
+
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  ASSERT_OK(server->Preprocess());
+  auto public_params = server->GetPublicParams();
+
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<RlweInteger>::Create(params, public_params));
+  for (int64_t index : {int64_t{1}, params.db_rows * params.db_cols - 1}) {
+    ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(index));
+    ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+    ASSERT_OK_AND_ASSIGN(auto record, client->RecoverRecord(response));
+    ASSERT_OK_AND_ASSIGN(auto expected, server->GetDatabase()->Record(index));
+    EXPECT_EQ(record, expected);
+  }
+}
+
+TEST(HintlessSimplePir, EndToEndTestWithPackedLinPirSlots) {
+  // With 512-dimensional LWE secrets and blocks of 256 rows, the hint rows of
+  // 4 shards share the 2048 slots per group of a single LinPir database.
+  Parameters params = kParameters;
+  params.lwe_secret_dim = 512;
+  params.linpir_params.rows_per_block = 256;
+  params.pack_linpir_slots = true;
+  ASSERT_EQ(LinPirPackingFactor(params), 4);
+
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  ASSERT_OK(server->Preprocess());
+  auto public_params = server->GetPublicParams();
+
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<RlweInteger>::Create(params, public_params));
+  for (int64_t index : {int64_t{1}, params.db_rows * params.db_cols - 1}) {
+    ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(index));
+    ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+    for (auto const& linpir_response : response.linpir_responses()) {
+      EXPECT_EQ(linpir_response.ct_inner_products_size(), 1);
+    }
+    ASSERT_OK_AND_ASSIGN(auto record, client->RecoverRecord(response));
+    ASSERT_OK_AND_ASSIGN(auto expected, server->GetDatabase()->Record(index));
+    EXPECT_EQ(record, expected);
+  }
+}
+
+TEST(HintlessSimplePir, EndToEndTestWithModulusSwitchedLinPirResponses) {
+  // The LinPir responses and their pads are sent over one of the two moduli.
+  Parameters params = kParameters;
+  params.linpir_params.num_response_moduli = 1;
+
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  ASSERT_OK(server->Preprocess());
+  auto public_params = server->GetPublicParams();
+
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<RlweInteger>::Create(params, public_params));
+  for (int64_t index : {int64_t{1}, params.db_rows * params.db_cols - 1}) {
+    ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(index));
+    ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+    ASSERT_OK_AND_ASSIGN(auto record, client->RecoverRecord(response));
+    ASSERT_OK_AND_ASSIGN(auto expected, server->GetDatabase()->Record(index));
+    EXPECT_EQ(record, expected);
+  }
+}
+
+TEST(HintlessSimplePir, EndToEndTestWithPackedLinPirBlocks) {
+  // With 512-dimensional LWE secrets and blocks of 16 rows, the 4 hint blocks
+  // of every shard share the 2048 slots per group of a single block.
+  Parameters params = kParameters;
+  params.db_rows = 64;
+  params.lwe_secret_dim = 512;
+  params.linpir_params.rows_per_block = 16;
+  params.linpir_params.block_packing_factor = 4;
+
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  ASSERT_OK(server->Preprocess());
+  auto public_params = server->GetPublicParams();
+
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<RlweInteger>::Create(params, public_params));
+  for (int64_t index : {int64_t{1}, params.db_rows * params.db_cols - 1}) {
+    ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(index));
+    ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+    for (auto const& linpir_response : response.linpir_responses()) {
+      for (auto const& inner_product : linpir_response.ct_inner_products()) {
+        EXPECT_EQ(inner_product.ct_b_blocks_size(), 1);
+      }
+    }
+    ASSERT_OK_AND_ASSIGN(auto record, client->RecoverRecord(response));
+    ASSERT_OK_AND_ASSIGN(auto expected, server->GetDatabase()->Record(index));
+    EXPECT_EQ(record, expected);
+  }
+}
+
+TEST(HintlessSimplePir, CreateFailsWithPackedLinPirSlotsAndBlocks) {
+  Parameters params = kParameters;
+  params.lwe_secret_dim = 512;
+  params.linpir_params.rows_per_block = 256;
+  params.linpir_params.block_packing_factor = 2;
+  params.pack_linpir_slots = true;
+  EXPECT_THAT(Server<RlweInteger>::CreateWithRandomDatabaseRecords(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`linpir_params.block_packing_factor` must "
+                                 "be 1")));
+}
+
+TEST(HintlessSimplePir, CreateFailsWithAuxiliaryModuli) {
+  Parameters params = kParameters;
+  params.linpir_params.ps = {36028797018652673ULL};
+  EXPECT_THAT(Server<RlweInteger>::CreateWithRandomDatabaseRecords(params),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`linpir_params.ps` must be empty")));
+
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(kParameters));
+  ASSERT_OK(server->Preprocess());
+  EXPECT_THAT(Client<RlweInteger>::Create(params, server->GetPublicParams()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`linpir_params.ps` must be empty")));
+}
+
 }  // namespace
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
@@ -24,6 +24,7 @@
 #include "absl/types/span.h"
 #include "hwy/detect_targets.h"
 #include "lwe/types.h"
+#include "shell_encryption/status_macros.h"
 
 // Highway implementations.
 // clang-format off
@@ -42,6 +43,13 @@ namespace HWY_NAMESPACE {
 
 #if HWY_TARGET == HWY_SCALAR
 
+template <typename PlainInteger>
+absl::Status InnerProductAccumulateHwy(absl::Span<const BlockVector> matrix,
+                                       absl::Span<const lwe::Integer> vec,
+                                       absl::Span<lwe::Integer> result) {
+  return InnerProductAccumulateNoHwy<PlainInteger>(matrix, vec, result);
+}
+
 template <typename PlainInteger>
 absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
     absl::Span<const BlockVector> matrix, absl::Span<const lwe::Integer> vec) {
@@ -53,36 +61,33 @@ absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
 namespace hn = hwy::HWY_NAMESPACE;
 
 template <typename PlainInteger>
-absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
-    absl::Span<const BlockVector> matrix, absl::Span<const lwe::Integer> vec) {
+absl::Status InnerProductAccumulateHwy(absl::Span<const BlockVector> matrix,
+                                       absl::Span<const lwe::Integer> vec,
+                                       absl::Span<lwe::Integer> result) {
   if (matrix.size() != vec.size()) {
     return absl::InvalidArgumentError(
         "`matrix` and `vec` must have matching dimensions.");
   }
+  if (matrix.empty()) {
+    return absl::OkStatus();
+  }
 
-  // Vector type used throughout this function: Largest byte vector
-  // available.
   const hn::ScalableTag<lwe::Integer> d32;
   const hn::Rebind<PlainInteger, hn::ScalableTag<lwe::Integer>> d_plain;
   const int N = hn::Lanes(d32);
-
-  // Do not run the highway version if
-  // - the number of bytes in a hwy vector is less than 16, or
-  // - the number of bytes in a hwy vector is not a multiple of 16.
+  // Same restrictions on the vector size as in `InnerProductHwy()`.
   if (ABSL_PREDICT_FALSE(N < 4 || N % 4 != 0)) {
-    return InnerProductNoHwy<PlainInteger>(matrix, vec);
+    return InnerProductAccumulateNoHwy<PlainInteger>(matrix, vec, result);
   }
 
   // Assume all columns have the same size.
   int num_blocks = matrix[0].size();
   int num_values_per_block = sizeof(BlockType) / sizeof(PlainInteger);
   int num_rows = num_blocks * num_values_per_block;
-
-  // Allocate aligned buffers to hold the intermediate values of inner
-  // products.
-  hwy::AlignedFreeUniquePtr<lwe::Integer[]> aligned_results =
-      hwy::AllocateAligned<lwe::Integer>(num_rows);
-  std::fill_n(aligned_results.get(), num_rows, 0);
+  if (result.size() < num_rows) {
+    return absl::InvalidArgumentError(
+        "`result` must have one value per row of `matrix`.");
+  }
 
   for (int j = 0; j < vec.size(); ++j) {
     int row_idx = 0;
@@ -96,11 +101,11 @@ absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
       } else {
         value_ptr += N;
       }
-      lwe::Integer* result_ptr = &aligned_results[row_idx];
-      auto add32_0 = hn::Load(d32, result_ptr);
-      auto add32_1 = hn::Load(d32, result_ptr + N);
-      auto add32_2 = hn::Load(d32, result_ptr + 2 * N);
-      auto add32_3 = hn::Load(d32, result_ptr + 3 * N);
+      lwe::Integer* result_ptr = result.data() + row_idx;
+      auto add32_0 = hn::LoadU(d32, result_ptr);
+      auto add32_1 = hn::LoadU(d32, result_ptr + N);
+      auto add32_2 = hn::LoadU(d32, result_ptr + 2 * N);
+      auto add32_3 = hn::LoadU(d32, result_ptr + 3 * N);
 
       auto left0 = hn::LoadU(d_plain, value_ptr);
       auto left1 = hn::LoadU(d_plain, value_ptr + N);
@@ -119,10 +124,10 @@ absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
       auto mul32_2 = hn::MulAdd(left32_2, right32, add32_2);
       auto mul32_3 = hn::MulAdd(left32_3, right32, add32_3);
 
-      hn::Store(mul32_0, d32, result_ptr);
-      hn::Store(mul32_1, d32, result_ptr + N);
-      hn::Store(mul32_2, d32, result_ptr + 2 * N);
-      hn::Store(mul32_3, d32, result_ptr + 3 * N);
+      hn::StoreU(mul32_0, d32, result_ptr);
+      hn::StoreU(mul32_1, d32, result_ptr + N);
+      hn::StoreU(mul32_2, d32, result_ptr + 2 * N);
+      hn::StoreU(mul32_3, d32, result_ptr + 3 * N);
     }
 
     // Next, run 1x per iteration.
@@ -134,13 +139,13 @@ absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
       } else {
         value_ptr += N;
       }
-      lwe::Integer* result_ptr = &aligned_results[row_idx];
-      auto add32 = hn::Load(d32, result_ptr);
+      lwe::Integer* result_ptr = result.data() + row_idx;
+      auto add32 = hn::LoadU(d32, result_ptr);
       auto left = hn::LoadU(d_plain, value_ptr);
       auto left32 = hn::PromoteTo(d32, left);
       auto right32 = hn::Set(d32, vec[j]);
       auto mul32 = hn::MulAdd(left32, right32, add32);
-      hn::Store(mul32, d32, result_ptr);
+      hn::StoreU(mul32, d32, result_ptr);
     }
 
     // Handle the remaining rows that didn't take a full lane.
@@ -156,12 +161,48 @@ absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
               reinterpret_cast<const lwe::PlainInteger*>(&matrix[j][block_idx]);
         }
         int block_pos = row_idx % num_values_per_block;
-        aligned_results.get()[row_idx] +=
+        result[row_idx] +=
             static_cast<lwe::Integer>(block_as_values[block_pos]) * vec[j];
       }
     }
   }
 
+  return absl::OkStatus();
+}
+
+template <typename PlainInteger>
+absl::StatusOr<std::vector<lwe::Integer>> InnerProductHwy(
+    absl::Span<const BlockVector> matrix, absl::Span<const lwe::Integer> vec) {
+  if (matrix.size() != vec.size()) {
+    return absl::InvalidArgumentError(
+        "`matrix` and `vec` must have matching dimensions.");
+  }
+
+  // Vector type used throughout this function: Largest byte vector
+  // available.
+  const hn::ScalableTag<lwe::Integer> d32;
+  const int N = hn::Lanes(d32);
+
+  // Do not run the highway version if
+  // - the number of bytes in a hwy vector is less than 16, or
+  // - the number of bytes in a hwy vector is not a multiple of 16.
+  if (ABSL_PREDICT_FALSE(N < 4 || N % 4 != 0)) {
+    return InnerProductNoHwy<PlainInteger>(matrix, vec);
+  }
+
+  // Assume all columns have the same size.
+  int num_blocks = matrix[0].size();
+  int num_values_per_block = sizeof(BlockType) / sizeof(PlainInteger);
+  int num_rows = num_blocks * num_values_per_block;
+
+  // Allocate aligned buffers to hold the intermediate values of inner
+  // products.
+  hwy::AlignedFreeUniquePtr<lwe::Integer[]> aligned_results =
+      hwy::AllocateAligned<lwe::Integer>(num_rows);
+  std::fill_n(aligned_results.get(), num_rows, 0);
+
+  RLWE_RETURN_IF_ERROR(InnerProductAccumulateHwy<PlainInteger>(
+      matrix, vec, absl::MakeSpan(aligned_results.get(), num_rows)));
   return std::vector<lwe::Integer>(aligned_results.get(),
                                    aligned_results.get() + num_rows);
 }
@@ -207,10 +248,50 @@ absl::StatusOr<std::vector<lwe::Integer>> InnerProductNoHwy(
   return result;
 }
 
+template <typename PlainInteger>
+absl::Status InnerProductAccumulateNoHwy(absl::Span<const BlockVector> matrix,
+                                         absl::Span<const lwe::Integer> vec,
+                                         absl::Span<lwe::Integer> result) {
+  if (matrix.size() != vec.size()) {
+    return absl::InvalidArgumentError(
+        "`matrix` and `vec` must have matching dimensions.");
+  }
+  if (matrix.empty()) {
+    return absl::OkStatus();
+  }
+
+  constexpr int num_values_per_block = sizeof(BlockType) / sizeof(PlainInteger);
+
+  // Assume all columns have the same size.
+  int num_blocks = matrix[0].size();
+  int num_rows = num_blocks * num_values_per_block;
+  if (result.size() < num_rows) {
+    return absl::InvalidArgumentError(
+        "`result` must have one value per row of `matrix`.");
+  }
+
+  for (int j = 0; j < vec.size(); ++j) {
+    int i = 0;
+    for (int block_idx = 0; block_idx < num_blocks; ++block_idx) {
+      BlockType block = matrix[j][block_idx];
+      const PlainInteger* block_as_values =
+          reinterpret_cast<const PlainInteger*>(&block);
+      for (int block_pos = 0; block_pos < num_values_per_block;
+           ++block_pos, ++i) {
+        result[i] += static_cast<lwe::Integer>(block_as_values[block_pos]) *
+                     vec[j];
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
 // Only instantiate the 8-bit and 16-bit versions, which are the choices of
 // LWE plaintext integer types we support.
 HWY_EXPORT_T(InnerProductHwy8, InnerProductHwy<uint8_t>);
 HWY_EXPORT_T(InnerProductHwy16, InnerProductHwy<uint16_t>);
+HWY_EXPORT_T(InnerProductAccumulateHwy8, InnerProductAccumulateHwy<uint8_t>);
+HWY_EXPORT_T(InnerProductAccumulateHwy16, InnerProductAccumulateHwy<uint16_t>);
 
 template <typename PlainInteger>
 absl::StatusOr<std::vector<lwe::Integer>> InnerProduct(
@@ -230,5 +311,28 @@ absl::StatusOr<std::vector<lwe::Integer>> InnerProduct<uint16_t>(
   return HWY_DYNAMIC_DISPATCH_T(InnerProductHwy16)(matrix, vec);
 }
 
+template <typename PlainInteger>
+absl::Status InnerProductAccumulate(absl::Span<const BlockVector> matrix,
+                                    absl::Span<const lwe::Integer> vec,
+                                    absl::Span<lwe::Integer> result) {
+  return InnerProductAccumulateNoHwy<PlainInteger>(matrix, vec, result);
+}
+
+template <>
+absl::Status InnerProductAccumulate<uint8_t>(
+    absl::Span<const BlockVector> matrix, absl::Span<const lwe::Integer> vec,
+    absl::Span<lwe::Integer> result) {
+  return HWY_DYNAMIC_DISPATCH_T(InnerProductAccumulateHwy8)(matrix, vec,
+                                                             result);
+}
+
+template <>
+absl::Status InnerProductAccumulate<uint16_t>(
+    absl::Span<const BlockVector> matrix, absl::Span<const lwe::Integer> vec,
+    absl::Span<lwe::Integer> result) {
+  return HWY_DYNAMIC_DISPATCH_T(InnerProductAccumulateHwy16)(matrix, vec,
+                                                              result);
+}
+
 }  // namespace hintless_pir::hintless_simplepir::internal
 #endif  // HWY_ONCE || HWY_IDE
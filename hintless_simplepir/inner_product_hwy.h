@@ -46,6 +46,21 @@ template <typename PlainInteger>
 absl::StatusOr<std::vector<lwe::Integer>> InnerProductNoHwy(
     absl::Span<const BlockVector> matrix, absl::Span<const lwe::Integer> vec);
 
+// Adds `matrix` * `vec` (mod Q) to `result`, which must hold at least one value
+// per row of `matrix`, i.e. sizeof(BlockType) / sizeof(PlainInteger) values
+// per block of a column. Unlike `InnerProduct()`, it does not allocate, so the
+// products of many ranges of columns can share one buffer.
+template <typename PlainInteger>
+absl::Status InnerProductAccumulate(absl::Span<const BlockVector> matrix,
+                                    absl::Span<const lwe::Integer> vec,
+                                    absl::Span<lwe::Integer> result);
+
+// `InnerProductAccumulate()` implemented without highway SIMD intrinsics.
+template <typename PlainInteger>
+absl::Status InnerProductAccumulateNoHwy(absl::Span<const BlockVector> matrix,
+                                         absl::Span<const lwe::Integer> vec,
+                                         absl::Span<lwe::Integer> result);
+
 }  // namespace internal
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
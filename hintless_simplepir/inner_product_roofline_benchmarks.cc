@@ -0,0 +1,253 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Roofline benchmarks for the packed database inner product.
+//
+// The inner product streams the whole database once per query and does only a
+// few integer operations per byte, so its ceiling is the memory bandwidth of
+// the host. These benchmarks first measure a STREAM-like peak read bandwidth
+// for every thread count in the sweep, and then report the bandwidth achieved
+// by the kernel over a range of database sizes (from cache resident to several
+// GB), thread counts and plaintext widths, both in GB/s and as a percentage of
+// the peak.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/numeric/int128.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "benchmarks/memory_bandwidth.h"
+#include "benchmarks/perf_counters.h"
+#include "hintless_simplepir/inner_product_hwy.h"
+#include "hintless_simplepir/testing.h"
+#include "hintless_simplepir/utils.h"
+#include "linpir/parallel.h"
+#include "lwe/types.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(int64_t, min_db_bytes, int64_t{1} << 18,
+          "Size in bytes of the smallest database in the sweep");
+ABSL_FLAG(int64_t, max_db_bytes, int64_t{1} << 30,
+          "Size in bytes of the largest database in the sweep");
+ABSL_FLAG(int, max_threads, 0,
+          "Largest number of threads in the sweep; 0 means all hardware "
+          "threads");
+ABSL_FLAG(int64_t, stream_bytes, int64_t{1} << 29,
+          "Buffer size in bytes used to measure the peak memory bandwidth");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using internal::BlockType;
+using internal::BlockVector;
+
+// Peak read bandwidth in bytes per second, indexed by the number of threads.
+std::map<int, double>& PeakBandwidths() {
+  static auto* peaks = new std::map<int, double>();
+  return *peaks;
+}
+
+// Returns a matrix of `num_cols` columns, each of `num_blocks` random blocks.
+// The most recent matrix is kept around, so that a large database is only
+// sampled once for all thread counts in the sweep.
+const std::vector<BlockVector>& SampleRawMatrix(int64_t num_blocks,
+                                                int64_t num_cols) {
+  static auto* matrix = new std::vector<BlockVector>();
+  if (matrix->size() == num_cols && (*matrix)[0].size() == num_blocks) {
+    return *matrix;
+  }
+  matrix->clear();
+  absl::BitGen bitgen;
+  matrix->resize(num_cols, BlockVector(num_blocks));
+  for (BlockVector& column : *matrix) {
+    for (BlockType& block : column) {
+      block = absl::MakeUint128(absl::Uniform<uint64_t>(bitgen),
+                                absl::Uniform<uint64_t>(bitgen));
+    }
+  }
+  return *matrix;
+}
+
+// Computes matrix * vec with `num_threads` threads, the caller and those of
+// `pool`, where each thread handles a contiguous range of columns and the
+// partial products are summed (mod Q).
+template <typename PlainInteger>
+absl::StatusOr<std::vector<lwe::Integer>> ParallelInnerProduct(
+    absl::Span<const BlockVector> matrix, absl::Span<const lwe::Integer> vec,
+    int num_threads, linpir::ThreadPool* pool) {
+  if (num_threads == 1) {
+    return internal::InnerProduct<PlainInteger>(matrix, vec);
+  }
+  int num_cols = static_cast<int>(matrix.size());
+  int cols_per_range = linpir::ItemsPerRange(num_cols, num_threads);
+  int num_ranges = DivAndRoundUp(num_cols, cols_per_range);
+  std::vector<std::vector<lwe::Integer>> partials(num_ranges);
+  RLWE_RETURN_IF_ERROR(linpir::ParallelFor(
+      num_cols, num_threads, pool, [&](int begin, int end) -> absl::Status {
+        RLWE_ASSIGN_OR_RETURN(partials[begin / cols_per_range],
+                              internal::InnerProduct<PlainInteger>(
+                                  matrix.subspan(begin, end - begin),
+                                  vec.subspan(begin, end - begin)));
+        return absl::OkStatus();
+      }));
+  std::vector<lwe::Integer> product = std::move(partials[0]);
+  for (int r = 1; r < num_ranges; ++r) {
+    for (int64_t i = 0; i < product.size(); ++i) {
+      product[i] += partials[r][i];
+    }
+  }
+  return product;
+}
+
+// Runs the inner product over a square database of about state.range(0) bytes
+// of PlainInteger values, using state.range(1) threads.
+template <typename PlainInteger>
+void BM_InnerProductRoofline(benchmark::State& state) {
+  int64_t target_bytes = state.range(0);
+  int num_threads = state.range(1);
+  constexpr int64_t kNumValuesPerBlock =
+      sizeof(BlockType) / sizeof(PlainInteger);
+
+  int64_t num_values = target_bytes / sizeof(PlainInteger);
+  int64_t num_cols = std::max<int64_t>(1, std::sqrt(num_values));
+  int64_t num_blocks =
+      std::max<int64_t>(1, num_values / num_cols / kNumValuesPerBlock);
+  int64_t db_bytes = num_blocks * num_cols * sizeof(BlockType);
+
+  const std::vector<BlockVector>& matrix =
+      SampleRawMatrix(num_blocks, num_cols);
+  std::vector<lwe::Integer> query = testing::GenerateRandomQuery(num_cols);
+
+  // The threads are started once, outside of the timed loop, as the database
+  // does for its query threads.
+  std::unique_ptr<linpir::ThreadPool> pool;
+  if (num_threads > 1) {
+    pool = std::make_unique<linpir::ThreadPool>(num_threads - 1);
+  }
+
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  absl::Time start = absl::Now();
+  for (auto _ : state) {
+    auto product = ParallelInnerProduct<PlainInteger>(matrix, query,
+                                                      num_threads, pool.get());
+    if (!product.ok()) {
+      state.SkipWithError(product.status().ToString().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(product);
+  }
+  double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+
+  double achieved = db_bytes * static_cast<double>(state.iterations()) /
+                    std::max(seconds, 1e-9);
+  state.counters["rows"] = num_blocks * kNumValuesPerBlock;
+  state.counters["cols"] = num_cols;
+  state.counters["db_MiB"] = db_bytes / static_cast<double>(1 << 20);
+  state.counters["GB/s"] = achieved / 1e9;
+  auto peak = PeakBandwidths().find(num_threads);
+  if (peak != PeakBandwidths().end() && peak->second > 0) {
+    state.counters["%peak"] = 100 * achieved / peak->second;
+  }
+}
+
+// Returns 1, 2, 4, ... up to `max_threads`, always including `max_threads`.
+std::vector<int> ThreadCounts(int max_threads) {
+  std::vector<int> counts;
+  for (int t = 1; t < max_threads; t *= 2) {
+    counts.push_back(t);
+  }
+  counts.push_back(max_threads);
+  return counts;
+}
+
+void RegisterRooflineBenchmarks() {
+  int64_t min_bytes = absl::GetFlag(FLAGS_min_db_bytes);
+  int64_t max_bytes = absl::GetFlag(FLAGS_max_db_bytes);
+  int max_threads = absl::GetFlag(FLAGS_max_threads);
+  if (max_threads <= 0) {
+    max_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<int> thread_counts = ThreadCounts(max_threads);
+
+  int64_t stream_bytes = absl::GetFlag(FLAGS_stream_bytes);
+  std::cout << "Peak read bandwidth over " << (stream_bytes >> 20)
+            << " MiB:\n";
+  for (int num_threads : thread_counts) {
+    double peak = benchmarks::MeasureReadBandwidth(stream_bytes, num_threads);
+    PeakBandwidths()[num_threads] = peak;
+    std::cout << "  " << num_threads << " thread(s): " << peak / 1e9
+              << " GB/s\n";
+  }
+
+  // Sweep one plaintext width at a time, so that each sampled database is
+  // reused across all thread counts.
+  for (int64_t bytes = min_bytes; bytes <= max_bytes; bytes *= 4) {
+    for (int num_threads : thread_counts) {
+      benchmark::RegisterBenchmark("BM_InnerProductRoofline<uint8_t>",
+                                   BM_InnerProductRoofline<uint8_t>)
+          ->Args({bytes, num_threads})
+          ->UseRealTime()
+          ->Unit(benchmark::kMillisecond);
+    }
+  }
+  for (int64_t bytes = min_bytes; bytes <= max_bytes; bytes *= 4) {
+    for (int num_threads : thread_counts) {
+      benchmark::RegisterBenchmark("BM_InnerProductRoofline<uint16_t>",
+                                   BM_InnerProductRoofline<uint16_t>)
+          ->Args({bytes, num_threads})
+          ->UseRealTime()
+          ->Unit(benchmark::kMillisecond);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    hintless_pir::hintless_simplepir::RegisterRooflineBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,313 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Load benchmark for the HintlessPIR server under concurrent clients.
+//
+// A number of simulated clients are set up with pre-generated request pools:
+// one first request per client, carrying the session Galois key, and several
+// subsequent requests that rely on the cached key. The requests are served by
+// a pool of `--num_threads` handler threads, in one of two modes:
+//
+//  * closed loop: each of the `--num_clients` clients sends its next request
+//    as soon as the previous response is received;
+//  * open loop: requests arrive as a Poisson process at `--target_qps`, and
+//    latency is measured from the intended arrival time, so that queueing
+//    delay is included.
+//
+// The benchmark reports the throughput, the latency distribution (overall and
+// separately for first and subsequent requests), the CPU utilisation, and the
+// resident memory of the process.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/load_stats.h"
+#include "benchmarks/worker_pool.h"
+#include "hintless_simplepir/client.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "hintless_simplepir/server.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(int, num_rows, 1024, "Number of rows");
+ABSL_FLAG(int, num_cols, 1024, "Number of cols");
+ABSL_FLAG(int, record_bit_size, 64, "Size of a database record in bits");
+ABSL_FLAG(int, num_threads, 4, "Number of server threads handling requests");
+ABSL_FLAG(int, num_clients, 8, "Number of simulated clients");
+ABSL_FLAG(int, requests_per_client, 4,
+          "Number of pre-generated subsequent requests per client");
+ABSL_FLAG(double, first_request_ratio, 0.1,
+          "Fraction of requests that start a new session and carry the "
+          "Galois key");
+ABSL_FLAG(std::string, mode, "closed", "Load model: 'closed' or 'open'");
+ABSL_FLAG(double, target_qps, 10, "Arrival rate in the open-loop mode");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(30),
+          "Duration of the measurement");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+// The pre-generated requests of one simulated client.
+struct RequestPool {
+  HintlessPirRequest first_request;
+  std::vector<HintlessPirRequest> subsequent_requests;
+};
+
+// Latencies and error counts collected during the measurement.
+struct LoadResults {
+  benchmarks::LatencyRecorder all;
+  benchmarks::LatencyRecorder first;
+  benchmarks::LatencyRecorder subsequent;
+  std::atomic<int64_t> num_errors{0};
+};
+
+absl::StatusOr<std::vector<RequestPool>> GenerateRequestPools(
+    const Parameters& params,
+    const HintlessPirServerPublicParams& public_params, int num_clients,
+    int requests_per_client) {
+  absl::BitGen bitgen;
+  int64_t num_records = params.db_rows * params.db_cols;
+  std::vector<RequestPool> pools(num_clients);
+  for (RequestPool& pool : pools) {
+    RLWE_ASSIGN_OR_RETURN(auto client,
+                          Client<RlweInteger>::Create(params, public_params));
+    // The first request of a client session includes the Galois key.
+    RLWE_ASSIGN_OR_RETURN(pool.first_request,
+                          client->GenerateRequest(
+                              absl::Uniform<int64_t>(bitgen, 0, num_records)));
+    for (int i = 0; i < requests_per_client; ++i) {
+      RLWE_ASSIGN_OR_RETURN(
+          HintlessPirRequest request,
+          client->GenerateRequest(
+              absl::Uniform<int64_t>(bitgen, 0, num_records)));
+      pool.subsequent_requests.push_back(std::move(request));
+    }
+  }
+  return pools;
+}
+
+// Picks a request according to the mix of first and subsequent requests.
+const HintlessPirRequest& PickRequest(const std::vector<RequestPool>& pools,
+                                      double first_request_ratio,
+                                      absl::BitGen& bitgen, bool& is_first) {
+  const RequestPool& pool =
+      pools[absl::Uniform<size_t>(bitgen, 0, pools.size())];
+  is_first = absl::Bernoulli(bitgen, first_request_ratio);
+  if (is_first) {
+    return pool.first_request;
+  }
+  return pool.subsequent_requests[absl::Uniform<size_t>(
+      bitgen, 0, pool.subsequent_requests.size())];
+}
+
+// Handles `request` and records its latency measured from `start`.
+void Serve(Server<RlweInteger>& server, const HintlessPirRequest& request,
+           bool is_first, absl::Time start, LoadResults& results) {
+  auto response = server.HandleRequest(request);
+  absl::Duration latency = absl::Now() - start;
+  if (!response.ok()) {
+    results.num_errors++;
+    return;
+  }
+  results.all.Add(latency);
+  (is_first ? results.first : results.subsequent).Add(latency);
+}
+
+void RunClosedLoop(Server<RlweInteger>& server,
+                   const std::vector<RequestPool>& pools,
+                   benchmarks::WorkerPool& workers, int num_clients,
+                   double first_request_ratio, absl::Time deadline,
+                   LoadResults& results) {
+  std::vector<std::thread> clients;
+  for (int i = 0; i < num_clients; ++i) {
+    clients.emplace_back([&]() {
+      absl::BitGen bitgen;
+      while (absl::Now() < deadline) {
+        bool is_first;
+        const HintlessPirRequest& request =
+            PickRequest(pools, first_request_ratio, bitgen, is_first);
+        absl::Notification done;
+        absl::Time start = absl::Now();
+        workers.Schedule([&]() {
+          Serve(server, request, is_first, start, results);
+          done.Notify();
+        });
+        done.WaitForNotification();
+      }
+    });
+  }
+  for (std::thread& client : clients) {
+    client.join();
+  }
+}
+
+void RunOpenLoop(Server<RlweInteger>& server,
+                 const std::vector<RequestPool>& pools,
+                 benchmarks::WorkerPool& workers, double target_qps,
+                 double first_request_ratio, absl::Time deadline,
+                 LoadResults& results) {
+  absl::BitGen bitgen;
+  absl::Time arrival = absl::Now();
+  while (true) {
+    arrival += absl::Seconds(absl::Exponential<double>(bitgen, target_qps));
+    if (arrival >= deadline) {
+      break;
+    }
+    absl::SleepFor(arrival - absl::Now());
+    bool is_first;
+    const HintlessPirRequest* request =
+        &PickRequest(pools, first_request_ratio, bitgen, is_first);
+    // Latency counts from the intended arrival time, so that requests delayed
+    // by a saturated server are not under-reported.
+    workers.Schedule([&server, request, is_first, arrival, &results]() {
+      Serve(server, *request, is_first, arrival, results);
+    });
+  }
+}
+
+absl::Status RunLoadBenchmark() {
+  Parameters params = kParameters;
+  params.db_rows = absl::GetFlag(FLAGS_num_rows);
+  params.db_cols = absl::GetFlag(FLAGS_num_cols);
+  params.db_record_bit_size = absl::GetFlag(FLAGS_record_bit_size);
+  int num_threads = absl::GetFlag(FLAGS_num_threads);
+  int num_clients = absl::GetFlag(FLAGS_num_clients);
+  int requests_per_client = absl::GetFlag(FLAGS_requests_per_client);
+  double first_request_ratio = absl::GetFlag(FLAGS_first_request_ratio);
+  std::string mode = absl::GetFlag(FLAGS_mode);
+  if (mode != "closed" && mode != "open") {
+    return absl::InvalidArgumentError("--mode must be 'closed' or 'open'.");
+  }
+  if (num_threads <= 0 || num_clients <= 0 || requests_per_client <= 0) {
+    return absl::InvalidArgumentError(
+        "--num_threads, --num_clients and --requests_per_client must be "
+        "positive.");
+  }
+
+  std::cout << "Setting up a " << params.db_rows << " x " << params.db_cols
+            << " database of " << params.db_record_bit_size
+            << "-bit records...\n";
+  RLWE_ASSIGN_OR_RETURN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  RLWE_RETURN_IF_ERROR(server->Preprocess());
+  HintlessPirServerPublicParams public_params = server->GetPublicParams();
+  RLWE_ASSIGN_OR_RETURN(
+      std::vector<RequestPool> pools,
+      GenerateRequestPools(params, public_params, num_clients,
+                           requests_per_client));
+
+  // Open all sessions so that subsequent requests find their cached keys.
+  for (const RequestPool& pool : pools) {
+    RLWE_RETURN_IF_ERROR(server->HandleRequest(pool.first_request).status());
+  }
+
+  LoadResults results;
+  benchmarks::ResetPeakRss();
+  benchmarks::ProcessUsage usage_before = benchmarks::GetProcessUsage();
+  absl::Time start = absl::Now();
+  absl::Time deadline = start + absl::GetFlag(FLAGS_duration);
+  {
+    benchmarks::WorkerPool workers(num_threads);
+    if (mode == "closed") {
+      RunClosedLoop(*server, pools, workers, num_clients, first_request_ratio,
+                    deadline, results);
+    } else {
+      RunOpenLoop(*server, pools, workers, absl::GetFlag(FLAGS_target_qps),
+                  first_request_ratio, deadline, results);
+    }
+  }  // Waits for all scheduled requests to finish.
+  absl::Duration elapsed = absl::Now() - start;
+  benchmarks::ProcessUsage usage_after = benchmarks::GetProcessUsage();
+
+  double seconds = absl::ToDoubleSeconds(elapsed);
+  double cores_used =
+      absl::ToDoubleSeconds(usage_after.cpu_time - usage_before.cpu_time) /
+      seconds;
+  int num_cores = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "Mode            : " << mode << " loop, " << num_threads
+            << " server threads, " << num_clients << " clients, "
+            << first_request_ratio * 100 << "% first requests\n";
+  std::cout << "Requests        : " << results.all.Count() << " ok, "
+            << results.num_errors << " failed in "
+            << absl::FormatDuration(elapsed) << "\n";
+  std::cout << "Throughput      : " << results.all.Count() / seconds
+            << " QPS\n";
+  std::cout << "Latency (all)   : " << benchmarks::LatencySummary(results.all)
+            << " mean=" << absl::FormatDuration(results.all.Mean()) << "\n";
+  std::cout << "Latency (first) : " << benchmarks::LatencySummary(results.first)
+            << "\n";
+  std::cout << "Latency (subseq): "
+            << benchmarks::LatencySummary(results.subsequent) << "\n";
+  std::cout << "CPU             : " << cores_used << " cores ("
+            << 100 * cores_used / num_cores << "% of " << num_cores << ")\n";
+  std::cout << "Memory          : RSS " << (usage_after.rss_bytes >> 20)
+            << " MiB, peak " << (usage_after.peak_rss_bytes >> 20)
+            << " MiB\n";
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = hintless_pir::hintless_simplepir::RunLoadBenchmark();
+  if (!status.ok()) {
+    std::cerr << status << "\n";
+    return 1;
+  }
+  return 0;
+}
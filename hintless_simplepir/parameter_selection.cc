@@ -0,0 +1,334 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hintless_simplepir/parameter_selection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/utils.h"
+#include "linpir/parameters.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+
+// NTT-friendly primes for ring dimensions up to 2^13, i.e. q = 1 (mod 2^14).
+constexpr RlweInteger kCandidateQs[] = {
+    18014398508400641ULL, 18014398508138497ULL, 18014398507892737ULL,
+    18014398507794433ULL};
+constexpr RlweInteger kCandidateTs[] = {4079617, 4046849, 3850241, 3735553};
+constexpr int kCandidateGadgetLogB = 18;
+constexpr int kMinLogN = 11;
+constexpr int kMaxLogN = 13;
+constexpr int kMinLogRowsPerBlock = 6;
+constexpr int kMaxPlaintextBitSize = 8 * sizeof(lwe::PlainInteger);
+
+// Upper bound on the size of a varint-encoded LWE ciphertext coefficient; as
+// the coefficients are uniform mod 2^32, almost all take 5 bytes.
+constexpr int64_t kLweCoefficientBytes = 5;
+
+// Variance of the LWE error, a centered binomial as in lwe/sample_error.h.
+constexpr double kLweErrorVariance = 8;
+
+// Variance of a uniform ternary secret coefficient.
+constexpr double kTernaryVariance = 2.0 / 3.0;
+
+// Returns log2(Pr[|X| >= bound]) for X ~ N(0, variance).
+double Log2GaussianTail(double bound, double variance) {
+  double y = bound / std::sqrt(2 * variance);
+  if (y < 5) {
+    return std::log2(std::erfc(y));
+  }
+  // Asymptotic expansion of log(erfc(y)), as erfc underflows for large y.
+  return (-y * y - std::log(y * std::sqrt(M_PI))) / std::log(2.0);
+}
+
+// Returns log2(2^a + 2^b).
+double Log2Sum(double a, double b) {
+  double hi = std::max(a, b);
+  double lo = std::min(a, b);
+  return hi + std::log2(1 + std::exp2(lo - hi));
+}
+
+int NumShards(const Parameters& params) {
+  return DivAndRoundUp(params.db_record_bit_size,
+                       params.lwe_plaintext_bit_size);
+}
+
+int64_t NumBlocks(const Parameters& params) {
+  return DivAndRoundUp<int64_t>(params.db_rows,
+                                params.linpir_params.rows_per_block *
+                                    params.linpir_params.block_packing_factor);
+}
+
+// Returns the size of a serialized polynomial modulo all of `qs`.
+int64_t SerializedPolynomialBytes(
+    const linpir::RlweParameters<RlweInteger>& params) {
+  int64_t num_bytes = 0;
+  for (RlweInteger q : params.qs) {
+    num_bytes +=
+        DivAndRoundUp<int64_t>((int64_t{1} << params.log_n) * BitLength(q), 8);
+  }
+  return num_bytes;
+}
+
+}  // namespace
+
+int BitLength(Parameters::RlweInteger x) {
+  int bits = 0;
+  for (; x > 0; x >>= 1) {
+    ++bits;
+  }
+  return bits;
+}
+
+int NumGadgetDigits(
+    const linpir::RlweParameters<Parameters::RlweInteger>& params) {
+  int num_digits = 0;
+  for (int i = 0; i < params.qs.size(); ++i) {
+    num_digits += DivAndRoundUp<int>(BitLength(params.qs[i]),
+                                     params.gadget_log_bs[i]);
+  }
+  return num_digits;
+}
+
+int MaxLogCiphertextModulus(int log_n, int security_level) {
+  // HomomorphicEncryption.org security standard, Table 1, ternary secrets.
+  static constexpr int kMaxLogQ128[] = {27, 54, 109, 218, 438, 881};
+  static constexpr int kMaxLogQ192[] = {19, 37, 75, 152, 305, 611};
+  static constexpr int kMaxLogQ256[] = {14, 29, 58, 118, 237, 476};
+  if (log_n < 10 || log_n > 15) {
+    return 0;
+  }
+  switch (security_level) {
+    case 128:
+      return kMaxLogQ128[log_n - 10];
+    case 192:
+      return kMaxLogQ192[log_n - 10];
+    case 256:
+      return kMaxLogQ256[log_n - 10];
+    default:
+      return 0;
+  }
+}
+
+double FailureProbabilities::Total() const {
+  return Log2Sum(Log2Sum(lwe, crt), linpir);
+}
+
+// The noise model treats every error term as Gaussian with the variance of the
+// sum of its independent summands:
+//
+// - LWE: a shard of the record is decoded from Delta * m + sum_j D[j] e_j,
+//   where Delta = 2^(32 - plaintext_bits), D[j] are uniform plaintexts and e_j
+//   the LWE errors. Decoding fails if the error sum reaches Delta / 2.
+//
+// - CRT: the client interpolates the entries of Hint * s modulo t = prod(ts),
+//   where the hint entries are uniform mod 2^32 and s is ternary. The result
+//   is wrong if |Hint * s| reaches t / 2.
+//
+// - LinPIR: the i-th rotation of the query accumulates i key switching errors,
+//   each the sum of the products of the gadget digits (uniform in
+//   [-b/2, b/2)) with fresh errors. The response multiplies every rotation by a
+//   diagonal with coefficients uniform mod t, and decryption fails if any of
+//   the N coefficients of the result reaches q / (2t).
+FailureProbabilities EstimateFailureProbabilities(const Parameters& params) {
+  const auto& rlwe_params = params.linpir_params;
+  double num_shards = NumShards(params);
+  FailureProbabilities result;
+
+  double delta = std::exp2(params.lwe_modulus_bit_size -
+                           params.lwe_plaintext_bit_size);
+  double plaintext_modulus = std::exp2(params.lwe_plaintext_bit_size);
+  double lwe_variance = params.db_cols * kLweErrorVariance *
+                        plaintext_modulus * plaintext_modulus / 3;
+  result.lwe =
+      std::log2(num_shards) + Log2GaussianTail(delta / 2, lwe_variance);
+
+  double log_t = 0;
+  for (RlweInteger t : rlwe_params.ts) {
+    log_t += std::log2(static_cast<double>(t));
+  }
+  double lwe_modulus = std::exp2(params.lwe_modulus_bit_size);
+  double crt_variance = params.lwe_secret_dim * lwe_modulus * lwe_modulus /
+                        12 * kTernaryVariance;
+  result.crt = std::log2(num_shards) +
+               Log2GaussianTail(std::exp2(log_t - 1), crt_variance);
+
+  double n = std::exp2(rlwe_params.log_n);
+  double log_q = 0;
+  for (RlweInteger q : rlwe_params.qs) {
+    log_q += std::log2(static_cast<double>(q));
+  }
+  double key_switching_variance = 0;
+  for (int i = 0; i < rlwe_params.qs.size(); ++i) {
+    double base = std::exp2(rlwe_params.gadget_log_bs[i]);
+    int num_digits = DivAndRoundUp<int>(BitLength(rlwe_params.qs[i]),
+                                        rlwe_params.gadget_log_bs[i]);
+    key_switching_variance +=
+        n * num_digits * base * base / 12 * rlwe_params.error_variance;
+  }
+  double num_rotations = rlwe_params.rows_per_block / 2;
+  double rotations_variance =
+      num_rotations * rlwe_params.error_variance +
+      key_switching_variance * num_rotations * (num_rotations - 1) / 2;
+  result.linpir = -1e9;
+  for (RlweInteger t : rlwe_params.ts) {
+    double t_value = static_cast<double>(t);
+    double variance = n * t_value * t_value / 12 * rotations_variance;
+    double bound = std::exp2(log_q - std::log2(2 * t_value));
+    result.linpir =
+        Log2Sum(result.linpir, std::log2(num_shards * n) +
+                                   Log2GaussianTail(bound, variance));
+  }
+  return result;
+}
+
+absl::StatusOr<CostEstimate> EstimateCost(const Parameters& params,
+                                          const CostModel& model) {
+  const auto& rlwe_params = params.linpir_params;
+  int num_qs = rlwe_params.qs.size();
+  auto it = model.rlwe.find(std::make_pair(rlwe_params.log_n, num_qs));
+  if (it == model.rlwe.end()) {
+    return absl::NotFoundError(
+        absl::StrCat("The cost model has no RLWE costs for log_n = ",
+                     rlwe_params.log_n, " and ", num_qs, " moduli."));
+  }
+  const RlweCosts& rlwe = it->second;
+  const LweCosts& lwe = model.lwe;
+
+  int64_t n = int64_t{1} << rlwe_params.log_n;
+  int64_t num_shards = NumShards(params);
+  int64_t num_blocks = NumBlocks(params);
+  int64_t num_ts = rlwe_params.ts.size();
+  int64_t num_rotations = rlwe_params.rows_per_block / 2;
+  int64_t num_digits = NumGadgetDigits(rlwe_params);
+  int64_t polynomial_bytes = SerializedPolynomialBytes(rlwe_params);
+  // Polynomials are held in memory as one 64-bit word per coefficient and
+  // modulus.
+  int64_t polynomial_memory = n * num_qs * sizeof(RlweInteger);
+  int64_t num_values = num_shards * params.db_rows * params.db_cols;
+  int64_t num_diagonals = num_shards * num_blocks * num_rotations;
+
+  CostEstimate estimate;
+  estimate.server_ms_per_query =
+      (num_values * lwe.query_ns_per_value +
+       num_ts * ((num_rotations - 1) * rlwe.rotation_ns +
+                 num_diagonals * rlwe.absorb_ns)) /
+      1e6;
+  estimate.preprocess_ms =
+      (params.db_cols * params.lwe_secret_dim * lwe.pad_ns_per_value +
+       num_values * params.lwe_secret_dim * lwe.hint_ns_per_product +
+       num_ts * ((num_rotations - 1) * rlwe.pad_rotation_ns +
+                 num_diagonals * (rlwe.encode_ns + rlwe.pad_absorb_ns))) /
+      1e6;
+  estimate.server_memory_bytes =
+      num_values * sizeof(lwe::PlainInteger) +
+      num_shards * params.db_rows * params.lwe_secret_dim *
+          sizeof(lwe::Integer) +
+      num_ts * (num_diagonals + num_rotations * (1 + num_digits) +
+                2 * num_shards * num_blocks) *
+          polynomial_memory;
+  estimate.upload_bytes =
+      params.db_cols * kLweCoefficientBytes + num_ts * polynomial_bytes;
+  estimate.first_upload_bytes =
+      estimate.upload_bytes + num_digits * polynomial_bytes;
+  estimate.hint_bytes = num_ts * num_shards * num_blocks * polynomial_bytes;
+  estimate.download_bytes =
+      num_shards * params.db_rows * kLweCoefficientBytes + estimate.hint_bytes;
+  return estimate;
+}
+
+std::vector<Parameters> EnumerateParameters(const SelectionTarget& target) {
+  std::vector<Parameters> candidates;
+  if (target.num_records <= 0 || target.record_bit_size <= 0) {
+    return candidates;
+  }
+  for (int plaintext_bits = 1; plaintext_bits <= kMaxPlaintextBitSize;
+       ++plaintext_bits) {
+    for (int log_n = kMinLogN; log_n <= kMaxLogN; ++log_n) {
+      int num_slots_per_group = 1 << (log_n - 1);
+      if (target.lwe_secret_dim > num_slots_per_group) {
+        continue;
+      }
+      int max_log_q = MaxLogCiphertextModulus(log_n, target.security_level);
+      int log_q = 0;
+      for (int num_qs = 1; num_qs <= std::size(kCandidateQs); ++num_qs) {
+        log_q += BitLength(kCandidateQs[num_qs - 1]);
+        if (log_q > max_log_q) {
+          break;
+        }
+        for (int log_rows_per_block = kMinLogRowsPerBlock;
+             log_rows_per_block < log_n; ++log_rows_per_block) {
+          int rows_per_block = 1 << log_rows_per_block;
+          // Database shapes with a power-of-two number of blocks.
+          for (int64_t db_rows = rows_per_block;; db_rows *= 2) {
+            int64_t db_cols = DivAndRoundUp(target.num_records, db_rows);
+            db_cols += db_cols % 2;  // The LWE error sampler needs even sizes.
+            Parameters params{
+                .db_rows = db_rows,
+                .db_cols = db_cols,
+                .db_record_bit_size = target.record_bit_size,
+                .lwe_secret_dim = target.lwe_secret_dim,
+                .lwe_modulus_bit_size = 32,
+                .lwe_plaintext_bit_size = plaintext_bits,
+                .lwe_error_variance = kLweErrorVariance,
+                .linpir_params =
+                    linpir::RlweParameters<RlweInteger>{
+                        .log_n = log_n,
+                        .qs = std::vector<RlweInteger>(
+                            kCandidateQs, kCandidateQs + num_qs),
+                        .ts = {},
+                        .gadget_log_bs = std::vector<size_t>(
+                            num_qs, kCandidateGadgetLogB),
+                        .error_variance = 8,
+                        .prng_type = rlwe::PRNG_TYPE_HKDF,
+                        .rows_per_block = rows_per_block,
+                    },
+                .prng_type = rlwe::PRNG_TYPE_HKDF,
+            };
+            // Use the fewest plaintext moduli that meet the target.
+            for (RlweInteger t : kCandidateTs) {
+              params.linpir_params.ts.push_back(t);
+              if (EstimateFailureProbabilities(params).Total() <=
+                  target.log2_failure_probability) {
+                candidates.push_back(params);
+                break;
+              }
+            }
+            if (db_cols <= 2) {
+              break;
+            }
+          }
+        }
+      }
+    }
+  }
+  return candidates;
+}
+
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
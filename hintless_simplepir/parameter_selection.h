@@ -0,0 +1,138 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_HINTLESS_SIMPLEPIR_PARAMETER_SELECTION_H_
+#define HINTLESS_PIR_HINTLESS_SIMPLEPIR_PARAMETER_SELECTION_H_
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "hintless_simplepir/parameters.h"
+#include "linpir/parameters.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+
+// Requirements on the parameters of a new database.
+struct SelectionTarget {
+  int64_t num_records;
+  int record_bit_size;
+
+  // Classical security level in bits of the RLWE parameters, per the
+  // HomomorphicEncryption.org standard for ternary secrets: 128, 192 or 256.
+  int security_level = 128;
+
+  // Upper bound on the base-2 log of the probability that a query fails to
+  // recover the correct record.
+  double log2_failure_probability = -40;
+
+  // The LWE secret dimension is not selected, as its security depends on the
+  // fixed LWE modulus 2^32 and error distribution.
+  int lwe_secret_dim = 1024;
+};
+
+// Returns the number of bits needed to represent `x`, which is 0 for 0.
+int BitLength(Parameters::RlweInteger x);
+
+// Returns the total number of gadget digits over all ciphertext moduli of
+// `params`.
+int NumGadgetDigits(
+    const linpir::RlweParameters<Parameters::RlweInteger>& params);
+
+// Returns the largest bit size of the RLWE ciphertext modulus at ring dimension
+// 2^log_n for `security_level`, or 0 if the combination is not supported.
+int MaxLogCiphertextModulus(int log_n, int security_level);
+
+// Base-2 logs of the probabilities that the parts of a query fail, per the
+// noise model in parameter_selection.cc.
+struct FailureProbabilities {
+  // The LWE error of a record shard exceeds the decoding bound.
+  double lwe;
+  // Hint * LWE secret overflows the product of the LinPIR plaintext moduli.
+  double crt;
+  // The BFV error of a LinPIR response exceeds the decryption bound.
+  double linpir;
+
+  // Returns the union bound on the failure probability of a query.
+  double Total() const;
+};
+
+FailureProbabilities EstimateFailureProbabilities(const Parameters& params);
+
+// Costs of the LWE operations, in nanoseconds.
+struct LweCosts {
+  // Per database value and shard in `Database::InnerProductWith`.
+  double query_ns_per_value;
+  // Per database value, shard and LWE secret coordinate in
+  // `Database::UpdateHints`.
+  double hint_ns_per_product;
+  // Per entry of the LWE query pad in `lwe::ExpandPad`.
+  double pad_ns_per_value;
+};
+
+// Costs of the LinPIR operations for one RLWE ring and ciphertext modulus, in
+// nanoseconds.
+struct RlweCosts {
+  // Rotating a query ciphertext, including the key switching.
+  double rotation_ns;
+  // Multiplying a rotated query by a diagonal and accumulating the result.
+  double absorb_ns;
+  // Encoding a diagonal into a plaintext polynomial.
+  double encode_ns;
+  // Rotating the random pads of the queries during preprocessing.
+  double pad_rotation_ns;
+  // Multiplying the rotated pads by a diagonal during preprocessing.
+  double pad_absorb_ns;
+};
+
+// A cost model, usually calibrated by micro-benchmarks on the target host.
+struct CostModel {
+  LweCosts lwe;
+  // Keyed by (log_n, number of ciphertext moduli).
+  std::map<std::pair<int, int>, RlweCosts> rlwe;
+};
+
+// Estimated costs of a parameter set.
+struct CostEstimate {
+  // Server CPU time to handle a request, excluding the Galois key setup.
+  double server_ms_per_query;
+  double preprocess_ms;
+  // The database, hints and LinPIR preprocessed state. The LWE query pad is
+  // streamed into the hints and not held.
+  int64_t server_memory_bytes;
+  // Sizes of a request without and with the Galois key.
+  int64_t upload_bytes;
+  int64_t first_upload_bytes;
+  int64_t download_bytes;
+  // Size of the LinPIR response pads in the public parameters.
+  int64_t hint_bytes;
+};
+
+// Returns the communication sizes and memory of `params`, and the CPU times
+// per `model`. Returns an error if `model` lacks the RLWE costs of `params`.
+absl::StatusOr<CostEstimate> EstimateCost(const Parameters& params,
+                                          const CostModel& model);
+
+// Returns the parameter sets that meet `target`. The RLWE moduli are taken from
+// a fixed set of NTT-friendly primes.
+std::vector<Parameters> EnumerateParameters(const SelectionTarget& target);
+
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_HINTLESS_SIMPLEPIR_PARAMETER_SELECTION_H_
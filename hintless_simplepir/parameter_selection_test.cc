@@ -0,0 +1,162 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hintless_simplepir/parameter_selection.h"
+
+#include <cstdint>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "hintless_simplepir/parameters.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/testing/status_matchers.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+using rlwe::testing::StatusIs;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+TEST(ParameterSelectionTest, MaxLogCiphertextModulus) {
+  EXPECT_EQ(MaxLogCiphertextModulus(12, 128), 109);
+  EXPECT_EQ(MaxLogCiphertextModulus(13, 256), 118);
+  EXPECT_EQ(MaxLogCiphertextModulus(12, 100), 0);
+  EXPECT_EQ(MaxLogCiphertextModulus(20, 128), 0);
+}
+
+TEST(ParameterSelectionTest, BitLength) {
+  EXPECT_EQ(BitLength(0), 0);
+  EXPECT_EQ(BitLength(1), 1);
+  EXPECT_EQ(BitLength(255), 8);
+  EXPECT_EQ(BitLength(256), 9);
+  EXPECT_EQ(BitLength(35184371884033ULL), 45);
+}
+
+TEST(ParameterSelectionTest, NumGadgetDigits) {
+  // Two 45-bit moduli with 16-bit digits.
+  EXPECT_EQ(NumGadgetDigits(kParameters.linpir_params), 6);
+}
+
+TEST(ParameterSelectionTest, DefaultParametersAreCorrect) {
+  FailureProbabilities failure = EstimateFailureProbabilities(kParameters);
+  EXPECT_LT(failure.lwe, -40);
+  EXPECT_LT(failure.crt, -40);
+  EXPECT_LT(failure.linpir, -40);
+  EXPECT_LT(failure.Total(), -40);
+}
+
+TEST(ParameterSelectionTest, SinglePlaintextModulusOverflows) {
+  Parameters params = kParameters;
+  params.linpir_params.ts = {2056193};
+  EXPECT_GT(EstimateFailureProbabilities(params).crt, -1);
+}
+
+TEST(ParameterSelectionTest, SingleCiphertextModulusIsTooNoisy) {
+  Parameters params = kParameters;
+  params.linpir_params.qs = {35184371884033ULL};
+  params.linpir_params.gadget_log_bs = {16};
+  EXPECT_GT(EstimateFailureProbabilities(params).linpir, -1);
+}
+
+TEST(ParameterSelectionTest, EstimateCostSizes) {
+  CostModel model;
+  model.rlwe[{12, 2}] = RlweCosts{};
+  ASSERT_OK_AND_ASSIGN(CostEstimate estimate,
+                       EstimateCost(kParameters, model));
+  // 4096 coefficients of two 45-bit moduli.
+  constexpr int64_t kPolynomialBytes = 4096 * 90 / 8;
+  // 8 shards of one block each, for each of the two plaintext moduli.
+  EXPECT_EQ(estimate.hint_bytes, 2 * 8 * kPolynomialBytes);
+  EXPECT_EQ(estimate.upload_bytes, 1024 * 5 + 2 * kPolynomialBytes);
+  // Three 16-bit gadget digits per modulus.
+  EXPECT_EQ(estimate.first_upload_bytes,
+            estimate.upload_bytes + 6 * kPolynomialBytes);
+  EXPECT_EQ(estimate.download_bytes,
+            8 * 1024 * 5 + 2 * 8 * kPolynomialBytes);
+  EXPECT_GT(estimate.server_memory_bytes, 8 * 1024 * 1024);
+}
+
+TEST(ParameterSelectionTest, EstimateCostScalesWithModel) {
+  CostModel model;
+  model.lwe = LweCosts{.query_ns_per_value = 1};
+  model.rlwe[{12, 2}] = RlweCosts{.rotation_ns = 1000, .absorb_ns = 100};
+  ASSERT_OK_AND_ASSIGN(CostEstimate estimate,
+                       EstimateCost(kParameters, model));
+  // 8 * 1024 * 1024 LWE values, and for each plaintext modulus 511 rotations
+  // and 8 * 512 diagonals.
+  double expected_ns =
+      8 * 1024 * 1024 + 2 * (511 * 1000 + 8 * 512 * 100);
+  EXPECT_DOUBLE_EQ(estimate.server_ms_per_query, expected_ns / 1e6);
+}
+
+TEST(ParameterSelectionTest, EstimateCostFailsWithoutRlweCosts) {
+  EXPECT_THAT(EstimateCost(kParameters, CostModel{}),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(ParameterSelectionTest, EnumeratedParametersMeetTarget) {
+  SelectionTarget target{.num_records = 1 << 20, .record_bit_size = 64};
+  std::vector<Parameters> candidates = EnumerateParameters(target);
+  ASSERT_FALSE(candidates.empty());
+  for (const Parameters& params : candidates) {
+    const auto& rlwe_params = params.linpir_params;
+    EXPECT_GE(params.db_rows * params.db_cols, target.num_records);
+    EXPECT_EQ(params.db_rows % rlwe_params.rows_per_block, 0);
+    EXPECT_EQ(params.db_cols % 2, 0);
+    EXPECT_LE(params.lwe_secret_dim, 1 << (rlwe_params.log_n - 1));
+    EXPECT_LE(EstimateFailureProbabilities(params).Total(),
+              target.log2_failure_probability);
+    int log_q = 54 * rlwe_params.qs.size();
+    EXPECT_LE(log_q, MaxLogCiphertextModulus(rlwe_params.log_n,
+                                             target.security_level));
+  }
+}
+
+TEST(ParameterSelectionTest, EnumerateRejectsInvalidTarget) {
+  EXPECT_TRUE(EnumerateParameters({.num_records = 0, .record_bit_size = 8})
+                  .empty());
+  // No supported ring has enough slots for the LWE secret.
+  EXPECT_TRUE(EnumerateParameters({.num_records = 1024,
+                                   .record_bit_size = 8,
+                                   .lwe_secret_dim = 1 << 14})
+                  .empty());
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
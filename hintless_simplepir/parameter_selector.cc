@@ -0,0 +1,394 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Lists the HintlessPIR parameter sets for a new database, ranked by their
+// estimated costs on this host, e.g.
+//
+//   parameter_selector --num_records=16777216 --record_bit_size=256 \
+//       --security_level=128 --log2_failure_probability=-40 --objective=cpu
+//
+// The candidates are the database shapes, LWE plaintext sizes, ring
+// dimensions, RLWE moduli and LinPIR block sizes that meet the security and
+// correctness targets per the noise model in parameter_selection.h. Their
+// costs are estimated by a cost model whose per-operation timings are first
+// measured with short micro-benchmarks of the LWE and LinPIR primitives.
+//
+// The best parameter set is also printed as a ParameterSweepConfig, so that it
+// can be validated end to end with `parameter_sweep`.
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "hintless_simplepir/database_hwy.h"
+#include "hintless_simplepir/parameter_selection.h"
+#include "hintless_simplepir/parameters.h"
+#include "linpir/client.h"
+#include "linpir/database.h"
+#include "linpir/parameters.h"
+#include "linpir/serialization.pb.h"
+#include "linpir/server.h"
+#include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/types.h"
+#include "shell_encryption/montgomery.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/rns/rns_context.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(int64_t, num_records, 1 << 20, "Number of records");
+ABSL_FLAG(int, record_bit_size, 64, "Size of a record in bits");
+ABSL_FLAG(int, security_level, 128,
+          "Security level of the RLWE parameters in bits: 128, 192 or 256");
+ABSL_FLAG(double, log2_failure_probability, -40,
+          "Upper bound on the base-2 log of the query failure probability");
+ABSL_FLAG(int, lwe_secret_dim, 1024, "Dimension of the LWE secret");
+ABSL_FLAG(std::string, objective, "cpu",
+          "Cost to rank the parameter sets by: cpu, preprocess, memory, "
+          "upload, download or total_bytes");
+ABSL_FLAG(int, max_results, 20, "Number of parameter sets to list");
+ABSL_FLAG(absl::Duration, calibration_time, absl::Milliseconds(200),
+          "Minimum duration of each calibration measurement");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+using RlweRnsContext = rlwe::RnsContext<rlwe::MontgomeryInt<RlweInteger>>;
+using LinPirClient = linpir::Client<RlweInteger>;
+using LinPirDatabase = linpir::Database<RlweInteger>;
+using LinPirServer = linpir::Server<RlweInteger>;
+using Prng = rlwe::SingleThreadHkdfPrng;
+
+// Shape of the database used to calibrate the LWE costs.
+constexpr int64_t kCalibrationRows = 256;
+constexpr int64_t kCalibrationCols = 1024;
+
+// Rows per block of the LinPIR databases used to calibrate the RLWE costs.
+constexpr int kCalibrationRowsPerBlock = 16;
+
+// Returns the mean duration of `fn` in nanoseconds, over repeated calls lasting
+// at least --calibration_time.
+template <typename Fn>
+absl::StatusOr<double> MeanNanos(Fn fn) {
+  absl::Duration min_time = absl::GetFlag(FLAGS_calibration_time);
+  int64_t num_calls = 0;
+  absl::Time start = absl::Now();
+  absl::Duration elapsed;
+  do {
+    RLWE_RETURN_IF_ERROR(fn());
+    ++num_calls;
+    elapsed = absl::Now() - start;
+  } while (elapsed < min_time);
+  return absl::ToDoubleNanoseconds(elapsed) / num_calls;
+}
+
+absl::StatusOr<LweCosts> CalibrateLwe(int lwe_secret_dim) {
+  Parameters params{
+      .db_rows = kCalibrationRows,
+      .db_cols = kCalibrationCols,
+      .db_record_bit_size = 8,
+      .lwe_secret_dim = lwe_secret_dim,
+      .lwe_modulus_bit_size = 32,
+      .lwe_plaintext_bit_size = 8,
+  };
+  RLWE_ASSIGN_OR_RETURN(auto database, Database::CreateRandom(params));
+
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed, Prng::GenerateSeed());
+  lwe::Matrix pad;
+  auto expand_pad = [&]() -> absl::Status {
+    RLWE_ASSIGN_OR_RETURN(auto prng, Prng::Create(prng_seed));
+    RLWE_ASSIGN_OR_RETURN(
+        pad, lwe::ExpandPad(params.db_cols, lwe_secret_dim, prng.get()));
+    return absl::OkStatus();
+  };
+  RLWE_ASSIGN_OR_RETURN(double pad_ns, MeanNanos(expand_pad));
+  RLWE_RETURN_IF_ERROR(database->UpdateLweQueryPad(&pad));
+  RLWE_ASSIGN_OR_RETURN(double hint_ns,
+                        MeanNanos([&]() { return database->UpdateHints(); }));
+
+  absl::BitGen bitgen;
+  Database::LweVector query(params.db_cols);
+  for (auto& x : query) {
+    x = absl::Uniform<lwe::Integer>(bitgen);
+  }
+  RLWE_ASSIGN_OR_RETURN(double query_ns, MeanNanos([&]() {
+                          return database->InnerProductWith(query).status();
+                        }));
+
+  double num_values = params.db_rows * params.db_cols;
+  return LweCosts{
+      .query_ns_per_value = query_ns / num_values,
+      .hint_ns_per_product = hint_ns / (num_values * lwe_secret_dim),
+      .pad_ns_per_value = pad_ns / (params.db_cols * lwe_secret_dim),
+  };
+}
+
+// Measures the LinPIR costs for the ring and ciphertext moduli of `params`.
+// The per-block costs are the differences between servers holding one and two
+// blocks, and the remaining time is attributed to the rotations.
+absl::StatusOr<RlweCosts> CalibrateRlwe(
+    linpir::RlweParameters<RlweInteger> params) {
+  params.rows_per_block = kCalibrationRowsPerBlock;
+  RlweInteger t = params.ts[0];
+  RLWE_ASSIGN_OR_RETURN(RlweRnsContext context,
+                        RlweRnsContext::CreateForBfvFiniteFieldEncoding(
+                            params.log_n, params.qs, /*ps=*/{}, t));
+
+  // One block of rows, filling all slots of a group.
+  int num_cols = 1 << (params.log_n - 1);
+  absl::BitGen bitgen;
+  std::vector<std::vector<RlweInteger>> data(kCalibrationRowsPerBlock);
+  for (auto& row : data) {
+    row.resize(num_cols);
+    for (auto& x : row) {
+      x = absl::Uniform<RlweInteger>(bitgen, 0, t);
+    }
+  }
+  std::vector<std::unique_ptr<LinPirDatabase>> databases(3);
+  auto create_database = [&]() -> absl::Status {
+    RLWE_ASSIGN_OR_RETURN(databases[0],
+                          LinPirDatabase::Create(params, &context, data));
+    return absl::OkStatus();
+  };
+  RLWE_ASSIGN_OR_RETURN(double encode_ns, MeanNanos(create_database));
+  for (int i = 1; i < databases.size(); ++i) {
+    RLWE_ASSIGN_OR_RETURN(databases[i],
+                          LinPirDatabase::Create(params, &context, data));
+  }
+
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_ct_pad, Prng::GenerateSeed());
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_gk_pad, Prng::GenerateSeed());
+  RLWE_ASSIGN_OR_RETURN(
+      auto one_block_server,
+      LinPirServer::Create(params, &context, {databases[0].get()},
+                           prng_seed_ct_pad, prng_seed_gk_pad));
+  RLWE_ASSIGN_OR_RETURN(
+      auto two_block_server,
+      LinPirServer::Create(params, &context,
+                           {databases[1].get(), databases[2].get()},
+                           prng_seed_ct_pad, prng_seed_gk_pad));
+  RLWE_ASSIGN_OR_RETURN(double one_block_preprocess_ns, MeanNanos([&]() {
+                          return one_block_server->Preprocess();
+                        }));
+  RLWE_ASSIGN_OR_RETURN(double two_block_preprocess_ns, MeanNanos([&]() {
+                          return two_block_server->Preprocess();
+                        }));
+
+  RLWE_ASSIGN_OR_RETURN(auto client,
+                        LinPirClient::Create(params, &context, prng_seed_ct_pad,
+                                             prng_seed_gk_pad));
+  std::vector<RlweInteger> query(num_cols);
+  for (auto& x : query) {
+    x = absl::Uniform<RlweInteger>(bitgen, 0, t);
+  }
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_sk, Prng::GenerateSeed());
+  RLWE_ASSIGN_OR_RETURN(auto ct_query,
+                        client->EncryptQuery(query, prng_seed_sk));
+  RLWE_ASSIGN_OR_RETURN(auto gk, client->GenerateGaloisKey(prng_seed_sk));
+  RLWE_ASSIGN_OR_RETURN(LinPirRequest request,
+                        client->GenerateRequest(ct_query, gk));
+  // Register the Galois key, then time the requests reusing it.
+  request.set_client_id("calibration");
+  RLWE_RETURN_IF_ERROR(one_block_server->HandleRequest(request).status());
+  RLWE_RETURN_IF_ERROR(two_block_server->HandleRequest(request).status());
+  request.clear_gk_key_bs();
+  RLWE_ASSIGN_OR_RETURN(double one_block_request_ns, MeanNanos([&]() {
+                          return one_block_server->HandleRequest(request)
+                              .status();
+                        }));
+  RLWE_ASSIGN_OR_RETURN(double two_block_request_ns, MeanNanos([&]() {
+                          return two_block_server->HandleRequest(request)
+                              .status();
+                        }));
+
+  double num_rotations = kCalibrationRowsPerBlock / 2;
+  double block_ns = std::max(0.0, two_block_request_ns - one_block_request_ns);
+  double preprocess_block_ns =
+      std::max(0.0, two_block_preprocess_ns - one_block_preprocess_ns);
+  return RlweCosts{
+      .rotation_ns = std::max(0.0, one_block_request_ns - block_ns) /
+                     (num_rotations - 1),
+      .absorb_ns = block_ns / num_rotations,
+      .encode_ns = encode_ns / num_rotations,
+      .pad_rotation_ns =
+          std::max(0.0, one_block_preprocess_ns - preprocess_block_ns) /
+          (num_rotations - 1),
+      .pad_absorb_ns = preprocess_block_ns / num_rotations,
+  };
+}
+
+// Returns the cost to minimize for `objective`.
+absl::StatusOr<std::function<double(const CostEstimate&)>> ObjectiveFunction(
+    const std::string& objective) {
+  using Objective = std::function<double(const CostEstimate&)>;
+  static const auto* objectives = new std::map<std::string, Objective>{
+      {"cpu", [](const CostEstimate& e) { return e.server_ms_per_query; }},
+      {"preprocess", [](const CostEstimate& e) { return e.preprocess_ms; }},
+      {"memory",
+       [](const CostEstimate& e) {
+         return static_cast<double>(e.server_memory_bytes);
+       }},
+      {"upload",
+       [](const CostEstimate& e) {
+         return static_cast<double>(e.upload_bytes);
+       }},
+      {"download",
+       [](const CostEstimate& e) {
+         return static_cast<double>(e.download_bytes);
+       }},
+      {"total_bytes",
+       [](const CostEstimate& e) {
+         return static_cast<double>(e.upload_bytes + e.download_bytes);
+       }},
+  };
+  auto it = objectives->find(objective);
+  if (it == objectives->end()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Unknown objective \"", objective, "\"."));
+  }
+  return it->second;
+}
+
+double KiB(int64_t bytes) { return bytes / 1024.0; }
+
+void PrintSweepConfig(const Parameters& params) {
+  const auto& rlwe_params = params.linpir_params;
+  std::cout << "db_rows: " << params.db_rows << "\n"
+            << "db_cols: " << params.db_cols << "\n"
+            << "db_record_bit_size: " << params.db_record_bit_size << "\n"
+            << "lwe_secret_dim: " << params.lwe_secret_dim << "\n"
+            << "lwe_plaintext_bit_size: " << params.lwe_plaintext_bit_size
+            << "\n"
+            << "log_n: " << rlwe_params.log_n << "\n"
+            << "rows_per_block: " << rlwe_params.rows_per_block << "\n"
+            << "rlwe_moduli {\n";
+  for (RlweInteger q : rlwe_params.qs) {
+    std::cout << "  qs: " << q << "\n";
+  }
+  for (RlweInteger t : rlwe_params.ts) {
+    std::cout << "  ts: " << t << "\n";
+  }
+  for (size_t log_b : rlwe_params.gadget_log_bs) {
+    std::cout << "  gadget_log_bs: " << log_b << "\n";
+  }
+  std::cout << "}\n";
+}
+
+absl::Status RunSelector() {
+  SelectionTarget target{
+      .num_records = absl::GetFlag(FLAGS_num_records),
+      .record_bit_size = absl::GetFlag(FLAGS_record_bit_size),
+      .security_level = absl::GetFlag(FLAGS_security_level),
+      .log2_failure_probability =
+          absl::GetFlag(FLAGS_log2_failure_probability),
+      .lwe_secret_dim = absl::GetFlag(FLAGS_lwe_secret_dim),
+  };
+  int max_results = absl::GetFlag(FLAGS_max_results);
+  RLWE_ASSIGN_OR_RETURN(auto objective,
+                        ObjectiveFunction(absl::GetFlag(FLAGS_objective)));
+  if (target.num_records <= 0 || target.record_bit_size <= 0 ||
+      max_results <= 0) {
+    return absl::InvalidArgumentError(
+        "--num_records, --record_bit_size and --max_results must be "
+        "positive.");
+  }
+
+  std::vector<Parameters> candidates = EnumerateParameters(target);
+  if (candidates.empty()) {
+    return absl::NotFoundError("No parameter set meets the target.");
+  }
+
+  std::cout << "Calibrating the cost model on this host...\n";
+  CostModel model;
+  RLWE_ASSIGN_OR_RETURN(model.lwe, CalibrateLwe(target.lwe_secret_dim));
+  for (const Parameters& params : candidates) {
+    const auto& rlwe_params = params.linpir_params;
+    auto key = std::make_pair(rlwe_params.log_n,
+                              static_cast<int>(rlwe_params.qs.size()));
+    if (model.rlwe.find(key) == model.rlwe.end()) {
+      RLWE_ASSIGN_OR_RETURN(model.rlwe[key], CalibrateRlwe(rlwe_params));
+    }
+  }
+
+  std::vector<std::pair<Parameters, CostEstimate>> estimates;
+  estimates.reserve(candidates.size());
+  for (Parameters& params : candidates) {
+    RLWE_ASSIGN_OR_RETURN(CostEstimate estimate, EstimateCost(params, model));
+    estimates.emplace_back(std::move(params), estimate);
+  }
+  std::stable_sort(estimates.begin(), estimates.end(),
+                   [&objective](const auto& a, const auto& b) {
+                     return objective(a.second) < objective(b.second);
+                   });
+
+  std::cout << absl::StreamFormat(
+      "%d parameter sets meet the target; the best %d by %s:\n",
+      estimates.size(), std::min<int>(max_results, estimates.size()),
+      absl::GetFlag(FLAGS_objective));
+  std::cout << absl::StreamFormat(
+      "%8s %8s %4s %5s %3s %3s %5s | %9s %10s %10s %10s %10s %11s %10s %8s\n",
+      "rows", "cols", "ptxt", "log_n", "#qs", "#ts", "block", "cpu_ms",
+      "preproc_s", "memory_MiB", "upload_KiB", "first_KiB", "download_KiB",
+      "hint_KiB", "log2_err");
+  for (int i = 0; i < std::min<int>(max_results, estimates.size()); ++i) {
+    const Parameters& params = estimates[i].first;
+    const CostEstimate& estimate = estimates[i].second;
+    const auto& rlwe_params = params.linpir_params;
+    std::cout << absl::StreamFormat(
+        "%8d %8d %4d %5d %3d %3d %5d | %9.2f %10.2f %10.1f %10.1f %10.1f "
+        "%11.1f %10.1f %8.1f\n",
+        params.db_rows, params.db_cols, params.lwe_plaintext_bit_size,
+        rlwe_params.log_n, rlwe_params.qs.size(), rlwe_params.ts.size(),
+        rlwe_params.rows_per_block, estimate.server_ms_per_query,
+        estimate.preprocess_ms / 1000,
+        estimate.server_memory_bytes / (1024.0 * 1024.0),
+        KiB(estimate.upload_bytes), KiB(estimate.first_upload_bytes),
+        KiB(estimate.download_bytes), KiB(estimate.hint_bytes),
+        EstimateFailureProbabilities(params).Total());
+  }
+
+  std::cout << "\nBest parameter set as a ParameterSweepConfig:\n";
+  PrintSweepConfig(estimates[0].first);
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = hintless_pir::hintless_simplepir::RunSelector();
+  if (!status.ok()) {
+    std::cerr << status << "\n";
+    return 1;
+  }
+  return 0;
+}
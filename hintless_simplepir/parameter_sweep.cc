@@ -0,0 +1,388 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Runs HintlessPIR end to end over a grid of parameter sets and writes the
+// timings, communication sizes and memory usage as JSON and/or CSV.
+//
+// The grid is given as a text-format ParameterSweepConfig, e.g.
+//
+//   db_rows: 1024
+//   db_rows: 4096
+//   db_cols: 1024
+//   db_record_bit_size: 64
+//   rows_per_block: 512
+//   rows_per_block: 1024
+//   rlwe_moduli {
+//     qs: 35184371884033 qs: 35184371703809
+//     ts: 2056193 ts: 1990657
+//     gadget_log_bs: 16 gadget_log_bs: 16
+//   }
+//
+// and the tool is invoked as
+//
+//   parameter_sweep --config=sweep.textproto --output_csv=sweep.csv
+//
+// Parameters not listed in the config take the values of `kParameters`.
+// A parameter set that fails (e.g. inconsistent moduli) is reported with its
+// error status and does not stop the sweep.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_replace.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/load_stats.h"
+#include "google/protobuf/text_format.h"
+#include "hintless_simplepir/client.h"
+#include "hintless_simplepir/parameter_sweep.pb.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "hintless_simplepir/server.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(std::string, config, "",
+          "Path to a text-format ParameterSweepConfig");
+ABSL_FLAG(std::string, output_json, "", "Path of the JSON output, if any");
+ABSL_FLAG(std::string, output_csv, "",
+          "Path of the CSV output; written to stdout if neither output is "
+          "given");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+// One row of the output: named values, which are either numbers or strings.
+struct Field {
+  std::string name;
+  std::string value;
+  bool is_number;
+};
+using Row = std::vector<Field>;
+
+template <typename T>
+Field Number(std::string name, T value) {
+  return Field{std::move(name), absl::StrCat(value), true};
+}
+
+Field String(std::string name, std::string value) {
+  return Field{std::move(name), std::move(value), false};
+}
+
+double Milliseconds(absl::Duration duration) {
+  return absl::ToDoubleMilliseconds(duration);
+}
+
+// Expands the grid in `config` into a list of parameter sets.
+std::vector<Parameters> ExpandGrid(const ParameterSweepConfig& config) {
+  std::vector<Parameters> grid = {kParameters};
+  // Replaces every parameter set in `grid` by one copy per value in `values`.
+  auto expand = [&grid](const auto& values, auto set_value) {
+    if (values.empty()) {
+      return;
+    }
+    std::vector<Parameters> expanded;
+    for (const Parameters& params : grid) {
+      for (const auto& value : values) {
+        Parameters copy = params;
+        set_value(copy, value);
+        expanded.push_back(std::move(copy));
+      }
+    }
+    grid = std::move(expanded);
+  };
+  expand(config.db_rows(), [](Parameters& p, int64_t v) { p.db_rows = v; });
+  expand(config.db_cols(), [](Parameters& p, int64_t v) { p.db_cols = v; });
+  expand(config.db_record_bit_size(),
+         [](Parameters& p, int v) { p.db_record_bit_size = v; });
+  expand(config.lwe_secret_dim(),
+         [](Parameters& p, int v) { p.lwe_secret_dim = v; });
+  expand(config.lwe_plaintext_bit_size(),
+         [](Parameters& p, int v) { p.lwe_plaintext_bit_size = v; });
+  expand(config.log_n(),
+         [](Parameters& p, int v) { p.linpir_params.log_n = v; });
+  expand(config.rows_per_block(),
+         [](Parameters& p, int v) { p.linpir_params.rows_per_block = v; });
+  expand(config.rlwe_moduli(),
+         [](Parameters& p, const ParameterSweepConfig::RlweModuli& v) {
+           p.linpir_params.qs.assign(v.qs().begin(), v.qs().end());
+           p.linpir_params.ts.assign(v.ts().begin(), v.ts().end());
+           p.linpir_params.gadget_log_bs.assign(v.gadget_log_bs().begin(),
+                                                v.gadget_log_bs().end());
+         });
+  return grid;
+}
+
+// Returns the fields describing the parameter set itself.
+Row ParameterFields(const Parameters& params) {
+  return {
+      Number("db_rows", params.db_rows),
+      Number("db_cols", params.db_cols),
+      Number("db_record_bit_size", params.db_record_bit_size),
+      Number("lwe_secret_dim", params.lwe_secret_dim),
+      Number("lwe_plaintext_bit_size", params.lwe_plaintext_bit_size),
+      Number("log_n", params.linpir_params.log_n),
+      Number("rows_per_block", params.linpir_params.rows_per_block),
+      Number("num_qs", params.linpir_params.qs.size()),
+      String("ts", absl::StrJoin(params.linpir_params.ts, ";")),
+  };
+}
+
+// Runs the protocol with `params` and returns the measurements.
+absl::StatusOr<Row> RunParameterSet(const Parameters& params,
+                                    int num_queries) {
+  Row row;
+
+  // Server setup and preprocessing, tracking the peak memory.
+  benchmarks::ResetPeakRss();
+  RLWE_ASSIGN_OR_RETURN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  absl::Time start = absl::Now();
+  RLWE_RETURN_IF_ERROR(server->Preprocess());
+  absl::Duration preprocess_time = absl::Now() - start;
+  int64_t preprocess_peak_rss = benchmarks::GetProcessUsage().peak_rss_bytes;
+  HintlessPirServerPublicParams public_params = server->GetPublicParams();
+
+  start = absl::Now();
+  RLWE_ASSIGN_OR_RETURN(auto client,
+                        Client<RlweInteger>::Create(params, public_params));
+  absl::Duration client_create_time = absl::Now() - start;
+
+  absl::BitGen bitgen;
+  int64_t num_records = params.db_rows * params.db_cols;
+  absl::Duration first_request_time, first_handle_time;
+  absl::Duration request_time, handle_time, recover_time;
+  int64_t first_upload_bytes = 0, upload_bytes = 0, download_bytes = 0;
+  bool correct = true;
+  // The first query carries the Galois key; the others reuse the session.
+  for (int i = 0; i <= num_queries; ++i) {
+    int64_t index = absl::Uniform<int64_t>(bitgen, 0, num_records);
+    start = absl::Now();
+    RLWE_ASSIGN_OR_RETURN(HintlessPirRequest request,
+                          client->GenerateRequest(index));
+    absl::Duration generate = absl::Now() - start;
+    start = absl::Now();
+    RLWE_ASSIGN_OR_RETURN(HintlessPirResponse response,
+                          server->HandleRequest(request));
+    absl::Duration handle = absl::Now() - start;
+    start = absl::Now();
+    RLWE_ASSIGN_OR_RETURN(std::string record, client->RecoverRecord(response));
+    absl::Duration recover = absl::Now() - start;
+
+    RLWE_ASSIGN_OR_RETURN(std::string expected,
+                          server->GetDatabase()->Record(index));
+    correct = correct && (record == expected);
+    recover_time += recover;
+    download_bytes += response.ByteSizeLong();
+    if (i == 0) {
+      first_request_time = generate;
+      first_handle_time = handle;
+      first_upload_bytes = request.ByteSizeLong();
+    } else {
+      request_time += generate;
+      handle_time += handle;
+      upload_bytes += request.ByteSizeLong();
+    }
+  }
+  int num_subsequent = std::max(num_queries, 1);
+  benchmarks::ProcessUsage usage = benchmarks::GetProcessUsage();
+
+  row.push_back(Number("preprocess_ms", Milliseconds(preprocess_time)));
+  row.push_back(Number("client_create_ms", Milliseconds(client_create_time)));
+  row.push_back(
+      Number("first_request_ms", Milliseconds(first_request_time)));
+  row.push_back(Number("first_handle_ms", Milliseconds(first_handle_time)));
+  row.push_back(
+      Number("request_ms", Milliseconds(request_time) / num_subsequent));
+  row.push_back(
+      Number("handle_ms", Milliseconds(handle_time) / num_subsequent));
+  row.push_back(
+      Number("recover_ms", Milliseconds(recover_time) / (num_queries + 1)));
+  row.push_back(Number("first_upload_bytes", first_upload_bytes));
+  row.push_back(Number("upload_bytes", upload_bytes / num_subsequent));
+  row.push_back(Number("download_bytes", download_bytes / (num_queries + 1)));
+  row.push_back(Number("hint_bytes", public_params.ByteSizeLong()));
+  row.push_back(Number("preprocess_peak_rss_bytes", preprocess_peak_rss));
+  row.push_back(Number("peak_rss_bytes", usage.peak_rss_bytes));
+  row.push_back(Number("correct", correct ? 1 : 0));
+  return row;
+}
+
+// Names of the measurement fields, used to fill in rows of failed runs.
+const std::vector<std::string>& MeasurementNames() {
+  static const auto* names = new std::vector<std::string>{
+      "preprocess_ms",      "client_create_ms", "first_request_ms",
+      "first_handle_ms",    "request_ms",       "handle_ms",
+      "recover_ms",         "first_upload_bytes", "upload_bytes",
+      "download_bytes",     "hint_bytes",       "preprocess_peak_rss_bytes",
+      "peak_rss_bytes",     "correct"};
+  return *names;
+}
+
+std::string EscapeCsv(const std::string& value) {
+  if (value.find_first_of(",\"\n") == std::string::npos) {
+    return value;
+  }
+  return absl::StrCat("\"", absl::StrReplaceAll(value, {{"\"", "\"\""}}),
+                      "\"");
+}
+
+std::string EscapeJson(const std::string& value) {
+  return absl::StrReplaceAll(value, {{"\\", "\\\\"}, {"\"", "\\\""},
+                                     {"\n", "\\n"}});
+}
+
+void WriteCsv(const std::vector<Row>& rows, std::ostream& out) {
+  if (rows.empty()) {
+    return;
+  }
+  std::vector<std::string> names;
+  for (const Field& field : rows[0]) {
+    names.push_back(EscapeCsv(field.name));
+  }
+  out << absl::StrJoin(names, ",") << "\n";
+  for (const Row& row : rows) {
+    std::vector<std::string> values;
+    for (const Field& field : row) {
+      values.push_back(EscapeCsv(field.value));
+    }
+    out << absl::StrJoin(values, ",") << "\n";
+  }
+}
+
+void WriteJson(const std::vector<Row>& rows, std::ostream& out) {
+  out << "[\n";
+  for (int i = 0; i < rows.size(); ++i) {
+    std::vector<std::string> members;
+    for (const Field& field : rows[i]) {
+      std::string value = field.is_number
+                              ? field.value
+                              : absl::StrCat("\"", EscapeJson(field.value),
+                                             "\"");
+      members.push_back(absl::StrCat("\"", field.name, "\": ", value));
+    }
+    out << "  {" << absl::StrJoin(members, ", ") << "}"
+        << (i + 1 < rows.size() ? ",\n" : "\n");
+  }
+  out << "]\n";
+}
+
+absl::Status RunSweep() {
+  std::string config_path = absl::GetFlag(FLAGS_config);
+  if (config_path.empty()) {
+    return absl::InvalidArgumentError("--config is required.");
+  }
+  std::ifstream config_file(config_path);
+  if (!config_file) {
+    return absl::NotFoundError(absl::StrCat("Cannot open ", config_path));
+  }
+  std::stringstream config_text;
+  config_text << config_file.rdbuf();
+  ParameterSweepConfig config;
+  if (!google::protobuf::TextFormat::ParseFromString(config_text.str(),
+                                                     &config)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Cannot parse ", config_path,
+                     " as a text-format ParameterSweepConfig."));
+  }
+
+  std::vector<Parameters> grid = ExpandGrid(config);
+  std::vector<Row> rows;
+  for (int i = 0; i < grid.size(); ++i) {
+    std::cerr << "Parameter set " << i + 1 << "/" << grid.size() << ": "
+              << grid[i].db_rows << " x " << grid[i].db_cols << ", "
+              << grid[i].db_record_bit_size << "-bit records\n";
+    Row row = ParameterFields(grid[i]);
+    absl::StatusOr<Row> measurements =
+        RunParameterSet(grid[i], config.num_queries());
+    row.push_back(String("status", measurements.status().ToString()));
+    if (measurements.ok()) {
+      row.insert(row.end(), measurements->begin(), measurements->end());
+    } else {
+      std::cerr << "  failed: " << measurements.status() << "\n";
+      for (const std::string& name : MeasurementNames()) {
+        row.push_back(String(name, ""));
+      }
+    }
+    rows.push_back(std::move(row));
+  }
+
+  std::string json_path = absl::GetFlag(FLAGS_output_json);
+  std::string csv_path = absl::GetFlag(FLAGS_output_csv);
+  if (!json_path.empty()) {
+    std::ofstream json(json_path);
+    WriteJson(rows, json);
+  }
+  if (!csv_path.empty()) {
+    std::ofstream csv(csv_path);
+    WriteCsv(rows, csv);
+  }
+  if (json_path.empty() && csv_path.empty()) {
+    WriteCsv(rows, std::cout);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = hintless_pir::hintless_simplepir::RunSweep();
+  if (!status.ok()) {
+    std::cerr << status << "\n";
+    return 1;
+  }
+  return 0;
+}
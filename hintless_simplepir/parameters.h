@@ -17,15 +17,24 @@
 #define HINTLESS_PIR_HINTLESS_SIMPLEPIR_PARAMETERS_H_
 
 #include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
 
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "linpir/packing.h"
 #include "linpir/parameters.h"
 #include "lwe/types.h"
 #include "shell_encryption/serialization.pb.h"
+#include "shell_encryption/status_macros.h"
 
 namespace hintless_pir {
 namespace hintless_simplepir {
 
-// Parameters of the hintless SimplePIR protocol.
+// Parameters of the hintless SimplePIR protocol. The RLWE moduli are held as
+// 64-bit integers; the server and the client may compute with a narrower RLWE
+// integer type when all moduli fit, see `NarrowLinPirParameters()`.
 struct Parameters {
   using LweInteger = lwe::Integer;
   using RlweInteger = linpir::Uint64;
@@ -41,9 +50,113 @@ struct Parameters {
 
   linpir::RlweParameters<RlweInteger> linpir_params;
 
+  // The PRNG expanding the LWE query pad and sampling the LWE secrets: HKDF,
+  // ChaCha, or `lwe::kPrngTypeAesCtr`.
   rlwe::PrngType prng_type;
+
+  // Number of threads used by the client to expand the LWE query pad when
+  // `prng_type` is seekable, i.e. AES-CTR, and by the server to preprocess the
+  // hints of that many plaintext moduli of `linpir_params.ts` concurrently.
+  // Each of them runs `linpir_params.num_threads` threads of its own to encode
+  // and preprocess its LinPIR databases, which is left as is, so preprocessing
+  // runs up to `num_threads` * `linpir_params.num_threads` threads.
+  int num_threads = 1;
+
+  // Number of threads multiplying the data matrices with each LWE query: the
+  // calling thread and a pool of `num_query_threads` - 1 threads, created
+  // with the database and shared by all the concurrent requests.
+  int num_query_threads = 1;
+
+  // Whether to pack the hint matrices of all shards into the slots of a single
+  // LinPIR database per plaintext modulus, when `lwe_secret_dim` is small
+  // enough for several hint rows to share the slots of a group. This cuts the
+  // number of LinPIR databases, and hence the LinPIR response size and the
+  // server work, by up to the packing factor; see `LinPirPackingFactor()`.
+  // Otherwise, `linpir_params.block_packing_factor` packs the hint blocks of
+  // each shard instead; the two cannot be combined.
+  bool pack_linpir_slots = false;
 };
 
+// Returns the number of hint matrices whose rows share the slots of a LinPIR
+// database, i.e. the largest packing factor for `lwe_secret_dim` columns if
+// `params.pack_linpir_slots` is set, and 1 otherwise.
+inline int LinPirPackingFactor(const Parameters& params) {
+  if (!params.pack_linpir_slots) {
+    return 1;
+  }
+  return linpir::MaxPackingFactor(params.linpir_params, params.lwe_secret_dim);
+}
+
+// Returns the number of rows of the LinPIR database packing the hints of
+// `num_shards` shards with `num_hint_rows` rows each: the hints are stacked
+// into a matrix of num_shards * num_hint_rows rows, whose p'th range of
+// `num_packed_rows` rows is the p'th packed matrix.
+inline int64_t NumPackedHintRows(int num_shards, int64_t num_hint_rows,
+                                 int packing_factor) {
+  return (num_shards * num_hint_rows + packing_factor - 1) / packing_factor;
+}
+
+// Returns the LinPIR parameters of `params` with the RLWE moduli represented
+// as `RlweInteger`, or an error if some modulus does not fit. Also returns an
+// error if `params.linpir_params.ps` is not empty, as Hintless SimplePIR keeps
+// gadget-based rotation keys and creates its RLWE contexts without auxiliary
+// moduli, or if both `params.pack_linpir_slots` and
+// `params.linpir_params.block_packing_factor` pack the LinPIR slots.
+template <typename RlweInteger>
+absl::StatusOr<linpir::RlweParameters<RlweInteger>> NarrowLinPirParameters(
+    const Parameters& params) {
+  if (!params.linpir_params.ps.empty()) {
+    return absl::InvalidArgumentError(
+        "`linpir_params.ps` must be empty: Hintless SimplePIR does not support "
+        "auxiliary key-switching moduli.");
+  }
+  if (params.pack_linpir_slots &&
+      params.linpir_params.block_packing_factor > 1) {
+    return absl::InvalidArgumentError(
+        "`linpir_params.block_packing_factor` must be 1 when "
+        "`pack_linpir_slots` is set.");
+  }
+  auto narrow = [](const std::vector<Parameters::RlweInteger>& moduli)
+      -> absl::StatusOr<std::vector<RlweInteger>> {
+    std::vector<RlweInteger> narrowed;
+    narrowed.reserve(moduli.size());
+    for (Parameters::RlweInteger modulus : moduli) {
+      if (modulus > std::numeric_limits<RlweInteger>::max()) {
+        return absl::InvalidArgumentError(
+            "RLWE moduli in `params` do not fit in `RlweInteger`.");
+      }
+      narrowed.push_back(static_cast<RlweInteger>(modulus));
+    }
+    return narrowed;
+  };
+  auto const& linpir_params = params.linpir_params;
+  RLWE_ASSIGN_OR_RETURN(std::vector<RlweInteger> qs, narrow(linpir_params.qs));
+  RLWE_ASSIGN_OR_RETURN(std::vector<RlweInteger> ts, narrow(linpir_params.ts));
+  return linpir::RlweParameters<RlweInteger>{
+      .log_n = linpir_params.log_n,
+      .qs = std::move(qs),
+      .ts = std::move(ts),
+      .gadget_log_bs = linpir_params.gadget_log_bs,
+      .error_variance = linpir_params.error_variance,
+      .prng_type = linpir_params.prng_type,
+      .rows_per_block = linpir_params.rows_per_block,
+      .num_threads = linpir_params.num_threads,
+      .num_response_moduli = linpir_params.num_response_moduli,
+      .block_packing_factor = linpir_params.block_packing_factor,
+  };
+}
+
+// Returns `params` with the LinPIR ciphertext moduli replaced by three 30-bit
+// NTT-friendly primes (90 bits in total, for ring dimensions up to 2^15), so
+// that the server and the client can be instantiated with 32-bit RLWE
+// integers, whose Montgomery products and NTTs fit twice as many SIMD lanes.
+// The plaintext moduli in `params.linpir_params.ts` must fit in 30 bits.
+inline Parameters With30BitRlweModuli(Parameters params) {
+  params.linpir_params.qs = {1073479681, 1072496641, 1071513601};
+  params.linpir_params.gadget_log_bs = {15, 15, 15};
+  return params;
+}
+
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
 
@@ -0,0 +1,295 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A closed-loop load generator for `pir_server`, e.g.
+//
+//   pir_load_client --socket_path=/tmp/pir.sock --num_connections=16 \
+//       --duration=30s --first_request_ratio=0.05
+//
+// The tool fetches the public parameters and database shape from the server,
+// then opens `--num_connections` connections. Each connection pre-generates
+// `--requests_per_connection` requests, a `--first_request_ratio` fraction of
+// which start new client sessions and carry Galois keys, and sends the first
+// request of every session once to warm up the server's key cache. It then
+// sends the requests back to back, one at a time, for `--duration`.
+//
+// Latency is measured around the whole exchange, including serialization,
+// the socket round trip and parsing, which are also reported separately.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/framed_socket.h"
+#include "benchmarks/load_stats.h"
+#include "hintless_simplepir/client.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/pir_socket.pb.h"
+#include "hintless_simplepir/request_log.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(std::string, socket_path, "/tmp/hintless_pir.sock",
+          "Path of the server's Unix domain socket");
+ABSL_FLAG(int, num_connections, 4, "Number of concurrent connections");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(10),
+          "Duration of the measured load");
+ABSL_FLAG(int, requests_per_connection, 16,
+          "Number of distinct requests pre-generated for each connection");
+ABSL_FLAG(double, first_request_ratio, 0.0,
+          "Fraction of requests that start a new session and carry the "
+          "Galois key");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+
+// The parameters not sent by the server with the database shape.
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+struct LoadResults {
+  benchmarks::LatencyRecorder all;
+  benchmarks::LatencyRecorder first;
+  benchmarks::LatencyRecorder subsequent;
+  std::atomic<int64_t> num_errors{0};
+  std::atomic<int64_t> request_bytes{0};
+  std::atomic<int64_t> response_bytes{0};
+  std::atomic<int64_t> serialize_nanos{0};
+  std::atomic<int64_t> parse_nanos{0};
+};
+
+// Sends `request` on `socket` and returns the response, failing if the server
+// returned an error status.
+absl::StatusOr<PirSocketResponse> Exchange(const benchmarks::Socket& socket,
+                                           const PirSocketRequest& request,
+                                           LoadResults* results = nullptr) {
+  absl::Time start = absl::Now();
+  std::string request_frame = request.SerializeAsString();
+  absl::Time serialized = absl::Now();
+  RLWE_RETURN_IF_ERROR(benchmarks::WriteFrame(socket, request_frame));
+  RLWE_ASSIGN_OR_RETURN(std::string response_frame,
+                        benchmarks::ReadFrame(socket));
+  absl::Time received = absl::Now();
+  PirSocketResponse response;
+  if (!response.ParseFromString(response_frame)) {
+    return absl::DataLossError("Malformed response.");
+  }
+  if (results != nullptr) {
+    results->serialize_nanos += absl::ToInt64Nanoseconds(serialized - start);
+    results->parse_nanos += absl::ToInt64Nanoseconds(absl::Now() - received);
+    results->request_bytes += request_frame.size();
+    results->response_bytes += response_frame.size();
+  }
+  absl::Status status(static_cast<absl::StatusCode>(response.status_code()),
+                      response.status_message());
+  if (!status.ok()) {
+    return status;
+  }
+  return response;
+}
+
+// The requests of one connection, and the sessions they belong to.
+struct ConnectionRequests {
+  std::vector<std::unique_ptr<Client<RlweInteger>>> sessions;
+  std::vector<PirSocketRequest> requests;
+};
+
+absl::StatusOr<ConnectionRequests> GenerateRequests(
+    const Parameters& params, const HintlessPirServerPublicParams& public_params,
+    int num_requests, double first_request_ratio) {
+  absl::BitGen bitgen;
+  int64_t num_records = params.db_rows * params.db_cols;
+  ConnectionRequests generated;
+  for (int i = 0; i < num_requests; ++i) {
+    if (generated.sessions.empty() ||
+        absl::Bernoulli(bitgen, first_request_ratio)) {
+      RLWE_ASSIGN_OR_RETURN(
+          auto client, Client<RlweInteger>::Create(params, public_params));
+      generated.sessions.push_back(std::move(client));
+    }
+    Client<RlweInteger>& client = *generated.sessions.back();
+    PirSocketRequest request;
+    RLWE_ASSIGN_OR_RETURN(
+        *request.mutable_pir_request(),
+        client.GenerateRequest(absl::Uniform<int64_t>(bitgen, 0, num_records)));
+    generated.requests.push_back(std::move(request));
+  }
+  return generated;
+}
+
+absl::Status RunConnection(const std::string& socket_path,
+                           const ConnectionRequests& generated,
+                           absl::Time start, absl::Time deadline,
+                           LoadResults& results) {
+  RLWE_ASSIGN_OR_RETURN(benchmarks::Socket socket,
+                        benchmarks::ConnectUnixSocket(socket_path));
+  // Register the Galois keys of all sessions before the measurement.
+  for (const PirSocketRequest& request : generated.requests) {
+    if (request.pir_request().linpir_gk_bs_size() > 0) {
+      RLWE_RETURN_IF_ERROR(Exchange(socket, request).status());
+    }
+  }
+  absl::SleepFor(start - absl::Now());
+  for (size_t i = 0; absl::Now() < deadline; ++i) {
+    const PirSocketRequest& request =
+        generated.requests[i % generated.requests.size()];
+    absl::Time begin = absl::Now();
+    absl::StatusOr<PirSocketResponse> response =
+        Exchange(socket, request, &results);
+    absl::Duration latency = absl::Now() - begin;
+    if (!response.ok()) {
+      if (results.num_errors++ == 0) {
+        std::cerr << "Request failed: " << response.status() << "\n";
+      }
+      continue;
+    }
+    bool is_first = request.pir_request().linpir_gk_bs_size() > 0;
+    results.all.Add(latency);
+    (is_first ? results.first : results.subsequent).Add(latency);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RunLoadClient() {
+  std::string socket_path = absl::GetFlag(FLAGS_socket_path);
+  int num_connections = absl::GetFlag(FLAGS_num_connections);
+  absl::Duration duration = absl::GetFlag(FLAGS_duration);
+  int requests_per_connection = absl::GetFlag(FLAGS_requests_per_connection);
+  double first_request_ratio = absl::GetFlag(FLAGS_first_request_ratio);
+  if (num_connections <= 0 || requests_per_connection <= 0 ||
+      duration <= absl::ZeroDuration()) {
+    return absl::InvalidArgumentError(
+        "--num_connections, --requests_per_connection and --duration must be "
+        "positive.");
+  }
+
+  PirSocketResponse server_info;
+  {
+    RLWE_ASSIGN_OR_RETURN(benchmarks::Socket socket,
+                          benchmarks::ConnectUnixSocket(socket_path));
+    PirSocketRequest request;
+    request.mutable_get_public_params();
+    RLWE_ASSIGN_OR_RETURN(server_info, Exchange(socket, request));
+  }
+  Parameters params =
+      ApplyRequestLogHeader(server_info.database_shape(), kParameters);
+  std::cout << "Server holds a " << params.db_rows << " x " << params.db_cols
+            << " database of " << params.db_record_bit_size
+            << "-bit records\n";
+
+  std::vector<ConnectionRequests> generated;
+  for (int i = 0; i < num_connections; ++i) {
+    RLWE_ASSIGN_OR_RETURN(
+        ConnectionRequests requests,
+        GenerateRequests(params, server_info.public_params(),
+                         requests_per_connection, first_request_ratio));
+    generated.push_back(std::move(requests));
+  }
+
+  LoadResults results;
+  std::vector<absl::Status> statuses(num_connections);
+  // Leave time for all connections to warm up before the measurement.
+  absl::Time start = absl::Now() + absl::Seconds(1);
+  absl::Time deadline = start + duration;
+  {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_connections; ++i) {
+      threads.emplace_back([&, i]() {
+        statuses[i] = RunConnection(socket_path, generated[i], start, deadline,
+                                    results);
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  absl::Duration elapsed = std::max(absl::Now(), deadline) - start;
+  for (const absl::Status& status : statuses) {
+    RLWE_RETURN_IF_ERROR(status);
+  }
+
+  int64_t count = results.all.Count();
+  double seconds = absl::ToDoubleSeconds(elapsed);
+  int64_t num_exchanges = std::max<int64_t>(count + results.num_errors, 1);
+  std::cout << "Connections     : " << num_connections << "\n";
+  std::cout << "Requests        : " << count << " ok, " << results.num_errors
+            << " failed\n";
+  std::cout << "Throughput      : " << count / seconds << " QPS\n";
+  std::cout << "Latency (all)   : " << benchmarks::LatencySummary(results.all)
+            << " mean=" << absl::FormatDuration(results.all.Mean()) << "\n";
+  std::cout << "Latency (first) : " << benchmarks::LatencySummary(results.first)
+            << "\n";
+  std::cout << "Latency (subseq): "
+            << benchmarks::LatencySummary(results.subsequent) << "\n";
+  std::cout << "Serialize       : "
+            << absl::FormatDuration(
+                   absl::Nanoseconds(results.serialize_nanos / num_exchanges))
+            << " per request, parse "
+            << absl::FormatDuration(
+                   absl::Nanoseconds(results.parse_nanos / num_exchanges))
+            << " per response\n";
+  std::cout << "Bytes           : " << results.request_bytes / num_exchanges
+            << " up, " << results.response_bytes / num_exchanges
+            << " down per request\n";
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = hintless_pir::hintless_simplepir::RunLoadClient();
+  if (!status.ok()) {
+    std::cerr << status << "\n";
+    return 1;
+  }
+  return 0;
+}
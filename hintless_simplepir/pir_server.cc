@@ -0,0 +1,256 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A standalone PIR server answering PirSocketRequest frames on a Unix domain
+// socket, e.g.
+//
+//   pir_server --socket_path=/tmp/pir.sock --num_rows=2048 --num_cols=2048 \
+//       --num_threads=8
+//
+// The server holds a random database of the given shape. Each connection is
+// served by its own I/O thread, which reads a request frame, hands the request
+// to a pool of `--num_threads` workers and writes back the response, so the
+// worker pool bounds the number of requests processed concurrently. Requests
+// can optionally be recorded to a request log for `request_replay`.
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/framed_socket.h"
+#include "benchmarks/worker_pool.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/pir_socket.pb.h"
+#include "hintless_simplepir/request_log.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "hintless_simplepir/server.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(std::string, socket_path, "/tmp/hintless_pir.sock",
+          "Path of the Unix domain socket to listen on");
+ABSL_FLAG(int, num_rows, 1024, "Number of rows");
+ABSL_FLAG(int, num_cols, 1024, "Number of cols");
+ABSL_FLAG(int, record_bit_size, 64, "Size of a database record in bits");
+ABSL_FLAG(int, num_threads, 4, "Number of worker threads handling requests");
+ABSL_FLAG(int, max_connections, 0,
+          "Exit after serving this many connections; 0 serves forever");
+ABSL_FLAG(std::string, request_log, "",
+          "If set, path of a request log recording all PIR requests");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+class SocketServer {
+ public:
+  SocketServer(const Parameters& params,
+               std::unique_ptr<Server<RlweInteger>> server,
+               std::unique_ptr<RequestLogWriter> request_log, int num_threads)
+      : server_(std::move(server)),
+        request_log_(std::move(request_log)),
+        database_shape_(CreateRequestLogHeader(params)),
+        workers_(num_threads),
+        start_(absl::Now()) {}
+
+  // Serves the requests of `connection` until the peer closes it.
+  void Serve(benchmarks::Socket connection) {
+    while (true) {
+      absl::StatusOr<std::string> frame = benchmarks::ReadFrame(connection);
+      if (absl::IsOutOfRange(frame.status())) {
+        return;  // Closed by the client.
+      }
+      if (!frame.ok()) {
+        std::cerr << "Dropping connection: " << frame.status() << "\n";
+        return;
+      }
+      PirSocketResponse response;
+      absl::Notification done;
+      workers_.Schedule([&]() {
+        response = Handle(*frame);
+        done.Notify();
+      });
+      done.WaitForNotification();
+      absl::Status status =
+          benchmarks::WriteFrame(connection, response.SerializeAsString());
+      if (!status.ok()) {
+        std::cerr << "Dropping connection: " << status << "\n";
+        return;
+      }
+    }
+  }
+
+ private:
+  PirSocketResponse Handle(const std::string& frame) {
+    PirSocketResponse response;
+    PirSocketRequest request;
+    if (!request.ParseFromString(frame)) {
+      SetStatus(absl::InvalidArgumentError("Malformed request."), response);
+      return response;
+    }
+    switch (request.request_case()) {
+      case PirSocketRequest::kGetPublicParams:
+        *response.mutable_public_params() = server_->GetPublicParams();
+        *response.mutable_database_shape() = database_shape_;
+        break;
+      case PirSocketRequest::kPirRequest: {
+        if (request_log_ != nullptr) {
+          absl::Status status =
+              request_log_->Append(request.pir_request(), /*response_bytes=*/-1,
+                                   absl::Now() - start_);
+          if (!status.ok()) {
+            std::cerr << "Cannot log request: " << status << "\n";
+          }
+        }
+        absl::StatusOr<HintlessPirResponse> pir_response =
+            server_->HandleRequest(request.pir_request());
+        if (!pir_response.ok()) {
+          SetStatus(pir_response.status(), response);
+          return response;
+        }
+        *response.mutable_pir_response() = *std::move(pir_response);
+        break;
+      }
+      default:
+        SetStatus(absl::InvalidArgumentError("Empty request."), response);
+        return response;
+    }
+    SetStatus(absl::OkStatus(), response);
+    return response;
+  }
+
+  static void SetStatus(const absl::Status& status,
+                        PirSocketResponse& response) {
+    response.set_status_code(static_cast<int>(status.code()));
+    if (!status.ok()) {
+      response.set_status_message(std::string(status.message()));
+    }
+  }
+
+  std::unique_ptr<Server<RlweInteger>> server_;
+  std::unique_ptr<RequestLogWriter> request_log_;
+  const RequestLogHeader database_shape_;
+  benchmarks::WorkerPool workers_;
+  const absl::Time start_;
+};
+
+absl::Status RunServer() {
+  Parameters params = kParameters;
+  params.db_rows = absl::GetFlag(FLAGS_num_rows);
+  params.db_cols = absl::GetFlag(FLAGS_num_cols);
+  params.db_record_bit_size = absl::GetFlag(FLAGS_record_bit_size);
+  std::string socket_path = absl::GetFlag(FLAGS_socket_path);
+  int num_threads = absl::GetFlag(FLAGS_num_threads);
+  int max_connections = absl::GetFlag(FLAGS_max_connections);
+  std::string request_log_path = absl::GetFlag(FLAGS_request_log);
+  if (num_threads <= 0 || max_connections < 0) {
+    return absl::InvalidArgumentError(
+        "--num_threads must be positive and --max_connections non-negative.");
+  }
+
+  std::cout << "Preprocessing a " << params.db_rows << " x " << params.db_cols
+            << " database of " << params.db_record_bit_size
+            << "-bit records...\n";
+  absl::Time start = absl::Now();
+  RLWE_ASSIGN_OR_RETURN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  RLWE_RETURN_IF_ERROR(server->Preprocess());
+  std::cout << "Preprocessed in " << absl::FormatDuration(absl::Now() - start)
+            << "\n";
+
+  std::unique_ptr<RequestLogWriter> request_log;
+  if (!request_log_path.empty()) {
+    RLWE_ASSIGN_OR_RETURN(request_log,
+                          RequestLogWriter::Create(
+                              request_log_path, CreateRequestLogHeader(params)));
+  }
+
+  RLWE_ASSIGN_OR_RETURN(benchmarks::Socket listener,
+                        benchmarks::ListenUnixSocket(socket_path));
+  std::cout << "Serving on " << socket_path << " with " << num_threads
+            << " worker threads\n";
+  absl::Status status = absl::OkStatus();
+  {
+    SocketServer socket_server(params, std::move(server),
+                               std::move(request_log), num_threads);
+    std::vector<std::thread> connections;
+    for (int i = 0; max_connections == 0 || i < max_connections; ++i) {
+      absl::StatusOr<benchmarks::Socket> connection =
+          benchmarks::AcceptConnection(listener);
+      if (!connection.ok()) {
+        status = connection.status();
+        break;
+      }
+      connections.emplace_back(
+          [&socket_server](benchmarks::Socket connection) {
+            socket_server.Serve(std::move(connection));
+          },
+          *std::move(connection));
+    }
+    for (std::thread& connection : connections) {
+      connection.join();
+    }
+  }
+  return status;
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = hintless_pir::hintless_simplepir::RunServer();
+  if (!status.ok()) {
+    std::cerr << status << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,484 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of the individual stages of `Server::Preprocess()`. Each stage is
+// timed on the outputs of the previous stages, which are computed once and
+// shared by all benchmarks. Besides the running time, each benchmark reports
+// the peak resident memory reached while running the stage ("peak_MiB") and
+// how much it grew over the memory held before the stage ("stage_MiB").
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/statusor.h"
+#include "benchmark/benchmark.h"
+#include "benchmarks/load_stats.h"
+#include "benchmarks/perf_counters.h"
+#include "hintless_simplepir/database_hwy.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/server.h"
+#include "hintless_simplepir/utils.h"
+#include "linpir/database.h"
+#include "linpir/parameters.h"
+#include "linpir/server.h"
+#include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/types.h"
+#include "shell_encryption/montgomery.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/rns/rns_context.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(int, num_rows, 2048, "Number of rows");
+ABSL_FLAG(int, num_cols, 2048, "Number of cols");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+using RlweModularInt = rlwe::MontgomeryInt<RlweInteger>;
+using RlweRnsContext = rlwe::RnsContext<RlweModularInt>;
+using LinPirDatabase = linpir::Database<RlweInteger>;
+using LinPirServer = linpir::Server<RlweInteger>;
+using Prng = rlwe::SingleThreadHkdfPrng;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+// Reports the peak resident memory while the object is alive.
+class ScopedPeakMemory {
+ public:
+  explicit ScopedPeakMemory(benchmark::State& state) : state_(state) {
+    benchmarks::ResetPeakRss();
+    base_rss_bytes_ = benchmarks::GetProcessUsage().rss_bytes;
+  }
+
+  ~ScopedPeakMemory() {
+    constexpr double kMiB = 1024.0 * 1024.0;
+    int64_t peak_rss_bytes = benchmarks::GetProcessUsage().peak_rss_bytes;
+    state_.counters["peak_MiB"] = peak_rss_bytes / kMiB;
+    state_.counters["stage_MiB"] = (peak_rss_bytes - base_rss_bytes_) / kMiB;
+  }
+
+ private:
+  benchmark::State& state_;
+  int64_t base_rss_bytes_;
+};
+
+// The intermediate states of the preprocessing, in the order they are computed
+// by `Server::Preprocess()`.
+struct PreprocessingEnv {
+  Parameters params;
+  std::string prng_seed_lwe_query_pad;
+  std::unique_ptr<const lwe::Matrix> lwe_query_pad;
+  std::unique_ptr<Database> database;
+  // One RLWE context per plaintext modulus.
+  std::vector<std::unique_ptr<const RlweRnsContext>> rlwe_contexts;
+  // The hints encoded mod each plaintext modulus, indexed by [k][shard].
+  std::vector<std::vector<std::vector<std::vector<RlweInteger>>>>
+      encoded_hints;
+  // LinPir databases and servers, one set per plaintext modulus.
+  std::vector<std::vector<std::unique_ptr<LinPirDatabase>>> linpir_databases;
+  std::vector<std::unique_ptr<LinPirServer>> linpir_servers;
+
+  // Computes all the intermediate states for `params`.
+  static absl::StatusOr<std::unique_ptr<PreprocessingEnv>> Create(
+      const Parameters& params) {
+    auto env = std::make_unique<PreprocessingEnv>();
+    env->params = params;
+    RLWE_ASSIGN_OR_RETURN(env->prng_seed_lwe_query_pad, Prng::GenerateSeed());
+    RLWE_ASSIGN_OR_RETURN(auto prng,
+                          Prng::Create(env->prng_seed_lwe_query_pad));
+    RLWE_ASSIGN_OR_RETURN(
+        lwe::Matrix lwe_query_pad,
+        lwe::ExpandPad(params.db_cols, params.lwe_secret_dim, prng.get()));
+    env->lwe_query_pad =
+        std::make_unique<const lwe::Matrix>(std::move(lwe_query_pad));
+
+    RLWE_ASSIGN_OR_RETURN(env->database, Database::CreateRandom(params));
+    RLWE_RETURN_IF_ERROR(
+        env->database->UpdateLweQueryPad(env->lwe_query_pad.get()));
+    RLWE_RETURN_IF_ERROR(env->database->UpdateHints());
+
+    RlweInteger lwe_modulus = RlweInteger{1} << params.lwe_modulus_bit_size;
+    auto const& rlwe_params = params.linpir_params;
+    for (RlweInteger t : rlwe_params.ts) {
+      RLWE_ASSIGN_OR_RETURN(auto rlwe_context,
+                            RlweRnsContext::CreateForBfvFiniteFieldEncoding(
+                                rlwe_params.log_n, rlwe_params.qs,
+                                /*ps=*/{}, t));
+      env->rlwe_contexts.push_back(
+          std::make_unique<const RlweRnsContext>(std::move(rlwe_context)));
+      std::vector<std::vector<std::vector<RlweInteger>>> hints_mod_t;
+      for (const Database::LweMatrix& hint : env->database->Hints()) {
+        hints_mod_t.push_back(EncodeLweMatrix(hint, lwe_modulus, t));
+      }
+      env->encoded_hints.push_back(std::move(hints_mod_t));
+    }
+
+    RLWE_ASSIGN_OR_RETURN(std::string prng_seed_gk_pad, Prng::GenerateSeed());
+    for (int k = 0; k < env->rlwe_contexts.size(); ++k) {
+      std::vector<std::unique_ptr<LinPirDatabase>> databases_mod_tk;
+      std::vector<LinPirDatabase*> database_ptrs;
+      for (const auto& hint : env->encoded_hints[k]) {
+        RLWE_ASSIGN_OR_RETURN(
+            auto database,
+            LinPirDatabase::Create(rlwe_params, env->rlwe_contexts[k].get(),
+                                   hint));
+        database_ptrs.push_back(database.get());
+        databases_mod_tk.push_back(std::move(database));
+      }
+      RLWE_ASSIGN_OR_RETURN(std::string prng_seed_ct_pad,
+                            Prng::GenerateSeed());
+      RLWE_ASSIGN_OR_RETURN(
+          auto server,
+          LinPirServer::Create(rlwe_params, env->rlwe_contexts[k].get(),
+                               database_ptrs, prng_seed_ct_pad,
+                               prng_seed_gk_pad));
+      RLWE_RETURN_IF_ERROR(server->Preprocess());
+      env->linpir_databases.push_back(std::move(databases_mod_tk));
+      env->linpir_servers.push_back(std::move(server));
+    }
+    return env;
+  }
+};
+
+// Returns the environment for the parameters given by the flags, or nullptr
+// after marking `state` as skipped if it cannot be built. It is built on first
+// use and shared by all benchmarks.
+PreprocessingEnv* GetEnv(benchmark::State& state) {
+  static auto* env = [] {
+    Parameters params = kParameters;
+    params.db_rows = absl::GetFlag(FLAGS_num_rows);
+    params.db_cols = absl::GetFlag(FLAGS_num_cols);
+    return new absl::StatusOr<std::unique_ptr<PreprocessingEnv>>(
+        PreprocessingEnv::Create(params));
+  }();
+  if (!env->ok()) {
+    state.SkipWithError(env->status().ToString().c_str());
+    return nullptr;
+  }
+  return env->value().get();
+}
+
+// Stage 1 of `GeneratePublicParams()`: expanding the LWE query pad "A".
+void BM_ExpandLweQueryPad(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto prng = Prng::Create(env->prng_seed_lwe_query_pad);
+    if (!prng.ok()) {
+      state.SkipWithError(prng.status().ToString().c_str());
+      return;
+    }
+    auto pad = lwe::ExpandPad(env->params.db_cols, env->params.lwe_secret_dim,
+                              prng->get());
+    if (!pad.ok()) {
+      state.SkipWithError(pad.status().ToString().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(pad);
+  }
+}
+BENCHMARK(BM_ExpandLweQueryPad)->Unit(benchmark::kMillisecond);
+
+// Stage 2: computing the hint matrices H = D * A for all shards.
+void BM_UpdateHints(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto status = env->database->UpdateHints();
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      return;
+    }
+  }
+}
+BENCHMARK(BM_UpdateHints)->Unit(benchmark::kMillisecond);
+
+// Stages 1 and 2 as run by `Server::Preprocess()`: the hints are computed while
+// streaming the LWE query pad from its seed, which is never held in memory.
+void BM_UpdateHintsFromSeed(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto status = env->database->UpdateHintsFromSeed(
+        env->prng_seed_lwe_query_pad, rlwe::PRNG_TYPE_HKDF);
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      return;
+    }
+  }
+}
+BENCHMARK(BM_UpdateHintsFromSeed)->Unit(benchmark::kMillisecond);
+
+// Stage 3: reducing the hints mod every LinPir plaintext modulus.
+void BM_EncodeLweMatrix(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  RlweInteger lwe_modulus = RlweInteger{1}
+                            << env->params.lwe_modulus_bit_size;
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    for (const auto& rlwe_context : env->rlwe_contexts) {
+      RlweInteger t = rlwe_context->PlaintextModulus();
+      for (const Database::LweMatrix& hint : env->database->Hints()) {
+        auto hint_mod_t = EncodeLweMatrix(hint, lwe_modulus, t);
+        benchmark::DoNotOptimize(hint_mod_t);
+      }
+    }
+  }
+}
+BENCHMARK(BM_EncodeLweMatrix)->Unit(benchmark::kMillisecond);
+
+// Stage 4: encoding the diagonals of the hints as RLWE plaintexts.
+void BM_LinPirDatabaseCreate(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    for (int k = 0; k < env->rlwe_contexts.size(); ++k) {
+      for (const auto& hint : env->encoded_hints[k]) {
+        auto database = LinPirDatabase::Create(
+            env->params.linpir_params, env->rlwe_contexts[k].get(), hint);
+        if (!database.ok()) {
+          state.SkipWithError(database.status().ToString().c_str());
+          return;
+        }
+        benchmark::DoNotOptimize(database);
+      }
+    }
+  }
+}
+BENCHMARK(BM_LinPirDatabaseCreate)->Unit(benchmark::kMillisecond);
+
+// Stages 3 and 4 as run by `Server::Preprocess()`: the hints are reduced and
+// encoded one LinPir block of rows at a time, so the reduced hints are never
+// held in memory in full.
+void BM_LinPirDatabaseCreateFromRowBlocks(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  RlweInteger lwe_modulus = RlweInteger{1}
+                            << env->params.lwe_modulus_bit_size;
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    for (const auto& rlwe_context : env->rlwe_contexts) {
+      RlweInteger t = rlwe_context->PlaintextModulus();
+      for (const Database::LweMatrix& hint : env->database->Hints()) {
+        auto database = LinPirDatabase::CreateFromRowBlocks(
+            env->params.linpir_params, rlwe_context.get(), hint.size(),
+            hint[0].size(), [&](int row_begin, int row_end) {
+              return EncodeLweMatrixRows(hint, row_begin, row_end,
+                                         lwe_modulus, t);
+            });
+        if (!database.ok()) {
+          state.SkipWithError(database.status().ToString().c_str());
+          return;
+        }
+        benchmark::DoNotOptimize(database);
+      }
+    }
+  }
+}
+BENCHMARK(BM_LinPirDatabaseCreateFromRowBlocks)
+    ->Unit(benchmark::kMillisecond);
+
+// Stage 5: computing the "a" components of the rotated query ciphertexts. The
+// LinPir servers are created without databases, so that `Preprocess()` only
+// computes the rotation pads.
+void BM_LinPirRotationPads(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  std::vector<std::unique_ptr<LinPirServer>> servers;
+  for (int k = 0; k < env->rlwe_contexts.size(); ++k) {
+    auto server = LinPirServer::Create(
+        env->params.linpir_params, env->rlwe_contexts[k].get(),
+        /*databases=*/{},
+        env->linpir_servers[k]->PrngSeedForCiphertextRandomPads(),
+        env->linpir_servers[k]->PrngSeedForGaloisKeyRandomPads());
+    if (!server.ok()) {
+      state.SkipWithError(server.status().ToString().c_str());
+      return;
+    }
+    servers.push_back(std::move(*server));
+  }
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    for (auto& server : servers) {
+      auto status = server->Preprocess();
+      if (!status.ok()) {
+        state.SkipWithError(status.ToString().c_str());
+        return;
+      }
+    }
+  }
+}
+BENCHMARK(BM_LinPirRotationPads)->Unit(benchmark::kMillisecond);
+
+// Stage 6: the inner products between the diagonals and the rotation pads.
+void BM_LinPirDatabasePreprocess(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    for (int k = 0; k < env->rlwe_contexts.size(); ++k) {
+      auto pads = env->linpir_servers[k]->RotatedCiphertextPads();
+      for (auto& database : env->linpir_databases[k]) {
+        auto status = database->Preprocess(pads);
+        if (!status.ok()) {
+          state.SkipWithError(status.ToString().c_str());
+          return;
+        }
+      }
+    }
+  }
+}
+BENCHMARK(BM_LinPirDatabasePreprocess)->Unit(benchmark::kMillisecond);
+
+// Stage 7: serializing the response pads into the public parameters.
+void BM_GetResponsePads(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  int64_t num_bytes = 0;
+  for (auto& server : env->linpir_servers) {
+    auto response_pads = server->GetResponsePads();
+    if (!response_pads.ok()) {
+      state.SkipWithError(response_pads.status().ToString().c_str());
+      return;
+    }
+    num_bytes += response_pads->ByteSizeLong();
+  }
+  state.counters["pads_KiB"] = num_bytes / 1024.0;
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    for (auto& server : env->linpir_servers) {
+      auto response_pads = server->GetResponsePads();
+      benchmark::DoNotOptimize(response_pads);
+    }
+  }
+}
+BENCHMARK(BM_GetResponsePads)->Unit(benchmark::kMillisecond);
+
+// All stages together, as run by the server with the given number of threads:
+// the plaintext moduli are preprocessed concurrently, and the threads left over
+// are split among their LinPir databases.
+void BM_ServerPreprocess(benchmark::State& state) {
+  PreprocessingEnv* env = GetEnv(state);
+  if (env == nullptr) {
+    return;
+  }
+  Parameters params = env->params;
+  int num_threads = state.range(0);
+  int num_moduli = params.linpir_params.ts.size();
+  params.num_threads = std::max(1, std::min(num_threads, num_moduli));
+  params.linpir_params.num_threads =
+      std::max(1, num_threads / params.num_threads);
+  auto server = Server<RlweInteger>::CreateWithRandomDatabaseRecords(params);
+  if (!server.ok()) {
+    state.SkipWithError(server.status().ToString().c_str());
+    return;
+  }
+  ScopedPeakMemory peak_memory(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto status = (*server)->Preprocess();
+    if (!status.ok()) {
+      state.SkipWithError(status.ToString().c_str());
+      return;
+    }
+  }
+}
+BENCHMARK(BM_ServerPreprocess)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
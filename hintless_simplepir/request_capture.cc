@@ -0,0 +1,154 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Generates a request log of simulated client traffic, to be replayed with
+// `request_replay`. Servers can capture real traffic in the same format by
+// appending each handled request to a RequestLogWriter.
+//
+// Requests arrive as a Poisson process at `--qps`. Each request opens a new
+// client session, carrying the Galois key, with probability
+// `--first_request_ratio`, and otherwise continues one of the open sessions.
+// Every request is handled by a server at capture time, so the log records the
+// expected response sizes and the server-side key cache stays consistent.
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "hintless_simplepir/client.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/request_log.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "hintless_simplepir/server.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(int, num_rows, 1024, "Number of rows");
+ABSL_FLAG(int, num_cols, 1024, "Number of cols");
+ABSL_FLAG(int, record_bit_size, 64, "Size of a database record in bits");
+ABSL_FLAG(int, num_requests, 100, "Number of requests to capture");
+ABSL_FLAG(double, qps, 10, "Arrival rate of the requests");
+ABSL_FLAG(double, first_request_ratio, 0.1,
+          "Fraction of requests that start a new session and carry the "
+          "Galois key");
+ABSL_FLAG(std::string, output, "", "Path of the request log to write");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+absl::Status RunCapture() {
+  Parameters params = kParameters;
+  params.db_rows = absl::GetFlag(FLAGS_num_rows);
+  params.db_cols = absl::GetFlag(FLAGS_num_cols);
+  params.db_record_bit_size = absl::GetFlag(FLAGS_record_bit_size);
+  int num_requests = absl::GetFlag(FLAGS_num_requests);
+  double qps = absl::GetFlag(FLAGS_qps);
+  double first_request_ratio = absl::GetFlag(FLAGS_first_request_ratio);
+  std::string output = absl::GetFlag(FLAGS_output);
+  if (output.empty()) {
+    return absl::InvalidArgumentError("--output is required.");
+  }
+  if (num_requests <= 0 || qps <= 0) {
+    return absl::InvalidArgumentError(
+        "--num_requests and --qps must be positive.");
+  }
+
+  RLWE_ASSIGN_OR_RETURN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  RLWE_RETURN_IF_ERROR(server->Preprocess());
+  HintlessPirServerPublicParams public_params = server->GetPublicParams();
+  RLWE_ASSIGN_OR_RETURN(
+      auto writer,
+      RequestLogWriter::Create(output, CreateRequestLogHeader(params)));
+
+  absl::BitGen bitgen;
+  int64_t num_records = params.db_rows * params.db_cols;
+  std::vector<std::unique_ptr<Client<RlweInteger>>> sessions;
+  absl::Duration arrival = absl::ZeroDuration();
+  int num_first_requests = 0;
+  for (int i = 0; i < num_requests; ++i) {
+    arrival += absl::Seconds(absl::Exponential<double>(bitgen, qps));
+    Client<RlweInteger>* client;
+    if (sessions.empty() || absl::Bernoulli(bitgen, first_request_ratio)) {
+      RLWE_ASSIGN_OR_RETURN(auto new_client,
+                            Client<RlweInteger>::Create(params, public_params));
+      sessions.push_back(std::move(new_client));
+      client = sessions.back().get();
+      num_first_requests++;
+    } else {
+      client = sessions[absl::Uniform<size_t>(bitgen, 0, sessions.size())]
+                   .get();
+    }
+    RLWE_ASSIGN_OR_RETURN(HintlessPirRequest request,
+                          client->GenerateRequest(absl::Uniform<int64_t>(
+                              bitgen, 0, num_records)));
+    RLWE_ASSIGN_OR_RETURN(HintlessPirResponse response,
+                          server->HandleRequest(request));
+    RLWE_RETURN_IF_ERROR(
+        writer->Append(request, response.ByteSizeLong(), arrival));
+  }
+  RLWE_RETURN_IF_ERROR(writer->Flush());
+
+  std::cout << "Captured " << num_requests << " requests ("
+            << num_first_requests << " first requests) spanning "
+            << absl::FormatDuration(arrival) << " to " << output << "\n";
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = hintless_pir::hintless_simplepir::RunCapture();
+  if (!status.ok()) {
+    std::cerr << status << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hintless_simplepir/request_log.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/request_log.pb.h"
+#include "hintless_simplepir/serialization.pb.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+
+using google::protobuf::util::ParseDelimitedFromZeroCopyStream;
+using google::protobuf::util::SerializeDelimitedToOstream;
+
+absl::StatusOr<std::unique_ptr<RequestLogWriter>> RequestLogWriter::Create(
+    absl::string_view path, const RequestLogHeader& header) {
+  std::ofstream output(std::string(path), std::ios::binary | std::ios::trunc);
+  if (!output) {
+    return absl::NotFoundError(absl::StrCat("Cannot open ", path));
+  }
+  if (!SerializeDelimitedToOstream(header, &output)) {
+    return absl::InternalError(
+        absl::StrCat("Failed to write the header to ", path));
+  }
+  return absl::WrapUnique(new RequestLogWriter(std::move(output)));
+}
+
+absl::Status RequestLogWriter::Append(const HintlessPirRequest& request,
+                                      int64_t response_bytes) {
+  return Append(request, response_bytes, absl::Now() - start_);
+}
+
+absl::Status RequestLogWriter::Append(const HintlessPirRequest& request,
+                                      int64_t response_bytes,
+                                      absl::Duration timestamp) {
+  RequestLogEntry entry;
+  entry.set_timestamp_micros(absl::ToInt64Microseconds(timestamp));
+  *entry.mutable_request() = request;
+  if (response_bytes >= 0) {
+    entry.set_response_bytes(response_bytes);
+  }
+  absl::MutexLock lock(&mutex_);
+  if (!SerializeDelimitedToOstream(entry, &output_)) {
+    return absl::InternalError("Failed to append to the request log.");
+  }
+  return absl::OkStatus();
+}
+
+absl::Status RequestLogWriter::Flush() {
+  absl::MutexLock lock(&mutex_);
+  if (!output_.flush()) {
+    return absl::InternalError("Failed to flush the request log.");
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<RequestLog> ReadRequestLog(absl::string_view path) {
+  std::ifstream input(std::string(path), std::ios::binary);
+  if (!input) {
+    return absl::NotFoundError(absl::StrCat("Cannot open ", path));
+  }
+  google::protobuf::io::IstreamInputStream stream(&input);
+  RequestLog log;
+  bool clean_eof = false;
+  if (!ParseDelimitedFromZeroCopyStream(&log.header, &stream, &clean_eof)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat(path, " does not start with a request log header."));
+  }
+  while (true) {
+    RequestLogEntry entry;
+    if (!ParseDelimitedFromZeroCopyStream(&entry, &stream, &clean_eof)) {
+      if (clean_eof) {
+        break;
+      }
+      return absl::DataLossError(
+          absl::StrCat(path, " is truncated after ", log.entries.size(),
+                       " entries."));
+    }
+    log.entries.push_back(std::move(entry));
+  }
+  return log;
+}
+
+RequestLogHeader CreateRequestLogHeader(const Parameters& params) {
+  RequestLogHeader header;
+  header.set_db_rows(params.db_rows);
+  header.set_db_cols(params.db_cols);
+  header.set_db_record_bit_size(params.db_record_bit_size);
+  header.set_lwe_secret_dim(params.lwe_secret_dim);
+  header.set_lwe_plaintext_bit_size(params.lwe_plaintext_bit_size);
+  header.set_log_n(params.linpir_params.log_n);
+  header.set_rows_per_block(params.linpir_params.rows_per_block);
+  return header;
+}
+
+Parameters ApplyRequestLogHeader(const RequestLogHeader& header,
+                                 Parameters params) {
+  params.db_rows = header.db_rows();
+  params.db_cols = header.db_cols();
+  params.db_record_bit_size = header.db_record_bit_size();
+  params.lwe_secret_dim = header.lwe_secret_dim();
+  params.lwe_plaintext_bit_size = header.lwe_plaintext_bit_size();
+  params.linpir_params.log_n = header.log_n();
+  params.linpir_params.rows_per_block = header.rows_per_block();
+  return params;
+}
+
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
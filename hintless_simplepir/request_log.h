@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_HINTLESS_SIMPLEPIR_REQUEST_LOG_H_
+#define HINTLESS_PIR_HINTLESS_SIMPLEPIR_REQUEST_LOG_H_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/request_log.pb.h"
+#include "hintless_simplepir/serialization.pb.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+
+// Records a stream of HintlessPir requests with their arrival times, e.g. from
+// a staging server, so that the traffic can be replayed later.
+class RequestLogWriter {
+ public:
+  // Creates a log at `path`, overwriting any existing file.
+  static absl::StatusOr<std::unique_ptr<RequestLogWriter>> Create(
+      absl::string_view path, const RequestLogHeader& header);
+
+  // Appends `request`, timestamped with the time elapsed since the writer was
+  // created. `response_bytes` is the size of the response, or -1 if unknown.
+  // Safe to call concurrently from multiple threads.
+  absl::Status Append(const HintlessPirRequest& request,
+                      int64_t response_bytes = -1)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Appends `request` with the given arrival time.
+  absl::Status Append(const HintlessPirRequest& request,
+                      int64_t response_bytes, absl::Duration timestamp)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Flushes the log to disk.
+  absl::Status Flush() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  explicit RequestLogWriter(std::ofstream output)
+      : start_(absl::Now()), output_(std::move(output)) {}
+
+  const absl::Time start_;
+
+  absl::Mutex mutex_;
+  std::ofstream output_ ABSL_GUARDED_BY(mutex_);
+};
+
+// The content of a request log.
+struct RequestLog {
+  RequestLogHeader header;
+  std::vector<RequestLogEntry> entries;
+};
+
+// Reads the request log at `path`.
+absl::StatusOr<RequestLog> ReadRequestLog(absl::string_view path);
+
+// Returns the header describing the database shape of `params`.
+RequestLogHeader CreateRequestLogHeader(const Parameters& params);
+
+// Returns `params` with the database shape set as in `header`.
+Parameters ApplyRequestLogHeader(const RequestLogHeader& header,
+                                 Parameters params);
+
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_HINTLESS_SIMPLEPIR_REQUEST_LOG_H_
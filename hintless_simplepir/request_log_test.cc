@@ -0,0 +1,116 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hintless_simplepir/request_log.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/request_log.pb.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "shell_encryption/testing/status_matchers.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using rlwe::testing::StatusIs;
+
+std::string TempPath(absl::string_view name) {
+  return absl::StrCat(::testing::TempDir(), "/", name);
+}
+
+TEST(RequestLogTest, WriteAndRead) {
+  const Parameters params{
+      .db_rows = 128,
+      .db_cols = 32,
+      .db_record_bit_size = 8,
+      .lwe_secret_dim = 32,
+      .lwe_plaintext_bit_size = 8,
+      .linpir_params = {.log_n = 10, .rows_per_block = 512},
+  };
+  std::string path = TempPath("write_and_read.log");
+
+  HintlessPirRequest first_request, subsequent_request;
+  first_request.set_client_id("client");
+  first_request.add_linpir_gk_bs();
+  first_request.mutable_ct_query_vector()->add_b_coeffs(1);
+  subsequent_request.set_client_id("client");
+  subsequent_request.mutable_ct_query_vector()->add_b_coeffs(2);
+  {
+    ASSERT_OK_AND_ASSIGN(
+        auto writer,
+        RequestLogWriter::Create(path, CreateRequestLogHeader(params)));
+    ASSERT_OK(writer->Append(first_request, 100, absl::Milliseconds(5)));
+    ASSERT_OK(writer->Append(subsequent_request));
+    ASSERT_OK(writer->Flush());
+  }
+
+  ASSERT_OK_AND_ASSIGN(RequestLog log, ReadRequestLog(path));
+  Parameters read_params = ApplyRequestLogHeader(log.header, Parameters{});
+  EXPECT_EQ(read_params.db_rows, params.db_rows);
+  EXPECT_EQ(read_params.db_cols, params.db_cols);
+  EXPECT_EQ(read_params.db_record_bit_size, params.db_record_bit_size);
+  EXPECT_EQ(read_params.linpir_params.rows_per_block,
+            params.linpir_params.rows_per_block);
+
+  ASSERT_EQ(log.entries.size(), 2);
+  EXPECT_EQ(log.entries[0].timestamp_micros(), 5000);
+  EXPECT_EQ(log.entries[0].response_bytes(), 100);
+  EXPECT_EQ(log.entries[0].request().SerializeAsString(),
+            first_request.SerializeAsString());
+  EXPECT_FALSE(log.entries[1].has_response_bytes());
+  EXPECT_EQ(log.entries[1].request().SerializeAsString(),
+            subsequent_request.SerializeAsString());
+}
+
+TEST(RequestLogTest, ReadFailsIfMissing) {
+  EXPECT_THAT(ReadRequestLog(TempPath("missing.log")),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(RequestLogTest, ReadFailsIfTruncated) {
+  std::string path = TempPath("truncated.log");
+  {
+    ASSERT_OK_AND_ASSIGN(auto writer,
+                         RequestLogWriter::Create(path, RequestLogHeader()));
+    HintlessPirRequest request;
+    request.set_client_id("client");
+    ASSERT_OK(writer->Append(request));
+    ASSERT_OK(writer->Flush());
+  }
+  // Drop the last byte of the entry.
+  std::string content;
+  {
+    std::ifstream input(path, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(input), {});
+  }
+  {
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output << content.substr(0, content.size() - 1);
+  }
+  EXPECT_THAT(ReadRequestLog(path), StatusIs(absl::StatusCode::kDataLoss));
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
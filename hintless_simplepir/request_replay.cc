@@ -0,0 +1,239 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays a request log against a freshly preprocessed server with the
+// database shape recorded in the log, e.g.
+//
+//   request_replay --input=staging.log --speed=2 --num_threads=8
+//
+// With `--speed=s > 0`, the requests are sent at s times their original rate
+// and latency is measured from the intended arrival time, so that queueing
+// delay is included. With `--speed=0`, all requests are queued at once and
+// served as fast as possible, and latency is the service time.
+//
+// Requests without a Galois key wait for the preceding request of the same
+// client that carries one, so the session key mix of the log is preserved.
+// Since the server's public parameters differ from the captured ones, the
+// responses are not decryptable, but their cost and sizes are the same. The
+// tool reports throughput, latency percentiles and responses whose size
+// differs from the one recorded in the log. Sizes are compared with a small
+// tolerance, as the LWE ciphertexts are varint encoded.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmarks/load_stats.h"
+#include "benchmarks/worker_pool.h"
+#include "hintless_simplepir/parameters.h"
+#include "hintless_simplepir/request_log.h"
+#include "hintless_simplepir/serialization.pb.h"
+#include "hintless_simplepir/server.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/status_macros.h"
+
+ABSL_FLAG(std::string, input, "", "Path of the request log to replay");
+ABSL_FLAG(double, speed, 1.0,
+          "Replay rate relative to the original one; 0 replays as fast as "
+          "possible");
+ABSL_FLAG(int, num_threads, 4, "Number of server threads handling requests");
+ABSL_FLAG(double, response_size_tolerance, 0.01,
+          "Relative difference from the recorded response size above which a "
+          "response is reported as a mismatch");
+
+namespace hintless_pir {
+namespace hintless_simplepir {
+namespace {
+
+using RlweInteger = Parameters::RlweInteger;
+
+// The parameters not recorded in the log header.
+const Parameters kParameters{
+    .db_rows = 1024,
+    .db_cols = 1024,
+    .db_record_bit_size = 64,
+    .lwe_secret_dim = 1024,
+    .lwe_modulus_bit_size = 32,
+    .lwe_plaintext_bit_size = 8,
+    .lwe_error_variance = 8,
+    .linpir_params =
+        linpir::RlweParameters<RlweInteger>{
+            .log_n = 12,
+            .qs = {35184371884033ULL, 35184371703809ULL},
+            .ts = {2056193, 1990657},
+            .gadget_log_bs = {16, 16},
+            .error_variance = 8,
+            .prng_type = rlwe::PRNG_TYPE_HKDF,
+            .rows_per_block = 1024,
+        },
+    .prng_type = rlwe::PRNG_TYPE_HKDF,
+};
+
+// Number of response size mismatches printed individually.
+constexpr int kMaxReportedMismatches = 10;
+
+struct ReplayResults {
+  benchmarks::LatencyRecorder all;
+  benchmarks::LatencyRecorder first;
+  benchmarks::LatencyRecorder subsequent;
+  std::atomic<int64_t> num_errors{0};
+  std::atomic<int64_t> num_mismatches{0};
+};
+
+absl::Status RunReplay() {
+  std::string input = absl::GetFlag(FLAGS_input);
+  double speed = absl::GetFlag(FLAGS_speed);
+  int num_threads = absl::GetFlag(FLAGS_num_threads);
+  double tolerance = absl::GetFlag(FLAGS_response_size_tolerance);
+  if (input.empty()) {
+    return absl::InvalidArgumentError("--input is required.");
+  }
+  if (speed < 0 || num_threads <= 0) {
+    return absl::InvalidArgumentError(
+        "--speed must be non-negative and --num_threads positive.");
+  }
+
+  RLWE_ASSIGN_OR_RETURN(RequestLog log, ReadRequestLog(input));
+  const std::vector<RequestLogEntry>& entries = log.entries;
+  if (entries.empty()) {
+    return absl::InvalidArgumentError("The request log is empty.");
+  }
+  Parameters params = ApplyRequestLogHeader(log.header, kParameters);
+  std::cout << "Replaying " << entries.size() << " requests on a "
+            << params.db_rows << " x " << params.db_cols << " database of "
+            << params.db_record_bit_size << "-bit records...\n";
+  RLWE_ASSIGN_OR_RETURN(
+      auto server,
+      Server<RlweInteger>::CreateWithRandomDatabaseRecords(params));
+  RLWE_RETURN_IF_ERROR(server->Preprocess());
+
+  // Link every request without a key to the latest preceding request of the
+  // same client that carries one.
+  int num_entries = entries.size();
+  std::vector<std::unique_ptr<absl::Notification>> key_handled(num_entries);
+  std::vector<absl::Notification*> key_dependency(num_entries, nullptr);
+  std::map<std::string, absl::Notification*> latest_key;
+  for (int i = 0; i < num_entries; ++i) {
+    const HintlessPirRequest& request = entries[i].request();
+    if (request.linpir_gk_bs_size() > 0) {
+      key_handled[i] = std::make_unique<absl::Notification>();
+      latest_key[request.client_id()] = key_handled[i].get();
+    } else if (auto it = latest_key.find(request.client_id());
+               it != latest_key.end()) {
+      key_dependency[i] = it->second;
+    }
+  }
+
+  ReplayResults results;
+  benchmarks::ResetPeakRss();
+  benchmarks::ProcessUsage usage_before = benchmarks::GetProcessUsage();
+  absl::Time start = absl::Now();
+  {
+    benchmarks::WorkerPool workers(num_threads);
+    for (int i = 0; i < num_entries; ++i) {
+      absl::Time arrival = absl::InfiniteFuture();
+      if (speed > 0) {
+        arrival = start + absl::Microseconds(entries[i].timestamp_micros()) /
+                              speed;
+        absl::SleepFor(arrival - absl::Now());
+      }
+      workers.Schedule([&, i, arrival]() {
+        const RequestLogEntry& entry = entries[i];
+        if (key_dependency[i] != nullptr) {
+          key_dependency[i]->WaitForNotification();
+        }
+        absl::Time begin = speed > 0 ? arrival : absl::Now();
+        auto response = server->HandleRequest(entry.request());
+        absl::Duration latency = absl::Now() - begin;
+        if (key_handled[i] != nullptr) {
+          key_handled[i]->Notify();
+        }
+        if (!response.ok()) {
+          results.num_errors++;
+          return;
+        }
+        bool is_first = entry.request().linpir_gk_bs_size() > 0;
+        results.all.Add(latency);
+        (is_first ? results.first : results.subsequent).Add(latency);
+        int64_t response_bytes = response->ByteSizeLong();
+        if (entry.has_response_bytes() &&
+            std::abs(response_bytes - entry.response_bytes()) >
+                tolerance * entry.response_bytes()) {
+          if (results.num_mismatches++ < kMaxReportedMismatches) {
+            std::cerr << "Request " << i << ": response has " << response_bytes
+                      << " bytes, expected " << entry.response_bytes()
+                      << "\n";
+          }
+        }
+      });
+    }
+  }  // Waits for all scheduled requests to finish.
+  absl::Duration elapsed = absl::Now() - start;
+  benchmarks::ProcessUsage usage_after = benchmarks::GetProcessUsage();
+
+  double seconds = absl::ToDoubleSeconds(elapsed);
+  absl::Duration original =
+      absl::Microseconds(entries.back().timestamp_micros());
+  std::cout << "Speed           : "
+            << (speed > 0 ? absl::StrCat(speed, "x") : "as fast as possible")
+            << ", " << num_threads << " server threads\n";
+  std::cout << "Requests        : " << results.all.Count() << " ok, "
+            << results.num_errors << " failed, " << results.num_mismatches
+            << " response size mismatches\n";
+  std::cout << "Duration        : " << absl::FormatDuration(elapsed)
+            << " (original " << absl::FormatDuration(original) << ")\n";
+  std::cout << "Throughput      : " << results.all.Count() / seconds
+            << " QPS\n";
+  std::cout << "Latency (all)   : " << benchmarks::LatencySummary(results.all)
+            << " mean=" << absl::FormatDuration(results.all.Mean()) << "\n";
+  std::cout << "Latency (first) : " << benchmarks::LatencySummary(results.first)
+            << "\n";
+  std::cout << "Latency (subseq): "
+            << benchmarks::LatencySummary(results.subsequent) << "\n";
+  std::cout << "CPU             : "
+            << absl::ToDoubleSeconds(usage_after.cpu_time -
+                                     usage_before.cpu_time) /
+                   seconds
+            << " cores\n";
+  std::cout << "Memory          : RSS " << (usage_after.rss_bytes >> 20)
+            << " MiB, peak " << (usage_after.peak_rss_bytes >> 20)
+            << " MiB\n";
+  return absl::OkStatus();
+}
+
+}  // namespace
+}  // namespace hintless_simplepir
+}  // namespace hintless_pir
+
+int main(int argc, char* argv[]) {
+  absl::ParseCommandLine(argc, argv);
+  absl::Status status = hintless_pir::hintless_simplepir::RunReplay();
+  if (!status.ok()) {
+    std::cerr << status << "\n";
+    return 1;
+  }
+  return 0;
+}
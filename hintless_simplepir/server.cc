@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -31,13 +32,15 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "hintless_simplepir/database_hwy.h"
+#include "hintless_simplepir/database_shape.h"
 #include "hintless_simplepir/parameters.h"
 #include "hintless_simplepir/serialization.pb.h"
 #include "hintless_simplepir/utils.h"
-#include "lwe/lwe_symmetric_encryption.h"
+#include "linpir/packing.h"
+#include "linpir/parallel.h"
+#include "linpir/parameters.h"
+#include "lwe/prng_type.h"
 #include "lwe/types.h"
-#include "shell_encryption/prng/single_thread_chacha_prng.h"
-#include "shell_encryption/prng/single_thread_hkdf_prng.h"
 #include "shell_encryption/status_macros.h"
 
 namespace hintless_pir {
@@ -47,8 +50,7 @@ namespace {
 
 // Returns an error if `params` uses an invalid PRNG type.
 inline absl::Status CheckForValidPrngType(const Parameters& params) {
-  if (!(params.prng_type == rlwe::PRNG_TYPE_HKDF ||
-        params.prng_type == rlwe::PRNG_TYPE_CHACHA)) {
+  if (!lwe::IsSupportedPrngType(params.prng_type)) {
     return absl::InvalidArgumentError("Invalid PRNG type in `params`.");
   }
   return absl::OkStatus();
@@ -56,152 +58,144 @@ inline absl::Status CheckForValidPrngType(const Parameters& params) {
 
 }  // namespace
 
-absl::StatusOr<std::unique_ptr<Server>> Server::Create(
-    const Parameters& params) {
-  RLWE_RETURN_IF_ERROR(CheckForValidPrngType(params));
-
+template <typename RlweInteger>
+absl::StatusOr<std::vector<std::unique_ptr<
+    const typename Server<RlweInteger>::RlweRnsContext>>>
+Server<RlweInteger>::CreateRlweContexts(
+    const linpir::RlweParameters<RlweInteger>& linpir_params) {
   // Create RLWE contexts, one per plaintext modulus in `ts`.
-  auto const& rlwe_params = params.linpir_params;
-  int num_linpir_instances = rlwe_params.ts.size();
+  int num_linpir_instances = linpir_params.ts.size();
   std::vector<std::unique_ptr<const RlweRnsContext>> rlwe_contexts;
   rlwe_contexts.reserve(num_linpir_instances);
   for (int i = 0; i < num_linpir_instances; ++i) {
-    RLWE_ASSIGN_OR_RETURN(
-        auto rlwe_context,
-        RlweRnsContext::CreateForBfvFiniteFieldEncoding(
-            rlwe_params.log_n, rlwe_params.qs, /*ps=*/{}, rlwe_params.ts[i]));
+    RLWE_ASSIGN_OR_RETURN(auto rlwe_context,
+                          RlweRnsContext::CreateForBfvFiniteFieldEncoding(
+                              linpir_params.log_n, linpir_params.qs,
+                              /*ps=*/{}, linpir_params.ts[i]));
     rlwe_contexts.push_back(
         std::make_unique<const RlweRnsContext>(std::move(rlwe_context)));
   }
+  return rlwe_contexts;
+}
+
+template <typename RlweInteger>
+absl::StatusOr<std::unique_ptr<Server<RlweInteger>>>
+Server<RlweInteger>::Create(const Parameters& params) {
+  RLWE_RETURN_IF_ERROR(CheckForValidPrngType(params));
+  RLWE_ASSIGN_OR_RETURN(auto linpir_params,
+                        NarrowLinPirParameters<RlweInteger>(params));
+  RLWE_ASSIGN_OR_RETURN(auto rlwe_contexts, CreateRlweContexts(linpir_params));
 
   // Create a Database object holding the database and hint matrices.
   RLWE_ASSIGN_OR_RETURN(auto database, Database::Create(params));
 
-  return absl::WrapUnique(
-      new Server(params, std::move(database), std::move(rlwe_contexts)));
+  return absl::WrapUnique(new Server(params, std::move(linpir_params),
+                                     std::move(database),
+                                     std::move(rlwe_contexts)));
 }
 
-absl::StatusOr<std::unique_ptr<Server>> Server::CreateWithRandomDatabaseRecords(
-    const Parameters& params) {
-  RLWE_RETURN_IF_ERROR(CheckForValidPrngType(params));
+template <typename RlweInteger>
+absl::StatusOr<std::unique_ptr<Server<RlweInteger>>>
+Server<RlweInteger>::CreateForRecords(int64_t num_records, int record_bit_size,
+                                      ShapeObjective objective,
+                                      const Parameters& base_params) {
+  RLWE_ASSIGN_OR_RETURN(Parameters params,
+                        SelectDatabaseShape(num_records, record_bit_size,
+                                            objective, base_params));
+  return Create(params);
+}
 
-  // Create RLWE contexts, one per plaintext modulus in `ts`.
-  auto const& rlwe_params = params.linpir_params;
-  int num_linpir_instances = rlwe_params.ts.size();
-  std::vector<std::unique_ptr<const RlweRnsContext>> rlwe_contexts;
-  rlwe_contexts.reserve(num_linpir_instances);
-  for (int i = 0; i < num_linpir_instances; ++i) {
-    RLWE_ASSIGN_OR_RETURN(
-        auto rlwe_context,
-        RlweRnsContext::CreateForBfvFiniteFieldEncoding(
-            rlwe_params.log_n, rlwe_params.qs, /*ps=*/{}, rlwe_params.ts[i]));
-    rlwe_contexts.push_back(
-        std::make_unique<const RlweRnsContext>(std::move(rlwe_context)));
-  }
+template <typename RlweInteger>
+absl::StatusOr<std::unique_ptr<Server<RlweInteger>>>
+Server<RlweInteger>::CreateWithRandomDatabaseRecords(const Parameters& params) {
+  RLWE_RETURN_IF_ERROR(CheckForValidPrngType(params));
+  RLWE_ASSIGN_OR_RETURN(auto linpir_params,
+                        NarrowLinPirParameters<RlweInteger>(params));
+  RLWE_ASSIGN_OR_RETURN(auto rlwe_contexts, CreateRlweContexts(linpir_params));
 
   // Create a Databas holding random records.
   RLWE_ASSIGN_OR_RETURN(auto database, Database::CreateRandom(params));
 
-  return absl::WrapUnique(
-      new Server(params, std::move(database), std::move(rlwe_contexts)));
+  return absl::WrapUnique(new Server(params, std::move(linpir_params),
+                                     std::move(database),
+                                     std::move(rlwe_contexts)));
 }
 
-absl::Status Server::GeneratePublicParams() {
+template <typename RlweInteger>
+absl::Status Server<RlweInteger>::GeneratePublicParams() {
   int num_linpir_instances = params_.linpir_params.ts.size();
-  if (params_.prng_type == rlwe::PRNG_TYPE_HKDF) {
-    // Sample PRNG seeds for LWE "A" matrix and LinPIR.
-    RLWE_ASSIGN_OR_RETURN(prng_seed_lwe_query_pad_,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-    prng_seed_linpir_ct_pads_.clear();
-    prng_seed_linpir_ct_pads_.resize(num_linpir_instances);
-    for (int i = 0; i < num_linpir_instances; ++i) {
-      RLWE_ASSIGN_OR_RETURN(prng_seed_linpir_ct_pads_[i],
-                            rlwe::SingleThreadHkdfPrng::GenerateSeed());
-    }
-    RLWE_ASSIGN_OR_RETURN(prng_seed_linpir_gk_pad_,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-    // Generate the LWE "A" matrix.
-    RLWE_ASSIGN_OR_RETURN(auto prng, rlwe::SingleThreadHkdfPrng::Create(
-                                         prng_seed_lwe_query_pad_));
-    RLWE_ASSIGN_OR_RETURN(
-        auto pad,
-        lwe::ExpandPad(params_.db_cols, params_.lwe_secret_dim, prng.get()));
-    lwe_query_pad_ = std::make_unique<const lwe::Matrix>(std::move(pad));
-  } else {
-    RLWE_ASSIGN_OR_RETURN(prng_seed_lwe_query_pad_,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-    prng_seed_linpir_ct_pads_.clear();
-    prng_seed_linpir_ct_pads_.resize(num_linpir_instances);
-    for (int i = 0; i < num_linpir_instances; ++i) {
-      RLWE_ASSIGN_OR_RETURN(prng_seed_linpir_ct_pads_[i],
-                            rlwe::SingleThreadChaChaPrng::GenerateSeed());
-    }
-    RLWE_ASSIGN_OR_RETURN(prng_seed_linpir_gk_pad_,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-
-    RLWE_ASSIGN_OR_RETURN(auto prng, rlwe::SingleThreadChaChaPrng::Create(
-                                         prng_seed_lwe_query_pad_));
-    RLWE_ASSIGN_OR_RETURN(
-        auto pad,
-        lwe::ExpandPad(params_.db_cols, params_.lwe_secret_dim, prng.get()));
-    lwe_query_pad_ = std::make_unique<const lwe::Matrix>(std::move(pad));
+  rlwe::PrngType linpir_prng_type = params_.linpir_params.prng_type;
+  // Sample PRNG seeds for LWE "A" matrix and LinPIR.
+  RLWE_ASSIGN_OR_RETURN(prng_seed_lwe_query_pad_,
+                        lwe::GeneratePrngSeed(params_.prng_type));
+  prng_seed_linpir_ct_pads_.clear();
+  prng_seed_linpir_ct_pads_.resize(num_linpir_instances);
+  for (int i = 0; i < num_linpir_instances; ++i) {
+    RLWE_ASSIGN_OR_RETURN(prng_seed_linpir_ct_pads_[i],
+                          lwe::GeneratePrngSeed(linpir_prng_type));
   }
+  // The Galois key pads are expanded by SHELL.
+  RLWE_ASSIGN_OR_RETURN(
+      prng_seed_linpir_gk_pad_,
+      lwe::GeneratePrngSeed(lwe::ShellPrngType(linpir_prng_type)));
   return absl::OkStatus();
 }
 
-namespace {
-
-// Given `matrix` with mod-q entries, returns `matrix` mod p, where modular
-// numbers are in balanced representation.
-template <typename Integer>
-std::vector<std::vector<Integer>> EncodeLweMatrix(
-    const Database::LweMatrix& matrix, Integer q, Integer p) {
-  Integer q_half = q >> 1;
-  int num_rows = matrix.size();
-  int num_cols = matrix[0].size();
-  std::vector<std::vector<Integer>> matrix_mod_p(num_rows);
-  for (int i = 0; i < num_rows; ++i) {
-    matrix_mod_p[i].reserve(num_cols);
-    for (int j = 0; j < num_cols; ++j) {
-      Integer x = static_cast<Integer>(matrix[i][j]);
-      matrix_mod_p[i].push_back(ConvertModulus(x, q, p, q_half));
-    }
-  }
-  return matrix_mod_p;
-}
-
-}  // namespace
+template <typename RlweInteger>
+absl::Status Server<RlweInteger>::Preprocess() {
+  is_preprocessed_ = false;
 
-absl::Status Server::Preprocess() {
   // Refresh the PRNG seeds.
   RLWE_RETURN_IF_ERROR(GeneratePublicParams());
 
-  // Make sure the hint is up to date.
-  RLWE_RETURN_IF_ERROR(database_->UpdateLweQueryPad(lwe_query_pad_.get()));
-  RLWE_RETURN_IF_ERROR(database_->UpdateHints());
+  // Make sure the hint is up to date, generating the LWE "A" matrix from its
+  // seed tile by tile.
+  RLWE_RETURN_IF_ERROR(database_->UpdateHintsFromSeed(prng_seed_lwe_query_pad_,
+                                                      params_.prng_type));
 
-  RlweInteger lwe_modulus = RlweInteger{1} << params_.lwe_modulus_bit_size;
+  uint64_t lwe_modulus = uint64_t{1} << params_.lwe_modulus_bit_size;
   size_t num_shards = database_->NumShards();
 
-  // Create LinPir databases (holding the preprocessed hints) and servers.
+  // Create LinPir databases (holding the preprocessed hints) and servers. Up
+  // to `params_.num_threads` plaintext moduli are handled in parallel, and
+  // each LinPir database encodes and preprocesses its diagonals with
+  // `linpir_params_.num_threads` threads.
+  int num_contexts = rlwe_contexts_.size();
+  int num_context_threads =
+      std::max(1, std::min(params_.num_threads, num_contexts));
+  const linpir::RlweParameters<RlweInteger>& linpir_params = linpir_params_;
   linpir_servers_.clear();
-  linpir_servers_.resize(rlwe_contexts_.size());
+  linpir_servers_.resize(num_contexts);
   linpir_databases_.clear();
-  linpir_databases_.resize(rlwe_contexts_.size());
-  for (int k = 0; k < rlwe_contexts_.size(); ++k) {
+  linpir_databases_.resize(num_contexts);
+  int packing_factor = LinPirPackingFactor(params_);
+  auto preprocess_mod_tk = [&](int k) -> absl::Status {
     RlweInteger plaintext_modulus = rlwe_contexts_[k]->PlaintextModulus();
 
-    // One LinPir database per shard, for the current plaintext modulus.
+    // One LinPir database per shard for the current plaintext modulus, or a
+    // single one when the hints of all shards are packed together.
     std::vector<std::unique_ptr<LinPirDatabase>> linpir_databases_mod_tk;
-    linpir_databases_mod_tk.reserve(num_shards);
-    for (const Database::LweMatrix& hint : database_->Hints()) {
-      std::vector<std::vector<RlweInteger>> hint_mod_tk =
-          EncodeLweMatrix(hint, lwe_modulus, plaintext_modulus);
+    if (packing_factor > 1) {
       RLWE_ASSIGN_OR_RETURN(
           auto linpir_database,
-          LinPirDatabase::Create(params_.linpir_params, rlwe_contexts_[k].get(),
-                                 hint_mod_tk));
+          CreatePackedLinPirDatabase(linpir_params, k, packing_factor));
       linpir_databases_mod_tk.push_back(std::move(linpir_database));
+    } else {
+      linpir_databases_mod_tk.reserve(num_shards);
+      for (const Database::LweMatrix& hint : database_->Hints()) {
+        // Reduce the hint mod t_k one LinPir block of rows at a time, so that
+        // only one block of the reduced hint is alive while its diagonals are
+        // encoded.
+        RLWE_ASSIGN_OR_RETURN(
+            auto linpir_database,
+            LinPirDatabase::CreateFromRowBlocks(
+                linpir_params, rlwe_contexts_[k].get(), hint.size(),
+                hint[0].size(), [&](int row_begin, int row_end) {
+                  return EncodeLweMatrixRows(hint, row_begin, row_end,
+                                             lwe_modulus, plaintext_modulus);
+                }));
+        linpir_databases_mod_tk.push_back(std::move(linpir_database));
+      }
     }
     std::vector<LinPirDatabase*> linpir_databases_ptrs;
     std::transform(linpir_databases_mod_tk.begin(),
@@ -210,7 +204,7 @@ absl::Status Server::Preprocess() {
                    [](auto& ptr) { return ptr.get(); });
     RLWE_ASSIGN_OR_RETURN(
         auto linpir_server_mod_tk,
-        LinPirServer::Create(params_.linpir_params, rlwe_contexts_[k].get(),
+        LinPirServer::Create(linpir_params, rlwe_contexts_[k].get(),
                              linpir_databases_ptrs,
                              prng_seed_linpir_ct_pads_[k],
                              prng_seed_linpir_gk_pad_));
@@ -218,7 +212,16 @@ absl::Status Server::Preprocess() {
 
     linpir_databases_[k] = std::move(linpir_databases_mod_tk);
     linpir_servers_[k] = std::move(linpir_server_mod_tk);
-  }
+    return absl::OkStatus();
+  };
+  RLWE_RETURN_IF_ERROR(linpir::ParallelFor(
+      num_contexts, num_context_threads,
+      [&](int k_begin, int k_end) -> absl::Status {
+        for (int k = k_begin; k < k_end; ++k) {
+          RLWE_RETURN_IF_ERROR(preprocess_mod_tk(k));
+        }
+        return absl::OkStatus();
+      }));
 // Get the response pads (hints) from all LinPIR servers.
   linpir_response_pads_.clear();
   linpir_response_pads_.reserve(linpir_servers_.size());
@@ -227,10 +230,75 @@ absl::Status Server::Preprocess() {
                         linpir_servers_[k]->GetResponsePads());
   linpir_response_pads_.push_back(std::move(response_pads));
 }
+  is_preprocessed_ = true;
   return absl::OkStatus();
 }
 
-absl::StatusOr<HintlessPirResponse> Server::HandleRequest(
+template <typename RlweInteger>
+absl::StatusOr<std::unique_ptr<linpir::Database<RlweInteger>>>
+Server<RlweInteger>::CreatePackedLinPirDatabase(
+    const linpir::RlweParameters<RlweInteger>& linpir_params, int k,
+    int packing_factor) const {
+  uint64_t lwe_modulus = uint64_t{1} << params_.lwe_modulus_bit_size;
+  RlweInteger plaintext_modulus = rlwe_contexts_[k]->PlaintextModulus();
+  auto const& hints = database_->Hints();
+  int num_shards = hints.size();
+  int64_t num_hint_rows = hints[0].size();
+  int num_hint_cols = hints[0][0].size();
+  int64_t num_stacked_rows = num_shards * num_hint_rows;
+  int64_t num_packed_rows =
+      NumPackedHintRows(num_shards, num_hint_rows, packing_factor);
+  int num_slots_per_group = 1 << (linpir_params.log_n - 1);
+
+  // The hints are stacked into a matrix of `num_stacked_rows` rows, and row i
+  // of the packed matrix holds the rows i + p * `num_packed_rows` of the
+  // stacked matrix for all p. Only the stacked rows of one block of packed
+  // rows are reduced mod t_k at a time.
+  auto packed_row_source = [&](int row_begin, int row_end)
+      -> absl::StatusOr<std::vector<std::vector<RlweInteger>>> {
+    int num_rows = row_end - row_begin;
+    std::vector<std::vector<std::vector<RlweInteger>>> stacked_rows(
+        packing_factor);
+    for (int p = 0; p < packing_factor; ++p) {
+      int64_t stacked_begin = p * num_packed_rows + row_begin;
+      int64_t stacked_end =
+          std::min(stacked_begin + num_rows, num_stacked_rows);
+      stacked_rows[p].reserve(num_rows);
+      for (int64_t t = stacked_begin; t < stacked_end;) {
+        int shard = t / num_hint_rows;
+        int64_t shard_row_begin = t % num_hint_rows;
+        int64_t shard_row_end =
+            std::min(num_hint_rows, shard_row_begin + (stacked_end - t));
+        for (auto& row :
+             EncodeLweMatrixRows(hints[shard], shard_row_begin, shard_row_end,
+                                 lwe_modulus, plaintext_modulus)) {
+          stacked_rows[p].push_back(std::move(row));
+        }
+        t += shard_row_end - shard_row_begin;
+      }
+    }
+
+    std::vector<std::vector<RlweInteger>> packed_rows;
+    packed_rows.reserve(num_rows);
+    std::vector<const RlweInteger*> rows(packing_factor);
+    for (int i = 0; i < num_rows; ++i) {
+      for (int p = 0; p < packing_factor; ++p) {
+        rows[p] = i < static_cast<int>(stacked_rows[p].size())
+                    ? stacked_rows[p][i].data()
+                    : nullptr;
+      }
+      packed_rows.push_back(linpir::PackRow<RlweInteger>(
+          linpir_params, packing_factor, row_begin + i, rows, num_hint_cols));
+    }
+    return packed_rows;
+  };
+  return LinPirDatabase::CreateFromRowBlocks(
+      linpir_params, rlwe_contexts_[k].get(), num_packed_rows,
+      num_slots_per_group, packed_row_source);
+}
+
+template <typename RlweInteger>
+absl::StatusOr<HintlessPirResponse> Server<RlweInteger>::HandleRequest(
     const HintlessPirRequest& request) {
   if (!IsPreprocessed()) {
     return absl::FailedPreconditionError("Server has not been preprocessed.");
@@ -293,7 +361,8 @@ absl::StatusOr<HintlessPirResponse> Server::HandleRequest(
   return response;
 }
 
-HintlessPirServerPublicParams Server::GetPublicParams() const {
+template <typename RlweInteger>
+HintlessPirServerPublicParams Server<RlweInteger>::GetPublicParams() const {
   HintlessPirServerPublicParams output;
   output.set_prng_seed_lwe_query_pad(prng_seed_lwe_query_pad_);
   for (auto const& prng_seed : prng_seed_linpir_ct_pads_) {
@@ -307,5 +376,8 @@ HintlessPirServerPublicParams Server::GetPublicParams() const {
   return output;
 }
 
+template class Server<linpir::Uint32>;
+template class Server<linpir::Uint64>;
+
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
@@ -16,6 +16,7 @@
 #ifndef HINTLESS_PIR_HINTLESS_SIMPLEPIR_SERVER_H_
 #define HINTLESS_PIR_HINTLESS_SIMPLEPIR_SERVER_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -25,6 +26,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "hintless_simplepir/database_hwy.h"
+#include "hintless_simplepir/database_shape.h"
 #include "hintless_simplepir/parameters.h"
 #include "hintless_simplepir/serialization.pb.h"
 #include "linpir/database.h"
@@ -36,12 +38,23 @@
 namespace hintless_pir {
 namespace hintless_simplepir {
 
-// The server part of the HintlessPir protocol.
+// The server part of the HintlessPir protocol, computing the LinPIR part with
+// RLWE integers of type `RlweInteger`, i.e. `linpir::Uint32` or
+// `linpir::Uint64`. All RLWE moduli in the parameters must fit in the former
+// to use 32-bit RLWE integers.
+template <typename RlweInteger>
 class Server {
  public:
   static absl::StatusOr<std::unique_ptr<Server>> Create(
       const Parameters& params);
 
+  // Creates a server for `num_records` records of `record_bit_size` bits, with
+  // the database shape minimizing `objective`. The other parameters are taken
+  // from `base_params`; see `SelectDatabaseShape()`.
+  static absl::StatusOr<std::unique_ptr<Server>> CreateForRecords(
+      int64_t num_records, int record_bit_size, ShapeObjective objective,
+      const Parameters& base_params);
+
   // Creates a server holding a random database supporting the given parameters.
   static absl::StatusOr<std::unique_ptr<Server>>
   CreateWithRandomDatabaseRecords(const Parameters& params);
@@ -52,47 +65,64 @@ class Server {
   // be called before accepting client requests.
   absl::Status Preprocess();
 
+  // Returns the response to `request`. After `Preprocess()`, this may be called
+  // concurrently from multiple threads.
   absl::StatusOr<HintlessPirResponse> HandleRequest(
       const HintlessPirRequest& request);
 
   // Returns the server's public parameters that are sent to the client.
   HintlessPirServerPublicParams GetPublicParams() const;
 
-  Database* GetDatabase() const { return database_.get(); }
+  const Parameters& GetParameters() const { return params_; }
 
-  const lwe::Matrix* LweQueryPad() const { return lwe_query_pad_.get(); }
+  Database* GetDatabase() const { return database_.get(); }
 
  private:
-  using RlweInteger = Parameters::RlweInteger;
   using RlweModularInt = rlwe::MontgomeryInt<RlweInteger>;
   using RlweRnsContext = rlwe::RnsContext<RlweModularInt>;
   using LinPirServer = linpir::Server<RlweInteger>;
   using LinPirDatabase = linpir::Database<RlweInteger>;
 
   explicit Server(
-      Parameters params, std::unique_ptr<Database> database,
+      Parameters params, linpir::RlweParameters<RlweInteger> linpir_params,
+      std::unique_ptr<Database> database,
       std::vector<std::unique_ptr<const RlweRnsContext>> rlwe_contexts)
       : params_(std::move(params)),
+        linpir_params_(std::move(linpir_params)),
         database_(std::move(database)),
         rlwe_contexts_(std::move(rlwe_contexts)) {}
 
+  // Returns the RLWE contexts for `linpir_params`, one per plaintext modulus.
+  static absl::StatusOr<std::vector<std::unique_ptr<const RlweRnsContext>>>
+  CreateRlweContexts(const linpir::RlweParameters<RlweInteger>& linpir_params);
+
+  // Returns the LinPir database for the plaintext modulus t_k packing the
+  // hints of all shards `packing_factor` rows at a time into its slots.
+  absl::StatusOr<std::unique_ptr<LinPirDatabase>> CreatePackedLinPirDatabase(
+      const linpir::RlweParameters<RlweInteger>& linpir_params, int k,
+      int packing_factor) const;
+
   // Refreshes the server's public parameters.
   // This is part of the preprocess steps.
   absl::Status GeneratePublicParams();
 
   // Returns if the server has been preprocessed to accept requests.
-  bool IsPreprocessed() const { return lwe_query_pad_ != nullptr; }
+  bool IsPreprocessed() const { return is_preprocessed_; }
 
   // The parameters of the SimplePIR protocol.
   const Parameters params_;
 
+  // The LinPIR parameters in `params_` with moduli of type `RlweInteger`.
+  const linpir::RlweParameters<RlweInteger> linpir_params_;
+
   // Holding the database matrices and the hint matrices.
   std::unique_ptr<Database> database_;
 
   std::vector<std::unique_ptr<const RlweRnsContext>> rlwe_contexts_;
 
+  // The LWE query pad is expanded from this seed when computing the hints, and
+  // is not held by the server.
   std::string prng_seed_lwe_query_pad_;
-  std::unique_ptr<const lwe::Matrix> lwe_query_pad_;
 
   std::vector<std::string> prng_seed_linpir_ct_pads_;
   std::string prng_seed_linpir_gk_pad_;
@@ -101,6 +131,8 @@ class Server {
   std::vector<std::unique_ptr<LinPirServer>> linpir_servers_;
   // Precomputed 'a' components of the LinPIR responses, serving as the hint.
   std::vector<hintless_pir::LinPirResponse> linpir_response_pads_;
+
+  bool is_preprocessed_ = false;
 };
 
 }  // namespace hintless_simplepir
@@ -23,10 +23,12 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "hintless_simplepir/database_hwy.h"
+#include "hintless_simplepir/database_shape.h"
 #include "hintless_simplepir/parameters.h"
 #include "hintless_simplepir/testing.h"
 #include "hintless_simplepir/utils.h"
 #include "linpir/parameters.h"
+#include "lwe/lwe_symmetric_encryption.h"
 #include "lwe/types.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
 #include "shell_encryption/testing/status_matchers.h"
@@ -66,27 +68,34 @@ class ServerTest : public ::testing::Test {
  protected:
   void SetUp() override {
     // Creates a server and fill in the database with random records.
-    server_ = Server::Create(kParameters).value();
+    server_ = Server<RlweInteger>::Create(kParameters).value();
     auto database = server_->GetDatabase();
     for (int64_t i = 0; i < kParameters.db_rows * kParameters.db_cols; ++i) {
       CHECK_OK(database->Append(testing::GenerateRandomRecord(kParameters)));
     }
   }
 
-  std::unique_ptr<Server> server_;
+  std::unique_ptr<Server<RlweInteger>> server_;
 };
 
 TEST(Server, CreateFailsIfInvalidPrngType) {
   const Parameters params{
       .prng_type = rlwe::PRNG_TYPE_INVALID,
   };
-  EXPECT_THAT(Server::Create(params),
+  EXPECT_THAT(Server<RlweInteger>::Create(params),
               StatusIs(absl::StatusCode::kInvalidArgument,
                        HasSubstr("Invalid PRNG type")));
 }
 
+TEST(Server, CreateFailsIfRlweModuliDoNotFit) {
+  // The ciphertext moduli of `kParameters` exceed 32 bits.
+  EXPECT_THAT(Server<linpir::Uint32>::Create(kParameters),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("do not fit in `RlweInteger`")));
+}
+
 TEST(Server, Create) {
-  ASSERT_OK_AND_ASSIGN(auto server, Server::Create(kParameters));
+  ASSERT_OK_AND_ASSIGN(auto server, Server<RlweInteger>::Create(kParameters));
   auto database = server->GetDatabase();
   ASSERT_NE(database, nullptr);
 
@@ -96,6 +105,33 @@ TEST(Server, Create) {
   ASSERT_EQ(database->NumRecords(), 0);
 }
 
+TEST(Server, CreateForRecords) {
+  constexpr int64_t kNumRecords = 1000;
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<RlweInteger>::CreateForRecords(
+          kNumRecords, /*record_bit_size=*/16, ShapeObjective::kTotalBytes,
+          kParameters));
+  const Parameters& params = server->GetParameters();
+  EXPECT_EQ(params.db_record_bit_size, 16);
+  EXPECT_EQ(params.db_rows % DatabaseRowAlignment(kParameters), 0);
+  EXPECT_GE(params.db_rows * params.db_cols, kNumRecords);
+  EXPECT_EQ(server->GetDatabase()->NumShards(), 2);
+
+  // Fill in the database and check that it is ready for requests.
+  for (int64_t i = 0; i < kNumRecords; ++i) {
+    ASSERT_OK(server->GetDatabase()->Append(
+        testing::GenerateRandomRecord(params)));
+  }
+  ASSERT_OK(server->Preprocess());
+}
+
+TEST(Server, CreateForRecordsFailsIfNoRecords) {
+  EXPECT_THAT(Server<RlweInteger>::CreateForRecords(
+                  0, 8, ShapeObjective::kLatency, kParameters),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 TEST_F(ServerTest, Preprocess) {
   // Check that the server's public parameters are generated and the database
   // structures are preprocessed.
@@ -113,10 +149,12 @@ TEST_F(ServerTest, Preprocess) {
               expected_prng_seed_length);
   }
 
-  const lwe::Matrix* lwe_matrix = this->server_->LweQueryPad();
-  ASSERT_NE(lwe_matrix, nullptr);
-  ASSERT_EQ(lwe_matrix->rows(), kParameters.db_cols);
-  ASSERT_EQ(lwe_matrix->cols(), kParameters.lwe_secret_dim);
+  // The server does not keep the LWE query pad, so expand it from its seed.
+  ASSERT_OK_AND_ASSIGN(
+      lwe::Matrix lwe_matrix,
+      lwe::ExpandPadFromSeed(kParameters.db_cols, kParameters.lwe_secret_dim,
+                             pub_params.prng_seed_lwe_query_pad(),
+                             kParameters.prng_type));
 
   Database* database = this->server_->GetDatabase();
   ASSERT_NE(database, nullptr);
@@ -132,9 +170,15 @@ TEST_F(ServerTest, Preprocess) {
     EXPECT_EQ(data_matrix[0].size(), expected_num_blocks_per_column);
   }
   ASSERT_EQ(database->Hints().size(), num_shards);
-  for (const Database::LweMatrix& hint_matrix : database->Hints()) {
+  for (int i = 0; i < num_shards; ++i) {
+    const Database::LweMatrix& hint_matrix = database->Hints()[i];
     EXPECT_EQ(hint_matrix.size(), kParameters.db_rows);
     EXPECT_EQ(hint_matrix[0].size(), kParameters.lwe_secret_dim);
+    lwe::Matrix data_matrix =
+        ExportRawMatrix(database->Data()[i], kParameters.db_rows,
+                        kParameters.lwe_plaintext_bit_size);
+    EXPECT_EQ(ExportLweMatrix(hint_matrix).transpose(),
+              data_matrix * lwe_matrix);
   }
 }
 
@@ -16,16 +16,21 @@
 #ifndef HINTLESS_PIR_HINTLESS_SIMPLEPIR_SIMPLEPIR_H_
 #define HINTLESS_PIR_HINTLESS_SIMPLEPIR_SIMPLEPIR_H_
 
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Eigen/Core"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "hintless_simplepir/database_hwy.h"
+#include "hintless_simplepir/parameters.h"
 #include "lwe/encode.h"
 #include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/prng_type.h"
 #include "lwe/sample_error.h"
 #include "lwe/types.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
@@ -94,14 +99,70 @@ class Parems {
                        " does not match the number in the public parameters, ",
                        DbRows(), "."));
     }
-    RLWE_ASSIGN_OR_RETURN(auto pad_prng, Prng::Create(Seed()));
-    RLWE_ASSIGN_OR_RETURN(
-        lwe::Matrix pad,
-        lwe::SampleUniformMatrix(DbCols(), LweSecretDim(), pad_prng.get()));
-    lwe::Matrix hint = database * pad;
+    RLWE_ASSIGN_OR_RETURN(std::shared_ptr<const lwe::Matrix> pad, Pad());
+    lwe::Matrix hint = database * *pad;
     return hint;
   }
 
+  // Preprocesses the database-dependent hint for the client from a database
+  // packed by `PackDatabase()`. The pad is streamed from the seed a tile of
+  // rows at a time, and is never held in memory.
+  absl::StatusOr<lwe::Matrix> ServerPreprocess(
+      hintless_simplepir::Database* database) const {
+    if (database == nullptr) {
+      return absl::InvalidArgumentError("`database` must not be null.");
+    }
+    RLWE_RETURN_IF_ERROR(
+        database->UpdateHintsFromSeed(Seed(), lwe::PrngTypeOf<Prng>()));
+    // The hint of the single shard is stored by rows.
+    return hintless_simplepir::ExportLweMatrix(database->Hints()[0])
+        .transpose()
+        .eval();
+  }
+
+  // Packs `database` into a `hintless_simplepir::Database`, storing each entry
+  // in 8 bits rather than in an `lwe::Integer`. The server responses of the
+  // packed database are computed by the Highway kernels with `num_threads`
+  // threads. Requires `RecordBitSize()` to be at most 8.
+  absl::StatusOr<std::unique_ptr<hintless_simplepir::Database>> PackDatabase(
+      const lwe::Matrix& database, int num_threads = 1) const {
+    if (database.cols() != DbCols() || database.rows() != DbRows()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The database is ", database.rows(), " x ", database.cols(),
+          ", which does not match the public parameters, ", DbRows(), " x ",
+          DbCols(), "."));
+    }
+    if (RecordBitSize() <= 0 ||
+        RecordBitSize() > 8 * sizeof(lwe::PlainInteger)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("The record bit size, ", RecordBitSize(),
+                       ", does not fit in a packed database value."));
+    }
+    if (num_threads < 1) {
+      return absl::InvalidArgumentError("`num_threads` must be positive.");
+    }
+    hintless_simplepir::Parameters params{
+        .db_rows = DbRows(),
+        .db_cols = DbCols(),
+        .db_record_bit_size = RecordBitSize(),
+        .lwe_secret_dim = LweSecretDim(),
+        .lwe_modulus_bit_size = lwe::kIntBitwidth,
+        .lwe_plaintext_bit_size = RecordBitSize(),
+        .prng_type = lwe::PrngTypeOf<Prng>(),
+        .num_query_threads = num_threads,
+    };
+    RLWE_ASSIGN_OR_RETURN(std::unique_ptr<hintless_simplepir::Database> packed,
+                          hintless_simplepir::Database::Create(params));
+    // The packed database stores its records row after row.
+    for (int i = 0; i < DbRows(); ++i) {
+      for (int j = 0; j < DbCols(); ++j) {
+        RLWE_RETURN_IF_ERROR(
+            packed->Append(std::string(1, static_cast<char>(database(i, j)))));
+      }
+    }
+    return packed;
+  }
+
   absl::StatusOr<std::pair<ClientState, lwe::Vector>> ClientQuery(
       int query_idx, const lwe::Matrix& hint) const {
     int db_size = DbRows() * DbCols();
@@ -122,10 +183,7 @@ class Parems {
                        DbRows(), "."));
     }
 
-    RLWE_ASSIGN_OR_RETURN(auto pad_prng, Prng::Create(Seed()));
-    RLWE_ASSIGN_OR_RETURN(
-        lwe::Matrix pad,
-        lwe::SampleUniformMatrix(DbCols(), LweSecretDim(), pad_prng.get()));
+    RLWE_ASSIGN_OR_RETURN(std::shared_ptr<const lwe::Matrix> pad, Pad());
     int col_idx = query_idx / DbRows();
     int row_idx = query_idx % DbRows();
     RLWE_ASSIGN_OR_RETURN(std::string client_seed, Prng::GenerateSeed());
@@ -141,7 +199,7 @@ class Parems {
     ptxt[col_idx] = 1;
     // Computing b = pad * s + \Delta ptxt + e
     RLWE_RETURN_IF_ERROR(key.EncryptFromPadInPlace(
-        ptxt, pad, log_scaling_factor, client_prng.get()));
+        ptxt, *pad, log_scaling_factor, client_prng.get()));
 
     // Also need H_i1 * s, where H_i1 is the i1-th row of the hint H
     // From above there are DimLweSecretKey() columns of the hint,
@@ -160,6 +218,20 @@ class Parems {
     return database * client_query;
   }
 
+  // Computes and returns the ServerResponse on a database packed by
+  // `PackDatabase()`.
+  absl::StatusOr<lwe::Vector> ServerResponse(
+      const hintless_simplepir::Database& database,
+      const lwe::Vector& client_query) const {
+    RLWE_ASSIGN_OR_RETURN(
+        std::vector<hintless_simplepir::Database::LweVector> responses,
+        database.InnerProductWith(hintless_simplepir::Database::LweVector(
+            client_query.data(), client_query.data() + client_query.size())));
+    return Eigen::Map<const lwe::Vector>(responses[0].data(),
+                                         responses[0].size())
+        .eval();
+  }
+
   absl::StatusOr<lwe::Integer> ClientRecovery(
       const ClientState& state, const lwe::Vector& server_response) const {
     // Note that as server_response is a RefVector,
@@ -187,6 +259,14 @@ class Parems {
     return noisy_plaintext.eval()(0);
   }
 
+  // Expands the LWE query pad once and keeps it, so that `ServerPreprocess()`
+  // and `ClientQuery()` no longer expand it from the seed on every call. The
+  // cached pad is shared by copies of these parameters.
+  absl::Status CachePad() {
+    RLWE_ASSIGN_OR_RETURN(pad_, ExpandPad());
+    return absl::OkStatus();
+  }
+
   // Accessors.
   absl::string_view Seed() const { return seed_; }
   int LweSecretDim() const { return lwe_secret_dim_; }
@@ -203,11 +283,31 @@ class Parems {
         db_rows_(db_rows),
         db_cols_(db_cols) {}
 
+  // Returns the LWE query pad expanded from the seed.
+  absl::StatusOr<std::shared_ptr<const lwe::Matrix>> ExpandPad() const {
+    RLWE_ASSIGN_OR_RETURN(auto pad_prng, Prng::Create(Seed()));
+    RLWE_ASSIGN_OR_RETURN(
+        lwe::Matrix pad,
+        lwe::SampleUniformMatrix(DbCols(), LweSecretDim(), pad_prng.get()));
+    return std::make_shared<const lwe::Matrix>(std::move(pad));
+  }
+
+  // Returns the cached LWE query pad if any, or a freshly expanded one.
+  absl::StatusOr<std::shared_ptr<const lwe::Matrix>> Pad() const {
+    if (pad_ != nullptr) {
+      return pad_;
+    }
+    return ExpandPad();
+  }
+
   std::string seed_;
   int lwe_secret_dim_;
   int record_bit_size_;
   int db_rows_;
   int db_cols_;
+
+  // The LWE query pad cached by `CachePad()`, or null.
+  std::shared_ptr<const lwe::Matrix> pad_;
 };
 
 }  // namespace simplepir
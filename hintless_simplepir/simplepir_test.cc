@@ -95,6 +95,50 @@ TEST_F(SimplePirTest, EndToEndTest) {
   EXPECT_EQ(output, database(client_state.row_idx, client_state.col_idx));
 }
 
+// Tests that the packed database yields the hint and the responses of the
+// unpacked one, and that a cached pad yields the same hint.
+TEST_F(SimplePirTest, PackedDatabaseEndToEndTest) {
+  ASSERT_OK_AND_ASSIGN(lwe::Matrix database, GenerateDatabase(parems_.get()));
+  ASSERT_OK_AND_ASSIGN(lwe::Matrix expected_hint,
+                       parems_->ServerPreprocess(database));
+  ASSERT_OK_AND_ASSIGN(auto packed_database,
+                       parems_->PackDatabase(database, /*num_threads=*/3));
+  ASSERT_OK_AND_ASSIGN(lwe::Matrix hint,
+                       parems_->ServerPreprocess(packed_database.get()));
+  EXPECT_EQ(hint, expected_hint);
+
+  Parems cached_parems = *parems_;
+  ASSERT_OK(cached_parems.CachePad());
+  ASSERT_OK_AND_ASSIGN(lwe::Matrix cached_hint,
+                       cached_parems.ServerPreprocess(database));
+  EXPECT_EQ(cached_hint, expected_hint);
+
+  for (int client_idx : {0, 111, parems_->DbRows() * parems_->DbCols() - 1}) {
+    ClientState client_state;
+    lwe::Vector query;
+    ASSERT_OK_AND_ASSIGN(std::tie(client_state, query),
+                         cached_parems.ClientQuery(client_idx, hint));
+    ASSERT_OK_AND_ASSIGN(lwe::Vector response,
+                         parems_->ServerResponse(*packed_database, query));
+    ASSERT_OK_AND_ASSIGN(lwe::Vector expected_response,
+                         parems_->ServerResponse(database, query));
+    EXPECT_EQ(response, expected_response);
+    ASSERT_OK_AND_ASSIGN(lwe::Integer output,
+                         parems_->ClientRecovery(client_state, response));
+    EXPECT_EQ(output, database(client_state.row_idx, client_state.col_idx));
+  }
+}
+
+TEST_F(SimplePirTest, PackDatabaseTooLargeBitSizeTest) {
+  auto parems = Parems::Create(parems_->Seed(), parems_->LweSecretDim(),
+                               /*record_bit_size=*/9, parems_->DbRows(),
+                               parems_->DbCols());
+  ASSERT_OK_AND_ASSIGN(lwe::Matrix database, GenerateDatabase(&parems));
+  EXPECT_THAT(parems.PackDatabase(database),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("does not fit in a packed")));
+}
+
 // Testing the various error-handling checks are all properly triggered
 // for code coverage.
 TEST_F(SimplePirTest, DatabaseGenNegRowsTest) {
@@ -17,6 +17,7 @@
 #define HINTLESS_PIR_HINTLESS_SIMPLEPIR_UTILS_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -158,6 +159,37 @@ inline Integer ConvertModulus(const Integer& x, const Integer& q,
   }
 }
 
+// Given `matrix` with mod-q entries, returns its rows in [row_begin, row_end)
+// mod p, where modular numbers are in balanced representation. `q` is taken as
+// a 64-bit integer so that the LWE modulus 2^32 can be used with 32-bit
+// `Integer`.
+template <typename Integer, typename LweMatrix>
+inline std::vector<std::vector<Integer>> EncodeLweMatrixRows(
+    const LweMatrix& matrix, int row_begin, int row_end, uint64_t q,
+    Integer p) {
+  uint64_t q_half = q >> 1;
+  int num_cols = matrix[0].size();
+  std::vector<std::vector<Integer>> rows_mod_p(row_end - row_begin);
+  for (int i = row_begin; i < row_end; ++i) {
+    std::vector<Integer>& row_mod_p = rows_mod_p[i - row_begin];
+    row_mod_p.reserve(num_cols);
+    for (int j = 0; j < num_cols; ++j) {
+      uint64_t x = static_cast<uint64_t>(matrix[i][j]);
+      row_mod_p.push_back(static_cast<Integer>(
+          ConvertModulus<uint64_t>(x, q, static_cast<uint64_t>(p), q_half)));
+    }
+  }
+  return rows_mod_p;
+}
+
+// Given `matrix` with mod-q entries, returns `matrix` mod p, where modular
+// numbers are in balanced representation.
+template <typename Integer, typename LweMatrix>
+inline std::vector<std::vector<Integer>> EncodeLweMatrix(
+    const LweMatrix& matrix, uint64_t q, Integer p) {
+  return EncodeLweMatrixRows(matrix, /*row_begin=*/0, matrix.size(), q, p);
+}
+
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
 
@@ -14,6 +14,7 @@
 
 #include "hintless_simplepir/utils.h"
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -64,6 +65,27 @@ TEST(UtilsTest, SplitAndReconstruct) {
   }
 }
 
+TEST(UtilsTest, EncodeLweMatrix) {
+  // Entries mod 16 in balanced representation are {0, 1, 8, -6, -1}.
+  std::vector<std::vector<uint64_t>> matrix = {{0, 1, 8, 10, 15},
+                                               {15, 10, 8, 1, 0}};
+  std::vector<std::vector<uint64_t>> encoded =
+      EncodeLweMatrix(matrix, uint64_t{16}, uint64_t{7});
+  ASSERT_EQ(encoded.size(), 2);
+  EXPECT_EQ(encoded[0], (std::vector<uint64_t>{0, 1, 1, 1, 6}));
+  EXPECT_EQ(encoded[1], (std::vector<uint64_t>{6, 1, 1, 1, 0}));
+}
+
+TEST(UtilsTest, EncodeLweMatrixRows) {
+  std::vector<std::vector<uint64_t>> matrix = {
+      {0, 1, 8, 10, 15}, {15, 10, 8, 1, 0}, {1, 2, 3, 14, 13}};
+  std::vector<std::vector<uint64_t>> encoded = EncodeLweMatrixRows(
+      matrix, /*row_begin=*/1, /*row_end=*/3, uint64_t{16}, uint64_t{7});
+  ASSERT_EQ(encoded.size(), 2);
+  EXPECT_EQ(encoded[0], (std::vector<uint64_t>{6, 1, 1, 1, 0}));
+  EXPECT_EQ(encoded[1], (std::vector<uint64_t>{1, 2, 3, 5, 4}));
+}
+
 }  // namespace
 }  // namespace hintless_simplepir
 }  // namespace hintless_pir
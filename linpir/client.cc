@@ -22,16 +22,18 @@
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "linpir/hybrid_galois_key.h"
+#include "linpir/packing.h"
 #include "linpir/parameters.h"
+#include "lwe/prng_type.h"
 #include "shell_encryption/montgomery.h"
 #include "shell_encryption/prng/prng.h"
-#include "shell_encryption/prng/single_thread_chacha_prng.h"
-#include "shell_encryption/prng/single_thread_hkdf_prng.h"
 #include "shell_encryption/rns/rns_bfv_ciphertext.h"
 #include "shell_encryption/rns/rns_galois_key.h"
 #include "shell_encryption/status_macros.h"
@@ -45,8 +47,7 @@ Client<RlweInteger>::Create(const RlweParameters<RlweInteger>& parameters,
                             const RnsContext* rns_context,
                             absl::string_view prng_seed_ct_pad,
                             absl::string_view prng_seed_gk_pad) {
-  if (!(parameters.prng_type == rlwe::PRNG_TYPE_HKDF ||
-        parameters.prng_type == rlwe::PRNG_TYPE_CHACHA)) {
+  if (!lwe::IsSupportedPrngType(parameters.prng_type)) {
     return absl::InvalidArgumentError("Invalid `prng_type`.");
   }
   if (rns_context == nullptr) {
@@ -54,6 +55,13 @@ Client<RlweInteger>::Create(const RlweParameters<RlweInteger>& parameters,
   }
 
   auto rns_moduli = rns_context->MainPrimeModuli();
+  if (parameters.num_response_moduli < 0 ||
+      parameters.num_response_moduli > static_cast<int>(rns_moduli.size())) {
+    return absl::InvalidArgumentError(
+        "`num_response_moduli` must be between 0 and the number of `qs`.");
+  }
+  RLWE_RETURN_IF_ERROR(
+      CheckPackingFactor(parameters, parameters.block_packing_factor));
   RLWE_ASSIGN_OR_RETURN(Encoder encoder, Encoder::Create(rns_context));
   RLWE_ASSIGN_OR_RETURN(
       auto rns_error_params,
@@ -61,19 +69,39 @@ Client<RlweInteger>::Create(const RlweParameters<RlweInteger>& parameters,
           parameters.log_n, rns_moduli, {},
           std::log2(static_cast<double>(rns_context->PlaintextModulus())),
           std::sqrt(parameters.error_variance)));
-  int level = rns_moduli.size() - 1;
-  RLWE_ASSIGN_OR_RETURN(auto q_hats,
-                        rns_context->MainPrimeModulusComplements(level));
-  RLWE_ASSIGN_OR_RETURN(auto q_hat_invs,
-                        rns_context->MainPrimeModulusCrtFactors(level));
-  RLWE_ASSIGN_OR_RETURN(
-      RnsGadget rns_gadget,
-      RnsGadget::Create(parameters.log_n, parameters.gadget_log_bs, q_hats,
-                        q_hat_invs, rns_moduli));
+
+  // Hybrid key switching uses the auxiliary moduli of the context in place of
+  // a gadget.
+  std::vector<const PrimeModulus*> aux_moduli;
+  std::unique_ptr<const RnsGadget> rns_gadget;
+  if (!parameters.ps.empty()) {
+    aux_moduli = rns_context->AuxPrimeModuli();
+    if (aux_moduli.size() != parameters.ps.size()) {
+      return absl::InvalidArgumentError(
+          "`rns_context` must have `ps` as its auxiliary moduli.");
+    }
+    for (int k = 0; k < aux_moduli.size(); ++k) {
+      if (aux_moduli[k]->ModParams()->modulus != parameters.ps[k]) {
+        return absl::InvalidArgumentError(
+            "`rns_context` must have `ps` as its auxiliary moduli.");
+      }
+    }
+  } else {
+    int level = rns_moduli.size() - 1;
+    RLWE_ASSIGN_OR_RETURN(auto q_hats,
+                          rns_context->MainPrimeModulusComplements(level));
+    RLWE_ASSIGN_OR_RETURN(auto q_hat_invs,
+                          rns_context->MainPrimeModulusCrtFactors(level));
+    RLWE_ASSIGN_OR_RETURN(
+        RnsGadget gadget,
+        RnsGadget::Create(parameters.log_n, parameters.gadget_log_bs, q_hats,
+                          q_hat_invs, rns_moduli));
+    rns_gadget = std::make_unique<const RnsGadget>(std::move(gadget));
+  }
   return absl::WrapUnique(new Client<RlweInteger>(
       parameters, std::string(prng_seed_ct_pad), std::string(prng_seed_gk_pad),
-      rns_context, std::move(rns_moduli), std::move(rns_gadget),
-      std::move(rns_error_params), std::move(encoder)));
+      rns_context, std::move(rns_moduli), std::move(aux_moduli),
+      std::move(rns_gadget), std::move(rns_error_params), std::move(encoder)));
 }
 
 template <typename RlweInteger>
@@ -87,6 +115,16 @@ Client<RlweInteger>::EncryptQuery(absl::Span<const RlweInteger> query_vector,
                      " element."));
   }
 
+  // Repeat the query once per packed block.
+  std::vector<RlweInteger> packed_query;
+  if (params_.block_packing_factor > 1) {
+    RLWE_ASSIGN_OR_RETURN(packed_query,
+                          PackQuery<RlweInteger>(params_,
+                                                 params_.block_packing_factor,
+                                                 query_vector));
+    query_vector = packed_query;
+  }
+
   // Encode the query vector.
   int num_rotations = params_.rows_per_block / 2;
   std::vector<RlweInteger> slots(num_slots_per_group * 2, 0);
@@ -101,26 +139,14 @@ Client<RlweInteger>::EncryptQuery(absl::Span<const RlweInteger> query_vector,
   }
 
   // Create PRNGs for sampling RLWE secret key and encryption.
-  std::unique_ptr<rlwe::SecurePrng> prng_sk, prng_enc, prng_pad;
-  if (params_.prng_type == rlwe::PRNG_TYPE_HKDF) {
-    RLWE_ASSIGN_OR_RETURN(prng_sk,
-                          rlwe::SingleThreadHkdfPrng::Create(prng_seed_sk));
-    RLWE_ASSIGN_OR_RETURN(std::string prng_seed_enc,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-    RLWE_ASSIGN_OR_RETURN(prng_enc,
-                          rlwe::SingleThreadHkdfPrng::Create(prng_seed_enc));
-    RLWE_ASSIGN_OR_RETURN(
-        prng_pad, rlwe::SingleThreadHkdfPrng::Create(prng_seed_ct_pad_));
-  } else {
-    RLWE_ASSIGN_OR_RETURN(prng_sk,
-                          rlwe::SingleThreadChaChaPrng::Create(prng_seed_sk));
-    RLWE_ASSIGN_OR_RETURN(std::string prng_seed_enc,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-    RLWE_ASSIGN_OR_RETURN(prng_enc,
-                          rlwe::SingleThreadChaChaPrng::Create(prng_seed_enc));
-    RLWE_ASSIGN_OR_RETURN(
-        prng_pad, rlwe::SingleThreadChaChaPrng::Create(prng_seed_ct_pad_));
-  }
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng_sk,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_sk));
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_enc,
+                        lwe::GeneratePrngSeed(params_.prng_type));
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng_enc,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_enc));
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng_pad,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_ct_pad_));
 
   // Sample RLWE secret key
   RLWE_ASSIGN_OR_RETURN(
@@ -144,45 +170,40 @@ template <typename RlweInteger>
 absl::StatusOr<rlwe::RnsBfvCiphertext<rlwe::MontgomeryInt<RlweInteger>>>
 Client<RlweInteger>::EncryptQuery(absl::Span<const RlweInteger> query_vector) {
   // Create PRNG for sampling RLWE secret key.
-  std::string prng_seed_sk;
-  if (params_.prng_type == rlwe::PRNG_TYPE_HKDF) {
-    RLWE_ASSIGN_OR_RETURN(prng_seed_sk,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-  } else {
-    RLWE_ASSIGN_OR_RETURN(prng_seed_sk,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-  }
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_sk,
+                        lwe::GeneratePrngSeed(params_.prng_type));
   return EncryptQuery(query_vector, prng_seed_sk);
 }
 
 template <typename RlweInteger>
 absl::StatusOr<rlwe::RnsGaloisKey<rlwe::MontgomeryInt<RlweInteger>>>
 Client<RlweInteger>::GenerateGaloisKey(absl::string_view prng_seed_sk) const {
-  // Sample RLWE secret key
-  std::unique_ptr<rlwe::SecurePrng> prng_sk;
-  if (params_.prng_type == rlwe::PRNG_TYPE_HKDF) {
-    RLWE_ASSIGN_OR_RETURN(prng_sk,
-                          rlwe::SingleThreadHkdfPrng::Create(prng_seed_sk));
-  } else {
-    RLWE_ASSIGN_OR_RETURN(prng_sk,
-                          rlwe::SingleThreadChaChaPrng::Create(prng_seed_sk));
+  if (rns_gadget_ == nullptr) {
+    return absl::FailedPreconditionError(
+        "Gadget Galois keys require empty `ps`.");
   }
+
+  // Sample RLWE secret key
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng_sk,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_sk));
   RLWE_ASSIGN_OR_RETURN(
       RnsSecretKey secret_key,
       RnsSecretKey::Sample(params_.log_n, params_.error_variance, rns_moduli_,
                            prng_sk.get()));
 
   // Create a Galois key with the given random pads.
-  RLWE_ASSIGN_OR_RETURN(std::vector<RnsPolynomial> gk_pads,
-                        RnsGaloisKey::SampleRandomPad(
-                            rns_gadget_.Dimension(), params_.log_n, rns_moduli_,
-                            prng_seed_gk_pad_, params_.prng_type));
+  RLWE_ASSIGN_OR_RETURN(
+      std::vector<RnsPolynomial> gk_pads,
+      RnsGaloisKey::SampleRandomPad(rns_gadget_->Dimension(), params_.log_n,
+                                    rns_moduli_, prng_seed_gk_pad_,
+                                    lwe::ShellPrngType(params_.prng_type)));
 
   RLWE_ASSIGN_OR_RETURN(
       RnsGaloisKey gk,
       RnsGaloisKey::CreateWithRandomPadForBfv(
           std::move(gk_pads), secret_key, /*power=*/5, params_.error_variance,
-          &rns_gadget_, prng_seed_gk_pad_, params_.prng_type));
+          rns_gadget_.get(), prng_seed_gk_pad_,
+          lwe::ShellPrngType(params_.prng_type)));
 
   return gk;
 }
@@ -190,30 +211,89 @@ Client<RlweInteger>::GenerateGaloisKey(absl::string_view prng_seed_sk) const {
 template <typename RlweInteger>
 absl::StatusOr<rlwe::RnsGaloisKey<rlwe::MontgomeryInt<RlweInteger>>>
 Client<RlweInteger>::GenerateGaloisKey() const {
+  if (rns_gadget_ == nullptr) {
+    return absl::FailedPreconditionError(
+        "Gadget Galois keys require empty `ps`.");
+  }
   if (secret_key_ == nullptr) {
     return absl::InvalidArgumentError("Secret key not found.");
   }
 
   // Create a Galois key from the stored secret key and random pads.
-  RLWE_ASSIGN_OR_RETURN(std::vector<RnsPolynomial> gk_pads,
-                        RnsGaloisKey::SampleRandomPad(
-                            rns_gadget_.Dimension(), params_.log_n, rns_moduli_,
-                            prng_seed_gk_pad_, params_.prng_type));
+  RLWE_ASSIGN_OR_RETURN(
+      std::vector<RnsPolynomial> gk_pads,
+      RnsGaloisKey::SampleRandomPad(rns_gadget_->Dimension(), params_.log_n,
+                                    rns_moduli_, prng_seed_gk_pad_,
+                                    lwe::ShellPrngType(params_.prng_type)));
   RLWE_ASSIGN_OR_RETURN(
       RnsGaloisKey gk,
       RnsGaloisKey::CreateWithRandomPadForBfv(
           std::move(gk_pads), *secret_key_, /*power=*/5, params_.error_variance,
-          &rns_gadget_, prng_seed_gk_pad_, params_.prng_type));
+          rns_gadget_.get(), prng_seed_gk_pad_,
+          lwe::ShellPrngType(params_.prng_type)));
   return gk;
 }
 
+template <typename RlweInteger>
+absl::StatusOr<HybridGaloisKey<rlwe::MontgomeryInt<RlweInteger>>>
+Client<RlweInteger>::CreateHybridGaloisKey(
+    const RnsSecretKey& secret_key) const {
+  if (aux_moduli_.empty()) {
+    return absl::FailedPreconditionError(
+        "Hybrid Galois keys require non-empty `ps`.");
+  }
+
+  // The pads are expanded from the shared seed, and the errors are sampled
+  // with a fresh one.
+  RLWE_ASSIGN_OR_RETURN(std::vector<RnsPolynomial> gk_pads,
+                        HybridGaloisKey::SampleRandomPad(
+                            params_.log_n, rns_moduli_, aux_moduli_,
+                            prng_seed_gk_pad_,
+                            lwe::ShellPrngType(params_.prng_type)));
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_error,
+                        lwe::GeneratePrngSeed(params_.prng_type));
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng_error,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_error));
+  return HybridGaloisKey::CreateWithRandomPad(
+      std::move(gk_pads), secret_key, /*power=*/5, params_.error_variance,
+      rns_moduli_, aux_moduli_, prng_error.get());
+}
+
+template <typename RlweInteger>
+absl::StatusOr<HybridGaloisKey<rlwe::MontgomeryInt<RlweInteger>>>
+Client<RlweInteger>::GenerateHybridGaloisKey(
+    absl::string_view prng_seed_sk) const {
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng_sk,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_sk));
+  RLWE_ASSIGN_OR_RETURN(
+      RnsSecretKey secret_key,
+      RnsSecretKey::Sample(params_.log_n, params_.error_variance, rns_moduli_,
+                           prng_sk.get()));
+  return CreateHybridGaloisKey(secret_key);
+}
+
+template <typename RlweInteger>
+absl::StatusOr<HybridGaloisKey<rlwe::MontgomeryInt<RlweInteger>>>
+Client<RlweInteger>::GenerateHybridGaloisKey() const {
+  if (secret_key_ == nullptr) {
+    return absl::InvalidArgumentError("Secret key not found.");
+  }
+  return CreateHybridGaloisKey(*secret_key_);
+}
+
 template <typename RlweInteger>
 absl::StatusOr<std::vector<std::vector<RlweInteger>>>
 Client<RlweInteger>::Recover(const LinPirResponse& response,
-                             const LinPirResponse& response_pads) {
+                             const LinPirResponse& response_pads,
+                             int packing_factor) {
   if (secret_key_ == nullptr) {
     return absl::InvalidArgumentError("Secret key not found.");
   }
+  RLWE_RETURN_IF_ERROR(CheckPackingFactor(params_, packing_factor));
+  if (packing_factor > 1 && params_.block_packing_factor > 1) {
+    return absl::InvalidArgumentError(
+        "`packing_factor` must be 1 when `block_packing_factor` is set.");
+  }
   if (response.ct_inner_products_size() !=
       response_pads.ct_inner_products_size()) {
     return absl::InvalidArgumentError(
@@ -221,9 +301,27 @@ Client<RlweInteger>::Recover(const LinPirResponse& response,
         "products.");
   }
 
+  // The responses are over the leading `num_response_moduli` moduli, and are
+  // decrypted under the secret key reduced to these moduli.
+  int num_response_moduli = params_.num_response_moduli > 0
+                                ? params_.num_response_moduli
+                                : rns_moduli_.size();
+  std::vector<const PrimeModulus*> response_moduli(
+      rns_moduli_.begin(), rns_moduli_.begin() + num_response_moduli);
+  RnsSecretKey response_key = *secret_key_;
+  while (response_key.Level() + 1 > num_response_moduli) {
+    RLWE_RETURN_IF_ERROR(response_key.ModReduce());
+  }
+
+  // The slots of a group are split into ranges, one per packed matrix or
+  // packed block, and the p'th range holds the inner products of the matrix
+  // p / `block_packing_factor`.
   RlweInteger plaintext_modulus = rns_context_->PlaintextModulus();
+  int num_slots_per_group = 1 << (params_.log_n - 1);
+  int num_ranges = packing_factor * params_.block_packing_factor;
+  int packing_width = num_slots_per_group / num_ranges;
   std::vector<std::vector<RlweInteger>> results(
-      response.ct_inner_products_size());
+      response.ct_inner_products_size() * packing_factor);
 
   for (int i = 0; i < response.ct_inner_products_size(); ++i) {
     const auto& ct_inner_products = response.ct_inner_products(i);
@@ -234,37 +332,51 @@ Client<RlweInteger>::Recover(const LinPirResponse& response,
           "`response` and `response_pads` have mismatching number of blocks.");
     }
 
-    int num_slots_per_group = 1 << (params_.log_n - 1);
     int num_blocks = ct_inner_products.ct_b_blocks_size();
-    results[i].reserve(num_blocks * params_.rows_per_block);
+    for (int p = 0; p < packing_factor; ++p) {
+      results[i * packing_factor + p].reserve(
+          num_blocks * params_.block_packing_factor * params_.rows_per_block);
+    }
 
     for (int j = 0; j < num_blocks; ++j) {
       // Reconstruct the ciphertext from the 'a' part (pad) and 'b' part.
       RLWE_ASSIGN_OR_RETURN(
           auto ct_b, RnsPolynomial::Deserialize(
-                         ct_inner_products.ct_b_blocks(j), rns_moduli_));
+                         ct_inner_products.ct_b_blocks(j), response_moduli));
       RLWE_ASSIGN_OR_RETURN(
           auto ct_a, RnsPolynomial::Deserialize(
-                         pad_inner_products.ct_b_blocks(j), rns_moduli_));
+                         pad_inner_products.ct_b_blocks(j), response_moduli));
 
-      RnsCiphertext ct_block({std::move(ct_b), std::move(ct_a)}, rns_moduli_,
-                             /*power_of_s=*/1, /*error=*/0, &rns_error_params_,
-                             rns_context_);
+      RnsCiphertext ct_block({std::move(ct_b), std::move(ct_a)},
+                             response_moduli, /*power_of_s=*/1, /*error=*/0,
+                             &rns_error_params_, rns_context_);
 
       RLWE_ASSIGN_OR_RETURN(
           auto slots,
-          secret_key_->template DecryptBfv<Encoder>(ct_block, &encoder_));
-      std::vector<RlweInteger> values(params_.rows_per_block, 0);
-      // First half of the block
-      for (int k = 0; k < num_slots_per_group; ++k) {
-        values[k % params_.rows_per_block] += slots[k];
-      }
-      // Second half of the block
-      for (int k = 0; k < num_slots_per_group; ++k) {
-        values[k % params_.rows_per_block] += slots[num_slots_per_group + k];
-      }
-      for (auto const& value : values) {
-        results[i].push_back(value % plaintext_modulus);
+          response_key.template DecryptBfv<Encoder>(ct_block, &encoder_));
+      // The slots k in [p * packing_width, (p + 1) * packing_width) hold the
+      // partial inner products of the p'th packed matrix, or of the p'th
+      // packed block, whose rows follow those of the previous range.
+      // The sums are accumulated in 128 bits, as up to 2 * packing_width /
+      // rows_per_block slots, each below the plaintext modulus, may overflow
+      // `RlweInteger`.
+      for (int p = 0; p < num_ranges; ++p) {
+        std::vector<absl::uint128> values(params_.rows_per_block, 0);
+        int slot_begin = p * packing_width;
+        int slot_end = slot_begin + packing_width;
+        // First half of the block
+        for (int k = slot_begin; k < slot_end; ++k) {
+          values[k % params_.rows_per_block] += slots[k];
+        }
+        // Second half of the block
+        for (int k = slot_begin; k < slot_end; ++k) {
+          values[k % params_.rows_per_block] += slots[num_slots_per_group + k];
+        }
+        auto& result =
+            results[i * packing_factor + p / params_.block_packing_factor];
+        for (auto const& value : values) {
+          result.push_back(static_cast<RlweInteger>(value % plaintext_modulus));
+        }
       }
     }
   }
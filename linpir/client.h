@@ -24,6 +24,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
+#include "linpir/hybrid_galois_key.h"
 #include "linpir/parameters.h"
 #include "linpir/serialization.pb.h"
 #include "shell_encryption/montgomery.h"
@@ -56,6 +57,7 @@ class Client {
   using RnsErrorParams = rlwe::RnsErrorParams<ModularInt>;
   using Encoder = rlwe::FiniteFieldEncoder<ModularInt>;
   using PrimeModulus = rlwe::PrimeModulus<ModularInt>;
+  using HybridGaloisKey = linpir::HybridGaloisKey<ModularInt>;
 
   // Creates a Client given the PRNG seeds for sampling random polynomials
   // in the query ciphertext and the Galois key.
@@ -65,7 +67,8 @@ class Client {
       absl::string_view prng_seed_gk_pad);
 
   // Samples a fresh RLWE secret key which is cached in `secret_key_`, and
-  // returns a ciphertext encrypting the vector under `secret_key_`.
+  // returns a ciphertext encrypting the vector under `secret_key_`. The
+  // vector is repeated once per packed block if `block_packing_factor` is set.
   absl::StatusOr<RnsCiphertext> EncryptQuery(
       absl::Span<const RlweInteger> query_vector);
 
@@ -75,13 +78,22 @@ class Client {
       absl::string_view prng_seed_sk);
 
   // Returns a Galois key based on the secret key that is sampled using the
-  // given PRNG seed.
+  // given PRNG seed. Requires empty `ps` in the parameters.
   absl::StatusOr<RnsGaloisKey> GenerateGaloisKey(
       absl::string_view prng_seed_sk) const;
 
   // Returns a Galois key based on the cached `secret_key_`.
   absl::StatusOr<RnsGaloisKey> GenerateGaloisKey() const;
 
+  // Returns a Galois key for hybrid key switching based on the secret key that
+  // is sampled using the given PRNG seed. Requires non-empty `ps`.
+  absl::StatusOr<HybridGaloisKey> GenerateHybridGaloisKey(
+      absl::string_view prng_seed_sk) const;
+
+  // Returns a Galois key for hybrid key switching based on the cached
+  // `secret_key_`.
+  absl::StatusOr<HybridGaloisKey> GenerateHybridGaloisKey() const;
+
   // Returns a LinPIR request including the given ciphertext and Galois key.
   absl::StatusOr<LinPirRequest> GenerateRequest(const RnsCiphertext& ct_query,
                                                 const RnsGaloisKey& gk) const {
@@ -96,18 +108,45 @@ class Client {
     return request;
   }
 
+  // Returns a LinPIR request including the given ciphertext and hybrid Galois
+  // key, whose "b" components are over the main and the auxiliary moduli.
+  absl::StatusOr<LinPirRequest> GenerateRequest(
+      const RnsCiphertext& ct_query, const HybridGaloisKey& gk) const {
+    LinPirRequest request;
+    RLWE_ASSIGN_OR_RETURN(RnsPolynomial ct_query_b, ct_query.Component(0));
+    RLWE_ASSIGN_OR_RETURN(*request.mutable_ct_query_b(),
+                          ct_query_b.Serialize(rns_moduli_));
+    for (auto const& gk_key_b : gk.GetKeyB()) {
+      RLWE_ASSIGN_OR_RETURN(*request.add_gk_key_bs(),
+                            gk_key_b.Serialize(gk.KeyModuli()));
+    }
+    return request;
+  }
+
   // Returns a LinPIR request including ciphertext that encrypts `query_vector`
-  // under a fresh RLWE secret key and a corresponding Galois key.
+  // under a fresh RLWE secret key and a corresponding Galois key, which is a
+  // hybrid one if `ps` is set.
   absl::StatusOr<LinPirRequest> GenerateRequest(
       absl::Span<const RlweInteger> query_vector) {
     RLWE_ASSIGN_OR_RETURN(RnsCiphertext ct_query, EncryptQuery(query_vector));
+    if (!params_.ps.empty()) {
+      RLWE_ASSIGN_OR_RETURN(HybridGaloisKey gk, GenerateHybridGaloisKey());
+      return GenerateRequest(ct_query, gk);
+    }
     RLWE_ASSIGN_OR_RETURN(RnsGaloisKey gk, GenerateGaloisKey());
     return GenerateRequest(ct_query, gk);
   }
 
   // Recovers the inner products from `response`, one per database matrix.
+  // When each database packs `packing_factor` matrices (see packing.h), the
+  // inner products of the p'th matrix packed in the i'th database are at
+  // index i * packing_factor + p. With `block_packing_factor` set, the packed
+  // blocks of each matrix are recovered in row order, and `packing_factor`
+  // must be 1. The responses and their pads are over the leading
+  // `num_response_moduli` moduli if set.
   absl::StatusOr<std::vector<std::vector<RlweInteger>>> Recover(
-      const LinPirResponse& response, const LinPirResponse& response_pads);
+      const LinPirResponse& response, const LinPirResponse& response_pads,
+      int packing_factor = 1);
 
   absl::string_view PrngSeedForCiphertextRandomPads() const {
     return prng_seed_ct_pad_;
@@ -121,17 +160,23 @@ class Client {
                   std::string prng_seed_ct_pad, std::string prng_seed_gk_pad,
                   const RnsContext* rns_context,
                   std::vector<const PrimeModulus*> rns_moduli,
-                  RnsGadget rns_gadget, RnsErrorParams rns_error_params,
-                  Encoder encoder)
+                  std::vector<const PrimeModulus*> aux_moduli,
+                  std::unique_ptr<const RnsGadget> rns_gadget,
+                  RnsErrorParams rns_error_params, Encoder encoder)
       : params_(std::move(params)),
         prng_seed_ct_pad_(std::move(prng_seed_ct_pad)),
         prng_seed_gk_pad_(std::move(prng_seed_gk_pad)),
         rns_context_(rns_context),
         rns_moduli_(std::move(rns_moduli)),
+        aux_moduli_(std::move(aux_moduli)),
         rns_gadget_(std::move(rns_gadget)),
         rns_error_params_(std::move(rns_error_params)),
         encoder_(std::move(encoder)) {}
 
+  // Returns a hybrid Galois key under `secret_key`.
+  absl::StatusOr<HybridGaloisKey> CreateHybridGaloisKey(
+      const RnsSecretKey& secret_key) const;
+
   const RlweParameters<RlweInteger> params_;
 
   // PRNG seeds generated by the server to sample the "a" polynomials.
@@ -140,7 +185,9 @@ class Client {
 
   const RnsContext* rns_context_;
   const std::vector<const PrimeModulus*> rns_moduli_;
-  const RnsGadget rns_gadget_;
+  // The auxiliary moduli for hybrid key switching, and the gadget otherwise.
+  const std::vector<const PrimeModulus*> aux_moduli_;
+  const std::unique_ptr<const RnsGadget> rns_gadget_;
   const RnsErrorParams rns_error_params_;
 
   const Encoder encoder_;
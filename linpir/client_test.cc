@@ -15,6 +15,7 @@
 #include "linpir/client.h"
 
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -143,6 +144,26 @@ TEST_F(ClientTest, CreateFailsIfInvalidPrngType) {
                        HasSubstr("Invalid `prng_type`")));
 }
 
+TEST_F(ClientTest, CreateFailsIfAuxModuliMismatch) {
+  // The RNS context of the fixture has no auxiliary moduli.
+  RlweParameters<Integer> hybrid_params = kRlweParameters;
+  hybrid_params.ps = {36028797018652673ULL};
+  EXPECT_THAT(Client<Integer>::Create(hybrid_params, this->rns_context_.get(),
+                                      kPrngSeed0, kPrngSeed1),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must have `ps` as its auxiliary moduli")));
+}
+
+TEST_F(ClientTest, CreateFailsIfBlockPackingFactorIsInvalid) {
+  // Two packed blocks of 1024 rows take up all the slots of a group.
+  RlweParameters<Integer> invalid_params = kRlweParameters;
+  invalid_params.block_packing_factor = 4;
+  EXPECT_THAT(Client<Integer>::Create(invalid_params, this->rns_context_.get(),
+                                      kPrngSeed0, kPrngSeed1),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`packing_factor` must divide")));
+}
+
 TEST_F(ClientTest, CreateSucceeds) {
   ASSERT_OK_AND_ASSIGN(
       auto client,
@@ -250,6 +271,24 @@ TEST_F(ClientTest, RecoverFailsIfSecretKeyIsNotSet) {
                        HasSubstr("Secret key not found")));
 }
 
+TEST_F(ClientTest, RecoverFailsIfMatricesAndBlocksArePacked) {
+  RlweParameters<Integer> params = kRlweParameters;
+  params.block_packing_factor = 2;
+  ASSERT_OK_AND_ASSIGN(
+      auto client,
+      Client<Integer>::Create(params, this->rns_context_.get(),
+                              /*prng_seed_ct_pad=*/kPrngSeed0,
+                              /*prng_seed_gk_pad=*/kPrngSeed1));
+  std::vector<Integer> query(16, 1);
+  ASSERT_OK(client->EncryptQuery(query, kPrngSeed0).status());
+
+  LinPirResponse response;
+  LinPirResponse response_pads;
+  EXPECT_THAT(client->Recover(response, response_pads, /*packing_factor=*/2),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`packing_factor` must be 1")));
+}
+
 TEST_F(ClientTest, RecoverSucceeds) {
   ASSERT_OK_AND_ASSIGN(
       auto client,
@@ -312,6 +351,74 @@ LinPirResponse response;
   EXPECT_EQ(results[0], expected);
 }
 
+TEST(Client, RecoverDoesNotOverflowWith32BitIntegers) {
+  using ModularInt32 = rlwe::MontgomeryInt<Uint32>;
+  using RnsContext32 = rlwe::RnsContext<ModularInt32>;
+  using Encoder32 = rlwe::FiniteFieldEncoder<ModularInt32>;
+  using RnsSecretKey32 = rlwe::RnsRlweSecretKey<ModularInt32>;
+  using RnsErrorParams32 = rlwe::RnsErrorParams<ModularInt32>;
+
+  // A 30-bit plaintext modulus and blocks of 64 rows, so that every recovered
+  // value sums 64 slots close to 2^30, exceeding 32 bits.
+  const RlweParameters<Uint32> params{
+      .log_n = 12,
+      .qs = {1073479681, 1072496641, 1071513601},  // 90 bits
+      .ts = {1073692673},
+      .gadget_log_bs = {15, 15, 15},
+      .error_variance = 8,
+      .prng_type = kPrngType,
+      .rows_per_block = 64,
+  };
+  ASSERT_OK_AND_ASSIGN(auto rns_context,
+                       RnsContext32::CreateForBfvFiniteFieldEncoding(
+                           params.log_n, params.qs, /*ps=*/{}, params.ts[0]));
+  auto moduli = rns_context.MainPrimeModuli();
+  ASSERT_OK_AND_ASSIGN(auto encoder, Encoder32::Create(&rns_context));
+  ASSERT_OK_AND_ASSIGN(
+      auto error_params,
+      RnsErrorParams32::Create(params.log_n, moduli, {},
+                               std::log2(static_cast<double>(params.ts[0])),
+                               std::sqrt(params.error_variance)));
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<Uint32>::Create(params, &rns_context, kPrngSeed0,
+                                              kPrngSeed1));
+
+  // Set the secret key, and generate the same key to encrypt the response.
+  std::vector<Uint32> query(params.rows_per_block, 0);
+  ASSERT_OK(client->EncryptQuery(query, kPrngSeed0).status());
+  ASSERT_OK_AND_ASSIGN(auto prng_sk, Prng::Create(kPrngSeed0));
+  ASSERT_OK_AND_ASSIGN(
+      RnsSecretKey32 secret_key,
+      RnsSecretKey32::Sample(params.log_n, params.error_variance, moduli,
+                             prng_sk.get()));
+
+  Uint32 t = params.ts[0];
+  int num_slots = 1 << params.log_n;
+  std::vector<Uint32> slots(num_slots, t - 1);
+  auto expected = static_cast<Uint32>(
+      uint64_t{t - 1} * (num_slots / params.rows_per_block) % t);
+  ASSERT_OK_AND_ASSIGN(auto prng, Prng::Create(kPrngSeed1));
+  ASSERT_OK_AND_ASSIGN(auto ct_block,
+                       secret_key.template EncryptBfv<Encoder32>(
+                           slots, &encoder, &error_params, prng.get()));
+
+  LinPirResponse response;
+  LinPirResponse response_pads;
+  ASSERT_OK_AND_ASSIGN(auto ct_b, ct_block.Component(0));
+  ASSERT_OK_AND_ASSIGN(auto ct_a, ct_block.Component(1));
+  ASSERT_OK_AND_ASSIGN(
+      *response.add_ct_inner_products()->add_ct_b_blocks(),
+      ct_b.Serialize(moduli));
+  ASSERT_OK_AND_ASSIGN(
+      *response_pads.add_ct_inner_products()->add_ct_b_blocks(),
+      ct_a.Serialize(moduli));
+
+  ASSERT_OK_AND_ASSIGN(std::vector<std::vector<Uint32>> results,
+                       client->Recover(response, response_pads));
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0], ::testing::Each(expected));
+}
+
 }  // namespace
 }  // namespace linpir
 }  // namespace hintless_pir
@@ -14,7 +14,9 @@
 
 #include "linpir/database.h"
 
+#include <algorithm>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -22,6 +24,8 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
+#include "linpir/packing.h"
+#include "linpir/parallel.h"
 #include "linpir/parameters.h"
 #include "shell_encryption/montgomery.h"
 #include "shell_encryption/rns/rns_bfv_ciphertext.h"
@@ -34,8 +38,119 @@ namespace {
 
 inline int DivAndRoundUp(int x, int y) { return (x + y - 1) / y; }
 
+// Number of consecutive diagonals extracted together from a block.
+constexpr int kDiagonalTileSize = 16;
+
 }  // namespace
 
+template <typename RlweInteger>
+absl::StatusOr<
+    std::vector<rlwe::RnsPolynomial<rlwe::MontgomeryInt<RlweInteger>>>>
+Database<RlweInteger>::EncodeBlock(
+    const RlweParameters<RlweInteger>& rlwe_params, const Encoder& encoder,
+    absl::Span<const PrimeModulus* const> moduli,
+    absl::Span<const RlweInteger* const> rows, int num_cols) {
+  int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
+  int num_slots = num_slots_per_group * 2;
+  int num_rows = rows.size();
+  int rows_per_block = rlwe_params.rows_per_block;
+  int num_polynomials_per_block = rows_per_block / 2;
+  int width = num_slots_per_group / rlwe_params.block_packing_factor;
+
+  // Each block is a rectangle matrix divided into square submatrices of
+  // dimension rows_per_block * rows_per_block, and there are rows_per_block
+  // many diagonals. Since we assume data has number of columns < number of
+  // slots per group, we pack diagonals 0..(rows_per_block/2 - 1) in the first
+  // slot group, and rows_per_block/2..rows_per_block in the second group.
+  //
+  // *--@--*--@-. <- first group starts with the diagonal *, and the second
+  // -*--@--*--@.    group starts with the diagonal @, where . means empty
+  // --*--@--*--.    positions when extending the block into multiple square
+  // @--*--@--*-.    matrices.
+  // -@--*--@--*.
+  //
+  // Slot k of the j'th diagonal in the first group holds the entry at row
+  // k mod rows_per_block and column (k + j) mod num_slots_per_group, and in
+  // the second group at column (rows_per_block/2 + k + j) mod
+  // num_slots_per_group. With a block packing factor P, the slots of a group
+  // are split into P ranges of width w = num_slots_per_group / P as in
+  // packing.h: slot k in the p'th range holds row k mod rows_per_block of the
+  // p'th packed block, and the columns are taken mod w instead, so that the
+  // P blocks are summed into disjoint slots of the same diagonals.
+  //
+  // The diagonals are extracted in tiles of consecutive j's, so that for every
+  // slot k a tile reads consecutive entries of one row instead of one entry of
+  // a different row per diagonal. The row and column indices are advanced
+  // incrementally rather than computed with `%`.
+  int num_tiles = DivAndRoundUp(num_polynomials_per_block, kDiagonalTileSize);
+  std::vector<std::optional<RnsPolynomial>> encoded_diagonals(
+      num_polynomials_per_block);
+  RLWE_RETURN_IF_ERROR(ParallelFor(
+      num_tiles, rlwe_params.num_threads,
+      [&](int tile_begin, int tile_end) -> absl::Status {
+        // Slot values of the diagonals in a tile, reused across tiles.
+        std::vector<std::vector<RlweInteger>> tile_values(
+            kDiagonalTileSize, std::vector<RlweInteger>(num_slots));
+        for (int tile = tile_begin; tile < tile_end; ++tile) {
+          int j_begin = tile * kDiagonalTileSize;
+          int tile_size = std::min(kDiagonalTileSize,
+                                   num_polynomials_per_block - j_begin);
+          for (int group = 0; group < 2; ++group) {
+            int slot_offset = group * num_slots_per_group;
+            // Index into `rows` of the first row of the current slot range,
+            // and the position of slot k in that range.
+            int range_row_begin = 0;
+            int range_slot = 0;
+            int row_idx = 0;
+            int col_begin =
+                (group * num_polynomials_per_block + j_begin) % width;
+            for (int k = 0; k < num_slots_per_group; ++k) {
+              const RlweInteger* row = range_row_begin + row_idx < num_rows
+                                           ? rows[range_row_begin + row_idx]
+                                           : nullptr;
+              for (int t = 0; t < tile_size; ++t) {
+                int col_idx = col_begin + t;
+                if (col_idx >= width) {
+                  col_idx -= width;
+                }
+                tile_values[t][slot_offset + k] =
+                    (row != nullptr && col_idx < num_cols) ? row[col_idx] : 0;
+              }
+              if (++row_idx == rows_per_block) {
+                row_idx = 0;
+              }
+              if (++col_begin == width) {
+                col_begin = 0;
+              }
+              // When packing blocks, the width is a multiple of
+              // `rows_per_block`, so the next slot range starts at row 0 of
+              // the next packed block.
+              if (++range_slot == width) {
+                range_slot = 0;
+                range_row_begin += rows_per_block;
+              }
+            }
+          }
+          // Encode the whole tile once its slot values are extracted.
+          for (int t = 0; t < tile_size; ++t) {
+            RLWE_ASSIGN_OR_RETURN(
+                RnsPolynomial diagonal,
+                encoder.EncodeBfv(tile_values[t], moduli,
+                                  /*is_scaled=*/false));
+            encoded_diagonals[j_begin + t] = std::move(diagonal);
+          }
+        }
+        return absl::OkStatus();
+      }));
+
+  std::vector<RnsPolynomial> diagonals;
+  diagonals.reserve(num_polynomials_per_block);
+  for (std::optional<RnsPolynomial>& diagonal : encoded_diagonals) {
+    diagonals.push_back(*std::move(diagonal));
+  }
+  return diagonals;
+}
+
 template <typename RlweInteger>
 absl::StatusOr<std::unique_ptr<Database<RlweInteger>>>
 Database<RlweInteger>::Create(
@@ -54,60 +169,147 @@ Database<RlweInteger>::Create(
 
   int num_rows = data.size();
   int num_cols = data[0].size();
+  RLWE_RETURN_IF_ERROR(
+      CheckPackingFactor(rlwe_params, rlwe_params.block_packing_factor));
   int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
-  if (num_cols > num_slots_per_group) {
+  if (num_cols > num_slots_per_group / rlwe_params.block_packing_factor) {
     return absl::InvalidArgumentError(
         "`data` has more columns than supported by RLWE parameters.");
   }
 
-  int num_slots = num_slots_per_group * 2;
-  int num_polynomials_per_block = rlwe_params.rows_per_block / 2;
-  int num_blocks = DivAndRoundUp(num_rows, rlwe_params.rows_per_block);
-  std::vector<std::vector<RnsPolynomial>> diagonals(num_blocks);
+  // Each encoded block packs `block_packing_factor` blocks of rows.
+  int rows_per_encoded_block =
+      rlwe_params.rows_per_block * rlwe_params.block_packing_factor;
+  int num_blocks = DivAndRoundUp(num_rows, rows_per_encoded_block);
+  std::vector<std::vector<RnsPolynomial>> diagonals;
+  diagonals.reserve(num_blocks);
+  std::vector<const RlweInteger*> rows;
   for (int i = 0; i < num_blocks; ++i) {
-    diagonals[i].reserve(num_polynomials_per_block);
-
-    // Each block is a rectangle matrix divided into square submatrices of
-    // dimension rows_per_block * rows_per_block, and there are rows_per_block
-    // many diagonals. Since we assume data has number of columns < number of
-    // slots per group, we pack diagonals 0..(rows_per_block/2 - 1) in the first
-    // slot group, and rows_per_block/2..rows_per_block in the second group.
-    //
-    // *--@--*--@-. <- first group starts with the diagonal *, and the second
-    // -*--@--*--@.    group starts with the diagonal @, where . means empty
-    // --*--@--*--.    positions when extending the block into multiple square
-    // @--*--@--*-.    matrices.
-    // -@--*--@--*.
-    int row_idx_begin = i * rlwe_params.rows_per_block;
-    // The j'th and rows_per_block/2 + j'th diagonals.
-    for (int j = 0; j < num_polynomials_per_block; ++j) {
-      std::vector<RlweInteger> diag_values(num_slots, 0);
-      // first group of slots
-      for (int k = 0; k < num_slots_per_group; ++k) {
-        int row_idx = row_idx_begin + (k % rlwe_params.rows_per_block);
-        int col_idx = (k + j) % num_slots_per_group;
-        if (row_idx < num_rows && col_idx < num_cols) {  // valid indices
-          diag_values[k] = data[row_idx][col_idx];
-        }
-      }
-      // second group of slots
-      for (int k = 0; k < num_slots_per_group; ++k) {
-        int row_idx = row_idx_begin + (k % rlwe_params.rows_per_block);
-        int col_idx =
-            (rlwe_params.rows_per_block / 2 + k + j) % num_slots_per_group;
-        if (row_idx < num_rows && col_idx < num_cols) {  // valid indices
-          diag_values[num_slots_per_group + k] = data[row_idx][col_idx];
-        }
+    int row_begin = i * rows_per_encoded_block;
+    int row_end = std::min(row_begin + rows_per_encoded_block, num_rows);
+    rows.clear();
+    for (int r = row_begin; r < row_end; ++r) {
+      rows.push_back(data[r].data());
+    }
+    RLWE_ASSIGN_OR_RETURN(
+        std::vector<RnsPolynomial> block_diagonals,
+        EncodeBlock(rlwe_params, encoder, moduli, rows, num_cols));
+    diagonals.push_back(std::move(block_diagonals));
+  }
+  return absl::WrapUnique(new Database<RlweInteger>(
+      rns_context, std::move(moduli), std::move(encoder), std::move(diagonals),
+      rlwe_params.num_threads));
+}
+
+template <typename RlweInteger>
+absl::StatusOr<std::unique_ptr<Database<RlweInteger>>>
+Database<RlweInteger>::CreateFromRowMajor(
+    const RlweParameters<RlweInteger>& rlwe_params,
+    const RnsContext* rns_context, absl::Span<const RlweInteger> data,
+    int num_rows, int num_cols) {
+  if (rns_context == nullptr) {
+    return absl::InvalidArgumentError("`rns_context` must not be null.");
+  }
+  if (num_rows <= 0 || num_cols <= 0) {
+    return absl::InvalidArgumentError(
+        "`num_rows` and `num_cols` must be positive.");
+  }
+  if (data.size() != static_cast<size_t>(num_rows) * num_cols) {
+    return absl::InvalidArgumentError(
+        "`data` must contain `num_rows` * `num_cols` values.");
+  }
+  RLWE_RETURN_IF_ERROR(
+      CheckPackingFactor(rlwe_params, rlwe_params.block_packing_factor));
+  int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
+  if (num_cols > num_slots_per_group / rlwe_params.block_packing_factor) {
+    return absl::InvalidArgumentError(
+        "`num_cols` is larger than supported by RLWE parameters.");
+  }
+
+  std::vector<const PrimeModulus*> moduli = rns_context->MainPrimeModuli();
+  RLWE_ASSIGN_OR_RETURN(Encoder encoder, Encoder::Create(rns_context));
+
+  // Each encoded block packs `block_packing_factor` blocks of rows.
+  int rows_per_encoded_block =
+      rlwe_params.rows_per_block * rlwe_params.block_packing_factor;
+  int num_blocks = DivAndRoundUp(num_rows, rows_per_encoded_block);
+  std::vector<std::vector<RnsPolynomial>> diagonals;
+  diagonals.reserve(num_blocks);
+  std::vector<const RlweInteger*> rows;
+  for (int i = 0; i < num_blocks; ++i) {
+    int row_begin = i * rows_per_encoded_block;
+    int row_end = std::min(row_begin + rows_per_encoded_block, num_rows);
+    rows.clear();
+    for (int r = row_begin; r < row_end; ++r) {
+      rows.push_back(data.data() + static_cast<size_t>(r) * num_cols);
+    }
+    RLWE_ASSIGN_OR_RETURN(
+        std::vector<RnsPolynomial> block_diagonals,
+        EncodeBlock(rlwe_params, encoder, moduli, rows, num_cols));
+    diagonals.push_back(std::move(block_diagonals));
+  }
+  return absl::WrapUnique(new Database<RlweInteger>(
+      rns_context, std::move(moduli), std::move(encoder), std::move(diagonals),
+      rlwe_params.num_threads));
+}
+
+template <typename RlweInteger>
+absl::StatusOr<std::unique_ptr<Database<RlweInteger>>>
+Database<RlweInteger>::CreateFromRowBlocks(
+    const RlweParameters<RlweInteger>& rlwe_params,
+    const RnsContext* rns_context, int num_rows, int num_cols,
+    RowBlockSource row_source) {
+  if (rns_context == nullptr) {
+    return absl::InvalidArgumentError("`rns_context` must not be null.");
+  }
+  if (num_rows <= 0 || num_cols <= 0) {
+    return absl::InvalidArgumentError(
+        "`num_rows` and `num_cols` must be positive.");
+  }
+  RLWE_RETURN_IF_ERROR(
+      CheckPackingFactor(rlwe_params, rlwe_params.block_packing_factor));
+  int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
+  if (num_cols > num_slots_per_group / rlwe_params.block_packing_factor) {
+    return absl::InvalidArgumentError(
+        "`num_cols` is larger than supported by RLWE parameters.");
+  }
+
+  std::vector<const PrimeModulus*> moduli = rns_context->MainPrimeModuli();
+  RLWE_ASSIGN_OR_RETURN(Encoder encoder, Encoder::Create(rns_context));
+
+  // Each encoded block packs `block_packing_factor` blocks of rows.
+  int rows_per_encoded_block =
+      rlwe_params.rows_per_block * rlwe_params.block_packing_factor;
+  int num_blocks = DivAndRoundUp(num_rows, rows_per_encoded_block);
+  std::vector<std::vector<RnsPolynomial>> diagonals;
+  diagonals.reserve(num_blocks);
+  std::vector<const RlweInteger*> row_ptrs;
+  for (int i = 0; i < num_blocks; ++i) {
+    int row_begin = i * rows_per_encoded_block;
+    int row_end = std::min(row_begin + rows_per_encoded_block, num_rows);
+    RLWE_ASSIGN_OR_RETURN(std::vector<std::vector<RlweInteger>> rows,
+                          row_source(row_begin, row_end));
+    if (rows.size() != row_end - row_begin) {
+      return absl::InvalidArgumentError(
+          "`row_source` returned an incorrect number of rows.");
+    }
+    row_ptrs.clear();
+    for (const std::vector<RlweInteger>& row : rows) {
+      if (row.size() != num_cols) {
+        return absl::InvalidArgumentError(
+            "`row_source` returned a row with an incorrect number of "
+            "columns.");
       }
-      RLWE_ASSIGN_OR_RETURN(
-          RnsPolynomial diagonal,
-          encoder.EncodeBfv(diag_values, moduli, /*is_scaled=*/false));
-      diagonals[i].push_back(std::move(diagonal));
+      row_ptrs.push_back(row.data());
     }
+    RLWE_ASSIGN_OR_RETURN(
+        std::vector<RnsPolynomial> block_diagonals,
+        EncodeBlock(rlwe_params, encoder, moduli, row_ptrs, num_cols));
+    diagonals.push_back(std::move(block_diagonals));
   }
-  return absl::WrapUnique(
-      new Database<RlweInteger>(rns_context, std::move(moduli),
-                                std::move(encoder), std::move(diagonals)));
+  return absl::WrapUnique(new Database<RlweInteger>(
+      rns_context, std::move(moduli), std::move(encoder), std::move(diagonals),
+      rlwe_params.num_threads));
 }
 
 template <typename RlweInteger>
@@ -145,13 +347,31 @@ absl::Status Database<RlweInteger>::Preprocess(
 
   pad_inner_products_.clear();
   pad_inner_products_.reserve(diagonals_.size());
+  int num_diagonals = pad_rotated_queries.size();
   for (int i = 0; i < diagonals_.size(); ++i) {
-    RLWE_ASSIGN_OR_RETURN(
-        RnsPolynomial pad_inner_product,
-        pad_rotated_queries[0].Mul(diagonals_[i][0], moduli_));
-    for (int j = 1; j < pad_rotated_queries.size(); ++j) {
-      RLWE_RETURN_IF_ERROR(pad_inner_product.FusedMulAddInPlace(
-          pad_rotated_queries[j], diagonals_[i][j], moduli_));
+    // Each thread sums the products over a range of diagonals, and the partial
+    // sum is stored at the index of the first diagonal in the range.
+    std::vector<std::optional<RnsPolynomial>> partial_sums(num_diagonals);
+    RLWE_RETURN_IF_ERROR(ParallelFor(
+        num_diagonals, num_threads_,
+        [&](int j_begin, int j_end) -> absl::Status {
+          RLWE_ASSIGN_OR_RETURN(
+              RnsPolynomial partial_sum,
+              pad_rotated_queries[j_begin].Mul(diagonals_[i][j_begin],
+                                               moduli_));
+          for (int j = j_begin + 1; j < j_end; ++j) {
+            RLWE_RETURN_IF_ERROR(partial_sum.FusedMulAddInPlace(
+                pad_rotated_queries[j], diagonals_[i][j], moduli_));
+          }
+          partial_sums[j_begin] = std::move(partial_sum);
+          return absl::OkStatus();
+        }));
+    RnsPolynomial pad_inner_product = *std::move(partial_sums[0]);
+    for (int j = 1; j < num_diagonals; ++j) {
+      if (partial_sums[j].has_value()) {
+        RLWE_RETURN_IF_ERROR(
+            pad_inner_product.AddInPlace(*partial_sums[j], moduli_));
+      }
     }
     pad_inner_products_.push_back(std::move(pad_inner_product));
   }
@@ -19,6 +19,7 @@
 #include <memory>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/span.h"
@@ -52,8 +53,31 @@ class Database {
       const RnsContext* rns_context,
       const std::vector<std::vector<RlweInteger>>& data);
 
+  // Creates a database from the `num_rows` * `num_cols` matrix stored in
+  // row-major order in `data`, without copying its rows.
+  static absl::StatusOr<std::unique_ptr<Database>> CreateFromRowMajor(
+      const RlweParameters<RlweInteger>& rlwe_params,
+      const RnsContext* rns_context, absl::Span<const RlweInteger> data,
+      int num_rows, int num_cols);
+
+  // Returns the rows in [row_begin, row_end) of a database matrix.
+  using RowBlockSource =
+      absl::FunctionRef<absl::StatusOr<std::vector<std::vector<RlweInteger>>>(
+          int row_begin, int row_end)>;
+
+  // Creates a database of `num_rows` * `num_cols` values, which requests its
+  // rows from `row_source` one block of `rows_per_block` *
+  // `block_packing_factor` rows at a time. Each block is encoded into
+  // diagonals and released before the next block is requested, so the plain
+  // values of at most one block are held in memory.
+  static absl::StatusOr<std::unique_ptr<Database>> CreateFromRowBlocks(
+      const RlweParameters<RlweInteger>& rlwe_params,
+      const RnsContext* rns_context, int num_rows, int num_cols,
+      RowBlockSource row_source);
+
   // Preprocess the database with the given random pads to speedup inner product
-  // computation when query is available.
+  // computation when query is available. The products with the diagonals of a
+  // block are computed with `rlwe_params.num_threads` threads.
   absl::Status Preprocess(absl::Span<const RnsPolynomial> pad_rotated_queries);
 
   // Compute the matrix-vector product with the encrypted query vector.
@@ -77,11 +101,23 @@ class Database {
  private:
   explicit Database(const RnsContext* rns_context,
                     std::vector<const PrimeModulus*> moduli, Encoder encoder,
-                    std::vector<std::vector<RnsPolynomial>> diagonals)
+                    std::vector<std::vector<RnsPolynomial>> diagonals,
+                    int num_threads)
       : rns_context_(rns_context),
         moduli_(std::move(moduli)),
         encoder_(std::move(encoder)),
-        diagonals_(std::move(diagonals)) {}
+        diagonals_(std::move(diagonals)),
+        num_threads_(num_threads) {}
+
+  // Returns the diagonals of the block whose rows start at `rows`, each with
+  // `num_cols` values; the block is padded with zero rows to `rows_per_block`
+  // * `block_packing_factor` rows, and the p'th `rows_per_block` rows are
+  // packed into the p'th range of slots. The diagonals are encoded with
+  // `rlwe_params.num_threads` threads.
+  static absl::StatusOr<std::vector<RnsPolynomial>> EncodeBlock(
+      const RlweParameters<RlweInteger>& rlwe_params, const Encoder& encoder,
+      absl::Span<const PrimeModulus* const> moduli,
+      absl::Span<const RlweInteger* const> rows, int num_cols);
 
   const RnsContext* rns_context_;
 
@@ -93,6 +129,10 @@ class Database {
   // is stored as a vector of diagonals packed in RnsPolynomial.
   std::vector<std::vector<RnsPolynomial>> diagonals_;
 
+  // Number of threads encoding the diagonals of a block and computing their
+  // inner products with the random pads in `Preprocess()`.
+  const int num_threads_;
+
   // The random pads, i.e. the "a" parts, of the ciphertexts encrypting the
   // matrix-vector products between the blocks of diagonals and the query vector
   std::vector<RnsPolynomial> pad_inner_products_;
@@ -24,6 +24,7 @@
 #include "absl/strings/string_view.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "linpir/packing.h"
 #include "linpir/parameters.h"
 #include "shell_encryption/montgomery.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
@@ -145,6 +146,26 @@ TEST_F(DatabaseTest, CreateFailsIfDataHasTooManyColumns) {
                        HasSubstr("`data` has more columns than")));
 }
 
+TEST_F(DatabaseTest, CreateFailsIfDataHasTooManyColumnsForBlockPacking) {
+  // Each of the two packed blocks gets half of the slots of a group.
+  this->params_.block_packing_factor = 2;
+  int num_slots_per_group = 1 << (kRlweParameters.log_n - 1);
+  std::vector<Integer> row(num_slots_per_group / 2 + 1, 0);
+  EXPECT_THAT(Database<Integer>::Create(this->params_,
+                                        this->rns_context_.get(), {row}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`data` has more columns than")));
+}
+
+TEST_F(DatabaseTest, CreateFailsIfBlockPackingFactorIsInvalid) {
+  this->params_.block_packing_factor = 3;
+  auto data = SampleMatrix(kNumRows, 16, 16);
+  EXPECT_THAT(
+      Database<Integer>::Create(this->params_, this->rns_context_.get(), data),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("`packing_factor` must divide")));
+}
+
 TEST_F(DatabaseTest, CreateDatabase) {
   auto data = SampleMatrix(kNumRows, kNumCols, 16);
   ASSERT_OK_AND_ASSIGN(
@@ -157,6 +178,179 @@ TEST_F(DatabaseTest, CreateDatabase) {
   EXPECT_EQ(database->NumDiagonalsPerBlock(), expected_num_diags_per_block);
 }
 
+TEST_F(DatabaseTest, CreateFromRowBlocksFailsIfRowSourceReturnsWrongRows) {
+  auto data = SampleMatrix(kNumRows, kNumCols, 16);
+  EXPECT_THAT(Database<Integer>::CreateFromRowBlocks(
+                  this->params_, this->rns_context_.get(), kNumRows + 1,
+                  kNumCols,
+                  [&](int row_begin, int row_end) { return data; }),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("incorrect number of rows")));
+  EXPECT_THAT(Database<Integer>::CreateFromRowBlocks(
+                  this->params_, this->rns_context_.get(), kNumRows,
+                  kNumCols + 1,
+                  [&](int row_begin, int row_end) { return data; }),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("incorrect number of columns")));
+}
+
+TEST_F(DatabaseTest, CreateFromRowBlocksMatchesCreate) {
+  // Use small blocks so that the database spans several of them.
+  this->params_.rows_per_block = 8;
+  auto data = SampleMatrix(kNumRows + 3, kNumCols, 16);
+  ASSERT_OK_AND_ASSIGN(
+      auto database,
+      Database<Integer>::Create(this->params_, this->rns_context_.get(), data));
+  std::vector<std::pair<int, int>> requested_blocks;
+  ASSERT_OK_AND_ASSIGN(
+      auto streamed_database,
+      Database<Integer>::CreateFromRowBlocks(
+          this->params_, this->rns_context_.get(), data.size(), kNumCols,
+          [&](int row_begin, int row_end) {
+            requested_blocks.push_back({row_begin, row_end});
+            return std::vector<std::vector<Integer>>(
+                data.begin() + row_begin, data.begin() + row_end);
+          }));
+  ASSERT_EQ(streamed_database->NumBlocks(), database->NumBlocks());
+  ASSERT_EQ(streamed_database->NumDiagonalsPerBlock(),
+            database->NumDiagonalsPerBlock());
+  ASSERT_EQ(requested_blocks.size(), database->NumBlocks());
+  EXPECT_EQ(requested_blocks.back().second, data.size());
+
+  // Both databases must give the same products with random pads.
+  ASSERT_OK_AND_ASSIGN(auto prng, Prng::Create(kPrngSeed));
+  std::vector<RnsPolynomial> pads;
+  for (int j = 0; j < database->NumDiagonalsPerBlock(); ++j) {
+    ASSERT_OK_AND_ASSIGN(auto pad,
+                         RnsPolynomial::SampleUniform(
+                             this->params_.log_n, prng.get(), this->moduli_));
+    pads.push_back(std::move(pad));
+  }
+  ASSERT_OK(database->Preprocess(pads));
+  ASSERT_OK(streamed_database->Preprocess(pads));
+  for (int i = 0; i < database->NumBlocks(); ++i) {
+    EXPECT_EQ(streamed_database->GetPadInnerProducts()[i],
+              database->GetPadInnerProducts()[i]);
+  }
+}
+
+TEST_F(DatabaseTest, CreateFromRowMajorFailsIfDataHasWrongSize) {
+  std::vector<Integer> data(kNumRows * kNumCols - 1, 0);
+  EXPECT_THAT(Database<Integer>::CreateFromRowMajor(
+                  this->params_, this->rns_context_.get(), data, kNumRows,
+                  kNumCols),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`num_rows` * `num_cols` values")));
+}
+
+TEST_F(DatabaseTest, CreateFromRowMajorMatchesCreate) {
+  // A block size that does not divide the number of slots, so that the
+  // diagonals wrap around the rows and the columns at different slots, and
+  // more diagonals than fit in one tile.
+  this->params_.rows_per_block = 40;
+  this->params_.num_threads = 2;
+  int num_rows = 2 * this->params_.rows_per_block + 3;
+  auto data = SampleMatrix(num_rows, kNumCols, 16);
+  std::vector<Integer> row_major;
+  for (const auto& row : data) {
+    row_major.insert(row_major.end(), row.begin(), row.end());
+  }
+  ASSERT_OK_AND_ASSIGN(
+      auto database,
+      Database<Integer>::Create(this->params_, this->rns_context_.get(), data));
+  ASSERT_OK_AND_ASSIGN(auto row_major_database,
+                       Database<Integer>::CreateFromRowMajor(
+                           this->params_, this->rns_context_.get(), row_major,
+                           num_rows, kNumCols));
+  ASSERT_EQ(row_major_database->NumBlocks(), database->NumBlocks());
+  ASSERT_EQ(row_major_database->NumDiagonalsPerBlock(),
+            database->NumDiagonalsPerBlock());
+
+  // Both databases must give the same products with random pads.
+  ASSERT_OK_AND_ASSIGN(auto prng, Prng::Create(kPrngSeed));
+  std::vector<RnsPolynomial> pads;
+  for (int j = 0; j < database->NumDiagonalsPerBlock(); ++j) {
+    ASSERT_OK_AND_ASSIGN(auto pad,
+                         RnsPolynomial::SampleUniform(
+                             this->params_.log_n, prng.get(), this->moduli_));
+    pads.push_back(std::move(pad));
+  }
+  ASSERT_OK(database->Preprocess(pads));
+  ASSERT_OK(row_major_database->Preprocess(pads));
+  for (int i = 0; i < database->NumBlocks(); ++i) {
+    EXPECT_EQ(row_major_database->GetPadInnerProducts()[i],
+              database->GetPadInnerProducts()[i]);
+  }
+}
+
+TEST_F(DatabaseTest, BlockPackingMatchesPackedRows) {
+  // Pack four blocks of 8 rows into the slots of every encoded block, over
+  // three encoded blocks with a partial last one.
+  constexpr int kBlockPackingFactor = 4;
+  this->params_.rows_per_block = 8;
+  int rows_per_block = this->params_.rows_per_block;
+  int num_slots_per_group = 1 << (this->params_.log_n - 1);
+  int num_cols = num_slots_per_group / kBlockPackingFactor - 12;
+  int num_rows = 2 * kBlockPackingFactor * rows_per_block + 3;
+  auto data = SampleMatrix(num_rows, num_cols, 16);
+
+  RlweParameters<Integer> packed_params = this->params_;
+  packed_params.block_packing_factor = kBlockPackingFactor;
+  std::vector<std::pair<int, int>> requested_blocks;
+  ASSERT_OK_AND_ASSIGN(
+      auto database,
+      Database<Integer>::CreateFromRowBlocks(
+          packed_params, this->rns_context_.get(), num_rows, num_cols,
+          [&](int row_begin, int row_end) {
+            requested_blocks.push_back({row_begin, row_end});
+            return std::vector<std::vector<Integer>>(
+                data.begin() + row_begin, data.begin() + row_end);
+          }));
+  ASSERT_EQ(database->NumBlocks(), 3);
+  ASSERT_EQ(requested_blocks.size(), 3);
+  EXPECT_EQ(requested_blocks[1].first, kBlockPackingFactor * rows_per_block);
+  EXPECT_EQ(requested_blocks.back().second, num_rows);
+
+  // The same blocks packed as matrices with `PackRow`: row r of the i'th
+  // block of the packed matrix holds row r of the blocks i * P + p.
+  std::vector<std::vector<Integer>> packed_rows;
+  for (int i = 0; i < database->NumBlocks() * rows_per_block; ++i) {
+    int block = i / rows_per_block;
+    int row_in_block = i % rows_per_block;
+    std::vector<const Integer*> rows(kBlockPackingFactor, nullptr);
+    for (int p = 0; p < kBlockPackingFactor; ++p) {
+      int row =
+          (block * kBlockPackingFactor + p) * rows_per_block + row_in_block;
+      if (row < num_rows) {
+        rows[p] = data[row].data();
+      }
+    }
+    packed_rows.push_back(PackRow<Integer>(
+        this->params_, kBlockPackingFactor, i, rows, num_cols));
+  }
+  ASSERT_OK_AND_ASSIGN(auto packed_row_database,
+                       Database<Integer>::Create(
+                           this->params_, this->rns_context_.get(),
+                           packed_rows));
+  ASSERT_EQ(packed_row_database->NumBlocks(), database->NumBlocks());
+
+  // Both databases must give the same products with random pads.
+  ASSERT_OK_AND_ASSIGN(auto prng, Prng::Create(kPrngSeed));
+  std::vector<RnsPolynomial> pads;
+  for (int j = 0; j < database->NumDiagonalsPerBlock(); ++j) {
+    ASSERT_OK_AND_ASSIGN(auto pad,
+                         RnsPolynomial::SampleUniform(
+                             this->params_.log_n, prng.get(), this->moduli_));
+    pads.push_back(std::move(pad));
+  }
+  ASSERT_OK(database->Preprocess(pads));
+  ASSERT_OK(packed_row_database->Preprocess(pads));
+  for (int i = 0; i < database->NumBlocks(); ++i) {
+    EXPECT_EQ(packed_row_database->GetPadInnerProducts()[i],
+              database->GetPadInnerProducts()[i]);
+  }
+}
+
 TEST_F(DatabaseTest, InnerProductFailsIfIncorrectNumberOfQueryCiphertexts) {
   std::vector<Integer> row(1, 0);
   ASSERT_OK_AND_ASSIGN(auto database,
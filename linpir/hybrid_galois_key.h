@@ -0,0 +1,254 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_LINPIR_HYBRID_GALOIS_KEY_H_
+#define HINTLESS_PIR_LINPIR_HYBRID_GALOIS_KEY_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "linpir/rns_utils.h"
+#include "lwe/prng_type.h"
+#include "shell_encryption/prng/prng.h"
+#include "shell_encryption/rns/rns_modulus.h"
+#include "shell_encryption/rns/rns_polynomial.h"
+#include "shell_encryption/rns/rns_secret_key.h"
+#include "shell_encryption/status_macros.h"
+
+namespace hintless_pir {
+namespace linpir {
+
+// A Galois key for the automorphism X -> X^power, which switches ciphertexts
+// under s(X^power) to ciphertexts under s by hybrid key switching. The "a"
+// component of a ciphertext is split into its residues modulo the main primes
+// q_j of Q, and the j'th key component encrypts (P mod q_j) * s(X^power) on the
+// residue q_j modulo Q * P, where P is the product of the auxiliary primes. The
+// sum of the products of the residues with the key components is then divided
+// by P. Compared to a gadget key, there is one key component per main prime,
+// each of which is larger by the auxiliary primes.
+template <typename ModularInt>
+class HybridGaloisKey {
+ public:
+  using RnsPolynomial = rlwe::RnsPolynomial<ModularInt>;
+  using RnsSecretKey = rlwe::RnsRlweSecretKey<ModularInt>;
+  using PrimeModulus = rlwe::PrimeModulus<ModularInt>;
+
+  // Returns the "a" components of a key, one per main modulus, which are
+  // uniformly random polynomials over the main and the auxiliary moduli
+  // expanded from `prng_seed`.
+  static absl::StatusOr<std::vector<RnsPolynomial>> SampleRandomPad(
+      int log_n, absl::Span<const PrimeModulus* const> main_moduli,
+      absl::Span<const PrimeModulus* const> aux_moduli,
+      absl::string_view prng_seed, rlwe::PrngType prng_type) {
+    RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng,
+                          lwe::CreatePrng(prng_type, prng_seed));
+    std::vector<const PrimeModulus*> key_moduli =
+        ConcatModuli(main_moduli, aux_moduli);
+    std::vector<RnsPolynomial> key_as;
+    key_as.reserve(main_moduli.size());
+    for (int j = 0; j < main_moduli.size(); ++j) {
+      RLWE_ASSIGN_OR_RETURN(
+          RnsPolynomial key_a,
+          RnsPolynomial::SampleUniform(log_n, prng.get(), key_moduli));
+      key_as.push_back(std::move(key_a));
+    }
+    return key_as;
+  }
+
+  // Creates a key under `secret_key` with the given "a" components, sampling
+  // the errors with `prng_error`.
+  static absl::StatusOr<HybridGaloisKey> CreateWithRandomPad(
+      std::vector<RnsPolynomial> key_as, const RnsSecretKey& secret_key,
+      int power, double error_variance,
+      absl::Span<const PrimeModulus* const> main_moduli,
+      absl::Span<const PrimeModulus* const> aux_moduli,
+      rlwe::SecurePrng* prng_error) {
+    if (key_as.size() != main_moduli.size()) {
+      return absl::InvalidArgumentError(
+          "`key_as` must contain one polynomial per main modulus.");
+    }
+    RLWE_ASSIGN_OR_RETURN(auto mod_down,
+                          RnsModDown<ModularInt>::Create(main_moduli,
+                                                         aux_moduli));
+    std::vector<const PrimeModulus*> key_moduli =
+        ConcatModuli(main_moduli, aux_moduli);
+
+    // Lift the small coefficients of s to the auxiliary moduli.
+    RnsPolynomial key = secret_key.Key();
+    if (key.IsNttForm()) {
+      RLWE_RETURN_IF_ERROR(key.ConvertToCoeffForm(main_moduli));
+    }
+    RLWE_ASSIGN_OR_RETURN(
+        RnsPolynomial s,
+        ExtendResidue<ModularInt>(key, /*index=*/0, main_moduli, key_moduli));
+    RLWE_RETURN_IF_ERROR(s.ConvertToNttForm(key_moduli));
+    RLWE_ASSIGN_OR_RETURN(RnsPolynomial s_sub, s.Substitute(power, key_moduli));
+
+    // key_b[j] = -key_a[j] * s + e[j] + (P mod q_j) * s(X^power) mod q_j.
+    using Int = typename ModularInt::Int;
+    std::vector<RnsPolynomial> key_bs;
+    key_bs.reserve(main_moduli.size());
+    for (int j = 0; j < main_moduli.size(); ++j) {
+      RLWE_ASSIGN_OR_RETURN(RnsPolynomial key_b,
+                            key_as[j].Mul(s, key_moduli));
+      RLWE_RETURN_IF_ERROR(key_b.NegateInPlace(key_moduli));
+      RLWE_ASSIGN_OR_RETURN(
+          RnsPolynomial error,
+          SampleCenteredBinomial<ModularInt>(key.LogN(), error_variance,
+                                             key_moduli, prng_error));
+      RLWE_RETURN_IF_ERROR(key_b.AddInPlace(error, key_moduli));
+
+      const auto* params = main_moduli[j]->ModParams();
+      Int aux_product = 1;
+      for (const PrimeModulus* aux_modulus : aux_moduli) {
+        aux_product = internal::MulMod<Int>(
+            aux_product, aux_modulus->ModParams()->modulus % params->modulus,
+            params->modulus);
+      }
+      RLWE_ASSIGN_OR_RETURN(ModularInt gadget,
+                            ModularInt::ImportInt(aux_product, params));
+      std::vector<std::vector<ModularInt>> coeff_vectors = key_b.Coeffs();
+      for (int c = 0; c < coeff_vectors[j].size(); ++c) {
+        coeff_vectors[j][c] = coeff_vectors[j][c].Add(
+            s_sub.Coeffs()[j][c].Mul(gadget, params), params);
+      }
+      RLWE_ASSIGN_OR_RETURN(key_b, RnsPolynomial::Create(
+                                       std::move(coeff_vectors),
+                                       /*is_ntt=*/true));
+      key_bs.push_back(std::move(key_b));
+    }
+    return HybridGaloisKey(std::move(key_as), std::move(key_bs), power,
+                           std::move(key_moduli), std::move(mod_down));
+  }
+
+  // Creates a key from its "a" and "b" components, e.g. on the server from
+  // the expanded pads and the "b" components sent by the client.
+  static absl::StatusOr<HybridGaloisKey> CreateFromKeyComponents(
+      std::vector<RnsPolynomial> key_as, std::vector<RnsPolynomial> key_bs,
+      int power, absl::Span<const PrimeModulus* const> main_moduli,
+      absl::Span<const PrimeModulus* const> aux_moduli) {
+    if (key_as.size() != main_moduli.size() ||
+        key_bs.size() != main_moduli.size()) {
+      return absl::InvalidArgumentError(
+          "`key_as` and `key_bs` must contain one polynomial per main "
+          "modulus.");
+    }
+    RLWE_ASSIGN_OR_RETURN(auto mod_down,
+                          RnsModDown<ModularInt>::Create(main_moduli,
+                                                         aux_moduli));
+    return HybridGaloisKey(std::move(key_as), std::move(key_bs), power,
+                           ConcatModuli(main_moduli, aux_moduli),
+                           std::move(mod_down));
+  }
+
+  // Returns the residues of `a` modulo the main moduli, each lifted to the
+  // main and the auxiliary moduli in NTT form. `a` must be in coefficient form.
+  static absl::StatusOr<std::vector<RnsPolynomial>> Decompose(
+      const RnsPolynomial& a, absl::Span<const PrimeModulus* const> main_moduli,
+      absl::Span<const PrimeModulus* const> aux_moduli) {
+    std::vector<const PrimeModulus*> key_moduli =
+        ConcatModuli(main_moduli, aux_moduli);
+    std::vector<RnsPolynomial> digits;
+    digits.reserve(main_moduli.size());
+    for (int j = 0; j < main_moduli.size(); ++j) {
+      RLWE_ASSIGN_OR_RETURN(
+          RnsPolynomial digit,
+          ExtendResidue<ModularInt>(a, j, main_moduli, key_moduli));
+      RLWE_RETURN_IF_ERROR(digit.ConvertToNttForm(key_moduli));
+      digits.push_back(std::move(digit));
+    }
+    return digits;
+  }
+
+  // Returns the inner product of `digits` with the "a" components of the key
+  // divided by P, i.e. the "a" component of the switched ciphertext.
+  absl::StatusOr<RnsPolynomial> ApplyToComponentA(
+      absl::Span<const RnsPolynomial> digits) const {
+    return ApplyTo(digits, key_as_);
+  }
+
+  // Returns `b_sub` plus the inner product of `digits` with the "b" components
+  // of the key divided by P, i.e. the "b" component of the switched ciphertext
+  // whose "b" component under s(X^power) is `b_sub`.
+  absl::StatusOr<RnsPolynomial> ApplyToComponentB(
+      RnsPolynomial b_sub, absl::Span<const RnsPolynomial> digits) const {
+    RLWE_ASSIGN_OR_RETURN(RnsPolynomial b_switched, ApplyTo(digits, key_bs_));
+    RLWE_RETURN_IF_ERROR(b_sub.AddInPlace(b_switched, mod_down_.MainModuli()));
+    return b_sub;
+  }
+
+  // Accessors.
+  const std::vector<RnsPolynomial>& GetKeyA() const { return key_as_; }
+  const std::vector<RnsPolynomial>& GetKeyB() const { return key_bs_; }
+  int Power() const { return power_; }
+
+  // The main moduli followed by the auxiliary moduli, over which the key
+  // components are defined.
+  absl::Span<const PrimeModulus* const> KeyModuli() const {
+    return key_moduli_;
+  }
+
+ private:
+  HybridGaloisKey(std::vector<RnsPolynomial> key_as,
+                  std::vector<RnsPolynomial> key_bs, int power,
+                  std::vector<const PrimeModulus*> key_moduli,
+                  RnsModDown<ModularInt> mod_down)
+      : key_as_(std::move(key_as)),
+        key_bs_(std::move(key_bs)),
+        power_(power),
+        key_moduli_(std::move(key_moduli)),
+        mod_down_(std::move(mod_down)) {}
+
+  static std::vector<const PrimeModulus*> ConcatModuli(
+      absl::Span<const PrimeModulus* const> main_moduli,
+      absl::Span<const PrimeModulus* const> aux_moduli) {
+    std::vector<const PrimeModulus*> key_moduli(main_moduli.begin(),
+                                                main_moduli.end());
+    key_moduli.insert(key_moduli.end(), aux_moduli.begin(), aux_moduli.end());
+    return key_moduli;
+  }
+
+  absl::StatusOr<RnsPolynomial> ApplyTo(
+      absl::Span<const RnsPolynomial> digits,
+      const std::vector<RnsPolynomial>& key_components) const {
+    if (digits.size() != key_components.size()) {
+      return absl::InvalidArgumentError(
+          "`digits` must contain one polynomial per main modulus.");
+    }
+    RLWE_ASSIGN_OR_RETURN(RnsPolynomial product,
+                          digits[0].Mul(key_components[0], key_moduli_));
+    for (int j = 1; j < digits.size(); ++j) {
+      RLWE_RETURN_IF_ERROR(product.FusedMulAddInPlace(
+          digits[j], key_components[j], key_moduli_));
+    }
+    return mod_down_.Apply(product);
+  }
+
+  std::vector<RnsPolynomial> key_as_;
+  std::vector<RnsPolynomial> key_bs_;
+  int power_;
+  std::vector<const PrimeModulus*> key_moduli_;
+  RnsModDown<ModularInt> mod_down_;
+};
+
+}  // namespace linpir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_LINPIR_HYBRID_GALOIS_KEY_H_
@@ -13,14 +13,18 @@
  * limitations under the License.
  */
 
+#include <map>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/random/random.h"
 #include "benchmark/benchmark.h"
+#include "benchmarks/perf_counters.h"
 #include "gmock/gmock.h"
 #include "linpir/client.h"
 #include "linpir/database.h"
@@ -29,7 +33,10 @@
 #include "shell_encryption/montgomery.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
 #include "shell_encryption/rns/finite_field_encoder.h"
+#include "shell_encryption/rns/rns_bfv_ciphertext.h"
 #include "shell_encryption/rns/rns_context.h"
+#include "shell_encryption/rns/rns_gadget.h"
+#include "shell_encryption/rns/rns_galois_key.h"
 #include "shell_encryption/rns/rns_polynomial.h"
 #include "shell_encryption/testing/status_testing.h"
 
@@ -115,6 +122,7 @@ void BM_SingleDatabase(benchmark::State& state) {
   std::vector<Integer> query = SampleValues(num_cols, 8);
   ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(query));
 
+  benchmarks::ScopedPerfCounters perf_counters(state);
   for (auto _ : state) {
     auto response = server->HandleRequest(request);
     benchmark::DoNotOptimize(response);
@@ -122,6 +130,49 @@ void BM_SingleDatabase(benchmark::State& state) {
 }
 BENCHMARK(BM_SingleDatabase);
 
+// Same as above, with rotations by either gadget key switching or by hybrid
+// key switching over one auxiliary prime, reporting the Galois key size.
+void BM_SingleDatabaseKeySwitching(benchmark::State& state) {
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_cols = absl::GetFlag(FLAGS_num_cols);
+  RlweParameters<Integer> params = kRlweParameters;
+  if (state.range(0)) {
+    params.ps = {36028797018652673ULL};
+  }
+  auto rns_context = RnsContext::CreateForBfvFiniteFieldEncoding(
+                         params.log_n, params.qs, params.ps, params.ts[0])
+                         .value();
+
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_ct_pad, Prng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_gk_pad, Prng::GenerateSeed());
+  auto data = SampleMatrix(num_rows, num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(auto database,
+                       Database<Integer>::Create(params, &rns_context, data));
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<Integer>::Create(params, &rns_context, {database.get()},
+                              prng_seed_ct_pad, prng_seed_gk_pad));
+  ASSERT_OK(server->Preprocess());
+  ASSERT_OK_AND_ASSIGN(
+      auto client, Client<Integer>::Create(params, &rns_context,
+                                           prng_seed_ct_pad, prng_seed_gk_pad));
+
+  std::vector<Integer> query = SampleValues(num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(query));
+  int64_t num_bytes = 0;
+  for (auto const& gk_key_b : request.gk_key_bs()) {
+    num_bytes += gk_key_b.ByteSizeLong();
+  }
+
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto response = server->HandleRequest(request);
+    benchmark::DoNotOptimize(response);
+  }
+  state.counters["gk_KiB"] = num_bytes / 1024.0;
+}
+BENCHMARK(BM_SingleDatabaseKeySwitching)->ArgName("hybrid")->Arg(0)->Arg(1);
+
 // There are two instances of LinPIR protocols, where the two servers share
 // the same Galois key for generating rotations of encrypted query vector.
 // The two clients share the same RLWE secret key, but they use different seeds
@@ -191,6 +242,7 @@ void BM_TwoServersWithSharedGaloisKey(benchmark::State& state) {
   ASSERT_OK_AND_ASSIGN(auto request0, client0->GenerateRequest(ct_query0, gk));
   ASSERT_OK_AND_ASSIGN(auto request1, client1->GenerateRequest(ct_query1, gk));
 
+  benchmarks::ScopedPerfCounters perf_counters(state);
   for (auto _ : state) {
     auto response0 = server0->HandleRequest(request0);
     benchmark::DoNotOptimize(response0);
@@ -200,6 +252,243 @@ void BM_TwoServersWithSharedGaloisKey(benchmark::State& state) {
 }
 BENCHMARK(BM_TwoServersWithSharedGaloisKey);
 
+// Micro-benchmarks of the primitives used by the LinPIR server, swept over
+// the ring dimension, the number of rows per block and the number of RNS
+// moduli in the ciphertext modulus. These parameters are chosen for timing
+// only and are not checked for correctness or security.
+
+// NTT-friendly primes for ring dimensions up to 2^13.
+const std::vector<Integer> kSweepQs = {
+    18014398508400641ULL, 18014398508138497ULL, 18014398507892737ULL};
+constexpr Integer kSweepT = 4079617;
+constexpr int kSweepGadgetLogB = 18;
+
+using RnsGadget = rlwe::RnsGadget<ModularInt>;
+using RnsGaloisKey = rlwe::RnsGaloisKey<ModularInt>;
+using RnsCiphertext = rlwe::RnsBfvCiphertext<ModularInt>;
+
+// A LinPIR server over a single block of a database, with a client request.
+struct PrimitiveEnv {
+  RlweParameters<Integer> params;
+  std::unique_ptr<RnsContext> rns_context;
+  std::vector<const rlwe::PrimeModulus<ModularInt>*> moduli;
+  std::unique_ptr<RnsGadget> gadget;
+  std::string prng_seed_gk_pad;
+  std::vector<RnsPolynomial> gk_pads;
+  std::vector<std::vector<Integer>> data;
+  std::unique_ptr<Database<Integer>> database;
+  std::unique_ptr<Server<Integer>> server;
+  LinPirRequest request;
+  std::unique_ptr<RnsCiphertext> ct_query;
+  std::unique_ptr<RnsGaloisKey> gk;
+  // The rotations Enc(s << i) of the query, as computed by the server.
+  std::vector<RnsCiphertext> ct_rotated_queries;
+};
+
+std::unique_ptr<PrimitiveEnv> CreatePrimitiveEnv(int log_n,
+                                                 int rows_per_block,
+                                                 int num_qs) {
+  auto env = std::make_unique<PrimitiveEnv>();
+  env->params = RlweParameters<Integer>{
+      .log_n = log_n,
+      .qs = std::vector<Integer>(kSweepQs.begin(), kSweepQs.begin() + num_qs),
+      .ts = {kSweepT},
+      .gadget_log_bs = std::vector<size_t>(num_qs, kSweepGadgetLogB),
+      .error_variance = 8,
+      .prng_type = rlwe::PRNG_TYPE_HKDF,
+      .rows_per_block = rows_per_block,
+  };
+  env->rns_context = std::make_unique<RnsContext>(
+      RnsContext::CreateForBfvFiniteFieldEncoding(log_n, env->params.qs,
+                                                  /*ps=*/{}, kSweepT)
+          .value());
+  env->moduli = env->rns_context->MainPrimeModuli();
+  int level = num_qs - 1;
+  env->gadget = std::make_unique<RnsGadget>(
+      RnsGadget::Create(
+          log_n, env->params.gadget_log_bs,
+          env->rns_context->MainPrimeModulusComplements(level).value(),
+          env->rns_context->MainPrimeModulusCrtFactors(level).value(),
+          env->moduli)
+          .value());
+
+  std::string prng_seed_ct_pad = Prng::GenerateSeed().value();
+  env->prng_seed_gk_pad = Prng::GenerateSeed().value();
+  env->gk_pads = RnsGaloisKey::SampleRandomPad(
+                     env->gadget->Dimension(), log_n, env->moduli,
+                     env->prng_seed_gk_pad, env->params.prng_type)
+                     .value();
+
+  // One block of rows, filling all slots of a group.
+  env->data = SampleMatrix(rows_per_block, 1 << (log_n - 1), kSweepT);
+  env->database =
+      Database<Integer>::Create(env->params, env->rns_context.get(), env->data)
+          .value();
+  env->server = Server<Integer>::Create(env->params, env->rns_context.get(),
+                                        {env->database.get()},
+                                        prng_seed_ct_pad, env->prng_seed_gk_pad)
+                    .value();
+  env->server->Preprocess().IgnoreError();
+
+  auto client = Client<Integer>::Create(env->params, env->rns_context.get(),
+                                        prng_seed_ct_pad,
+                                        env->prng_seed_gk_pad)
+                    .value();
+  std::string prng_seed_sk = Prng::GenerateSeed().value();
+  std::vector<Integer> query = SampleValues(1 << (log_n - 1), kSweepT);
+  env->ct_query = std::make_unique<RnsCiphertext>(
+      client->EncryptQuery(query, prng_seed_sk).value());
+  env->gk = std::make_unique<RnsGaloisKey>(
+      client->GenerateGaloisKey(prng_seed_sk).value());
+  env->request = client->GenerateRequest(*env->ct_query, *env->gk).value();
+
+  auto pads = env->server->RotatedCiphertextPads();
+  auto pad_digits = env->server->SubstitutedPadDigits();
+  env->ct_rotated_queries.push_back(*env->ct_query);
+  for (int i = 1; i < rows_per_block / 2; ++i) {
+    auto ct_sub = env->ct_rotated_queries[i - 1].Substitute(5).value();
+    env->ct_rotated_queries.push_back(
+        env->gk->ApplyToWithRandomPad(ct_sub, pad_digits[i - 1], pads[i])
+            .value());
+  }
+  return env;
+}
+
+// Returns the environment for the (log_n, rows_per_block, num_qs) arguments
+// of `state`, creating it on first use.
+PrimitiveEnv& GetPrimitiveEnv(const benchmark::State& state) {
+  static auto* envs =
+      new std::map<std::tuple<int, int, int>, std::unique_ptr<PrimitiveEnv>>();
+  auto key = std::make_tuple(state.range(0), state.range(1), state.range(2));
+  auto it = envs->find(key);
+  if (it == envs->end()) {
+    it = envs->emplace(key, CreatePrimitiveEnv(state.range(0), state.range(1),
+                                               state.range(2)))
+             .first;
+  }
+  return *it->second;
+}
+
+// One substitution X -> X^5 of a query ciphertext.
+void BM_Substitute(benchmark::State& state) {
+  PrimitiveEnv& env = GetPrimitiveEnv(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto ct_sub = env.ct_query->Substitute(5);
+    benchmark::DoNotOptimize(ct_sub);
+  }
+}
+
+// One key switching of a substituted ciphertext with the preprocessed pads.
+void BM_ApplyToWithRandomPad(benchmark::State& state) {
+  PrimitiveEnv& env = GetPrimitiveEnv(state);
+  auto ct_sub = env.ct_query->Substitute(5).value();
+  auto pads = env.server->RotatedCiphertextPads();
+  auto pad_digits = env.server->SubstitutedPadDigits();
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto ct_rot = env.gk->ApplyToWithRandomPad(ct_sub, pad_digits[0], pads[1]);
+    benchmark::DoNotOptimize(ct_rot);
+  }
+}
+
+// Deserializing the "b" components of a Galois key from a request and
+// assembling the key with the expanded pads.
+void BM_GaloisKeyDeserialize(benchmark::State& state) {
+  PrimitiveEnv& env = GetPrimitiveEnv(state);
+  int64_t num_bytes = 0;
+  for (auto const& gk_key_b : env.request.gk_key_bs()) {
+    num_bytes += gk_key_b.ByteSizeLong();
+  }
+  state.counters["gk_KiB"] = num_bytes / 1024.0;
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    std::vector<RnsPolynomial> gk_key_bs;
+    gk_key_bs.reserve(env.request.gk_key_bs_size());
+    for (auto const& gk_key_b : env.request.gk_key_bs()) {
+      gk_key_bs.push_back(
+          RnsPolynomial::Deserialize(gk_key_b, env.moduli).value());
+    }
+    auto gk = RnsGaloisKey::CreateFromKeyComponents(
+        env.gk_pads, std::move(gk_key_bs), /*power=*/5, env.gadget.get(),
+        env.moduli, env.prng_seed_gk_pad, env.params.prng_type);
+    benchmark::DoNotOptimize(gk);
+  }
+}
+
+// Inner product of one block of diagonals with the rotated queries.
+void BM_InnerProductPerBlock(benchmark::State& state) {
+  PrimitiveEnv& env = GetPrimitiveEnv(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto ct_blocks =
+        env.database->InnerProductWithPreprocessedPads(env.ct_rotated_queries);
+    benchmark::DoNotOptimize(ct_blocks);
+  }
+}
+
+// Encoding one block of rows into diagonal plaintexts.
+void BM_DatabaseCreate(benchmark::State& state) {
+  PrimitiveEnv& env = GetPrimitiveEnv(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto database = Database<Integer>::Create(
+        env.params, env.rns_context.get(), env.data);
+    benchmark::DoNotOptimize(database);
+  }
+}
+
+// Encoding the same block of rows stored contiguously in row-major order.
+void BM_DatabaseCreateFromRowMajor(benchmark::State& state) {
+  PrimitiveEnv& env = GetPrimitiveEnv(state);
+  std::vector<Integer> data;
+  for (const auto& row : env.data) {
+    data.insert(data.end(), row.begin(), row.end());
+  }
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto database = Database<Integer>::CreateFromRowMajor(
+        env.params, env.rns_context.get(), data, env.data.size(),
+        env.data[0].size());
+    benchmark::DoNotOptimize(database);
+  }
+}
+
+// Rotation pads and database preprocessing for one block.
+void BM_ServerPreprocess(benchmark::State& state) {
+  PrimitiveEnv& env = GetPrimitiveEnv(state);
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto status = env.server->Preprocess();
+    benchmark::DoNotOptimize(status);
+  }
+}
+
+// Sweeps (log_n, rows_per_block, number of qs), with rows_per_block at most
+// the number of slots in a group.
+void PrimitiveSweep(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"log_n", "rows_per_block", "num_qs"});
+  for (int log_n : {11, 12, 13}) {
+    for (int rows_per_block : {512, 1024, 2048}) {
+      if (rows_per_block > (1 << (log_n - 1))) {
+        continue;
+      }
+      for (int num_qs = 1; num_qs <= kSweepQs.size(); ++num_qs) {
+        b->Args({log_n, rows_per_block, num_qs});
+      }
+    }
+  }
+  b->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(BM_Substitute)->Apply(PrimitiveSweep);
+BENCHMARK(BM_ApplyToWithRandomPad)->Apply(PrimitiveSweep);
+BENCHMARK(BM_GaloisKeyDeserialize)->Apply(PrimitiveSweep);
+BENCHMARK(BM_InnerProductPerBlock)->Apply(PrimitiveSweep);
+BENCHMARK(BM_DatabaseCreate)->Apply(PrimitiveSweep);
+BENCHMARK(BM_DatabaseCreateFromRowMajor)->Apply(PrimitiveSweep);
+BENCHMARK(BM_ServerPreprocess)->Apply(PrimitiveSweep);
+
 }  // namespace
 }  // namespace linpir
 }  // namespace hintless_pir
@@ -26,6 +26,7 @@
 #include "gtest/gtest.h"
 #include "linpir/client.h"
 #include "linpir/database.h"
+#include "linpir/packing.h"
 #include "linpir/parameters.h"
 #include "linpir/server.h"
 #include "shell_encryption/montgomery.h"
@@ -148,6 +149,215 @@ TEST_F(LinPirTest, EndToEndTest) {
   // }
 }
 
+TEST_F(LinPirTest, EndToEndWithHybridKeySwitchingTest) {
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_cols = absl::GetFlag(FLAGS_num_cols);
+
+  // Use one auxiliary prime for hybrid key switching.
+  RlweParameters<Integer> params = kRlweParameters;
+  params.ps = {36028797018652673ULL};
+  ASSERT_OK_AND_ASSIGN(auto rns_context,
+                       RnsContext::CreateForBfvFiniteFieldEncoding(
+                           params.log_n, params.qs, params.ps, params.ts[0]));
+
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_ct_pad, Prng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_gk_pad, Prng::GenerateSeed());
+
+  auto data = SampleMatrix(num_rows, num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(auto database,
+                       Database<Integer>::Create(params, &rns_context, data));
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<Integer>::Create(params, &rns_context, {database.get()},
+                              prng_seed_ct_pad, prng_seed_gk_pad));
+  ASSERT_OK(server->Preprocess());
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<Integer>::Create(params, &rns_context,
+                                               prng_seed_ct_pad,
+                                               prng_seed_gk_pad));
+
+  std::vector<Integer> query = SampleValues(num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(query));
+  ASSERT_EQ(request.gk_key_bs_size(), params.qs.size());
+  ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+  ASSERT_OK_AND_ASSIGN(auto response_pads, server->GetResponsePads());
+
+  ASSERT_OK_AND_ASSIGN(auto results, client->Recover(response, response_pads));
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_GE(results[0].size(), num_rows);
+  Integer t = params.ts[0];
+  for (int i = 0; i < num_rows; ++i) {
+    Integer expected = 0;
+    for (int j = 0; j < num_cols; ++j) {
+      expected = (expected + data[i][j] * query[j]) % t;
+    }
+    EXPECT_EQ(results[0][i], expected);
+  }
+}
+
+TEST_F(LinPirTest, EndToEndWithPackedMatricesTest) {
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_slots_per_group = 1 << (this->params_->log_n - 1);
+  int num_cols = num_slots_per_group / 2 - 24;
+  int packing_factor = MaxPackingFactor(*this->params_, num_cols);
+  ASSERT_EQ(packing_factor, 2);
+
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_ct_pad, Prng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_gk_pad, Prng::GenerateSeed());
+
+  // Pack two matrices into one database.
+  std::vector<std::vector<std::vector<Integer>>> matrices;
+  for (int p = 0; p < packing_factor; ++p) {
+    matrices.push_back(SampleMatrix(num_rows, num_cols, 8));
+  }
+  std::vector<std::vector<Integer>> packed;
+  for (int i = 0; i < num_rows; ++i) {
+    std::vector<const Integer*> rows;
+    for (const auto& matrix : matrices) {
+      rows.push_back(matrix[i].data());
+    }
+    packed.push_back(PackRow<Integer>(*this->params_, packing_factor, i, rows,
+                                      num_cols));
+  }
+  ASSERT_OK_AND_ASSIGN(auto database,
+                       Database<Integer>::Create(
+                           *this->params_, this->rns_context_.get(), packed));
+  ASSERT_OK_AND_ASSIGN(
+      auto server, Server<Integer>::Create(
+                       *this->params_, this->rns_context_.get(),
+                       {database.get()}, prng_seed_ct_pad, prng_seed_gk_pad));
+  ASSERT_OK(server->Preprocess());
+  ASSERT_OK_AND_ASSIGN(
+      auto client,
+      Client<Integer>::Create(*this->params_, this->rns_context_.get(),
+                              prng_seed_ct_pad, prng_seed_gk_pad));
+
+  std::vector<Integer> query = SampleValues(num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Integer> packed_query,
+      PackQuery<Integer>(*this->params_, packing_factor, query));
+  ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(packed_query));
+  ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+  ASSERT_EQ(response.ct_inner_products_size(), 1);
+  ASSERT_OK_AND_ASSIGN(auto response_pads, server->GetResponsePads());
+
+  ASSERT_OK_AND_ASSIGN(auto results, client->Recover(response, response_pads,
+                                                     packing_factor));
+  ASSERT_EQ(results.size(), packing_factor);
+  Integer t = this->params_->ts[0];
+  for (int p = 0; p < packing_factor; ++p) {
+    ASSERT_GE(results[p].size(), num_rows);
+    for (int i = 0; i < num_rows; ++i) {
+      Integer expected = 0;
+      for (int j = 0; j < num_cols; ++j) {
+        expected = (expected + matrices[p][i][j] * query[j]) % t;
+      }
+      EXPECT_EQ(results[p][i], expected);
+    }
+  }
+}
+
+TEST_F(LinPirTest, EndToEndWithPackedBlocksTest) {
+  // Four blocks of rows, packed two at a time into the slots of one block.
+  RlweParameters<Integer> params = kRlweParameters;
+  params.block_packing_factor = 2;
+  int num_rows = 3 * params.rows_per_block + 100;
+  int num_slots_per_group = 1 << (params.log_n - 1);
+  int num_cols = num_slots_per_group / 2 - 24;
+
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_ct_pad, Prng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_gk_pad, Prng::GenerateSeed());
+
+  auto data = SampleMatrix(num_rows, num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(
+      auto database,
+      Database<Integer>::Create(params, this->rns_context_.get(), data));
+  ASSERT_EQ(database->NumBlocks(), 2);
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<Integer>::Create(params, this->rns_context_.get(),
+                              {database.get()}, prng_seed_ct_pad,
+                              prng_seed_gk_pad));
+  ASSERT_OK(server->Preprocess());
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<Integer>::Create(params, this->rns_context_.get(),
+                                               prng_seed_ct_pad,
+                                               prng_seed_gk_pad));
+
+  std::vector<Integer> query = SampleValues(num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(query));
+  ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+  ASSERT_OK_AND_ASSIGN(auto response_pads, server->GetResponsePads());
+  ASSERT_EQ(response.ct_inner_products_size(), 1);
+  EXPECT_EQ(response.ct_inner_products(0).ct_b_blocks_size(), 2);
+  EXPECT_EQ(response_pads.ct_inner_products(0).ct_b_blocks_size(), 2);
+
+  ASSERT_OK_AND_ASSIGN(auto results, client->Recover(response, response_pads));
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_GE(results[0].size(), num_rows);
+  Integer t = params.ts[0];
+  for (int i = 0; i < num_rows; ++i) {
+    Integer expected = 0;
+    for (int j = 0; j < num_cols; ++j) {
+      expected = (expected + data[i][j] * query[j]) % t;
+    }
+    EXPECT_EQ(results[0][i], expected);
+  }
+}
+
+TEST_F(LinPirTest, EndToEndWithResponseModulusSwitchingTest) {
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_cols = absl::GetFlag(FLAGS_num_cols);
+
+  // Send the responses over the first of the two moduli only.
+  RlweParameters<Integer> params = kRlweParameters;
+  params.num_response_moduli = 1;
+  std::vector<const rlwe::PrimeModulus<ModularInt>*> response_moduli = {
+      this->moduli_[0]};
+
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_ct_pad, Prng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(std::string prng_seed_gk_pad, Prng::GenerateSeed());
+
+  auto data = SampleMatrix(num_rows, num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(
+      auto database,
+      Database<Integer>::Create(params, this->rns_context_.get(), data));
+  ASSERT_OK_AND_ASSIGN(
+      auto server,
+      Server<Integer>::Create(params, this->rns_context_.get(),
+                              {database.get()}, prng_seed_ct_pad,
+                              prng_seed_gk_pad));
+  ASSERT_OK(server->Preprocess());
+  ASSERT_OK_AND_ASSIGN(auto client,
+                       Client<Integer>::Create(params, this->rns_context_.get(),
+                                               prng_seed_ct_pad,
+                                               prng_seed_gk_pad));
+
+  std::vector<Integer> query = SampleValues(num_cols, 8);
+  ASSERT_OK_AND_ASSIGN(auto request, client->GenerateRequest(query));
+  ASSERT_OK_AND_ASSIGN(auto response, server->HandleRequest(request));
+  ASSERT_OK_AND_ASSIGN(auto response_pads, server->GetResponsePads());
+  ASSERT_EQ(response.ct_inner_products_size(), 1);
+  for (auto const& ct_b : response.ct_inner_products(0).ct_b_blocks()) {
+    EXPECT_OK(RnsPolynomial::Deserialize(ct_b, response_moduli));
+  }
+  for (auto const& pad : response_pads.ct_inner_products(0).ct_b_blocks()) {
+    EXPECT_OK(RnsPolynomial::Deserialize(pad, response_moduli));
+  }
+
+  ASSERT_OK_AND_ASSIGN(auto results, client->Recover(response, response_pads));
+  ASSERT_EQ(results.size(), 1);
+  ASSERT_GE(results[0].size(), num_rows);
+  Integer t = params.ts[0];
+  for (int i = 0; i < num_rows; ++i) {
+    Integer expected = 0;
+    for (int j = 0; j < num_cols; ++j) {
+      expected = (expected + data[i][j] * query[j]) % t;
+    }
+    EXPECT_EQ(results[0][i], expected);
+  }
+}
+
 }  // namespace
 }  // namespace linpir
 }  // namespace hintless_pir
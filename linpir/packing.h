@@ -0,0 +1,139 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_LINPIR_PACKING_H_
+#define HINTLESS_PIR_LINPIR_PACKING_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/status_macros.h"
+
+namespace hintless_pir {
+namespace linpir {
+
+// Slot packing of several matrices with the same query vector into one LinPIR
+// database matrix, for matrices with fewer columns than slots per group.
+//
+// The slot k of a group holds the inner product of row k mod rows_per_block
+// over a window of rows_per_block / 2 columns, so a block row r is covered by
+// the windows starting at columns r + m * rows_per_block / 2. With a packing
+// factor P, the slots of a group are split into P ranges of width
+// w = num_slots_per_group / P, a multiple of rows_per_block. Row r of the
+// packed matrix holds row r of the p'th matrix in the columns
+// [r + p * w, r + (p + 1) * w) (cyclically), at column c the entry at column
+// c mod w, and the query is repeated P times. Then the slots k in
+// [p * w, (p + 1) * w) only sum entries of the p'th matrix, and the client
+// separates the inner products of the P matrices by slot range.
+
+// Returns an error if matrices cannot be packed `packing_factor` at a time
+// with `rlwe_params`.
+template <typename RlweInteger>
+absl::Status CheckPackingFactor(const RlweParameters<RlweInteger>& rlwe_params,
+                                int packing_factor) {
+  int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
+  if (packing_factor < 1 || num_slots_per_group % packing_factor != 0 ||
+      (packing_factor > 1 &&
+       (num_slots_per_group / packing_factor) % rlwe_params.rows_per_block !=
+           0)) {
+    return absl::InvalidArgumentError(
+        "`packing_factor` must divide the number of slots per group into "
+        "multiples of `rows_per_block`.");
+  }
+  return absl::OkStatus();
+}
+
+// Returns the largest number of matrices with `num_cols` columns that can be
+// packed into one LinPIR database matrix, which is 1 if there is no room for
+// packing.
+template <typename RlweInteger>
+int MaxPackingFactor(const RlweParameters<RlweInteger>& rlwe_params,
+                     int num_cols) {
+  int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
+  for (int packing_factor = num_slots_per_group / std::max(num_cols, 1);
+       packing_factor > 1; --packing_factor) {
+    if (CheckPackingFactor(rlwe_params, packing_factor).ok() &&
+        num_slots_per_group / packing_factor >= num_cols) {
+      return packing_factor;
+    }
+  }
+  return 1;
+}
+
+// Returns the row `row_idx` of the packed matrix, where `rows[p]` is the row
+// `row_idx` of the p'th matrix with `num_cols` columns, or nullptr if the p'th
+// matrix has no such row.
+template <typename RlweInteger>
+std::vector<RlweInteger> PackRow(
+    const RlweParameters<RlweInteger>& rlwe_params, int packing_factor,
+    int row_idx, absl::Span<const RlweInteger* const> rows, int num_cols) {
+  int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
+  int width = num_slots_per_group / packing_factor;
+  int row_in_block = row_idx % rlwe_params.rows_per_block;
+  std::vector<RlweInteger> packed(num_slots_per_group, 0);
+  // The p'th range starts at column `row_in_block + p * width`.
+  for (int p = 0; p < rows.size() && p < packing_factor; ++p) {
+    if (rows[p] == nullptr) {
+      continue;
+    }
+    int col_idx = row_in_block + p * width;
+    int value_idx = row_in_block;
+    for (int i = 0; i < width; ++i) {
+      if (col_idx >= num_slots_per_group) {
+        col_idx -= num_slots_per_group;
+      }
+      if (value_idx >= width) {
+        value_idx -= width;
+      }
+      if (value_idx < num_cols) {
+        packed[col_idx] = rows[p][value_idx];
+      }
+      ++col_idx;
+      ++value_idx;
+    }
+  }
+  return packed;
+}
+
+// Returns the query vector of a packed matrix, i.e. `query` repeated
+// `packing_factor` times, each copy padded with zeros to the range width, or
+// an error if `query` has more than num_slots_per_group / `packing_factor`
+// values.
+template <typename RlweInteger>
+absl::StatusOr<std::vector<RlweInteger>> PackQuery(
+    const RlweParameters<RlweInteger>& rlwe_params, int packing_factor,
+    absl::Span<const RlweInteger> query) {
+  RLWE_RETURN_IF_ERROR(CheckPackingFactor(rlwe_params, packing_factor));
+  int num_slots_per_group = 1 << (rlwe_params.log_n - 1);
+  int width = num_slots_per_group / packing_factor;
+  if (query.size() > width) {
+    return absl::InvalidArgumentError(
+        "`query` must have at most one value per slot of a packed range.");
+  }
+  std::vector<RlweInteger> packed(num_slots_per_group, 0);
+  for (int p = 0; p < packing_factor; ++p) {
+    std::copy(query.begin(), query.end(), packed.begin() + p * width);
+  }
+  return packed;
+}
+
+}  // namespace linpir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_LINPIR_PACKING_H_
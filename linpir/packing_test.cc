@@ -0,0 +1,102 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linpir/packing.h"
+
+#include <vector>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace linpir {
+namespace {
+
+using Integer = Uint64;
+using ::rlwe::testing::StatusIs;
+using ::testing::HasSubstr;
+
+// 8 slots per group and blocks of 2 rows.
+const RlweParameters<Integer> kRlweParameters{
+    .log_n = 4,
+    .rows_per_block = 2,
+};
+
+TEST(PackingTest, CheckPackingFactor) {
+  EXPECT_OK(CheckPackingFactor(kRlweParameters, 1));
+  EXPECT_OK(CheckPackingFactor(kRlweParameters, 2));
+  EXPECT_OK(CheckPackingFactor(kRlweParameters, 4));
+  for (int packing_factor : {0, 3, 8}) {
+    EXPECT_THAT(CheckPackingFactor(kRlweParameters, packing_factor),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("`packing_factor` must divide")));
+  }
+}
+
+TEST(PackingTest, MaxPackingFactor) {
+  EXPECT_EQ(MaxPackingFactor(kRlweParameters, /*num_cols=*/1), 4);
+  EXPECT_EQ(MaxPackingFactor(kRlweParameters, /*num_cols=*/2), 4);
+  EXPECT_EQ(MaxPackingFactor(kRlweParameters, /*num_cols=*/3), 2);
+  EXPECT_EQ(MaxPackingFactor(kRlweParameters, /*num_cols=*/5), 1);
+  EXPECT_EQ(MaxPackingFactor(kRlweParameters, /*num_cols=*/8), 1);
+}
+
+TEST(PackingTest, PackRowShiftsRangesByRowInBlock) {
+  std::vector<Integer> row0 = {1, 2, 3};
+  std::vector<Integer> row1 = {4, 5, 6};
+  std::vector<const Integer*> rows = {row0.data(), row1.data()};
+  // Row 0 of a block: the ranges start at columns 0 and 4.
+  EXPECT_EQ(PackRow<Integer>(kRlweParameters, /*packing_factor=*/2,
+                             /*row_idx=*/0, rows, /*num_cols=*/3),
+            (std::vector<Integer>{1, 2, 3, 0, 4, 5, 6, 0}));
+  // Row 1 of a block: the ranges start at columns 1 and 5, and column c holds
+  // the entry at column c mod 4.
+  EXPECT_EQ(PackRow<Integer>(kRlweParameters, /*packing_factor=*/2,
+                             /*row_idx=*/3, rows, /*num_cols=*/3),
+            (std::vector<Integer>{4, 2, 3, 0, 1, 5, 6, 0}));
+  // A missing row is left as zeros.
+  rows[0] = nullptr;
+  EXPECT_EQ(PackRow<Integer>(kRlweParameters, /*packing_factor=*/2,
+                             /*row_idx=*/0, rows, /*num_cols=*/3),
+            (std::vector<Integer>{0, 0, 0, 0, 4, 5, 6, 0}));
+}
+
+TEST(PackingTest, PackQuery) {
+  std::vector<Integer> query = {7, 8, 9};
+  ASSERT_OK_AND_ASSIGN(
+      std::vector<Integer> packed,
+      PackQuery<Integer>(kRlweParameters, /*packing_factor=*/2, query));
+  EXPECT_EQ(packed, (std::vector<Integer>{7, 8, 9, 0, 7, 8, 9, 0}));
+}
+
+TEST(PackingTest, PackQueryFailsIfQueryIsTooLong) {
+  std::vector<Integer> query = {1, 2, 3, 4, 5};
+  EXPECT_THAT(PackQuery<Integer>(kRlweParameters, /*packing_factor=*/2, query),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("at most one value per slot")));
+}
+
+TEST(PackingTest, PackQueryFailsWithInvalidPackingFactor) {
+  std::vector<Integer> query = {1, 2};
+  EXPECT_THAT(PackQuery<Integer>(kRlweParameters, /*packing_factor=*/3, query),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`packing_factor` must divide")));
+}
+
+}  // namespace
+}  // namespace linpir
+}  // namespace hintless_pir
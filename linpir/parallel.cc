@@ -0,0 +1,122 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linpir/parallel.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "shell_encryption/status_macros.h"
+
+namespace hintless_pir {
+namespace linpir {
+
+ThreadPool::ThreadPool(int num_threads) {
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back(&ThreadPool::Run, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  absl::MutexLock lock(&mutex_);
+  tasks_.push_back(std::move(task));
+}
+
+void ThreadPool::Run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          +[](ThreadPool* pool) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pool->mutex_) {
+            return pool->stopping_ || !pool->tasks_.empty();
+          },
+          this));
+      if (tasks_.empty()) {
+        return;  // Stopping and nothing left to do.
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+int ItemsPerRange(int num_items, int num_ranges) {
+  if (num_items <= 0) {
+    return 1;
+  }
+  num_ranges = std::clamp(num_ranges, 1, num_items);
+  return (num_items + num_ranges - 1) / num_ranges;
+}
+
+absl::Status ParallelFor(
+    int num_items, int num_ranges, ThreadPool* pool,
+    absl::FunctionRef<absl::Status(int begin, int end)> fn) {
+  if (num_items <= 0) {
+    return absl::OkStatus();
+  }
+  // Recompute the number of ranges so that none of them is empty.
+  int items_per_range = ItemsPerRange(num_items, num_ranges);
+  num_ranges = (num_items + items_per_range - 1) / items_per_range;
+  if (num_ranges == 1) {
+    return fn(0, num_items);
+  }
+  std::vector<absl::Status> statuses(num_ranges);
+  absl::BlockingCounter num_pending(num_ranges - 1);
+  std::vector<std::thread> threads;
+  for (int r = 1; r < num_ranges; ++r) {
+    int begin = r * items_per_range;
+    int end = std::min(num_items, begin + items_per_range);
+    auto task = [&statuses, &num_pending, fn, r, begin, end]() {
+      statuses[r] = fn(begin, end);
+      num_pending.DecrementCount();
+    };
+    if (pool != nullptr) {
+      pool->Schedule(std::move(task));
+    } else {
+      threads.emplace_back(std::move(task));
+    }
+  }
+  statuses[0] = fn(0, items_per_range);
+  num_pending.Wait();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const absl::Status& status : statuses) {
+    RLWE_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace linpir
+}  // namespace hintless_pir
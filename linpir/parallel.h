@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_LINPIR_PARALLEL_H_
+#define HINTLESS_PIR_LINPIR_PARALLEL_H_
+
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+
+namespace hintless_pir {
+namespace linpir {
+
+// A fixed number of threads running tasks from a shared FIFO queue. A pool is
+// meant to be created once and reused, e.g. by all the requests to a database,
+// so that the number of threads does not grow with the number of callers.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads);
+
+  // Runs all pending tasks and joins the threads.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Enqueues `task` to be run by one of the threads.
+  void Schedule(std::function<void()> task) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int NumThreads() const { return threads_.size(); }
+
+ private:
+  void Run();
+
+  absl::Mutex mutex_;
+  std::deque<std::function<void()>> tasks_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<std::thread> threads_;
+};
+
+// Returns the number of items in each range, but possibly the last one, when
+// `ParallelFor()` splits `num_items` items into at most `num_ranges` ranges.
+// The range starting at item `begin` is then the (begin / ItemsPerRange())'th
+// one, so callers can keep per-range results without locking.
+int ItemsPerRange(int num_items, int num_ranges);
+
+// Splits [0, num_items) into at most `num_ranges` contiguous ranges of equal
+// size, and calls `fn(begin, end)` on each range [begin, end). The first range
+// runs on the calling thread, and the others on `pool`, or on threads created
+// for this call if `pool` is null. Returns the error of the first failing
+// range, if any. `fn` must not wait for other tasks of `pool`.
+absl::Status ParallelFor(
+    int num_items, int num_ranges, ThreadPool* pool,
+    absl::FunctionRef<absl::Status(int begin, int end)> fn);
+
+// As above, with the ranges other than the first one run on `num_threads` - 1
+// threads created for this call. This suits one-off work like preprocessing.
+inline absl::Status ParallelFor(
+    int num_items, int num_threads,
+    absl::FunctionRef<absl::Status(int begin, int end)> fn) {
+  return ParallelFor(num_items, num_threads, /*pool=*/nullptr, fn);
+}
+
+}  // namespace linpir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_LINPIR_PARALLEL_H_
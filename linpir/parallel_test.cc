@@ -0,0 +1,111 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linpir/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace linpir {
+namespace {
+
+using ::rlwe::testing::StatusIs;
+using ::testing::HasSubstr;
+
+TEST(ParallelForTest, CoversAllItemsOnce) {
+  for (int num_items : {1, 7, 64, 100}) {
+    for (int num_threads : {1, 3, 8, 200}) {
+      std::vector<int> counts(num_items, 0);
+      ASSERT_OK(ParallelFor(num_items, num_threads,
+                            [&](int begin, int end) -> absl::Status {
+                              for (int i = begin; i < end; ++i) {
+                                counts[i]++;
+                              }
+                              return absl::OkStatus();
+                            }));
+      EXPECT_THAT(counts, ::testing::Each(1));
+    }
+  }
+}
+
+TEST(ParallelForTest, ZeroItemsIsNoOp) {
+  ASSERT_OK(ParallelFor(/*num_items=*/0, /*num_threads=*/4,
+                        [](int begin, int end) -> absl::Status {
+                          return absl::InternalError("unexpected call");
+                        }));
+}
+
+TEST(ParallelForTest, ReturnsErrorOfFailingRange) {
+  EXPECT_THAT(ParallelFor(/*num_items=*/16, /*num_threads=*/4,
+                          [](int begin, int end) -> absl::Status {
+                            if (begin <= 9 && 9 < end) {
+                              return absl::InternalError("item 9 failed");
+                            }
+                            return absl::OkStatus();
+                          }),
+              StatusIs(absl::StatusCode::kInternal, HasSubstr("item 9")));
+}
+
+TEST(ParallelForTest, CoversAllItemsOnceWithThreadPool) {
+  ThreadPool pool(/*num_threads=*/3);
+  for (int num_items : {1, 7, 64, 100}) {
+    for (int num_ranges : {1, 4, 200}) {
+      std::vector<int> counts(num_items, 0);
+      ASSERT_OK(ParallelFor(num_items, num_ranges, &pool,
+                            [&](int begin, int end) -> absl::Status {
+                              for (int i = begin; i < end; ++i) {
+                                counts[i]++;
+                              }
+                              return absl::OkStatus();
+                            }));
+      EXPECT_THAT(counts, ::testing::Each(1));
+    }
+  }
+}
+
+TEST(ParallelForTest, RangesStartAtMultiplesOfItemsPerRange) {
+  for (int num_items : {1, 7, 64, 100}) {
+    for (int num_ranges : {1, 3, 8, 200}) {
+      int items_per_range = ItemsPerRange(num_items, num_ranges);
+      ASSERT_OK(ParallelFor(
+          num_items, num_ranges, [&](int begin, int end) -> absl::Status {
+            EXPECT_EQ(begin % items_per_range, 0);
+            EXPECT_EQ(end, std::min(num_items, begin + items_per_range));
+            return absl::OkStatus();
+          }));
+    }
+  }
+}
+
+TEST(ThreadPoolTest, RunsPendingTasksBeforeDestruction) {
+  std::atomic<int> num_runs = 0;
+  {
+    ThreadPool pool(/*num_threads=*/2);
+    for (int i = 0; i < 100; ++i) {
+      pool.Schedule([&num_runs]() { num_runs++; });
+    }
+  }
+  EXPECT_EQ(num_runs, 100);
+}
+
+}  // namespace
+}  // namespace linpir
+}  // namespace hintless_pir
@@ -43,9 +43,28 @@ using Uint64 = rlwe::Uint64;
 //          modulus in `qs`.
 // - error_variance: the variance of a centered binomial distribution, which
 //          is used as the RLWE error distribution.
-// - prng_type: The type of PRNG to sample random polynomials.
+// - prng_type: The type of PRNG to sample random polynomials: HKDF, ChaCha, or
+//          `lwe::kPrngTypeAesCtr`. The Galois key pads are sampled by SHELL,
+//          which uses HKDF in place of AES-CTR.
 // - rows_per_block: the number of rows of the database matrix in every block
 //          of the database encoding.
+// - ps:    the auxiliary RNS moduli for hybrid key switching of the query
+//          rotations. If empty, Galois keys use the gadget of `gadget_log_bs`;
+//          otherwise they have one component per member of `qs` modulo the
+//          product of `qs` and `ps`, and `gadget_log_bs` is ignored. The RNS
+//          context must then be created with `ps` as its auxiliary moduli.
+// - num_response_moduli: the number of leading members of `qs` over which the
+//          response ciphertexts are sent. The other moduli of `qs` are dropped
+//          by modulus switching the responses and their pads, which shrinks
+//          the download and the response hint at the cost of a rounding error
+//          in the inner products. If 0, the responses are over all of `qs`.
+// - block_packing_factor: the number of consecutive blocks of every database
+//          matrix whose rows share the slots of one encoded block, as the
+//          packed matrices of packing.h. The responses and their pads then
+//          have `block_packing_factor` times fewer ciphertexts per matrix. The
+//          matrices must have at most num_slots_per_group /
+//          `block_packing_factor` columns, and the client repeats the query
+//          once per packed block.
 template <typename RlweInteger>
 struct RlweParameters {
   int log_n;
@@ -57,6 +76,19 @@ struct RlweParameters {
 
   // Encoding a matrix into blocks.
   int rows_per_block;
+
+  // Hybrid key switching.
+  std::vector<RlweInteger> ps = {};
+
+  // Number of threads encoding the diagonals of a database block, and
+  // multiplying them with the rotation pads in `Database::Preprocess()`.
+  int num_threads = 1;
+
+  // Modulus switching of the responses.
+  int num_response_moduli = 0;
+
+  // Packing of consecutive blocks into the slots of one block.
+  int block_packing_factor = 1;
 };
 
 }  // namespace linpir
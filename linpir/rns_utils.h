@@ -0,0 +1,339 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_LINPIR_RNS_UTILS_H_
+#define HINTLESS_PIR_LINPIR_RNS_UTILS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/bits.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "shell_encryption/integral_types.h"
+#include "shell_encryption/prng/prng.h"
+#include "shell_encryption/rns/rns_modulus.h"
+#include "shell_encryption/rns/rns_polynomial.h"
+#include "shell_encryption/status_macros.h"
+
+namespace hintless_pir {
+namespace linpir {
+
+namespace internal {
+
+// Returns a * b mod `modulus`.
+template <typename Int>
+Int MulMod(Int a, Int b, Int modulus) {
+  return static_cast<Int>(absl::uint128{a} * b % modulus);
+}
+
+// Returns the inverse of `a` modulo the prime `modulus`.
+template <typename Int>
+Int InvMod(Int a, Int modulus) {
+  Int result = 1;
+  Int base = a % modulus;
+  for (Int exponent = modulus - 2; exponent > 0; exponent >>= 1) {
+    if (exponent & 1) {
+      result = MulMod(result, base, modulus);
+    }
+    base = MulMod(base, base, modulus);
+  }
+  return result;
+}
+
+// Returns the residue modulo `to` of the integer in (-from/2, from/2] that is
+// congruent to `value` modulo `from`.
+template <typename Int>
+Int SwitchModulusCentered(Int value, Int from, Int to) {
+  if (value <= from / 2) {
+    return value % to;
+  }
+  Int negated = (from - value) % to;
+  return negated == 0 ? 0 : to - negated;
+}
+
+}  // namespace internal
+
+// Returns the polynomial over `moduli` whose coefficients are the centered
+// residues of `x` modulo `x_moduli[index]`, i.e. the RNS digit `index` of `x`
+// lifted to all of `moduli`. `x` must be in coefficient form over `x_moduli`,
+// and so is the result over `moduli`.
+template <typename ModularInt>
+absl::StatusOr<rlwe::RnsPolynomial<ModularInt>> ExtendResidue(
+    const rlwe::RnsPolynomial<ModularInt>& x, int index,
+    absl::Span<const rlwe::PrimeModulus<ModularInt>* const> x_moduli,
+    absl::Span<const rlwe::PrimeModulus<ModularInt>* const> moduli) {
+  using Int = typename ModularInt::Int;
+  if (x.IsNttForm()) {
+    return absl::InvalidArgumentError("`x` must be in coefficient form.");
+  }
+  if (index < 0 || index >= x_moduli.size()) {
+    return absl::InvalidArgumentError("`index` out of range.");
+  }
+
+  const auto* x_params = x_moduli[index]->ModParams();
+  const std::vector<ModularInt>& residues = x.Coeffs()[index];
+  std::vector<std::vector<ModularInt>> coeff_vectors(moduli.size());
+  for (int i = 0; i < moduli.size(); ++i) {
+    if (moduli[i] == x_moduli[index]) {
+      coeff_vectors[i] = residues;
+      continue;
+    }
+    const auto* params = moduli[i]->ModParams();
+    coeff_vectors[i].reserve(residues.size());
+    for (const ModularInt& residue : residues) {
+      Int value = internal::SwitchModulusCentered<Int>(
+          residue.ExportInt(x_params), x_params->modulus, params->modulus);
+      RLWE_ASSIGN_OR_RETURN(ModularInt coeff,
+                            ModularInt::ImportInt(value, params));
+      coeff_vectors[i].push_back(std::move(coeff));
+    }
+  }
+  return rlwe::RnsPolynomial<ModularInt>::Create(std::move(coeff_vectors),
+                                                 /*is_ntt=*/false);
+}
+
+// Samples a polynomial over `moduli` in NTT form, with coefficients drawn from
+// a centered binomial distribution of the given `variance`. Unlike sampling
+// each modulus separately, the residues represent the same small integers.
+template <typename ModularInt>
+absl::StatusOr<rlwe::RnsPolynomial<ModularInt>> SampleCenteredBinomial(
+    int log_n, double variance,
+    absl::Span<const rlwe::PrimeModulus<ModularInt>* const> moduli,
+    rlwe::SecurePrng* prng) {
+  using Int = typename ModularInt::Int;
+  if (variance <= 0) {
+    return absl::InvalidArgumentError("`variance` must be positive.");
+  }
+
+  // The sum of `num_pairs` differences of two coin flips has variance
+  // `num_pairs` / 2. Every 64-bit sample holds 32 pairs of coin flips.
+  int num_pairs = static_cast<int>(std::ceil(2 * variance));
+  int num_coeffs = 1 << log_n;
+  std::vector<int> values(num_coeffs, 0);
+  for (int& value : values) {
+    for (int j = 0; j < num_pairs; j += 32) {
+      RLWE_ASSIGN_OR_RETURN(rlwe::Uint64 bits, prng->Rand64());
+      int count = std::min(32, num_pairs - j);
+      rlwe::Uint64 mask = (rlwe::Uint64{1} << count) - 1;
+      value += absl::popcount(bits & mask) -
+               absl::popcount((bits >> 32) & mask);
+    }
+  }
+
+  std::vector<std::vector<ModularInt>> coeff_vectors(moduli.size());
+  for (int i = 0; i < moduli.size(); ++i) {
+    const auto* params = moduli[i]->ModParams();
+    coeff_vectors[i].reserve(num_coeffs);
+    for (int value : values) {
+      Int residue = value >= 0 ? static_cast<Int>(value)
+                               : params->modulus - static_cast<Int>(-value);
+      RLWE_ASSIGN_OR_RETURN(ModularInt coeff,
+                            ModularInt::ImportInt(residue, params));
+      coeff_vectors[i].push_back(std::move(coeff));
+    }
+  }
+  RLWE_ASSIGN_OR_RETURN(auto poly,
+                        rlwe::RnsPolynomial<ModularInt>::Create(
+                            std::move(coeff_vectors), /*is_ntt=*/false));
+  RLWE_RETURN_IF_ERROR(poly.ConvertToNttForm(moduli));
+  return poly;
+}
+
+// Divides polynomials modulo Q * P by P and rounds, where Q is the product of
+// the main moduli and P is that of the auxiliary moduli. The result is modulo
+// Q. With more than one auxiliary modulus, x mod P is lifted to the main moduli
+// by fast basis conversion, which may add a small integer to each coefficient
+// of the result.
+template <typename ModularInt>
+class RnsModDown {
+ public:
+  using Int = typename ModularInt::Int;
+  using RnsPolynomial = rlwe::RnsPolynomial<ModularInt>;
+  using PrimeModulus = rlwe::PrimeModulus<ModularInt>;
+
+  static absl::StatusOr<RnsModDown> Create(
+      absl::Span<const PrimeModulus* const> main_moduli,
+      absl::Span<const PrimeModulus* const> aux_moduli) {
+    if (main_moduli.empty()) {
+      return absl::InvalidArgumentError("`main_moduli` must not be empty.");
+    }
+    if (aux_moduli.empty()) {
+      return absl::InvalidArgumentError("`aux_moduli` must not be empty.");
+    }
+
+    // (P / p_k)^-1 mod p_k.
+    std::vector<Int> aux_hat_invs;
+    aux_hat_invs.reserve(aux_moduli.size());
+    for (int k = 0; k < aux_moduli.size(); ++k) {
+      Int p_k = aux_moduli[k]->ModParams()->modulus;
+      Int aux_hat = 1;
+      for (int l = 0; l < aux_moduli.size(); ++l) {
+        if (l != k) {
+          aux_hat = internal::MulMod<Int>(
+              aux_hat, aux_moduli[l]->ModParams()->modulus % p_k, p_k);
+        }
+      }
+      aux_hat_invs.push_back(internal::InvMod<Int>(aux_hat, p_k));
+    }
+
+    // (P / p_k) mod q_i, and P^-1 mod q_i.
+    std::vector<std::vector<Int>> aux_hats(main_moduli.size());
+    std::vector<ModularInt> aux_invs;
+    aux_invs.reserve(main_moduli.size());
+    for (int i = 0; i < main_moduli.size(); ++i) {
+      const auto* params = main_moduli[i]->ModParams();
+      Int q_i = params->modulus;
+      Int aux_product = 1;
+      for (int k = 0; k < aux_moduli.size(); ++k) {
+        Int aux_hat = 1;
+        for (int l = 0; l < aux_moduli.size(); ++l) {
+          if (l != k) {
+            aux_hat = internal::MulMod<Int>(
+                aux_hat, aux_moduli[l]->ModParams()->modulus % q_i, q_i);
+          }
+        }
+        aux_hats[i].push_back(aux_hat);
+        aux_product = internal::MulMod<Int>(
+            aux_product, aux_moduli[k]->ModParams()->modulus % q_i, q_i);
+      }
+      if (aux_product == 0) {
+        return absl::InvalidArgumentError(
+            "`main_moduli` and `aux_moduli` must be distinct primes.");
+      }
+      RLWE_ASSIGN_OR_RETURN(
+          ModularInt aux_inv,
+          ModularInt::ImportInt(internal::InvMod<Int>(aux_product, q_i),
+                                params));
+      aux_invs.push_back(std::move(aux_inv));
+    }
+
+    return RnsModDown(
+        std::vector<const PrimeModulus*>(main_moduli.begin(),
+                                         main_moduli.end()),
+        std::vector<const PrimeModulus*>(aux_moduli.begin(), aux_moduli.end()),
+        std::move(aux_hat_invs), std::move(aux_hats), std::move(aux_invs));
+  }
+
+  // Returns round(x / P) modulo Q, where `x` is over the main moduli followed
+  // by the auxiliary moduli. The result is in the same form as `x`.
+  absl::StatusOr<RnsPolynomial> Apply(const RnsPolynomial& x) const {
+    int num_main = main_moduli_.size();
+    const auto& coeff_vectors = x.Coeffs();
+    if (coeff_vectors.size() != num_main + aux_moduli_.size()) {
+      return absl::InvalidArgumentError(
+          "`x` must be defined over the main and the auxiliary moduli.");
+    }
+    bool is_ntt = x.IsNttForm();
+    int num_coeffs = coeff_vectors[0].size();
+
+    // y_k = [x * (P / p_k)^-1]_{p_k}, in coefficient form.
+    RLWE_ASSIGN_OR_RETURN(
+        RnsPolynomial x_aux,
+        RnsPolynomial::Create(std::vector<std::vector<ModularInt>>(
+                                  coeff_vectors.begin() + num_main,
+                                  coeff_vectors.end()),
+                              is_ntt));
+    if (is_ntt) {
+      RLWE_RETURN_IF_ERROR(x_aux.ConvertToCoeffForm(aux_moduli_));
+    }
+    std::vector<std::vector<Int>> ys(aux_moduli_.size());
+    for (int k = 0; k < aux_moduli_.size(); ++k) {
+      const auto* params = aux_moduli_[k]->ModParams();
+      ys[k].reserve(num_coeffs);
+      for (const ModularInt& coeff : x_aux.Coeffs()[k]) {
+        ys[k].push_back(internal::MulMod<Int>(
+            coeff.ExportInt(params), aux_hat_invs_[k], params->modulus));
+      }
+    }
+
+    // Lift x mod P, centered, to the main moduli: sum_k y_k * (P / p_k).
+    std::vector<std::vector<ModularInt>> lifted(num_main);
+    for (int i = 0; i < num_main; ++i) {
+      const auto* params = main_moduli_[i]->ModParams();
+      Int q_i = params->modulus;
+      lifted[i].reserve(num_coeffs);
+      for (int c = 0; c < num_coeffs; ++c) {
+        Int sum = 0;
+        for (int k = 0; k < aux_moduli_.size(); ++k) {
+          Int y = internal::SwitchModulusCentered<Int>(
+              ys[k][c], aux_moduli_[k]->ModParams()->modulus, q_i);
+          sum += internal::MulMod<Int>(y, aux_hats_[i][k], q_i);
+          sum = sum >= q_i ? sum - q_i : sum;
+        }
+        RLWE_ASSIGN_OR_RETURN(ModularInt coeff,
+                              ModularInt::ImportInt(sum, params));
+        lifted[i].push_back(std::move(coeff));
+      }
+    }
+    RLWE_ASSIGN_OR_RETURN(
+        RnsPolynomial x_lifted,
+        RnsPolynomial::Create(std::move(lifted), /*is_ntt=*/false));
+    if (is_ntt) {
+      RLWE_RETURN_IF_ERROR(x_lifted.ConvertToNttForm(main_moduli_));
+    }
+
+    // (x - x_lifted) * P^-1 mod q_i.
+    std::vector<std::vector<ModularInt>> result(num_main);
+    for (int i = 0; i < num_main; ++i) {
+      const auto* params = main_moduli_[i]->ModParams();
+      result[i].reserve(num_coeffs);
+      for (int c = 0; c < num_coeffs; ++c) {
+        result[i].push_back(coeff_vectors[i][c]
+                                .Sub(x_lifted.Coeffs()[i][c], params)
+                                .Mul(aux_invs_[i], params));
+      }
+    }
+    return RnsPolynomial::Create(std::move(result), is_ntt);
+  }
+
+  absl::Span<const PrimeModulus* const> MainModuli() const {
+    return main_moduli_;
+  }
+  absl::Span<const PrimeModulus* const> AuxModuli() const {
+    return aux_moduli_;
+  }
+
+ private:
+  RnsModDown(std::vector<const PrimeModulus*> main_moduli,
+             std::vector<const PrimeModulus*> aux_moduli,
+             std::vector<Int> aux_hat_invs,
+             std::vector<std::vector<Int>> aux_hats,
+             std::vector<ModularInt> aux_invs)
+      : main_moduli_(std::move(main_moduli)),
+        aux_moduli_(std::move(aux_moduli)),
+        aux_hat_invs_(std::move(aux_hat_invs)),
+        aux_hats_(std::move(aux_hats)),
+        aux_invs_(std::move(aux_invs)) {}
+
+  std::vector<const PrimeModulus*> main_moduli_;
+  std::vector<const PrimeModulus*> aux_moduli_;
+
+  // (P / p_k)^-1 mod p_k, indexed by k.
+  std::vector<Int> aux_hat_invs_;
+  // (P / p_k) mod q_i, indexed by i and then k.
+  std::vector<std::vector<Int>> aux_hats_;
+  // P^-1 mod q_i, indexed by i.
+  std::vector<ModularInt> aux_invs_;
+};
+
+}  // namespace linpir
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_LINPIR_RNS_UTILS_H_
@@ -0,0 +1,155 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linpir/rns_utils.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "linpir/parameters.h"
+#include "shell_encryption/montgomery.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/rns/rns_context.h"
+#include "shell_encryption/rns/rns_modulus.h"
+#include "shell_encryption/rns/rns_polynomial.h"
+#include "shell_encryption/testing/status_matchers.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace linpir {
+namespace {
+
+using Integer = Uint64;
+using ModularInt = rlwe::MontgomeryInt<Integer>;
+using RnsContext = rlwe::RnsContext<ModularInt>;
+using RnsPolynomial = rlwe::RnsPolynomial<ModularInt>;
+using PrimeModulus = rlwe::PrimeModulus<ModularInt>;
+using Prng = rlwe::SingleThreadHkdfPrng;
+using ::rlwe::testing::StatusIs;
+using ::testing::HasSubstr;
+
+constexpr int kLogN = 12;
+constexpr absl::string_view kPrngSeed =
+    "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+const std::vector<Integer> kQs = {18014398509309953ULL, 18014398509293569ULL};
+const std::vector<Integer> kPs = {36028797018652673ULL};
+constexpr Integer kT = 4169729;
+
+class RnsUtilsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto rns_context =
+        RnsContext::CreateForBfvFiniteFieldEncoding(kLogN, kQs, kPs, kT)
+            .value();
+    rns_context_ = std::make_unique<const RnsContext>(std::move(rns_context));
+    main_moduli_ = rns_context_->MainPrimeModuli();
+    aux_moduli_ = rns_context_->AuxPrimeModuli();
+    all_moduli_ = main_moduli_;
+    all_moduli_.insert(all_moduli_.end(), aux_moduli_.begin(),
+                       aux_moduli_.end());
+    prng_ = Prng::Create(kPrngSeed).value();
+  }
+
+  // Returns a small polynomial over all moduli in coefficient form.
+  RnsPolynomial SampleSmall() {
+    RnsPolynomial poly = SampleCenteredBinomial<ModularInt>(
+                             kLogN, /*variance=*/8, all_moduli_, prng_.get())
+                             .value();
+    poly.ConvertToCoeffForm(all_moduli_).IgnoreError();
+    return poly;
+  }
+
+  // Returns the first `num_moduli` residues of `poly`.
+  static RnsPolynomial Truncate(const RnsPolynomial& poly, int num_moduli) {
+    std::vector<std::vector<ModularInt>> coeff_vectors(
+        poly.Coeffs().begin(), poly.Coeffs().begin() + num_moduli);
+    return RnsPolynomial::Create(std::move(coeff_vectors), poly.IsNttForm())
+        .value();
+  }
+
+  std::unique_ptr<const RnsContext> rns_context_;
+  std::vector<const PrimeModulus*> main_moduli_;
+  std::vector<const PrimeModulus*> aux_moduli_;
+  std::vector<const PrimeModulus*> all_moduli_;
+  std::unique_ptr<Prng> prng_;
+};
+
+TEST_F(RnsUtilsTest, ExtendResidueLiftsSmallCoefficients) {
+  RnsPolynomial small = SampleSmall();
+  RnsPolynomial small_main = Truncate(small, main_moduli_.size());
+  for (int index = 0; index < main_moduli_.size(); ++index) {
+    ASSERT_OK_AND_ASSIGN(
+        RnsPolynomial extended,
+        ExtendResidue<ModularInt>(small_main, index, main_moduli_,
+                                  all_moduli_));
+    EXPECT_EQ(extended, small);
+  }
+}
+
+TEST_F(RnsUtilsTest, ExtendResidueFailsIfNttForm) {
+  ASSERT_OK_AND_ASSIGN(auto poly, RnsPolynomial::SampleUniform(
+                                      kLogN, prng_.get(), main_moduli_));
+  EXPECT_THAT(
+      ExtendResidue<ModularInt>(poly, 0, main_moduli_, all_moduli_),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("must be in coefficient form")));
+}
+
+TEST_F(RnsUtilsTest, ModDownDividesByAuxModuli) {
+  ASSERT_OK_AND_ASSIGN(auto mod_down, RnsModDown<ModularInt>::Create(
+                                          main_moduli_, aux_moduli_));
+
+  // x = P * m + r for small m and r, whose division by P rounds to m.
+  RnsPolynomial m = SampleSmall();
+  RnsPolynomial r = SampleSmall();
+  std::vector<std::vector<ModularInt>> x_coeffs = r.Coeffs();
+  for (int i = 0; i < main_moduli_.size(); ++i) {
+    const auto* params = main_moduli_[i]->ModParams();
+    ASSERT_OK_AND_ASSIGN(
+        auto aux_product,
+        ModularInt::ImportInt(kPs[0] % params->modulus, params));
+    for (int c = 0; c < x_coeffs[i].size(); ++c) {
+      x_coeffs[i][c] = x_coeffs[i][c].Add(
+          m.Coeffs()[i][c].Mul(aux_product, params), params);
+    }
+  }
+  ASSERT_OK_AND_ASSIGN(RnsPolynomial x,
+                       RnsPolynomial::Create(std::move(x_coeffs),
+                                             /*is_ntt=*/false));
+  RnsPolynomial expected = Truncate(m, main_moduli_.size());
+
+  ASSERT_OK_AND_ASSIGN(RnsPolynomial x_down, mod_down.Apply(x));
+  EXPECT_EQ(x_down, expected);
+
+  // Same in NTT form.
+  ASSERT_OK(x.ConvertToNttForm(all_moduli_));
+  ASSERT_OK(expected.ConvertToNttForm(main_moduli_));
+  ASSERT_OK_AND_ASSIGN(x_down, mod_down.Apply(x));
+  EXPECT_EQ(x_down, expected);
+}
+
+TEST_F(RnsUtilsTest, ModDownFailsIfNoAuxModuli) {
+  EXPECT_THAT(RnsModDown<ModularInt>::Create(main_moduli_, {}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`aux_moduli` must not be empty")));
+}
+
+}  // namespace
+}  // namespace linpir
+}  // namespace hintless_pir
@@ -25,12 +25,14 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/repeated_ptr_field.h"
 #include "linpir/database.h"
+#include "linpir/hybrid_galois_key.h"
 #include "linpir/parameters.h"
+#include "linpir/rns_utils.h"
+#include "lwe/prng_type.h"
 #include "shell_encryption/prng/prng.h"
-#include "shell_encryption/prng/single_thread_chacha_prng.h"
-#include "shell_encryption/prng/single_thread_hkdf_prng.h"
 #include "shell_encryption/status_macros.h"
 
 namespace hintless_pir {
@@ -43,8 +45,7 @@ Server<RlweInteger>::Create(
     const RnsContext* rns_context,
     const std::vector<Database<RlweInteger>*>& databases,
     absl::string_view prng_seed_ct_pad, absl::string_view prng_seed_gk_pad) {
-  if (!(parameters.prng_type == rlwe::PRNG_TYPE_HKDF ||
-        parameters.prng_type == rlwe::PRNG_TYPE_CHACHA)) {
+  if (!lwe::IsSupportedPrngType(parameters.prng_type)) {
     return absl::InvalidArgumentError("Invalid `prng_type`.");
   }
   if (rns_context == nullptr) {
@@ -52,15 +53,56 @@ Server<RlweInteger>::Create(
   }
 
   auto rns_moduli = rns_context->MainPrimeModuli();
-  int level = rns_moduli.size() - 1;
-  RLWE_ASSIGN_OR_RETURN(auto q_hats,
-                        rns_context->MainPrimeModulusComplements(level));
-  RLWE_ASSIGN_OR_RETURN(auto q_hat_invs,
-                        rns_context->MainPrimeModulusCrtFactors(level));
-  RLWE_ASSIGN_OR_RETURN(
-      RnsGadget rns_gadget,
-      RnsGadget::Create(parameters.log_n, parameters.gadget_log_bs, q_hats,
-                        q_hat_invs, rns_moduli));
+
+  // Hybrid key switching uses the auxiliary moduli of the context in place of
+  // a gadget.
+  std::vector<const PrimeModulus*> aux_moduli;
+  std::unique_ptr<const RnsGadget> rns_gadget;
+  if (!parameters.ps.empty()) {
+    aux_moduli = rns_context->AuxPrimeModuli();
+    if (aux_moduli.size() != parameters.ps.size()) {
+      return absl::InvalidArgumentError(
+          "`rns_context` must have `ps` as its auxiliary moduli.");
+    }
+    for (int k = 0; k < aux_moduli.size(); ++k) {
+      if (aux_moduli[k]->ModParams()->modulus != parameters.ps[k]) {
+        return absl::InvalidArgumentError(
+            "`rns_context` must have `ps` as its auxiliary moduli.");
+      }
+    }
+  } else {
+    int level = rns_moduli.size() - 1;
+    RLWE_ASSIGN_OR_RETURN(auto q_hats,
+                          rns_context->MainPrimeModulusComplements(level));
+    RLWE_ASSIGN_OR_RETURN(auto q_hat_invs,
+                          rns_context->MainPrimeModulusCrtFactors(level));
+    RLWE_ASSIGN_OR_RETURN(
+        RnsGadget gadget,
+        RnsGadget::Create(parameters.log_n, parameters.gadget_log_bs, q_hats,
+                          q_hat_invs, rns_moduli));
+    rns_gadget = std::make_unique<const RnsGadget>(std::move(gadget));
+  }
+
+  // The responses are modulus switched from the moduli `qs` to their leading
+  // `num_response_moduli` members.
+  std::unique_ptr<const RnsModDown<ModularInt>> response_mod_down;
+  if (parameters.num_response_moduli < 0 ||
+      parameters.num_response_moduli > static_cast<int>(rns_moduli.size())) {
+    return absl::InvalidArgumentError(
+        "`num_response_moduli` must be between 0 and the number of `qs`.");
+  }
+  if (parameters.num_response_moduli > 0 &&
+      parameters.num_response_moduli < static_cast<int>(rns_moduli.size())) {
+    absl::Span<const PrimeModulus* const> moduli = rns_moduli;
+    RLWE_ASSIGN_OR_RETURN(
+        auto mod_down,
+        RnsModDown<ModularInt>::Create(
+            moduli.subspan(0, parameters.num_response_moduli),
+            moduli.subspan(parameters.num_response_moduli)));
+    response_mod_down =
+        std::make_unique<const RnsModDown<ModularInt>>(std::move(mod_down));
+  }
+
   RLWE_ASSIGN_OR_RETURN(
       auto rns_error_params,
       RnsErrorParams::Create(
@@ -70,7 +112,8 @@ Server<RlweInteger>::Create(
 
   return absl::WrapUnique(new Server<RlweInteger>(
       parameters, std::string(prng_seed_ct_pad), std::string(prng_seed_gk_pad),
-      rns_context, std::move(rns_moduli), std::move(rns_gadget),
+      rns_context, std::move(rns_moduli), std::move(aux_moduli),
+      std::move(rns_gadget), std::move(response_mod_down),
       std::move(rns_error_params), databases));
 }
 
@@ -81,20 +124,12 @@ Server<RlweInteger>::Create(
     const RnsContext* rns_context,
     const std::vector<Database<RlweInteger>*>& databases) {
   // Sample PRNG seeds for the query vector and the Galois key.
-  std::string prng_seed_ct_pad, prng_seed_gk_pad;
-  if (parameters.prng_type == rlwe::PRNG_TYPE_HKDF) {
-    RLWE_ASSIGN_OR_RETURN(prng_seed_ct_pad,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-    RLWE_ASSIGN_OR_RETURN(prng_seed_gk_pad,
-                          rlwe::SingleThreadHkdfPrng::GenerateSeed());
-  } else if (parameters.prng_type == rlwe::PRNG_TYPE_CHACHA) {
-    RLWE_ASSIGN_OR_RETURN(prng_seed_ct_pad,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-    RLWE_ASSIGN_OR_RETURN(prng_seed_gk_pad,
-                          rlwe::SingleThreadChaChaPrng::GenerateSeed());
-  } else {
-    return absl::InvalidArgumentError("Invalid `prng_type`.");
-  }
+  // The Galois key pads are expanded by SHELL.
+  RLWE_ASSIGN_OR_RETURN(std::string prng_seed_ct_pad,
+                        lwe::GeneratePrngSeed(parameters.prng_type));
+  RLWE_ASSIGN_OR_RETURN(
+      std::string prng_seed_gk_pad,
+      lwe::GeneratePrngSeed(lwe::ShellPrngType(parameters.prng_type)));
 
   return Server<RlweInteger>::Create(parameters, rns_context, databases,
                                      prng_seed_ct_pad, prng_seed_gk_pad);
@@ -106,31 +141,39 @@ absl::Status Server<RlweInteger>::Preprocess() {
   ct_sub_pad_digits_.clear();
   gk_pads_.clear();
 
-  // Create PRNGs.
-  std::unique_ptr<rlwe::SecurePrng> prng_ct, prng_gk;
-  if (params_.prng_type == rlwe::PRNG_TYPE_HKDF) {
-    RLWE_ASSIGN_OR_RETURN(
-        prng_ct, rlwe::SingleThreadHkdfPrng::Create(prng_seed_ct_pad_));
-    RLWE_ASSIGN_OR_RETURN(
-        prng_gk, rlwe::SingleThreadHkdfPrng::Create(prng_seed_gk_pad_));
-  } else {
-    RLWE_ASSIGN_OR_RETURN(
-        prng_ct, rlwe::SingleThreadChaChaPrng::Create(prng_seed_ct_pad_));
-    RLWE_ASSIGN_OR_RETURN(
-        prng_gk, rlwe::SingleThreadChaChaPrng::Create(prng_seed_gk_pad_));
-  }
+  // Create the PRNG of the query pad.
+  RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng_ct,
+                        lwe::CreatePrng(params_.prng_type, prng_seed_ct_pad_));
 
   // Expand seed to the "a" part of Enc(query vector)
   int log_n = rns_context_->LogN();
-  int gadget_dim = rns_gadget_.Dimension();
   RLWE_ASSIGN_OR_RETURN(auto ct_pad, RnsPolynomial::SampleUniform(
                                          log_n, prng_ct.get(), rns_moduli_));
   RLWE_RETURN_IF_ERROR(ct_pad.NegateInPlace(rns_moduli_));
 
   // Create the "a" part of Galois key
-  RLWE_ASSIGN_OR_RETURN(gk_pads_, RnsGaloisKey::SampleRandomPad(
-                                      gadget_dim, log_n, rns_moduli_,
-                                      prng_seed_gk_pad_, params_.prng_type));
+  bool is_hybrid = rns_gadget_ == nullptr;
+  std::vector<const PrimeModulus*> key_moduli = rns_moduli_;
+  std::unique_ptr<RnsModDown<ModularInt>> mod_down;
+  if (is_hybrid) {
+    RLWE_ASSIGN_OR_RETURN(gk_pads_,
+                          HybridGaloisKey::SampleRandomPad(
+                              log_n, rns_moduli_, aux_moduli_,
+                              prng_seed_gk_pad_,
+                              lwe::ShellPrngType(params_.prng_type)));
+    key_moduli.insert(key_moduli.end(), aux_moduli_.begin(),
+                      aux_moduli_.end());
+    RLWE_ASSIGN_OR_RETURN(auto rns_mod_down, RnsModDown<ModularInt>::Create(
+                                                 rns_moduli_, aux_moduli_));
+    mod_down =
+        std::make_unique<RnsModDown<ModularInt>>(std::move(rns_mod_down));
+  } else {
+    RLWE_ASSIGN_OR_RETURN(gk_pads_,
+                          RnsGaloisKey::SampleRandomPad(
+                              rns_gadget_->Dimension(), log_n, rns_moduli_,
+                              prng_seed_gk_pad_,
+                              lwe::ShellPrngType(params_.prng_type)));
+  }
 
   // Precompute the "a" part of Enc(s << i) and the digits used to generate
   // Enc(s << i).
@@ -147,23 +190,33 @@ absl::Status Server<RlweInteger>::Preprocess() {
     RLWE_ASSIGN_OR_RETURN(RnsPolynomial prev_sub_a,
                           ct_pads_[i - 1].Substitute(5, rns_moduli_));
 
-    // g^-1(ct[i-1].a(X^5))
+    // g^-1(ct[i-1].a(X^5)), or its residues mod q_j over the moduli Q * P.
     if (prev_sub_a.IsNttForm()) {
       RLWE_RETURN_IF_ERROR(prev_sub_a.ConvertToCoeffForm(rns_moduli_));
     }
-    RLWE_ASSIGN_OR_RETURN(auto prev_sub_a_digits,
-                          rns_gadget_.Decompose(prev_sub_a, rns_moduli_));
-    for (auto& digit : prev_sub_a_digits) {
-      RLWE_RETURN_IF_ERROR(digit.ConvertToNttForm(rns_moduli_));
+    std::vector<RnsPolynomial> prev_sub_a_digits;
+    if (is_hybrid) {
+      RLWE_ASSIGN_OR_RETURN(prev_sub_a_digits,
+                            HybridGaloisKey::Decompose(prev_sub_a, rns_moduli_,
+                                                       aux_moduli_));
+    } else {
+      RLWE_ASSIGN_OR_RETURN(prev_sub_a_digits,
+                            rns_gadget_->Decompose(prev_sub_a, rns_moduli_));
+      for (auto& digit : prev_sub_a_digits) {
+        RLWE_RETURN_IF_ERROR(digit.ConvertToNttForm(rns_moduli_));
+      }
     }
 
-    // g^-1(ct[i-1].a(X^5))^T * gk.a
+    // g^-1(ct[i-1].a(X^5))^T * gk.a, divided by P when hybrid.
     RLWE_ASSIGN_OR_RETURN(
         auto curr_a,
-        RnsPolynomial::CreateZero(log_n, rns_moduli_, /*is_ntt=*/true));
+        RnsPolynomial::CreateZero(log_n, key_moduli, /*is_ntt=*/true));
     for (int i = 0; i < prev_sub_a_digits.size(); ++i) {
       RLWE_RETURN_IF_ERROR(curr_a.FusedMulAddInPlace(prev_sub_a_digits[i],
-                                                     gk_pads_[i], rns_moduli_));
+                                                     gk_pads_[i], key_moduli));
+    }
+    if (is_hybrid) {
+      RLWE_ASSIGN_OR_RETURN(curr_a, mod_down->Apply(curr_a));
     }
     ct_pads_.push_back(std::move(curr_a));
     ct_sub_pad_digits_.push_back(std::move(prev_sub_a_digits));
@@ -177,87 +230,60 @@ absl::Status Server<RlweInteger>::Preprocess() {
 }
 
 template <typename RlweInteger>
-absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
-    const RnsCiphertext& ct_query, const RnsGaloisKey& gk) const {
-  
-  // Compute all rotations of the query vector.
+absl::StatusOr<std::vector<typename Server<RlweInteger>::RnsCiphertext>>
+Server<RlweInteger>::RotateQuery(const RnsCiphertext& ct_query,
+                                 const RnsGaloisKey& gk) const {
   int num_rotations = params_.rows_per_block / 2;
   std::vector<RnsCiphertext> ct_rotated_queries;
   ct_rotated_queries.reserve(num_rotations);
-  ct_rotated_queries.push_back(std::move(ct_query));
-  
+  ct_rotated_queries.push_back(ct_query);
   for (int i = 1; i < num_rotations; ++i) {
     RLWE_ASSIGN_OR_RETURN(RnsCiphertext ct_sub,
                           ct_rotated_queries[i - 1].Substitute(5));
-    
-    // 【修复点 1】使用 ApplyToWithRandomPad 和预计算的 pads
     RLWE_ASSIGN_OR_RETURN(RnsCiphertext ct_rot,
                           gk.ApplyToWithRandomPad(
                               ct_sub, ct_sub_pad_digits_[i - 1], ct_pads_[i]));
     ct_rotated_queries.push_back(std::move(ct_rot));
   }
-
-  // Compute inner products with the databases and serialize.
-  LinPirResponse response;
-  for (auto const& database : databases_) {
-    LinPirResponse::EncryptedInnerProduct inner_product;
-    
-    // 【修复点 2】使用 InnerProductWithPreprocessedPads
-    RLWE_ASSIGN_OR_RETURN(std::vector<RnsCiphertext> ct_blocks,
-                          database->InnerProductWithPreprocessedPads(ct_rotated_queries));
-                          
-    for (auto const& ct : ct_blocks) {
-      RLWE_ASSIGN_OR_RETURN(RnsPolynomial ct_b, ct.Component(0));
-      RLWE_ASSIGN_OR_RETURN(*inner_product.add_ct_b_blocks(),
-                        ct_b.Serialize(rns_moduli_));
-    }
-    *response.add_ct_inner_products() = std::move(inner_product);
-  }
-  return response;
+  return ct_rotated_queries;
 }
 
 template <typename RlweInteger>
-absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
-    const ::rlwe::SerializedRnsPolynomial& proto_ct_query_b,
-    const google::protobuf::RepeatedPtrField<::rlwe::SerializedRnsPolynomial>&
-        proto_gk_key_bs) const {
-  // Deserialize the "b" components from request and build the query ciphertext
-  // and the Galois key.
-  RLWE_ASSIGN_OR_RETURN(
-      RnsPolynomial ct_query_b,
-      RnsPolynomial::Deserialize(proto_ct_query_b, rns_moduli_));
-  RnsCiphertext ct_query({std::move(ct_query_b), ct_pads_[0]}, rns_moduli_,
-                         /*power_of_s=*/1, /*error=*/0, &rns_error_params_,
-                         rns_context_);
-
-  std::vector<RnsPolynomial> gk_key_bs;
-  gk_key_bs.reserve(proto_gk_key_bs.size());
-  for (int i = 0; i < proto_gk_key_bs.size(); ++i) {
-    RLWE_ASSIGN_OR_RETURN(
-        RnsPolynomial gk_key_b,
-        RnsPolynomial::Deserialize(proto_gk_key_bs[i], rns_moduli_));
-    gk_key_bs.push_back(std::move(gk_key_b));
+absl::StatusOr<std::vector<typename Server<RlweInteger>::RnsCiphertext>>
+Server<RlweInteger>::RotateQuery(const RnsCiphertext& ct_query,
+                                 const HybridGaloisKey& gk) const {
+  int num_rotations = params_.rows_per_block / 2;
+  if (rns_gadget_ != nullptr) {
+    return absl::FailedPreconditionError(
+        "Hybrid Galois keys require non-empty `ps`.");
+  }
+  if (ct_pads_.size() != num_rotations) {
+    return absl::FailedPreconditionError(
+        "Server has not been preprocessed for hybrid key switching.");
   }
-  RLWE_ASSIGN_OR_RETURN(
-      RnsGaloisKey gk,
-      RnsGaloisKey::CreateFromKeyComponents(
-          gk_pads_, std::move(gk_key_bs), /*power=*/5, &rns_gadget_,
-          rns_moduli_, prng_seed_gk_pad_, params_.prng_type));
 
-  // Compute all rotations of the query vector.
-  int num_rotations = params_.rows_per_block / 2;
+  // Only the "b" components are switched here, as the "a" components are the
+  // preprocessed pads.
   std::vector<RnsCiphertext> ct_rotated_queries;
   ct_rotated_queries.reserve(num_rotations);
-  ct_rotated_queries.push_back(std::move(ct_query));
+  ct_rotated_queries.push_back(ct_query);
   for (int i = 1; i < num_rotations; ++i) {
     RLWE_ASSIGN_OR_RETURN(RnsCiphertext ct_sub,
                           ct_rotated_queries[i - 1].Substitute(5));
-    RLWE_ASSIGN_OR_RETURN(RnsCiphertext ct_rot,
-                          gk.ApplyToWithRandomPad(
-                              ct_sub, ct_sub_pad_digits_[i - 1], ct_pads_[i]));
-    ct_rotated_queries.push_back(std::move(ct_rot));
+    RLWE_ASSIGN_OR_RETURN(RnsPolynomial ct_sub_b, ct_sub.Component(0));
+    RLWE_ASSIGN_OR_RETURN(
+        RnsPolynomial ct_rot_b,
+        gk.ApplyToComponentB(std::move(ct_sub_b), ct_sub_pad_digits_[i - 1]));
+    ct_rotated_queries.push_back(RnsCiphertext(
+        {std::move(ct_rot_b), ct_pads_[i]}, rns_moduli_, /*power_of_s=*/1,
+        /*error=*/0, &rns_error_params_, rns_context_));
   }
+  return ct_rotated_queries;
+}
 
+template <typename RlweInteger>
+absl::StatusOr<LinPirResponse> Server<RlweInteger>::InnerProductsWith(
+    const std::vector<RnsCiphertext>& ct_rotated_queries) const {
   // Compute inner products with the databases and serialize them.
   LinPirResponse response;
   response.mutable_ct_inner_products()->Reserve(databases_.size());
@@ -266,20 +292,99 @@ absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
         std::vector<RnsCiphertext> ct_blocks,
         database->InnerProductWithPreprocessedPads(ct_rotated_queries));
     LinPirResponse::EncryptedInnerProduct inner_product;
-    //inner_product.mutable_ct_blocks()->Reserve(ct_blocks.size());
     inner_product.mutable_ct_b_blocks()->Reserve(ct_blocks.size());
     for (auto const& ct : ct_blocks) {
-      //RLWE_ASSIGN_OR_RETURN(*inner_product.add_ct_blocks(), ct.Serialize());
-      //RLWE_ASSIGN_OR_RETURN(*inner_product.add_ct_b_blocks(), ct.Serialize());
       RLWE_ASSIGN_OR_RETURN(RnsPolynomial ct_b, ct.Component(0));
       RLWE_ASSIGN_OR_RETURN(*inner_product.add_ct_b_blocks(),
-                        ct_b.Serialize(rns_moduli_));
+                            SerializeResponseComponent(ct_b));
     }
     *response.add_ct_inner_products() = std::move(inner_product);
   }
   return response;
 }
 
+template <typename RlweInteger>
+absl::StatusOr<rlwe::SerializedRnsPolynomial>
+Server<RlweInteger>::SerializeResponseComponent(const RnsPolynomial& x) const {
+  if (response_mod_down_ == nullptr) {
+    return x.Serialize(rns_moduli_);
+  }
+  // Rounding x * Q' / Q for the product Q' of the response moduli, separately
+  // for the "b" and the "a" components, keeps the ciphertext decryptable under
+  // the secret key modulo Q'.
+  RLWE_ASSIGN_OR_RETURN(RnsPolynomial x_switched, response_mod_down_->Apply(x));
+  return x_switched.Serialize(response_mod_down_->MainModuli());
+}
+
+template <typename RlweInteger>
+absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
+    const RnsCiphertext& ct_query, const RnsGaloisKey& gk) const {
+  // Compute all rotations of the query vector.
+  RLWE_ASSIGN_OR_RETURN(std::vector<RnsCiphertext> ct_rotated_queries,
+                        RotateQuery(ct_query, gk));
+  return InnerProductsWith(ct_rotated_queries);
+}
+
+template <typename RlweInteger>
+absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
+    const RnsCiphertext& ct_query, const HybridGaloisKey& gk) const {
+  // Compute all rotations of the query vector.
+  RLWE_ASSIGN_OR_RETURN(std::vector<RnsCiphertext> ct_rotated_queries,
+                        RotateQuery(ct_query, gk));
+  return InnerProductsWith(ct_rotated_queries);
+}
+
+template <typename RlweInteger>
+absl::StatusOr<typename Server<RlweInteger>::GaloisKey>
+Server<RlweInteger>::DeserializeGaloisKey(
+    const google::protobuf::RepeatedPtrField<::rlwe::SerializedRnsPolynomial>&
+        proto_gk_key_bs) const {
+  // The "b" components of a hybrid key are over the main and the auxiliary
+  // moduli.
+  std::vector<const PrimeModulus*> key_moduli = rns_moduli_;
+  key_moduli.insert(key_moduli.end(), aux_moduli_.begin(), aux_moduli_.end());
+  std::vector<RnsPolynomial> gk_key_bs;
+  gk_key_bs.reserve(proto_gk_key_bs.size());
+  for (const auto& proto_gk_key_b : proto_gk_key_bs) {
+    RLWE_ASSIGN_OR_RETURN(
+        RnsPolynomial gk_key_b,
+        RnsPolynomial::Deserialize(proto_gk_key_b, key_moduli));
+    gk_key_bs.push_back(std::move(gk_key_b));
+  }
+
+  if (rns_gadget_ == nullptr) {
+    RLWE_ASSIGN_OR_RETURN(HybridGaloisKey gk,
+                          HybridGaloisKey::CreateFromKeyComponents(
+                              gk_pads_, std::move(gk_key_bs), /*power=*/5,
+                              rns_moduli_, aux_moduli_));
+    return GaloisKey(std::move(gk));
+  }
+  RLWE_ASSIGN_OR_RETURN(
+      RnsGaloisKey gk,
+      RnsGaloisKey::CreateFromKeyComponents(
+          gk_pads_, std::move(gk_key_bs), /*power=*/5, rns_gadget_.get(),
+          rns_moduli_, prng_seed_gk_pad_,
+          lwe::ShellPrngType(params_.prng_type)));
+  return GaloisKey(std::move(gk));
+}
+
+template <typename RlweInteger>
+absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
+    const ::rlwe::SerializedRnsPolynomial& proto_ct_query_b,
+    const google::protobuf::RepeatedPtrField<::rlwe::SerializedRnsPolynomial>&
+        proto_gk_key_bs) const {
+  // Deserialize the "b" components from request and build the query ciphertext
+  // and the Galois key.
+  RLWE_ASSIGN_OR_RETURN(
+      RnsPolynomial ct_query_b,
+      RnsPolynomial::Deserialize(proto_ct_query_b, rns_moduli_));
+  RnsCiphertext ct_query({std::move(ct_query_b), ct_pads_[0]}, rns_moduli_,
+                         /*power_of_s=*/1, /*error=*/0, &rns_error_params_,
+                         rns_context_);
+  RLWE_ASSIGN_OR_RETURN(GaloisKey gk, DeserializeGaloisKey(proto_gk_key_bs));
+  return HandleRequest(ct_query, gk);
+}
+
 template <typename RlweInteger>
 absl::StatusOr<LinPirResponse> Server<RlweInteger>::GetResponsePads() const {
   if (databases_.empty() || !databases_[0]->IsPreprocessed()) {
@@ -296,7 +401,7 @@ absl::StatusOr<LinPirResponse> Server<RlweInteger>::GetResponsePads() const {
     inner_product.mutable_ct_b_blocks()->Reserve(pad_inner_products.size());
     for (const auto& pad : pad_inner_products) {
       RLWE_ASSIGN_OR_RETURN(*inner_product.add_ct_b_blocks(),
-                            pad.Serialize(rns_moduli_));
+                            SerializeResponseComponent(pad));
     }
     *response_pads.add_ct_inner_products() = std::move(inner_product);
   }
@@ -325,29 +430,18 @@ absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
   // 2. Handle Galois Key (gk) with Session Caching
   if (request.gk_key_bs_size() > 0) {
     // 情况 A: 请求中包含了 Key (首次请求 或 无状态模式)
-    std::vector<RnsPolynomial> gk_key_bs;
-    gk_key_bs.reserve(request.gk_key_bs_size());
-    for (const auto& proto_poly : request.gk_key_bs()) {
-      RLWE_ASSIGN_OR_RETURN(
-          RnsPolynomial gk_key_b,
-          RnsPolynomial::Deserialize(proto_poly, rns_moduli_));
-      gk_key_bs.push_back(std::move(gk_key_b));
-    }
-    
-    RLWE_ASSIGN_OR_RETURN(
-        RnsGaloisKey gk,
-        RnsGaloisKey::CreateFromKeyComponents(
-            gk_pads_, std::move(gk_key_bs), /*power=*/5, &rns_gadget_,
-            rns_moduli_, prng_seed_gk_pad_, params_.prng_type));
+    RLWE_ASSIGN_OR_RETURN(GaloisKey gk,
+                          DeserializeGaloisKey(request.gk_key_bs()));
 
     if (request.has_client_id()) {
-        // 如果有 client_id，将 Key 存入缓存
-        // 先删除旧的（如果存在），避免潜在的冲突
-        gk_cache_.erase(request.client_id());
-        // 存入新 Key
-        auto insert_result = gk_cache_.emplace(request.client_id(), std::move(gk));
+        // 如果有 client_id，将 Key 存入缓存（替换旧的 Key）
+        auto cached_gk = std::make_shared<const GaloisKey>(std::move(gk));
+        {
+          absl::MutexLock lock(&gk_cache_mutex_);
+          gk_cache_[request.client_id()] = cached_gk;
+        }
         // 使用缓存中的 Key 进行计算
-        return HandleRequest(ct_query, insert_result.first->second);
+        return HandleRequest(ct_query, *cached_gk);
     } else {
         // 无状态模式，直接使用生成的 Key
         return HandleRequest(ct_query, gk);
@@ -358,15 +452,22 @@ absl::StatusOr<LinPirResponse> Server<RlweInteger>::HandleRequest(
         return absl::InvalidArgumentError("Missing Galois Key and Client ID.");
     }
     
-    // 在 gk_cache_ 中查找
-    auto it = gk_cache_.find(request.client_id());
-    if (it == gk_cache_.end()) {
+    // 在 gk_cache_ 中查找；只在查找时持有锁，计算时不持有
+    std::shared_ptr<const GaloisKey> cached_gk;
+    {
+      absl::MutexLock lock(&gk_cache_mutex_);
+      auto it = gk_cache_.find(request.client_id());
+      if (it != gk_cache_.end()) {
+        cached_gk = it->second;
+      }
+    }
+    if (cached_gk == nullptr) {
         return absl::InvalidArgumentError(
             "Session key not found or expired for client ID: " + request.client_id());
     }
     
     // 使用缓存中的 Key，调用底层的 HandleRequest
-    return HandleRequest(ct_query, it->second);
+    return HandleRequest(ct_query, *cached_gk);
   }
 }
 
@@ -16,18 +16,24 @@
 #ifndef HINTLESS_PIR_LINPIR_SERVER_H_
 #define HINTLESS_PIR_LINPIR_SERVER_H_
 
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <variant>
 #include <vector>
-#include <map>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "google/protobuf/repeated_ptr_field.h"
 #include "linpir/database.h"
+#include "linpir/hybrid_galois_key.h"
 #include "linpir/parameters.h"
+#include "linpir/rns_utils.h"
 #include "linpir/serialization.pb.h"
 #include "shell_encryption/montgomery.h"
 #include "shell_encryption/rns/rns_bfv_ciphertext.h"
@@ -59,6 +65,7 @@ class Server {
   using RnsCiphertext = rlwe::RnsBfvCiphertext<ModularInt>;
   using RnsErrorParams = rlwe::RnsErrorParams<ModularInt>;
   using PrimeModulus = rlwe::PrimeModulus<ModularInt>;
+  using HybridGaloisKey = linpir::HybridGaloisKey<ModularInt>;
 
   // Creates a LinPIR server which holds the matrices stored in the databases.
   // The server holds freshly generated PRNG seeds for the "a" components of
@@ -83,6 +90,8 @@ class Server {
 
   // Process a serialized LinPir request.
   // This variant requires the server and the database are preprocessed.
+  // Galois keys sent along with a `client_id` are cached for the subsequent
+  // requests of that client. Safe to call concurrently from multiple threads.
   absl::StatusOr<LinPirResponse> HandleRequest(
       const LinPirRequest& request) const;
       
@@ -103,6 +112,12 @@ class Server {
   absl::StatusOr<LinPirResponse> HandleRequest(const RnsCiphertext& ct_query,
                                                const RnsGaloisKey& gk) const;
 
+  // Process a LinPir request represented by a ciphertext encrypting the vector
+  // and a Galois key for hybrid key switching.
+  // This variant requires the server is preprocessed with non-empty `ps`.
+  absl::StatusOr<LinPirResponse> HandleRequest(
+      const RnsCiphertext& ct_query, const HybridGaloisKey& gk) const;
+
 // Returns the "a" components of the LinPir response ciphertexts.
   absl::StatusOr<LinPirResponse> GetResponsePads() const;
 
@@ -114,22 +129,72 @@ class Server {
     return prng_seed_gk_pad_;
   }
 
+  // Returns the "a" components of Enc(s << i) computed by `Preprocess()`, which
+  // are used to preprocess the databases.
+  absl::Span<const RnsPolynomial> RotatedCiphertextPads() const {
+    return ct_pads_;
+  }
+
+  // Returns the gadget decompositions of the substituted pads, where the i'th
+  // entry is used to rotate Enc(s << i) into Enc(s << (i + 1)). With non-empty
+  // `ps`, these are the residues modulo `qs` over the moduli `qs` and `ps`.
+  absl::Span<const std::vector<RnsPolynomial>> SubstitutedPadDigits() const {
+    return ct_sub_pad_digits_;
+  }
+
  private:
+  // A Galois key of either kind, as selected by `ps`.
+  using GaloisKey = std::variant<RnsGaloisKey, HybridGaloisKey>;
+
   explicit Server(RlweParameters<RlweInteger> params,
                   std::string prng_seed_ct_pad, std::string prng_seed_gk_pad,
                   const RnsContext* rns_context,
                   std::vector<const PrimeModulus*> rns_moduli,
-                  RnsGadget rns_gadget, RnsErrorParams rns_error_params,
+                  std::vector<const PrimeModulus*> aux_moduli,
+                  std::unique_ptr<const RnsGadget> rns_gadget,
+                  std::unique_ptr<const RnsModDown<ModularInt>>
+                      response_mod_down,
+                  RnsErrorParams rns_error_params,
                   std::vector<Database<RlweInteger>*> databases)
       : params_(std::move(params)),
         prng_seed_ct_pad_(std::move(prng_seed_ct_pad)),
         prng_seed_gk_pad_(std::move(prng_seed_gk_pad)),
         rns_context_(rns_context),
         rns_moduli_(std::move(rns_moduli)),
-        rns_error_params_(std::move(rns_error_params)),
+        aux_moduli_(std::move(aux_moduli)),
         rns_gadget_(std::move(rns_gadget)),
+        response_mod_down_(std::move(response_mod_down)),
+        rns_error_params_(std::move(rns_error_params)),
         databases_(std::move(databases)) {}
 
+  // Builds the Galois key from its serialized "b" components and the
+  // preprocessed pads.
+  absl::StatusOr<GaloisKey> DeserializeGaloisKey(
+      const google::protobuf::RepeatedPtrField<rlwe::SerializedRnsPolynomial>&
+          proto_gk_key_bs) const;
+
+  // Returns Enc(s << i) for all rotations i of `ct_query`.
+  absl::StatusOr<std::vector<RnsCiphertext>> RotateQuery(
+      const RnsCiphertext& ct_query, const RnsGaloisKey& gk) const;
+  absl::StatusOr<std::vector<RnsCiphertext>> RotateQuery(
+      const RnsCiphertext& ct_query, const HybridGaloisKey& gk) const;
+
+  // Serializes a component of a response ciphertext or of its pad, modulus
+  // switched to the leading `num_response_moduli` moduli if set.
+  absl::StatusOr<rlwe::SerializedRnsPolynomial> SerializeResponseComponent(
+      const RnsPolynomial& x) const;
+
+  // Computes the inner products of the rotated query with the databases.
+  absl::StatusOr<LinPirResponse> InnerProductsWith(
+      const std::vector<RnsCiphertext>& ct_rotated_queries) const;
+
+  // Processes a request with a Galois key of either kind.
+  absl::StatusOr<LinPirResponse> HandleRequest(const RnsCiphertext& ct_query,
+                                               const GaloisKey& gk) const {
+    return std::visit(
+        [&](const auto& key) { return HandleRequest(ct_query, key); }, gk);
+  }
+
   const RlweParameters<RlweInteger> params_;
 
   std::string prng_seed_ct_pad_;
@@ -137,7 +202,12 @@ class Server {
 
   const RnsContext* rns_context_;
   const std::vector<const PrimeModulus*> rns_moduli_;
-  const RnsGadget rns_gadget_;
+  // The auxiliary moduli for hybrid key switching, and the gadget otherwise.
+  const std::vector<const PrimeModulus*> aux_moduli_;
+  const std::unique_ptr<const RnsGadget> rns_gadget_;
+  // Switches the responses to the leading `num_response_moduli` moduli, or
+  // null if the responses are over all moduli.
+  const std::unique_ptr<const RnsModDown<ModularInt>> response_mod_down_;
   const RnsErrorParams rns_error_params_;
 
   // Holding the matrices via mutable pointers to perform preprocessing tasks.
@@ -148,7 +218,11 @@ class Server {
   std::vector<std::vector<RnsPolynomial>> ct_sub_pad_digits_;
   std::vector<RnsPolynomial> gk_pads_;
 
-  mutable std::map<std::string, RnsGaloisKey> gk_cache_;
+  // Galois keys of client sessions, indexed by client id. Entries are shared
+  // so that a key can be replaced while requests using it are in flight.
+  mutable absl::Mutex gk_cache_mutex_;
+  mutable std::map<std::string, std::shared_ptr<const GaloisKey>> gk_cache_
+      ABSL_GUARDED_BY(gk_cache_mutex_);
 };
 
 }  // namespace linpir
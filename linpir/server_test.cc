@@ -208,6 +208,20 @@ TEST_F(ServerTest, CreateFailsIfInvalidPrngType) {
                        HasSubstr("Invalid `prng_type`")));
 }
 
+TEST_F(ServerTest, CreateFailsIfTooManyResponseModuli) {
+  RlweParameters<Integer> invalid_params = kRlweParameters;
+  invalid_params.num_response_moduli = kRlweParameters.qs.size() + 1;
+
+  std::vector<Integer> row(1, 0);
+  ASSERT_OK_AND_ASSIGN(auto database,
+                       Database<Integer>::Create(
+                           this->params_, this->rns_context_.get(), {row}));
+  EXPECT_THAT(Server<Integer>::Create(invalid_params, this->rns_context_.get(),
+                                      {database.get()}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("`num_response_moduli` must be between")));
+}
+
 TEST_F(ServerTest, CreateWithPrngSeedsFailsIfInvalidPrngType) {
   RlweParameters<Integer> invalid_params = kRlweParameters;
   invalid_params.prng_type = rlwe::PRNG_TYPE_INVALID;
@@ -0,0 +1,346 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lwe/aes_ctr_prng.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "shell_encryption/integral_types.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/status_macros.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HINTLESS_PIR_AES_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_AES)
+#include <arm_neon.h>
+#define HINTLESS_PIR_AES_ARM 1
+#endif
+
+namespace hintless_pir {
+namespace lwe {
+namespace internal {
+namespace {
+
+constexpr int kNumRounds = 10;
+constexpr int kBlockBytes = 16;
+
+// clang-format off
+constexpr uint8_t kSbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
+    0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26,
+    0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
+    0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
+    0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f,
+    0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec,
+    0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14,
+    0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
+    0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f,
+    0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
+    0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
+    0xb0, 0x54, 0xbb, 0x16};
+// clang-format on
+
+// Multiplication by x in GF(2^8) modulo x^8 + x^4 + x^3 + x + 1.
+inline uint8_t XTime(uint8_t x) {
+  return static_cast<uint8_t>((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+// Encrypts the blocks at `data` in place, following FIPS-197 on a state
+// stored column by column.
+void EncryptBlocksPortable(const uint8_t* round_keys, uint8_t* data,
+                           size_t num_blocks) {
+  for (size_t i = 0; i < num_blocks; ++i) {
+    uint8_t* block = data + i * kBlockBytes;
+    uint8_t state[kBlockBytes];
+    for (int j = 0; j < kBlockBytes; ++j) {
+      state[j] = block[j] ^ round_keys[j];
+    }
+    for (int round = 1; round <= kNumRounds; ++round) {
+      // SubBytes and ShiftRows.
+      uint8_t t[kBlockBytes];
+      for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+          t[4 * c + r] = kSbox[state[4 * ((c + r) % 4) + r]];
+        }
+      }
+      // MixColumns, except in the last round.
+      if (round < kNumRounds) {
+        for (int c = 0; c < 4; ++c) {
+          uint8_t* col = t + 4 * c;
+          uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+          uint8_t u = a0 ^ a1 ^ a2 ^ a3;
+          col[0] = a0 ^ u ^ XTime(a0 ^ a1);
+          col[1] = a1 ^ u ^ XTime(a1 ^ a2);
+          col[2] = a2 ^ u ^ XTime(a2 ^ a3);
+          col[3] = a3 ^ u ^ XTime(a3 ^ a0);
+        }
+      }
+      // AddRoundKey.
+      const uint8_t* round_key = round_keys + round * kBlockBytes;
+      for (int j = 0; j < kBlockBytes; ++j) {
+        state[j] = t[j] ^ round_key[j];
+      }
+    }
+    std::memcpy(block, state, kBlockBytes);
+  }
+}
+
+#if defined(HINTLESS_PIR_AES_X86)
+
+// Encrypts the blocks at `data` in place with AES-NI, interleaving 8 blocks
+// to hide the latency of the AES instructions.
+__attribute__((target("aes,sse2"))) void EncryptBlocksHardware(
+    const uint8_t* round_keys, uint8_t* data, size_t num_blocks) {
+  constexpr int kLanes = 8;
+  __m128i keys[kNumRounds + 1];
+  for (int r = 0; r <= kNumRounds; ++r) {
+    keys[r] = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(round_keys + r * kBlockBytes));
+  }
+  auto* blocks = reinterpret_cast<__m128i*>(data);
+  size_t i = 0;
+  for (; i + kLanes <= num_blocks; i += kLanes) {
+    __m128i b[kLanes];
+    for (int j = 0; j < kLanes; ++j) {
+      b[j] = _mm_xor_si128(_mm_loadu_si128(blocks + i + j), keys[0]);
+    }
+    for (int r = 1; r < kNumRounds; ++r) {
+      for (int j = 0; j < kLanes; ++j) {
+        b[j] = _mm_aesenc_si128(b[j], keys[r]);
+      }
+    }
+    for (int j = 0; j < kLanes; ++j) {
+      _mm_storeu_si128(blocks + i + j,
+                       _mm_aesenclast_si128(b[j], keys[kNumRounds]));
+    }
+  }
+  for (; i < num_blocks; ++i) {
+    __m128i b = _mm_xor_si128(_mm_loadu_si128(blocks + i), keys[0]);
+    for (int r = 1; r < kNumRounds; ++r) {
+      b = _mm_aesenc_si128(b, keys[r]);
+    }
+    _mm_storeu_si128(blocks + i, _mm_aesenclast_si128(b, keys[kNumRounds]));
+  }
+}
+
+bool CpuHasAes() { return __builtin_cpu_supports("aes"); }
+
+#elif defined(HINTLESS_PIR_AES_ARM)
+
+// Encrypts the blocks at `data` in place with the ARMv8 cryptography
+// extensions, where AESE also adds the round key before SubBytes.
+void EncryptBlocksHardware(const uint8_t* round_keys, uint8_t* data,
+                           size_t num_blocks) {
+  uint8x16_t keys[kNumRounds + 1];
+  for (int r = 0; r <= kNumRounds; ++r) {
+    keys[r] = vld1q_u8(round_keys + r * kBlockBytes);
+  }
+  for (size_t i = 0; i < num_blocks; ++i) {
+    uint8x16_t b = vld1q_u8(data + i * kBlockBytes);
+    for (int r = 0; r < kNumRounds - 1; ++r) {
+      b = vaesmcq_u8(vaeseq_u8(b, keys[r]));
+    }
+    b = veorq_u8(vaeseq_u8(b, keys[kNumRounds - 1]), keys[kNumRounds]);
+    vst1q_u8(data + i * kBlockBytes, b);
+  }
+}
+
+bool CpuHasAes() { return true; }
+
+#else
+
+void EncryptBlocksHardware(const uint8_t* round_keys, uint8_t* data,
+                           size_t num_blocks) {
+  EncryptBlocksPortable(round_keys, data, num_blocks);
+}
+
+bool CpuHasAes() { return false; }
+
+#endif
+
+}  // namespace
+
+void ExpandAes128Key(const uint8_t* key, uint8_t* round_keys) {
+  std::memcpy(round_keys, key, kBlockBytes);
+  uint8_t rcon = 1;
+  for (int i = 4; i < 4 * (kNumRounds + 1); ++i) {
+    const uint8_t* prev = round_keys + 4 * (i - 1);
+    uint8_t temp[4] = {prev[0], prev[1], prev[2], prev[3]};
+    if (i % 4 == 0) {
+      // RotWord, SubWord and the round constant.
+      uint8_t t0 = temp[0];
+      temp[0] = kSbox[temp[1]] ^ rcon;
+      temp[1] = kSbox[temp[2]];
+      temp[2] = kSbox[temp[3]];
+      temp[3] = kSbox[t0];
+      rcon = XTime(rcon);
+    }
+    for (int j = 0; j < 4; ++j) {
+      round_keys[4 * i + j] = round_keys[4 * (i - 4) + j] ^ temp[j];
+    }
+  }
+}
+
+void AesCtrBlocks(const uint8_t* round_keys, absl::uint128 counter,
+                  size_t num_blocks, uint8_t* out, bool use_hardware) {
+  for (size_t i = 0; i < num_blocks; ++i, ++counter) {
+    absl::big_endian::Store64(out + i * kBlockBytes,
+                              absl::Uint128High64(counter));
+    absl::big_endian::Store64(out + i * kBlockBytes + 8,
+                              absl::Uint128Low64(counter));
+  }
+  if (use_hardware) {
+    EncryptBlocksHardware(round_keys, out, num_blocks);
+  } else {
+    EncryptBlocksPortable(round_keys, out, num_blocks);
+  }
+}
+
+}  // namespace internal
+
+AesCtrPrng::AesCtrPrng(absl::string_view seed, bool use_hardware)
+    : use_hardware_(use_hardware), buffer_pos_(kBufferBlocks * kBlockBytes) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(seed.data());
+  internal::ExpandAes128Key(bytes, round_keys_.data());
+  initial_counter_ =
+      absl::MakeUint128(absl::big_endian::Load64(bytes + 16),
+                        absl::big_endian::Load64(bytes + 24));
+  counter_ = initial_counter_;
+}
+
+absl::StatusOr<std::unique_ptr<AesCtrPrng>> AesCtrPrng::Create(
+    absl::string_view seed) {
+  if (seed.size() != kSeedLength) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("The seed must be ", kSeedLength, " bytes, got ",
+                     seed.size(), "."));
+  }
+  return absl::WrapUnique(new AesCtrPrng(seed, HasHardwareAes()));
+}
+
+bool AesCtrPrng::HasHardwareAes() {
+  static const bool has_hardware_aes = internal::CpuHasAes();
+  return has_hardware_aes;
+}
+
+absl::StatusOr<std::string> AesCtrPrng::GenerateSeed() {
+  // Draw the seed from an HKDF PRNG freshly seeded from the system's entropy.
+  RLWE_ASSIGN_OR_RETURN(std::string hkdf_seed,
+                        rlwe::SingleThreadHkdfPrng::GenerateSeed());
+  RLWE_ASSIGN_OR_RETURN(auto prng,
+                        rlwe::SingleThreadHkdfPrng::Create(hkdf_seed));
+  std::string seed(kSeedLength, '\0');
+  for (char& c : seed) {
+    RLWE_ASSIGN_OR_RETURN(rlwe::Uint8 byte, prng->Rand8());
+    c = static_cast<char>(byte);
+  }
+  return seed;
+}
+
+void AesCtrPrng::NextBlocks(size_t num_blocks, uint8_t* out) {
+  internal::AesCtrBlocks(round_keys_.data(), counter_, num_blocks, out,
+                         use_hardware_);
+  counter_ += num_blocks;
+}
+
+void AesCtrPrng::Refill() {
+  NextBlocks(kBufferBlocks, buffer_.data());
+  buffer_pos_ = 0;
+}
+
+absl::StatusOr<rlwe::Uint8> AesCtrPrng::Rand8() {
+  if (buffer_pos_ == buffer_.size()) {
+    Refill();
+  }
+  return buffer_[buffer_pos_++];
+}
+
+absl::StatusOr<rlwe::Uint64> AesCtrPrng::Rand64() {
+  uint8_t bytes[8];
+  Fill(absl::MakeSpan(bytes));
+  return absl::little_endian::Load64(bytes);
+}
+
+void AesCtrPrng::Fill(absl::Span<uint8_t> out) {
+  if (out.empty()) {
+    return;
+  }
+  uint8_t* dst = out.data();
+  size_t size = out.size();
+
+  // Drain the buffered keystream first.
+  size_t num_buffered = std::min(size, buffer_.size() - buffer_pos_);
+  std::memcpy(dst, buffer_.data() + buffer_pos_, num_buffered);
+  buffer_pos_ += num_buffered;
+  dst += num_buffered;
+  size -= num_buffered;
+
+  // Write whole blocks directly to `out`, and buffer the last partial block.
+  size_t num_blocks = size / kBlockBytes;
+  NextBlocks(num_blocks, dst);
+  dst += num_blocks * kBlockBytes;
+  size -= num_blocks * kBlockBytes;
+  if (size > 0) {
+    Refill();
+    std::memcpy(dst, buffer_.data(), size);
+    buffer_pos_ = size;
+  }
+}
+
+void AesCtrPrng::FillUint32(absl::Span<uint32_t> out) {
+  Fill(absl::MakeSpan(reinterpret_cast<uint8_t*>(out.data()),
+                      out.size() * sizeof(uint32_t)));
+  if constexpr (!absl::little_endian::IsLittleEndian()) {
+    for (uint32_t& x : out) {
+      x = absl::little_endian::Load32(&x);
+    }
+  }
+}
+
+void AesCtrPrng::Seek(absl::uint128 offset) {
+  counter_ = initial_counter_ + offset / kBlockBytes;
+  buffer_pos_ = buffer_.size();
+  size_t block_offset = static_cast<size_t>(offset % kBlockBytes);
+  if (block_offset > 0) {
+    Refill();
+    buffer_pos_ = block_offset;
+  }
+}
+
+}  // namespace lwe
+}  // namespace hintless_pir
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_LWE_AES_CTR_PRNG_H_
+#define HINTLESS_PIR_LWE_AES_CTR_PRNG_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "shell_encryption/integral_types.h"
+#include "shell_encryption/prng/prng.h"
+
+namespace hintless_pir {
+namespace lwe {
+
+namespace internal {
+
+// Number of bytes of the expanded AES-128 key schedule.
+inline constexpr int kAes128RoundKeyBytes = 176;
+
+// Expands the 16-byte AES-128 `key` into `round_keys`.
+void ExpandAes128Key(const uint8_t* key, uint8_t* round_keys);
+
+// Writes to `out` the AES-128 encryptions under `round_keys` of `num_blocks`
+// consecutive 128-bit big-endian counter blocks starting at `counter`. Uses
+// the AES instructions of the CPU iff `use_hardware`, which requires
+// `AesCtrPrng::HasHardwareAes()`; exposed for testing.
+void AesCtrBlocks(const uint8_t* round_keys, absl::uint128 counter,
+                  size_t num_blocks, uint8_t* out, bool use_hardware);
+
+}  // namespace internal
+
+// A PRNG producing the AES-128 keystream in counter mode. The 32-byte seed is
+// the AES key followed by the initial counter block.
+//
+// Unlike the HKDF and ChaCha PRNGs of SHELL, the keystream is produced many
+// blocks at a time with AES-NI or the ARMv8 cryptography extensions when
+// available, and `Fill()` writes it directly into bulk buffers such as the
+// LWE query pad.
+class AesCtrPrng : public rlwe::SecurePrng {
+ public:
+  static absl::StatusOr<std::unique_ptr<AesCtrPrng>> Create(
+      absl::string_view seed);
+
+  absl::StatusOr<rlwe::Uint8> Rand8() override;
+
+  // Returns the next 8 bytes of the keystream as a little-endian integer.
+  absl::StatusOr<rlwe::Uint64> Rand64() override;
+
+  // Fills `out` with the next bytes of the keystream.
+  void Fill(absl::Span<uint8_t> out);
+
+  // Fills `out` with the next 4 * `out.size()` bytes of the keystream, read as
+  // little-endian integers. This yields the same values as splitting the
+  // results of `Rand64()` into their low and high halves.
+  void FillUint32(absl::Span<uint32_t> out);
+
+  // Moves to byte `offset` of the keystream, counted from the start of the
+  // keystream of the seed. Counter mode makes this constant time, so disjoint
+  // ranges of the keystream can be generated independently.
+  void Seek(absl::uint128 offset);
+
+  static absl::StatusOr<std::string> GenerateSeed();
+
+  static int SeedLength() { return kSeedLength; }
+
+  // Returns whether the CPU has AES instructions usable by this class.
+  static bool HasHardwareAes();
+
+ private:
+  static constexpr int kSeedLength = 32;
+  static constexpr int kBlockBytes = 16;
+  // The keystream is produced in batches of this many blocks.
+  static constexpr int kBufferBlocks = 64;
+
+  AesCtrPrng(absl::string_view seed, bool use_hardware);
+
+  // Writes the next `num_blocks` blocks of the keystream to `out`.
+  void NextBlocks(size_t num_blocks, uint8_t* out);
+
+  // Refills `buffer_` with the next batch of the keystream.
+  void Refill();
+
+  std::array<uint8_t, internal::kAes128RoundKeyBytes> round_keys_;
+  // The counter block given by the seed, and the next counter block.
+  absl::uint128 initial_counter_;
+  absl::uint128 counter_;
+  const bool use_hardware_;
+
+  std::array<uint8_t, kBufferBlocks * kBlockBytes> buffer_;
+  // Number of bytes of `buffer_` already consumed.
+  size_t buffer_pos_;
+};
+
+}  // namespace lwe
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_LWE_AES_CTR_PRNG_H_
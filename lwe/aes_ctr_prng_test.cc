@@ -0,0 +1,172 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lwe/aes_ctr_prng.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/numeric/int128.h"
+#include "absl/status/status.h"
+#include "absl/strings/escaping.h"
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "shell_encryption/testing/status_matchers.h"
+#include "shell_encryption/testing/status_testing.h"
+
+namespace hintless_pir {
+namespace lwe {
+namespace {
+
+using ::rlwe::testing::StatusIs;
+using ::testing::ElementsAreArray;
+
+std::vector<uint8_t> HexToBytes(absl::string_view hex) {
+  std::string bytes = absl::HexStringToBytes(hex);
+  return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+std::vector<bool> HardwareOptions() {
+  if (AesCtrPrng::HasHardwareAes()) {
+    return {false, true};
+  }
+  return {false};
+}
+
+TEST(AesCtrPrngTest, Fips197KnownAnswer) {
+  // FIPS-197, Appendix C.1.
+  std::vector<uint8_t> key = HexToBytes("000102030405060708090a0b0c0d0e0f");
+  absl::uint128 plaintext =
+      absl::MakeUint128(0x0011223344556677ULL, 0x8899aabbccddeeffULL);
+  std::vector<uint8_t> expected =
+      HexToBytes("69c4e0d86a7b0430d8cdb78070b4c55a");
+  uint8_t round_keys[internal::kAes128RoundKeyBytes];
+  internal::ExpandAes128Key(key.data(), round_keys);
+  for (bool use_hardware : HardwareOptions()) {
+    uint8_t block[16];
+    internal::AesCtrBlocks(round_keys, plaintext, 1, block, use_hardware);
+    EXPECT_THAT(block, ElementsAreArray(expected));
+  }
+}
+
+TEST(AesCtrPrngTest, Sp80038aCounterModeKeystream) {
+  // NIST SP 800-38A, F.5.1: the output blocks of CTR-AES128.Encrypt.
+  std::string seed =
+      absl::HexStringToBytes("2b7e151628aed2a6abf7158809cf4f3c"
+                             "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");
+  std::vector<uint8_t> expected =
+      HexToBytes("ec8cdf7398607cb0f2d21675ea9ea1e4"
+                 "362b7c3c6773516318a077d7fc5073ae"
+                 "6a2cc3787889374fbeb4c81b17ba6c44"
+                 "e89c399ff0f198c6d40a31db156cabfe");
+  ASSERT_OK_AND_ASSIGN(auto prng, AesCtrPrng::Create(seed));
+  std::vector<uint8_t> keystream(expected.size());
+  prng->Fill(absl::MakeSpan(keystream));
+  EXPECT_EQ(keystream, expected);
+}
+
+TEST(AesCtrPrngTest, HardwareMatchesPortable) {
+  if (!AesCtrPrng::HasHardwareAes()) {
+    GTEST_SKIP() << "No AES instructions on this CPU.";
+  }
+  std::vector<uint8_t> key = HexToBytes("2b7e151628aed2a6abf7158809cf4f3c");
+  uint8_t round_keys[internal::kAes128RoundKeyBytes];
+  internal::ExpandAes128Key(key.data(), round_keys);
+  // Not a multiple of the interleaving width, and wrapping the counter.
+  constexpr int kNumBlocks = 37;
+  absl::uint128 counter = absl::Uint128Max() - 5;
+  std::vector<uint8_t> portable(16 * kNumBlocks), hardware(16 * kNumBlocks);
+  internal::AesCtrBlocks(round_keys, counter, kNumBlocks, portable.data(),
+                         /*use_hardware=*/false);
+  internal::AesCtrBlocks(round_keys, counter, kNumBlocks, hardware.data(),
+                         /*use_hardware=*/true);
+  EXPECT_EQ(portable, hardware);
+}
+
+TEST(AesCtrPrngTest, CreateFailsWithInvalidSeedLength) {
+  EXPECT_THAT(AesCtrPrng::Create(std::string(16, 'a')),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(AesCtrPrngTest, GenerateSeed) {
+  ASSERT_OK_AND_ASSIGN(std::string seed0, AesCtrPrng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(std::string seed1, AesCtrPrng::GenerateSeed());
+  EXPECT_EQ(seed0.size(), AesCtrPrng::SeedLength());
+  EXPECT_NE(seed0, seed1);
+}
+
+TEST(AesCtrPrngTest, OutputsFollowTheKeystream) {
+  ASSERT_OK_AND_ASSIGN(std::string seed, AesCtrPrng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(auto expected_prng, AesCtrPrng::Create(seed));
+  // Long enough to refill the internal buffer several times.
+  std::vector<uint8_t> keystream(5000);
+  expected_prng->Fill(absl::MakeSpan(keystream));
+
+  // Consume the same keystream with mixed calls crossing buffer boundaries.
+  ASSERT_OK_AND_ASSIGN(auto prng, AesCtrPrng::Create(seed));
+  std::vector<uint8_t> output;
+  ASSERT_OK_AND_ASSIGN(uint8_t byte, prng->Rand8());
+  output.push_back(byte);
+  ASSERT_OK_AND_ASSIGN(uint64_t word, prng->Rand64());
+  for (int i = 0; i < 8; ++i) {
+    output.push_back(static_cast<uint8_t>(word >> (8 * i)));
+  }
+  for (int size : {7, 1017, 16, 2048, 3}) {
+    std::vector<uint8_t> chunk(size);
+    prng->Fill(absl::MakeSpan(chunk));
+    output.insert(output.end(), chunk.begin(), chunk.end());
+  }
+  while (output.size() < keystream.size()) {
+    ASSERT_OK_AND_ASSIGN(byte, prng->Rand8());
+    output.push_back(byte);
+  }
+  EXPECT_EQ(output, keystream);
+}
+
+TEST(AesCtrPrngTest, FillUint32MatchesRand64) {
+  ASSERT_OK_AND_ASSIGN(std::string seed, AesCtrPrng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(auto prng0, AesCtrPrng::Create(seed));
+  ASSERT_OK_AND_ASSIGN(auto prng1, AesCtrPrng::Create(seed));
+  std::vector<uint32_t> values(1000);
+  prng0->FillUint32(absl::MakeSpan(values));
+  for (int i = 0; i < values.size(); i += 2) {
+    ASSERT_OK_AND_ASSIGN(uint64_t sample, prng1->Rand64());
+    EXPECT_EQ(values[i], static_cast<uint32_t>(sample));
+    EXPECT_EQ(values[i + 1], static_cast<uint32_t>(sample >> 32));
+  }
+}
+
+TEST(AesCtrPrngTest, SeekMatchesSequentialKeystream) {
+  ASSERT_OK_AND_ASSIGN(std::string seed, AesCtrPrng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(auto prng, AesCtrPrng::Create(seed));
+  std::vector<uint8_t> keystream(3000);
+  prng->Fill(absl::MakeSpan(keystream));
+
+  // Seek both forward and backward, to block boundaries and inside blocks.
+  for (int offset : {0, 2999, 16, 1024, 37, 1, 2048}) {
+    prng->Seek(offset);
+    std::vector<uint8_t> chunk(keystream.size() - offset);
+    prng->Fill(absl::MakeSpan(chunk));
+    EXPECT_TRUE(std::equal(chunk.begin(), chunk.end(),
+                           keystream.begin() + offset))
+        << "offset " << offset;
+  }
+}
+
+}  // namespace
+}  // namespace lwe
+}  // namespace hintless_pir
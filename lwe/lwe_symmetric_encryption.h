@@ -16,17 +16,29 @@
 #ifndef HINTLESS_PIR_LWE_SYMMETRIC_ENCRYPTION_H_
 #define HINTLESS_PIR_LWE_SYMMETRIC_ENCRYPTION_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "Eigen/Core"
+#include "absl/numeric/int128.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "lwe/aes_ctr_prng.h"
 #include "lwe/encode.h"
+#include "lwe/prng_type.h"
 #include "lwe/sample_error.h"
 #include "lwe/types.h"
 #include "shell_encryption/prng/prng.h"
+#include "shell_encryption/prng/single_thread_chacha_prng.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/serialization.pb.h"
 #include "shell_encryption/status_macros.h"
 
 namespace hintless_pir {
@@ -46,6 +58,164 @@ static absl::StatusOr<Matrix> ExpandPad(int num_rows, int num_cols,
   return SampleUniformMatrix(num_rows, num_cols, encryption_prng);
 }
 
+// Generates the pad of `ExpandPadFromSeed()` a range of consecutive rows at a
+// time, so that consumers such as the hint computation do not need to hold the
+// whole pad in memory.
+class PadRowStream {
+ public:
+  // Returns a stream of the rows of the `num_cols`-column pad expanded from
+  // `prng_seed`, starting at row `first_row`. Starting after the first row
+  // requires a seekable `prng_type`, see `IsSeekablePrngType()`.
+  static absl::StatusOr<PadRowStream> Create(absl::string_view prng_seed,
+                                             rlwe::PrngType prng_type,
+                                             int num_cols,
+                                             int64_t first_row = 0) {
+    if (num_cols < 1) {
+      return absl::InvalidArgumentError("The number of cols must be positive.");
+    } else if (num_cols % 2 != 0) {
+      // Same as `SampleUniformVectorInPlace()`.
+      return absl::InvalidArgumentError(
+          absl::StrCat("The number of cols, ", num_cols, ", must be even."));
+    } else if (first_row < 0) {
+      return absl::InvalidArgumentError("`first_row` must be non-negative.");
+    } else if (first_row > 0 && !IsSeekablePrngType(prng_type)) {
+      return absl::InvalidArgumentError(
+          "`prng_type` must be seekable to start after the first row.");
+    }
+    if (prng_type == kPrngTypeAesCtr) {
+      RLWE_ASSIGN_OR_RETURN(std::unique_ptr<AesCtrPrng> prng,
+                            AesCtrPrng::Create(prng_seed));
+      prng->Seek(absl::uint128(first_row) * num_cols * sizeof(Integer));
+      AesCtrPrng* aes_ctr_prng = prng.get();
+      return PadRowStream(num_cols, std::move(prng), aes_ctr_prng);
+    }
+    RLWE_ASSIGN_OR_RETURN(std::unique_ptr<rlwe::SecurePrng> prng,
+                          CreatePrng(prng_type, prng_seed));
+    return PadRowStream(num_cols, std::move(prng), /*aes_ctr_prng=*/nullptr);
+  }
+
+  // Writes the next `rows.rows()` rows of the pad to `rows`.
+  absl::Status Next(Eigen::Ref<Matrix> rows) {
+    if (rows.cols() != num_cols_) {
+      return absl::InvalidArgumentError("`rows` has incorrect number of cols.");
+    }
+    if (aes_ctr_prng_ == nullptr) {
+      for (int64_t i = 0; i < rows.rows(); ++i) {
+        RLWE_RETURN_IF_ERROR(SampleUniformVectorInPlace(buffer_, prng_.get()));
+        rows.row(i) = buffer_.transpose();
+      }
+      return absl::OkStatus();
+    }
+    // Consecutive rows of the pad are a contiguous range of the AES-CTR
+    // keystream in row-major order, so they are written a tile at a time.
+    for (int64_t i = 0; i < rows.rows(); i += kTileRows) {
+      int64_t num_rows = std::min<int64_t>(kTileRows, rows.rows() - i);
+      aes_ctr_prng_->FillUint32(
+          absl::MakeSpan(tile_.data(), num_rows * num_cols_));
+      rows.middleRows(i, num_rows) = tile_.topRows(num_rows);
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  static constexpr int kTileRows = 64;
+  using RowMajorMatrix =
+      Eigen::Matrix<Integer, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  PadRowStream(int num_cols, std::unique_ptr<rlwe::SecurePrng> prng,
+               AesCtrPrng* aes_ctr_prng)
+      : num_cols_(num_cols),
+        prng_(std::move(prng)),
+        aes_ctr_prng_(aes_ctr_prng) {
+    if (aes_ctr_prng_ == nullptr) {
+      buffer_.resize(num_cols_);
+    } else {
+      tile_.resize(kTileRows, num_cols_);
+    }
+  }
+
+  int num_cols_;
+  std::unique_ptr<rlwe::SecurePrng> prng_;
+  // `prng_` if it is an `AesCtrPrng`, which fills tiles of rows in bulk.
+  AesCtrPrng* aes_ctr_prng_;
+
+  // Buffer holding one row, or a tile of rows of an AES-CTR pad.
+  Vector buffer_;
+  RowMajorMatrix tile_;
+};
+
+// Fills rows [`row_begin`, `row_end`) of `pad` with the values that
+// `ExpandPadFromSeed()` puts there, without generating the rows before them.
+// Requires a seekable `prng_type`, see `IsSeekablePrngType()`.
+static absl::Status ExpandPadRowsInPlace(absl::string_view prng_seed,
+                                         rlwe::PrngType prng_type,
+                                         int row_begin, int row_end,
+                                         Matrix& pad) {
+  if (!IsSeekablePrngType(prng_type)) {
+    return absl::InvalidArgumentError("`prng_type` must be seekable.");
+  } else if (row_begin < 0 || row_end > pad.rows() || row_begin > row_end) {
+    return absl::InvalidArgumentError("Invalid range of rows.");
+  }
+  RLWE_ASSIGN_OR_RETURN(
+      PadRowStream stream,
+      PadRowStream::Create(prng_seed, prng_type, pad.cols(), row_begin));
+  return stream.Next(pad.middleRows(row_begin, row_end - row_begin));
+}
+
+// Expands the pad from `prng_seed` with a PRNG of type `prng_type`, calling the
+// PRNG without virtual dispatch. If `prng_type` is seekable, the rows are split
+// into `num_threads` ranges generated in parallel; the pad does not depend on
+// `num_threads`.
+static absl::StatusOr<Matrix> ExpandPadFromSeed(int num_rows, int num_cols,
+                                                absl::string_view prng_seed,
+                                                rlwe::PrngType prng_type,
+                                                int num_threads = 1) {
+  if (prng_type == rlwe::PRNG_TYPE_HKDF) {
+    RLWE_ASSIGN_OR_RETURN(auto prng,
+                          rlwe::SingleThreadHkdfPrng::Create(prng_seed));
+    return ExpandPad(num_rows, num_cols, prng.get());
+  } else if (prng_type == rlwe::PRNG_TYPE_CHACHA) {
+    RLWE_ASSIGN_OR_RETURN(auto prng,
+                          rlwe::SingleThreadChaChaPrng::Create(prng_seed));
+    return ExpandPad(num_rows, num_cols, prng.get());
+  } else if (prng_type != kPrngTypeAesCtr) {
+    return absl::InvalidArgumentError("Invalid `prng_type`.");
+  }
+
+  if (num_rows < 1) {
+    return absl::InvalidArgumentError("The number of rows must be positive.");
+  } else if (num_cols < 1) {
+    return absl::InvalidArgumentError("The number of cols must be positive.");
+  } else if (num_threads < 1) {
+    return absl::InvalidArgumentError("`num_threads` must be positive.");
+  }
+  Matrix pad(num_rows, num_cols);
+  num_threads = std::min(num_threads, num_rows);
+  if (num_threads == 1) {
+    RLWE_RETURN_IF_ERROR(
+        ExpandPadRowsInPlace(prng_seed, prng_type, 0, num_rows, pad));
+    return pad;
+  }
+  int rows_per_thread = (num_rows + num_threads - 1) / num_threads;
+  std::vector<absl::Status> statuses(num_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    int row_begin = std::min(num_rows, t * rows_per_thread);
+    int row_end = std::min(num_rows, row_begin + rows_per_thread);
+    threads.emplace_back([&, t, row_begin, row_end]() {
+      statuses[t] =
+          ExpandPadRowsInPlace(prng_seed, prng_type, row_begin, row_end, pad);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const absl::Status& status : statuses) {
+    RLWE_RETURN_IF_ERROR(status);
+  }
+  return pad;
+}
+
 // This file implements the somewhat homomorphic symmetric-key encryption scheme
 // used in SimplePIR
 // https://eprint.iacr.org/2022/949
@@ -128,7 +298,8 @@ class SymmetricLweKey {
     if (prng == nullptr) {
       return absl::InvalidArgumentError("The prng must not be null.");
     }
-    RLWE_ASSIGN_OR_RETURN(Vector key, SampleUniformTernary(num_coeffs, prng));
+    RLWE_ASSIGN_OR_RETURN(Vector key,
+                          SampleUniformTernaryBulk(num_coeffs, prng));
     return SymmetricLweKey(std::move(key));
   }
 
@@ -157,12 +328,62 @@ class SymmetricLweKey {
     // Encodes the vector
     RLWE_RETURN_IF_ERROR(EncodeMessageInPlace(plaintext, log_scaling_factor));
     // Samples the Centered binomial and adds it to the (encoded) plaintext
-    RLWE_RETURN_IF_ERROR(SampleAndAddCenteredBinomialInPlace(plaintext, prng));
+    RLWE_RETURN_IF_ERROR(
+        SampleAndAddCenteredBinomialInPlaceBulk(plaintext, prng));
     // Adds pad * s to the encoded vector \Delta * m + e
     plaintext += pad * key_;
     return absl::OkStatus();
   }
 
+  // Encrypts column i of `plaintexts` under `keys[i]` for all i, in place.
+  // This yields the same ciphertexts as calling `EncryptFromPadInPlace()` on
+  // each column in turn with the same PRNG, but all the products pad * s_i are
+  // computed in the single matrix product pad * [s_1 ... s_k], and the errors
+  // of all columns are sampled at once.
+  template <typename Prng = rlwe::SingleThreadHkdfPrng>
+  static absl::Status EncryptFromPadBatchInPlace(
+      absl::Span<const SymmetricLweKey> keys, Matrix& plaintexts,
+      const Matrix& pad, const int log_scaling_factor, Prng* prng) {
+    if (prng == nullptr) {
+      return absl::InvalidArgumentError("The prng must not be null");
+    } else if (log_scaling_factor < 0 || log_scaling_factor > kIntBitwidth) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("The log scaling factor, ", log_scaling_factor,
+                       ", should be >= 0 and <= ", kIntBitwidth));
+    } else if (plaintexts.cols() != keys.size()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The number of plaintexts, ", plaintexts.cols(),
+          ", does not match the number of keys, ", keys.size()));
+    } else if (plaintexts.rows() != pad.rows()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The plaintext size, ", plaintexts.rows(),
+          ", does not match the number of rows of the pad, ", pad.rows()));
+    } else if (plaintexts.rows() % 2 != 0) {
+      // The error of each column is sampled as in `EncryptFromPadInPlace()`.
+      return absl::InvalidArgumentError(absl::StrCat(
+          "The plaintext size, ", plaintexts.rows(), ", must be even."));
+    }
+    Matrix key_matrix(pad.cols(), keys.size());
+    for (int i = 0; i < keys.size(); ++i) {
+      if (keys[i].Len() != pad.cols()) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "The key length, ", keys[i].Len(),
+            ", does not match the number of cols of the pad, ", pad.cols()));
+      }
+      key_matrix.col(i) = keys[i].key_;
+    }
+    // Encodes the plaintexts, as in `EncodeMessageInPlace()`.
+    plaintexts *= (1 << log_scaling_factor);
+    // Samples the errors of all plaintexts, column after column.
+    Vector errors = Vector::Zero(plaintexts.size());
+    RLWE_RETURN_IF_ERROR(SampleAndAddCenteredBinomialInPlaceBulk(errors, prng));
+    plaintexts += Eigen::Map<const Matrix>(errors.data(), plaintexts.rows(),
+                                           plaintexts.cols());
+    // Adds pad * [s_1 ... s_k] to the encoded plaintexts.
+    plaintexts += pad * key_matrix;
+    return absl::OkStatus();
+  }
+
   // Encrypts the plaintext using learning-with-errors (LWE) encryption.
   // Takes the matrix `pad` as input, and returns the ciphertext.
   // Defers validating inputs to EncryptFromPadInPlace.
@@ -14,6 +14,7 @@
 
 #include "lwe/lwe_symmetric_encryption.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -22,9 +23,13 @@
 #include "absl/status/status.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "lwe/aes_ctr_prng.h"
 #include "lwe/encode.h"
+#include "lwe/prng_type.h"
 #include "lwe/types.h"
+#include "shell_encryption/prng/prng.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/serialization.pb.h"
 #include "shell_encryption/testing/status_matchers.h"
 #include "shell_encryption/testing/status_testing.h"
 
@@ -71,6 +76,83 @@ TEST_F(SymmetricLweEncryptionTest, ExpansionTest) {
   EXPECT_EQ(pad.cols(), num_cols_);
 }
 
+// Tests that the bulk expansion of an AES-CTR pad yields the same pad as
+// expanding it through the `SecurePrng` interface.
+TEST_F(SymmetricLweEncryptionTest, ExpandPadFromAesCtrSeed) {
+  ASSERT_OK_AND_ASSIGN(std::string seed, AesCtrPrng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(
+      Matrix pad,
+      ExpandPadFromSeed(num_rows_, num_cols_, seed, kPrngTypeAesCtr));
+  ASSERT_OK_AND_ASSIGN(std::unique_ptr<rlwe::SecurePrng> prng,
+                       CreatePrng(kPrngTypeAesCtr, seed));
+  ASSERT_OK_AND_ASSIGN(Matrix expected,
+                       ExpandPad(num_rows_, num_cols_, prng.get()));
+  EXPECT_EQ(pad, expected);
+}
+
+// Tests that any range of rows of an AES-CTR pad can be expanded on its own,
+// and that the parallel expansion yields the sequential pad.
+TEST_F(SymmetricLweEncryptionTest, ExpandPadRowsInPlace) {
+  ASSERT_OK_AND_ASSIGN(std::string seed, AesCtrPrng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(
+      Matrix expected,
+      ExpandPadFromSeed(num_rows_, num_cols_, seed, kPrngTypeAesCtr));
+
+  Matrix pad = Matrix::Zero(num_rows_, num_cols_);
+  int row_begin = num_rows_ / 3, row_end = num_rows_ - 1;
+  ASSERT_OK(ExpandPadRowsInPlace(seed, kPrngTypeAesCtr, row_begin, row_end,
+                                 pad));
+  EXPECT_EQ(pad.middleRows(row_begin, row_end - row_begin),
+            expected.middleRows(row_begin, row_end - row_begin));
+  EXPECT_TRUE(pad.topRows(row_begin).isZero());
+  EXPECT_TRUE(pad.bottomRows(num_rows_ - row_end).isZero());
+
+  for (int num_threads : {2, 3, num_rows_ + 1}) {
+    ASSERT_OK_AND_ASSIGN(Matrix parallel_pad,
+                         ExpandPadFromSeed(num_rows_, num_cols_, seed,
+                                           kPrngTypeAesCtr, num_threads));
+    EXPECT_EQ(parallel_pad, expected);
+  }
+}
+
+TEST_F(SymmetricLweEncryptionTest, ExpandPadRowsInPlaceFailsIfNotSeekable) {
+  Matrix pad = Matrix::Zero(num_rows_, num_cols_);
+  EXPECT_THAT(ExpandPadRowsInPlace("seed", rlwe::PRNG_TYPE_HKDF, 0, num_rows_,
+                                   pad),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+// Tests that streaming the rows of a pad in chunks yields the expanded pad.
+TEST_F(SymmetricLweEncryptionTest, PadRowStream) {
+  for (rlwe::PrngType prng_type :
+       {rlwe::PRNG_TYPE_HKDF, rlwe::PRNG_TYPE_CHACHA, kPrngTypeAesCtr}) {
+    ASSERT_OK_AND_ASSIGN(std::string seed, GeneratePrngSeed(prng_type));
+    ASSERT_OK_AND_ASSIGN(
+        Matrix expected,
+        ExpandPadFromSeed(num_rows_, num_cols_, seed, prng_type));
+    ASSERT_OK_AND_ASSIGN(PadRowStream stream,
+                         PadRowStream::Create(seed, prng_type, num_cols_));
+    Matrix pad = Matrix::Zero(num_rows_, num_cols_);
+    for (int i = 0, num_rows = 1; i < num_rows_; i += num_rows, ++num_rows) {
+      num_rows = std::min(num_rows, num_rows_ - i);
+      ASSERT_OK(stream.Next(pad.middleRows(i, num_rows)));
+    }
+    EXPECT_EQ(pad, expected);
+  }
+}
+
+TEST_F(SymmetricLweEncryptionTest, PadRowStreamFailsToSeekIfNotSeekable) {
+  EXPECT_THAT(PadRowStream::Create("seed", rlwe::PRNG_TYPE_HKDF, num_cols_,
+                                   /*first_row=*/1),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST_F(SymmetricLweEncryptionTest, ExpandPadFromSeedFailsIfInvalidPrngType) {
+  EXPECT_THAT(ExpandPadFromSeed(num_rows_, num_cols_, "seed",
+                                rlwe::PRNG_TYPE_INVALID),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
 // Tests that Encoding + adding noise + Decoding gets the plaintext back
 TEST_F(SymmetricLweEncryptionTest, ErrorCorrectionTest) {
   Vector actual_ptxt = Vector::Zero(num_rows_);
@@ -115,6 +197,57 @@ TEST_F(SymmetricLweEncryptionTest, EncryptThenDecryptTest) {
   }
 }
 
+// Tests that batched encryption yields the ciphertexts of one encryption per
+// plaintext, and that they decrypt under their own keys.
+TEST_F(SymmetricLweEncryptionTest, EncryptFromPadBatchInPlace) {
+  constexpr int kNumPlaintexts = 5;
+  ASSERT_OK_AND_ASSIGN(Matrix pad,
+                       ExpandPad(num_rows_, num_cols_, prng_.get()));
+  std::vector<SymmetricLweKey> keys;
+  Matrix plaintexts(num_rows_, kNumPlaintexts);
+  for (int j = 0; j < kNumPlaintexts; ++j) {
+    ASSERT_OK_AND_ASSIGN(SymmetricLweKey key,
+                         SymmetricLweKey::Sample(num_cols_, prng_.get()));
+    keys.push_back(std::move(key));
+    for (int i = 0; i < num_rows_; ++i) {
+      plaintexts(i, j) = (i + j) % 16;
+    }
+  }
+
+  ASSERT_OK_AND_ASSIGN(std::string seed, Prng::GenerateSeed());
+  ASSERT_OK_AND_ASSIGN(auto batch_prng, Prng::Create(seed));
+  Matrix ciphertexts = plaintexts;
+  ASSERT_OK(SymmetricLweKey::EncryptFromPadBatchInPlace(
+      absl::MakeConstSpan(keys), ciphertexts, pad, log_scaling_factor_,
+      batch_prng.get()));
+
+  ASSERT_OK_AND_ASSIGN(auto prng, Prng::Create(seed));
+  for (int j = 0; j < kNumPlaintexts; ++j) {
+    Vector b = plaintexts.col(j);
+    ASSERT_OK(keys[j].EncryptFromPadInPlace(b, pad, log_scaling_factor_,
+                                            prng.get()));
+    EXPECT_EQ(ciphertexts.col(j), b);
+    ASSERT_OK_AND_ASSIGN(
+        Vector decrypted,
+        keys[j].Decrypt(SymmetricLweCiphertext(pad, b, log_scaling_factor_)));
+    EXPECT_EQ(decrypted, plaintexts.col(j));
+  }
+}
+
+TEST_F(SymmetricLweEncryptionTest, EncryptFromPadBatchFailsIfKeysMismatch) {
+  ASSERT_OK_AND_ASSIGN(Matrix pad,
+                       ExpandPad(num_rows_, num_cols_, prng_.get()));
+  ASSERT_OK_AND_ASSIGN(SymmetricLweKey key,
+                       SymmetricLweKey::Sample(num_cols_, prng_.get()));
+  std::vector<SymmetricLweKey> keys = {key};
+  Matrix plaintexts = Matrix::Zero(num_rows_, 2);
+  EXPECT_THAT(SymmetricLweKey::EncryptFromPadBatchInPlace(
+                  absl::MakeConstSpan(keys), plaintexts, pad,
+                  log_scaling_factor_, prng_.get()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("does not match the number of keys")));
+}
+
 // Tests that Linear transformations work.
 // We test it in the boring way of letting T be a row-vector that
 // is the ith basis vector.
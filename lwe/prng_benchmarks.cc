@@ -0,0 +1,164 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/status/status.h"
+#include "benchmark/benchmark.h"
+#include "benchmarks/perf_counters.h"
+#include "gtest/gtest.h"
+#include "lwe/aes_ctr_prng.h"
+#include "lwe/lwe_symmetric_encryption.h"
+#include "lwe/prng_type.h"
+#include "lwe/sample_error.h"
+#include "lwe/types.h"
+#include "shell_encryption/prng/prng.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/serialization.pb.h"
+
+ABSL_FLAG(int, num_rows, 1024, "Number of rows of the expanded pad");
+ABSL_FLAG(int, num_cols, 1024, "Number of cols of the expanded pad");
+
+namespace hintless_pir {
+namespace lwe {
+namespace {
+
+// Expands a `num_rows` x `num_cols` pad from a fresh seed of the PRNG type
+// given by the benchmark argument.
+void BM_ExpandPadFromSeed(benchmark::State& state) {
+  auto prng_type = static_cast<rlwe::PrngType>(state.range(0));
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_cols = absl::GetFlag(FLAGS_num_cols);
+  std::string seed = GeneratePrngSeed(prng_type).value();
+
+  benchmarks::ScopedPerfCounters perf_counters(state);
+  for (auto _ : state) {
+    auto pad = ExpandPadFromSeed(num_rows, num_cols, seed, prng_type);
+    ASSERT_TRUE(pad.ok());
+    benchmark::DoNotOptimize(pad);
+  }
+  state.SetBytesProcessed(state.iterations() * num_rows * num_cols *
+                          sizeof(Integer));
+}
+BENCHMARK(BM_ExpandPadFromSeed)
+    ->ArgName("prng_type")
+    ->Arg(rlwe::PRNG_TYPE_HKDF)
+    ->Arg(rlwe::PRNG_TYPE_CHACHA)
+    ->Arg(kPrngTypeAesCtr);
+
+// Expands an AES-CTR pad with the number of threads given by the benchmark
+// argument.
+void BM_ExpandPadFromSeedParallel(benchmark::State& state) {
+  int num_threads = state.range(0);
+  int num_rows = absl::GetFlag(FLAGS_num_rows);
+  int num_cols = absl::GetFlag(FLAGS_num_cols);
+  std::string seed = AesCtrPrng::GenerateSeed().value();
+
+  for (auto _ : state) {
+    auto pad = ExpandPadFromSeed(num_rows, num_cols, seed, kPrngTypeAesCtr,
+                                 num_threads);
+    ASSERT_TRUE(pad.ok());
+    benchmark::DoNotOptimize(pad);
+  }
+  state.SetBytesProcessed(state.iterations() * num_rows * num_cols *
+                          sizeof(Integer));
+}
+BENCHMARK(BM_ExpandPadFromSeedParallel)
+    ->ArgName("num_threads")
+    ->RangeMultiplier(2)
+    ->Range(1, 16)
+    ->UseRealTime();
+
+// Draws 64-bit samples one at a time through the `SecurePrng` interface, as
+// SHELL does when expanding the LinPIR pads.
+void BM_Rand64(benchmark::State& state) {
+  auto prng_type = static_cast<rlwe::PrngType>(state.range(0));
+  std::string seed = GeneratePrngSeed(prng_type).value();
+  std::unique_ptr<rlwe::SecurePrng> prng =
+      CreatePrng(prng_type, seed).value();
+
+  for (auto _ : state) {
+    auto sample = prng->Rand64();
+    benchmark::DoNotOptimize(sample);
+  }
+  state.SetBytesProcessed(state.iterations() * sizeof(uint64_t));
+}
+BENCHMARK(BM_Rand64)
+    ->ArgName("prng_type")
+    ->Arg(rlwe::PRNG_TYPE_HKDF)
+    ->Arg(rlwe::PRNG_TYPE_CHACHA)
+    ->Arg(kPrngTypeAesCtr);
+
+// Samples the centered binomial error of `num_cols` coefficients, with the
+// scalar sampler if the benchmark argument is 0 and the bulk one otherwise.
+void BM_SampleCenteredBinomial(benchmark::State& state) {
+  bool bulk = state.range(0) != 0;
+  int num_coeffs = absl::GetFlag(FLAGS_num_cols);
+  std::string seed = rlwe::SingleThreadHkdfPrng::GenerateSeed().value();
+  auto prng = rlwe::SingleThreadHkdfPrng::Create(seed).value();
+
+  Vector error = Vector::Zero(num_coeffs);
+  for (auto _ : state) {
+    absl::Status status =
+        bulk ? SampleAndAddCenteredBinomialInPlaceBulk(error, prng.get())
+             : SampleAndAddCenteredBinomialInPlace(error, prng.get());
+    ASSERT_TRUE(status.ok());
+    benchmark::DoNotOptimize(error);
+  }
+}
+BENCHMARK(BM_SampleCenteredBinomial)->ArgName("bulk")->Arg(0)->Arg(1);
+
+// Samples a ternary secret of `num_cols` coefficients, with the scalar sampler
+// if the benchmark argument is 0 and the bulk one otherwise.
+void BM_SampleUniformTernary(benchmark::State& state) {
+  bool bulk = state.range(0) != 0;
+  int num_coeffs = absl::GetFlag(FLAGS_num_cols);
+  std::string seed = rlwe::SingleThreadHkdfPrng::GenerateSeed().value();
+  auto prng = rlwe::SingleThreadHkdfPrng::Create(seed).value();
+
+  for (auto _ : state) {
+    auto secret = bulk ? SampleUniformTernaryBulk(num_coeffs, prng.get())
+                       : SampleUniformTernary(num_coeffs, prng.get());
+    ASSERT_TRUE(secret.ok());
+    benchmark::DoNotOptimize(secret);
+  }
+}
+BENCHMARK(BM_SampleUniformTernary)->ArgName("bulk")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace lwe
+}  // namespace hintless_pir
+
+// Declare benchmark_filter flag, which will be defined by benchmark library.
+// Use it to check if any benchmarks were specified explicitly.
+//
+namespace benchmark {
+extern std::string FLAGS_benchmark_filter;
+}
+using benchmark::FLAGS_benchmark_filter;
+
+int main(int argc, char* argv[]) {
+  FLAGS_benchmark_filter = "";
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  if (!FLAGS_benchmark_filter.empty()) {
+    benchmark::RunSpecifiedBenchmarks();
+  }
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2024 Google LLC.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HINTLESS_PIR_LWE_PRNG_TYPE_H_
+#define HINTLESS_PIR_LWE_PRNG_TYPE_H_
+
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "lwe/aes_ctr_prng.h"
+#include "shell_encryption/prng/prng.h"
+#include "shell_encryption/prng/single_thread_chacha_prng.h"
+#include "shell_encryption/prng/single_thread_hkdf_prng.h"
+#include "shell_encryption/serialization.pb.h"
+
+namespace hintless_pir {
+namespace lwe {
+
+// The `prng_type` selecting `AesCtrPrng`. `rlwe::PrngType` is defined by SHELL
+// and has no AES-CTR entry; this is the unused value in the range of its
+// enumerators.
+inline constexpr rlwe::PrngType kPrngTypeAesCtr =
+    static_cast<rlwe::PrngType>(3);
+
+// Returns whether `prng_type` is HKDF, ChaCha or AES-CTR.
+inline bool IsSupportedPrngType(rlwe::PrngType prng_type) {
+  return prng_type == rlwe::PRNG_TYPE_HKDF ||
+         prng_type == rlwe::PRNG_TYPE_CHACHA || prng_type == kPrngTypeAesCtr;
+}
+
+// Returns the `prng_type` selecting the PRNG class `Prng`, or
+// `rlwe::PRNG_TYPE_INVALID` if it is not one of the supported PRNGs.
+template <typename Prng>
+constexpr rlwe::PrngType PrngTypeOf() {
+  if constexpr (std::is_same_v<Prng, rlwe::SingleThreadHkdfPrng>) {
+    return rlwe::PRNG_TYPE_HKDF;
+  } else if constexpr (std::is_same_v<Prng, rlwe::SingleThreadChaChaPrng>) {
+    return rlwe::PRNG_TYPE_CHACHA;
+  } else if constexpr (std::is_same_v<Prng, AesCtrPrng>) {
+    return kPrngTypeAesCtr;
+  } else {
+    return rlwe::PRNG_TYPE_INVALID;
+  }
+}
+
+// Returns whether the stream of a PRNG of type `prng_type` can be generated
+// from any offset, as required by `ExpandPadRowsInPlace()`.
+inline bool IsSeekablePrngType(rlwe::PrngType prng_type) {
+  return prng_type == kPrngTypeAesCtr;
+}
+
+// Returns the PRNG type to pass to SHELL for pads that SHELL expands itself,
+// such as the Galois key pads. SHELL does not know AES-CTR, so those fall back
+// to HKDF; their seeds must then come from `GeneratePrngSeed(ShellPrngType())`.
+inline rlwe::PrngType ShellPrngType(rlwe::PrngType prng_type) {
+  return prng_type == kPrngTypeAesCtr ? rlwe::PRNG_TYPE_HKDF : prng_type;
+}
+
+// Returns a fresh seed for a PRNG of type `prng_type`.
+inline absl::StatusOr<std::string> GeneratePrngSeed(rlwe::PrngType prng_type) {
+  if (prng_type == rlwe::PRNG_TYPE_HKDF) {
+    return rlwe::SingleThreadHkdfPrng::GenerateSeed();
+  } else if (prng_type == rlwe::PRNG_TYPE_CHACHA) {
+    return rlwe::SingleThreadChaChaPrng::GenerateSeed();
+  } else if (prng_type == kPrngTypeAesCtr) {
+    return AesCtrPrng::GenerateSeed();
+  }
+  return absl::InvalidArgumentError("Invalid `prng_type`.");
+}
+
+// Returns a PRNG of type `prng_type` seeded with `seed`.
+inline absl::StatusOr<std::unique_ptr<rlwe::SecurePrng>> CreatePrng(
+    rlwe::PrngType prng_type, absl::string_view seed) {
+  if (prng_type == rlwe::PRNG_TYPE_HKDF) {
+    return rlwe::SingleThreadHkdfPrng::Create(seed);
+  } else if (prng_type == rlwe::PRNG_TYPE_CHACHA) {
+    return rlwe::SingleThreadChaChaPrng::Create(seed);
+  } else if (prng_type == kPrngTypeAesCtr) {
+    return AesCtrPrng::Create(seed);
+  }
+  return absl::InvalidArgumentError("Invalid `prng_type`.");
+}
+
+}  // namespace lwe
+}  // namespace hintless_pir
+
+#endif  // HINTLESS_PIR_LWE_PRNG_TYPE_H_
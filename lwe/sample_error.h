@@ -17,7 +17,10 @@
 #define HINTLESS_PIR_LWE_SAMPLE_ERROR_H_
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "Eigen/Core"
@@ -25,6 +28,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "lwe/types.h"
 #include "shell_encryption/bits_util.h"
 #include "shell_encryption/prng/single_thread_hkdf_prng.h"
@@ -33,6 +37,53 @@
 namespace hintless_pir {
 namespace lwe {
 
+namespace internal {
+
+// Whether `Prng` writes its output in bulk via `FillUint32()`, like
+// `AesCtrPrng`, with the same values as splitting its `Rand64()` outputs.
+template <typename Prng, typename = void>
+inline constexpr bool kHasFillUint32 = false;
+
+template <typename Prng>
+inline constexpr bool kHasFillUint32<
+    Prng, std::void_t<decltype(std::declval<Prng&>().FillUint32(
+              std::declval<absl::Span<Integer>>()))>> = true;
+
+// Fills `out` with uniformly random 32-bit words: in bulk if `Prng` supports
+// it, and otherwise by splitting the results of `Rand64()` into their low and
+// high halves. Both ways yield the same values for the same PRNG stream.
+template <typename Prng>
+absl::Status FillUniformWords(absl::Span<Integer> out, Prng* prng) {
+  if constexpr (kHasFillUint32<Prng>) {
+    prng->FillUint32(out);
+    return absl::OkStatus();
+  }
+  size_t i = 0;
+  for (; i + 1 < out.size(); i += 2) {
+    RLWE_ASSIGN_OR_RETURN(uint64_t sample, prng->Rand64());
+    out[i] = static_cast<Integer>(sample);
+    out[i + 1] = static_cast<Integer>(sample >> 32);
+  }
+  if (i < out.size()) {
+    RLWE_ASSIGN_OR_RETURN(uint64_t sample, prng->Rand64());
+    out[i] = static_cast<Integer>(sample);
+  }
+  return absl::OkStatus();
+}
+
+// Returns the number of ones in the low 16 bits of `x` minus that in the high
+// 16 bits, modulo 2^32. Branch-free SWAR code, so that loops calling it are
+// vectorized by the compiler.
+inline Integer PopcountDifference16(Integer x) {
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  x = (x + (x >> 4)) & 0x0f0f0f0f;
+  x = (x + (x >> 8)) & 0x00ff00ff;
+  return (x & 0xffff) - (x >> 16);
+}
+
+}  // namespace internal
+
 // Takes as input a uint32_t buffer, and adds an i.i.d. Centered Binomial
 // (of Variance 8) to each coordinate of the buffer.
 //
@@ -68,6 +119,31 @@ static absl::Status SampleAndAddCenteredBinomialInPlace(Vector& buffer,
   return absl::OkStatus();
 }
 
+// Same as `SampleAndAddCenteredBinomialInPlace()`, and with the same output for
+// the same PRNG stream, but drawing the randomness of all coefficients at once
+// and sampling them in a branch-free loop that the compiler vectorizes.
+template <typename Prng = rlwe::SingleThreadHkdfPrng>
+static absl::Status SampleAndAddCenteredBinomialInPlaceBulk(Vector& buffer,
+                                                            Prng* prng) {
+  int num_coeffs = buffer.size();
+  if (num_coeffs % 2 != 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "The number of coefficients, ", num_coeffs, ", must be even."));
+  }
+  if (prng == nullptr) {
+    return absl::InvalidArgumentError("prng must not be null.");
+  }
+  // 16 coin flips B_i and 16 coin flips B_i' per coefficient.
+  std::vector<Integer> words(num_coeffs);
+  RLWE_RETURN_IF_ERROR(
+      internal::FillUniformWords(absl::MakeSpan(words), prng));
+  Integer* coeffs = buffer.data();
+  for (int i = 0; i < num_coeffs; ++i) {
+    coeffs[i] += internal::PopcountDifference16(words[i]);
+  }
+  return absl::OkStatus();
+}
+
 // Samples a centered binomial, allocating and returning the Vector it is
 // contained in.
 template <typename Prng = rlwe::SingleThreadHkdfPrng>
@@ -137,6 +213,64 @@ static absl::StatusOr<Vector> SampleUniformTernary(int num_coeffs, Prng* prng) {
   return map;
 }
 
+// Samples a vector of uniformly random ternary coefficients, like
+// `SampleUniformTernary()`, but with the rejection sampling bitsliced over 32
+// coefficients at a time and the random words drawn in bulk. The conversion of
+// the accepted bits to coefficients is branch-free.
+template <typename Prng = rlwe::SingleThreadHkdfPrng>
+static absl::StatusOr<Vector> SampleUniformTernaryBulk(int num_coeffs,
+                                                       Prng* prng) {
+  if (num_coeffs <= 0) {
+    return absl::InvalidArgumentError("`num_coeffs` must be positive.");
+  }
+  if (prng == nullptr) {
+    return absl::InvalidArgumentError("`prng` must not be null.");
+  }
+
+  // As in `SampleUniformTernary()`, each coefficient is encoded by a bit in
+  // each of two words: 0 as (0,0), 1 as (1,0), and -1 as (1,1); the invalid
+  // encoding (0,1) is re-sampled. Each group of 32 coefficients needs two
+  // words, plus two more per round of re-sampling, which are drawn in batches.
+  constexpr int kLanes = 32;
+  constexpr int kReserveWords = 64;
+  int num_groups = (num_coeffs + kLanes - 1) / kLanes;
+  std::vector<Integer> words(2 * num_groups);
+  RLWE_RETURN_IF_ERROR(
+      internal::FillUniformWords(absl::MakeSpan(words), prng));
+  std::vector<Integer> reserve(kReserveWords);
+  int reserve_pos = kReserveWords;
+
+  Vector output(num_coeffs);
+  for (int g = 0; g < num_groups; ++g) {
+    int num_filled_coeffs = std::min(kLanes, num_coeffs - g * kLanes);
+    Integer valid_bits = num_filled_coeffs < kLanes
+                             ? (Integer{1} << num_filled_coeffs) - 1
+                             : ~Integer{0};
+    Integer encoding_bits0 = words[2 * g] & valid_bits;
+    Integer encoding_bits1 = words[2 * g + 1] & valid_bits;
+    Integer missing_bits = ~encoding_bits0 & encoding_bits1;
+    while (missing_bits != 0) {
+      if (reserve_pos == kReserveWords) {
+        RLWE_RETURN_IF_ERROR(
+            internal::FillUniformWords(absl::MakeSpan(reserve), prng));
+        reserve_pos = 0;
+      }
+      encoding_bits0 ^= reserve[reserve_pos++] & missing_bits;
+      encoding_bits1 ^= reserve[reserve_pos++] & missing_bits;
+      missing_bits = ~encoding_bits0 & encoding_bits1;
+    }
+
+    // value = bit0 - 2 * (bit0 & bit1) (mod 2^32).
+    Integer* coeffs = output.data() + g * kLanes;
+    for (int i = 0; i < num_filled_coeffs; ++i) {
+      Integer bit0 = (encoding_bits0 >> i) & 1;
+      Integer bit1 = (encoding_bits1 >> i) & 1;
+      coeffs[i] = bit0 - ((bit0 & bit1) << 1);
+    }
+  }
+  return output;
+}
+
 // Samples a vector of uniforms without allocating
 template <typename Prng = rlwe::SingleThreadHkdfPrng>
 static absl::Status SampleUniformVectorInPlace(Vector& buffer, Prng* prng) {
@@ -148,13 +282,8 @@ static absl::Status SampleUniformVectorInPlace(Vector& buffer, Prng* prng) {
   if (prng == nullptr) {
     return absl::InvalidArgumentError("prng must not be null.");
   }
-  constexpr uint64_t low_mask = 0x00000000ffffffff;
-  for (int i = 0; i < num_coeffs; i += 2) {
-    RLWE_ASSIGN_OR_RETURN(uint64_t sample, prng->Rand64());
-    buffer[i] = (static_cast<Integer>(sample & low_mask));
-    buffer[i + 1] = (static_cast<Integer>(sample >> 32));
-  }
-  return absl::OkStatus();
+  return internal::FillUniformWords(absl::MakeSpan(buffer.data(), num_coeffs),
+                                   prng);
 }
 
 // Samples a vector of uniforms via allocating
@@ -182,11 +311,11 @@ static absl::StatusOr<Matrix> SampleUniformMatrix(int num_rows, int num_cols,
   if (prng == nullptr) {
     return absl::InvalidArgumentError("prng must not be null.");
   }
-  Matrix output = Matrix::Zero(num_rows, num_cols);
+  Matrix output(num_rows, num_cols);
+  Vector buffer(num_cols);
   for (int i = 0; i < num_rows; ++i) {
-    Vector buffer = Vector::Zero(num_cols);
     RLWE_RETURN_IF_ERROR(SampleUniformVectorInPlace(buffer, prng));
-    output.row(i) += buffer;
+    output.row(i) = buffer.transpose();
   }
   return output;
 }
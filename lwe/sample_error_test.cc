@@ -87,6 +87,63 @@ TEST(SampleErrorTest, CheckUniformTernary) {
   }
 }
 
+TEST(SampleErrorTest, BulkCenteredBinomialMatchesScalar) {
+  const std::vector<int> k_num_coeffs = {1200, 1024, 2};
+
+  auto prng = std::make_unique<TestingPrng>(0);
+  auto bulk_prng = std::make_unique<TestingPrng>(0);
+
+  for (int i = 0; i < kTestingRounds; ++i) {
+    for (auto num_coeffs : k_num_coeffs) {
+      Vector expected = Vector::Constant(num_coeffs, i);
+      Vector error = expected;
+      ASSERT_OK(SampleAndAddCenteredBinomialInPlace(expected, prng.get()));
+      ASSERT_OK(
+          SampleAndAddCenteredBinomialInPlaceBulk(error, bulk_prng.get()));
+      EXPECT_EQ(error, expected);
+    }
+  }
+}
+
+TEST(SampleErrorTest, CheckBulkUniformTernary) {
+  const std::vector<int> k_num_coeffs = {1200, 1024, 33, 1};
+  constexpr Integer plus = 1;
+  constexpr Integer minus = -plus;
+
+  auto prng = std::make_unique<TestingPrng>(0);
+
+  int num_plus = 0, num_minus = 0, num_zeros = 0;
+  for (int i = 0; i < kTestingRounds; ++i) {
+    for (auto num_coeffs : k_num_coeffs) {
+      ASSERT_OK_AND_ASSIGN(Vector error,
+                           SampleUniformTernaryBulk(num_coeffs, prng.get()));
+      ASSERT_EQ(error.size(), num_coeffs);
+      // Check that each coefficient is in {-1, 0, 1} mod 2^32.
+      for (int k = 0; k < num_coeffs; k++) {
+        if (error[k] == plus) {
+          ++num_plus;
+        } else if (error[k] == minus) {
+          ++num_minus;
+        } else {
+          EXPECT_EQ(error[k], 0);
+          ++num_zeros;
+        }
+      }
+    }
+  }
+  // Each value should appear about a third of the time.
+  int num_samples = num_plus + num_minus + num_zeros;
+  for (int count : {num_plus, num_minus, num_zeros}) {
+    EXPECT_NEAR(static_cast<double>(count) / num_samples, 1.0 / 3, 0.02);
+  }
+}
+
+TEST(SampleErrorTest, BulkUniformTernaryNullPrngTest) {
+  EXPECT_THAT(SampleUniformTernaryBulk(10, static_cast<TestingPrng*>(nullptr)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       testing::HasSubstr("null")));
+}
+
 TEST(SampleErrorTest, BinomialNegCoeffsTest) {
   auto prng = std::make_unique<TestingPrng>(0);
   auto status = SampleCenteredBinomial(-1, prng.get());